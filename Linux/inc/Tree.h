@@ -17,10 +17,18 @@
 #define __TREE_H__
 
 #include "RootNotErasableException.h"
+#include "TreeAllocatorTraits.h"
+#include "TreeCursor.h"
+#include "TreeRange.h"
 #include "TreeNode.h"
+#include "TreeObserver.h"
+#include <cstddef>
+#include <iterator>
 #include <map>
 #include <new>
-#include <stack>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 
 // *****************************************************************************
@@ -28,10 +36,33 @@
 // *****************************************************************************
 
 
-template <class T>
+template <class T, class Alloc>
 class TreeIterator;
 
 
+// *****************************************************************************
+//                                 ENUMERATIONS
+// *****************************************************************************
+
+
+/** Orders in which Tree::relayout() can place the nodes of a tree in memory. */
+enum TreeLayoutOrder {
+   /** Nodes are placed in the order a pre-order traversal visits them. */
+   TREE_PRE_ORDER_LAYOUT,
+
+   /** Nodes are placed level by level (breadth first). */
+   TREE_BREADTH_FIRST_LAYOUT,
+
+   /**
+    * Nodes are placed in van Emde Boas order: the top half of the tree (by
+    * height) goes first, followed by each of the subtrees hanging from it,
+    * recursively. It keeps every root to leaf path in few cache lines no
+    * matter the size of the cache.
+    */
+   TREE_VAN_EMDE_BOAS_LAYOUT
+};
+
+
 // *****************************************************************************
 // *****************************************************************************
 // *****************************************************************************
@@ -78,10 +109,22 @@ class TreeIterator;
  * them). Although this decision breaks a bit the rules of OOP, it makes the tree
  * structure behave more efficiently.
  *
+ * Every node (and every slot of the children lists) is allocated through 'Alloc',
+ * which lets the client place a tree in its own memory (arenas, pools, huge
+ * pages...). The allocator travels with the nodes: trees returned by prune()
+ * keep the allocator of the tree they were pruned from, and the graft methods
+ * only accept trees with the same allocator type. If the allocator instances
+ * of both trees don't compare equal, the grafted tree is copied instead of
+ * adopted.
+ *
+ * If the allocator releases its memory in bulk (see 'TreeAllocatorTraits' and
+ * 'TreeArenaAllocator'), destroying the tree doesn't deallocate any node and
+ * only the destructors of the payloads are run (if they have to be run at all).
+ *
  * @author Francisco Aisa García
  * @version 0.1
  */
-template <class T>
+template <class T, class Alloc>
 class Tree {
    public:
       // =======================================================================
@@ -91,6 +134,11 @@ class Tree {
 
       class PreOrderIterator;
       class PostOrderIterator;
+      class LeafIterator;
+      class ReversePreOrderIterator;
+      class ReversePostOrderIterator;
+      class AncestorIterator;
+      class EulerTourIterator;
 
 
       // =======================================================================
@@ -107,13 +155,26 @@ class Tree {
 
       //________________________________________________________________________
 
+      /**
+       * Custom constructor.
+       *
+       * It creates an empty tree that will allocate its nodes with the given
+       * allocator.
+       *
+       * @param alloc Allocator to be used by the tree.
+       */
+      inline explicit Tree(const Alloc& alloc);
+
+      //________________________________________________________________________
+
       /**
        * Custom constructor.
        * 
        * @param data Data to be assigned to the root node.
+       * @param alloc Allocator to be used by the tree.
        * @throws std::bad_alloc Thrown if memory allocation for the root node fails.
        */
-      Tree(const T& data) throw (std::bad_alloc);
+      Tree(const T& data, const Alloc& alloc = Alloc());
 
       //________________________________________________________________________
 
@@ -123,7 +184,7 @@ class Tree {
        * @param source Source tree.
        * @throws std::bad_alloc Thrown if memory allocation fails when copying.
        */
-      Tree(const Tree<T>& source) throw(std::bad_alloc);
+      Tree(const Tree<T, Alloc>& source);
 
       //________________________________________________________________________
 
@@ -143,7 +204,7 @@ class Tree {
        * @return A reference to 'this' tree.
        * @throws std::bad_alloc Thrown if memory allocation fails when copying.
        */
-      Tree<T>& operator=(const Tree<T>& rhs) throw(std::bad_alloc);
+      Tree<T, Alloc>& operator=(const Tree<T, Alloc>& rhs);
 
       //________________________________________________________________________
 
@@ -153,7 +214,7 @@ class Tree {
        * @param rhs Right hand side tree to be compared.
        * @return 'true' if both trees have the same nodes with the same values.
        */
-      bool operator==(const Tree<T>& rhs) const;
+      bool operator==(const Tree<T, Alloc>& rhs) const;
 
       //________________________________________________________________________
 
@@ -163,7 +224,7 @@ class Tree {
        * @param rhs Right hand side tree to be compared.
        * @return 'true' if the trees are different.
        */
-      inline bool operator!=(const Tree<T>& rhs) const;
+      inline bool operator!=(const Tree<T, Alloc>& rhs) const;
 
 
       // =======================================================================
@@ -225,6 +286,258 @@ class Tree {
        */
       inline PostOrderIterator postEnd() const;
 
+      //________________________________________________________________________
+
+      /**
+       * Retrieve a range to traverse a subtree in pre-order.
+       *
+       * The traversal starts at the given node and ends right after the last
+       * node of its subtree, so it costs O(size of the subtree) regardless of
+       * the size of the tree.
+       *
+       * @param subtreeRoot Iterator to the root of the subtree.
+       * @param maxDepth Nodes deeper than this (the root of the subtree being at
+       * depth 0) are not visited, nor touched.
+       * @return A range of 'PreOrderIterator' over the subtree.
+       */
+      inline TreeRange<PreOrderIterator> preorder(const TreeIterator<T, Alloc>& subtreeRoot, unsigned int maxDepth = TREE_UNLIMITED_DEPTH) const;
+
+      //________________________________________________________________________
+
+      /**
+       * Retrieve a range to traverse a subtree in post-order.
+       *
+       * The traversal starts at the first node of the subtree in post-order and
+       * ends with the given node, so it costs O(size of the subtree) regardless
+       * of the size of the tree.
+       *
+       * @param subtreeRoot Iterator to the root of the subtree.
+       * @param maxDepth Nodes deeper than this (the root of the subtree being at
+       * depth 0) are not visited, nor touched.
+       * @return A range of 'PostOrderIterator' over the subtree.
+       */
+      inline TreeRange<PostOrderIterator> postorder(const TreeIterator<T, Alloc>& subtreeRoot, unsigned int maxDepth = TREE_UNLIMITED_DEPTH) const;
+
+      //________________________________________________________________________
+
+      /**
+       * Retrieve a range to traverse the whole tree in pre-order.
+       *
+       * Ranges are views (see 'TreeRange'), so they can be handed to the
+       * standard algorithms or composed with the adaptors of <ranges>.
+       *
+       * @return A range of 'PreOrderIterator' over the tree.
+       */
+      inline TreeRange<PreOrderIterator> preorder() const;
+
+      //________________________________________________________________________
+
+      /**
+       * Retrieve a range to traverse the whole tree in post-order.
+       *
+       * @return A range of 'PostOrderIterator' over the tree.
+       */
+      inline TreeRange<PostOrderIterator> postorder() const;
+
+      //________________________________________________________________________
+
+      /**
+       * Retrieve a range to traverse the children of a node, from left to right.
+       *
+       * The iterators of the range are pre-order iterators that don't go deeper
+       * than the children, so they can be used as any other iterator of the
+       * tree (to push children, prune...).
+       *
+       * @param node Iterator to the parent node.
+       * @return A range of 'PreOrderIterator' over the children of the node.
+       */
+      inline TreeRange<PreOrderIterator> children(const TreeIterator<T, Alloc>& node) const;
+
+      //________________________________________________________________________
+
+      /**
+       * Retrieve a reverse pre-order iterator pointing to the last node of the
+       * tree in pre-order (its rightmost leaf).
+       *
+       * @return 'ReversePreOrderIterator' to the last node in pre-order.
+       */
+      inline ReversePreOrderIterator preRBegin() const;
+
+      //________________________________________________________________________
+
+      /**
+       * Retrieve a reverse pre-order iterator that marks the end of the tree.
+       *
+       * @return 'ReversePreOrderIterator' that marks the end of the tree.
+       */
+      inline ReversePreOrderIterator preREnd() const;
+
+      //________________________________________________________________________
+
+      /**
+       * Retrieve a reverse post-order iterator pointing to the root node (the
+       * last node of the tree in post-order).
+       *
+       * @return 'ReversePostOrderIterator' to the root node.
+       */
+      inline ReversePostOrderIterator postRBegin() const;
+
+      //________________________________________________________________________
+
+      /**
+       * Retrieve a reverse post-order iterator that marks the end of the tree.
+       *
+       * @return 'ReversePostOrderIterator' that marks the end of the tree.
+       */
+      inline ReversePostOrderIterator postREnd() const;
+
+      //________________________________________________________________________
+
+      /**
+       * Retrieve a range to traverse a subtree in reverse pre-order.
+       *
+       * The nodes are visited in the opposite order to preorder(), without
+       * storing the forward traversal anywhere.
+       *
+       * @param subtreeRoot Iterator to the root of the subtree.
+       * @param maxDepth Nodes deeper than this (the root of the subtree being at
+       * depth 0) are not visited, nor touched.
+       * @return A range of 'ReversePreOrderIterator' over the subtree.
+       */
+      inline TreeRange<ReversePreOrderIterator> reversePreorder(const TreeIterator<T, Alloc>& subtreeRoot, unsigned int maxDepth = TREE_UNLIMITED_DEPTH) const;
+
+      //________________________________________________________________________
+
+      /**
+       * Retrieve a range to traverse a subtree in reverse post-order.
+       *
+       * The nodes are visited in the opposite order to postorder(), without
+       * storing the forward traversal anywhere.
+       *
+       * @param subtreeRoot Iterator to the root of the subtree.
+       * @param maxDepth Nodes deeper than this (the root of the subtree being at
+       * depth 0) are not visited, nor touched.
+       * @return A range of 'ReversePostOrderIterator' over the subtree.
+       */
+      inline TreeRange<ReversePostOrderIterator> reversePostorder(const TreeIterator<T, Alloc>& subtreeRoot, unsigned int maxDepth = TREE_UNLIMITED_DEPTH) const;
+
+      //________________________________________________________________________
+
+      /**
+       * Retrieve a range to traverse the children of a node, from right to left.
+       *
+       * @param node Iterator to the parent node.
+       * @return A range of 'ReversePostOrderIterator' over the children of the
+       * node.
+       */
+      inline TreeRange<ReversePostOrderIterator> reverseChildren(const TreeIterator<T, Alloc>& node) const;
+
+      //________________________________________________________________________
+
+      /**
+       * Retrieve a range to traverse the ancestors of a node, from its parent up
+       * to the root.
+       *
+       * @param node Iterator to the node, it is not part of the range.
+       * @return A range of 'AncestorIterator' over the ancestors of the node.
+       */
+      inline TreeRange<AncestorIterator> ancestors(const TreeIterator<T, Alloc>& node) const;
+
+      //________________________________________________________________________
+
+      /**
+       * Retrieve an Euler tour iterator entering the root node.
+       *
+       * @return 'EulerTourIterator' to the first step of the tour.
+       */
+      inline EulerTourIterator eulerBegin() const;
+
+      //________________________________________________________________________
+
+      /**
+       * Retrieve an Euler tour iterator that marks the end of the tree.
+       *
+       * @return 'EulerTourIterator' that marks the end of the tour.
+       */
+      inline EulerTourIterator eulerEnd() const;
+
+      //________________________________________________________________________
+
+      /**
+       * Retrieve a range to take an Euler tour of a subtree, entering and
+       * exiting every node in a single pass (see 'EulerTourIterator').
+       *
+       * @param subtreeRoot Iterator to the root of the subtree.
+       * @param maxDepth Nodes deeper than this (the root of the subtree being at
+       * depth 0) are not visited, nor touched.
+       * @return A range of 'EulerTourIterator' over the subtree.
+       */
+      inline TreeRange<EulerTourIterator> eulerTour(const TreeIterator<T, Alloc>& subtreeRoot, unsigned int maxDepth = TREE_UNLIMITED_DEPTH) const;
+
+      //________________________________________________________________________
+
+      /**
+       * Retrieve a range to take an Euler tour of the tree.
+       *
+       * @return A range of 'EulerTourIterator' over the tree.
+       */
+      inline TreeRange<EulerTourIterator> eulerTour() const;
+
+      //________________________________________________________________________
+
+      /**
+       * Retrieve a leaf iterator pointing to the leftmost leaf of the tree.
+       *
+       * @return 'LeafIterator' to the first leaf.
+       */
+      inline LeafIterator leafBegin() const;
+
+      //________________________________________________________________________
+
+      /**
+       * Retrieve a leaf iterator that marks the end of the tree.
+       *
+       * @return 'LeafIterator' that marks the end of the tree.
+       */
+      inline LeafIterator leafEnd() const;
+
+      //________________________________________________________________________
+
+      /**
+       * Retrieve a range to traverse the leaves of a subtree, from left to right.
+       *
+       * @param subtreeRoot Iterator to the root of the subtree.
+       * @return A range of 'LeafIterator' over the leaves of the subtree.
+       */
+      inline TreeRange<LeafIterator> leaves(const TreeIterator<T, Alloc>& subtreeRoot) const;
+
+      //________________________________________________________________________
+
+      /**
+       * Retrieve a range to traverse the leaves of the tree, from left to right.
+       *
+       * @return A range of 'LeafIterator' over the leaves of the tree.
+       */
+      inline TreeRange<LeafIterator> leaves() const;
+
+      //________________________________________________________________________
+
+      /**
+       * Retrieve a leaf iterator to the k-th leaf (counting from 0, left to
+       * right) of a subtree. The iterator goes on through the rest of the leaves
+       * of the subtree.
+       *
+       * With the leaf index enabled, the leaf is found going down from the root
+       * of the subtree, so this costs O(depth * children per node). Otherwise,
+       * the first k leaves are traversed.
+       *
+       * @param subtreeRoot Iterator to the root of the subtree.
+       * @param k Position of the leaf.
+       * @return 'LeafIterator' to the k-th leaf, or leafEnd() if the subtree has
+       * k leaves or less.
+       */
+      LeafIterator leafAt(const TreeIterator<T, Alloc>& subtreeRoot, std::size_t k) const;
+
 
       // =======================================================================
       //                               CAPACITY
@@ -238,6 +551,89 @@ class Tree {
        */
       inline bool empty() const;
 
+      //________________________________________________________________________
+
+      /**
+       * Get the number of leaves of a subtree.
+       *
+       * It costs O(1) with the leaf index enabled, otherwise, the leaves of the
+       * subtree are traversed.
+       *
+       * @param subtreeRoot Iterator to the root of the subtree.
+       * @return The number of leaves of the subtree (1 if it is a leaf itself).
+       */
+      std::size_t nLeaves(const TreeIterator<T, Alloc>& subtreeRoot) const;
+
+
+      // =======================================================================
+      //                              LEAF INDEX
+      // =======================================================================
+
+
+      /**
+       * Keep the number of leaves of every subtree up to date.
+       *
+       * The counts are computed in a single pass over the tree, from then on,
+       * every insertion, erasure, chop, prune or graft updates the counts of the
+       * ancestors of the nodes involved, which costs O(depth) per operation.
+       * Trees copied from, or pruned from, a tree with the index enabled keep it
+       * enabled.
+       */
+      void enableLeafIndex();
+
+      //________________________________________________________________________
+
+      /** Stop keeping the number of leaves of every subtree up to date. */
+      inline void disableLeafIndex();
+
+      //________________________________________________________________________
+
+      /**
+       * Check whether the leaf index is enabled.
+       *
+       * @return 'true' if the number of leaves of every subtree is kept up to
+       * date, 'false' otherwise.
+       */
+      inline bool leafIndexEnabled() const;
+
+
+      // =======================================================================
+      //                               OBSERVERS
+      // =======================================================================
+
+
+      /**
+       * Register an observer to be told when the nodes of a subtree are about to
+       * be destroyed, moved or given a different path to the root (see
+       * 'TreeObserver'). Observers are not copied along with the tree.
+       *
+       * @param observer Observer to be registered, it must be unregistered
+       * before it is destroyed (unless the tree is destroyed first).
+       */
+      inline void addObserver(TreeObserver<T, Alloc>& observer);
+
+      //________________________________________________________________________
+
+      /**
+       * Unregister an observer.
+       *
+       * @param observer Observer to be unregistered.
+       */
+      void removeObserver(TreeObserver<T, Alloc>& observer);
+
+
+      // =======================================================================
+      //                               ALLOCATOR
+      // =======================================================================
+
+
+      /**
+       * Get a copy of the allocator used by the tree.
+       *
+       * @return The allocator associated to the tree.
+       */
+      inline Alloc getAllocator() const;
+
 
       // =======================================================================
       //                               MODIFIERS
@@ -253,7 +649,7 @@ class Tree {
        * @param data Data to be assigned to the root node.
        * @throws std::bad_alloc Thrown if memory allocation for the root node fails.
        */
-      void setRoot(const T& data) throw(std::bad_alloc);
+      void setRoot(const T& data);
 
       //________________________________________________________________________
 
@@ -265,7 +661,7 @@ class Tree {
        * @return 'PreOrderIterator' to the new children node created.
        * @throws std::bad_alloc Thrown if memory allocation for the children node fails.
        */
-      Tree<T>::PreOrderIterator pushFrontChild(const TreeIterator<T>& parent, const T& data) throw(std::bad_alloc);
+      Tree<T, Alloc>::PreOrderIterator pushFrontChild(const TreeIterator<T, Alloc>& parent, const T& data);
 
       //________________________________________________________________________
 
@@ -277,7 +673,7 @@ class Tree {
        * @return 'PreOrderIterator' to the new children node created.
        * @throws std::bad_alloc Thrown if memory allocation for the children node fails.
        */
-      Tree<T>::PreOrderIterator pushBackChild(const TreeIterator<T>& parent, const T& data) throw(std::bad_alloc);
+      Tree<T, Alloc>::PreOrderIterator pushBackChild(const TreeIterator<T, Alloc>& parent, const T& data);
 
       //________________________________________________________________________
 
@@ -295,7 +691,7 @@ class Tree {
        * @return 'PreOrderIterator' to the new child node created.
        * @throws std::bad_alloc Thrown if memory allocation for the children node fails.
        */
-      Tree<T>::PreOrderIterator insertChild(const TreeIterator<T>& parent, const TreeIterator<T>& childNode, const T& data) throw(std::bad_alloc);
+      Tree<T, Alloc>::PreOrderIterator insertChild(const TreeIterator<T, Alloc>& parent, const TreeIterator<T, Alloc>& childNode, const T& data);
 
       //________________________________________________________________________
 
@@ -309,7 +705,7 @@ class Tree {
        * @throws RootNotErasableException Thrown if the given iterator points to
        * the root node (because the root node can't/shouldn't be erased).
        */
-      void erase(TreeIterator<T>& node) throw(RootNotErasableException);
+      void erase(TreeIterator<T, Alloc>& node);
 
       //________________________________________________________________________
 
@@ -324,7 +720,7 @@ class Tree {
        * to prune hangs.
        * @return The subtree that hangs from the node pointed by 'rootNode'.
        */
-      Tree<T> prune(TreeIterator<T>& rootNode);
+      Tree<T, Alloc> prune(TreeIterator<T, Alloc>& rootNode);
 
       //________________________________________________________________________
 
@@ -338,7 +734,7 @@ class Tree {
        * @param rootNode Iterator to the node from which the subtree that we want
        * to erase hangs.
        */
-      void chop(TreeIterator<T>& rootNode);
+      void chop(TreeIterator<T, Alloc>& rootNode);
 
       //________________________________________________________________________
 
@@ -350,10 +746,15 @@ class Tree {
        * modified, which means that after the execution of this method, the given
        * tree will be empty.
        *
+       * If the allocators of both trees don't compare equal, the nodes of the
+       * given tree are copied with the allocator of 'this' tree.
+       *
        * @param parent Iterator to the node where we want to graft the given tree.
        * @param tree Tree to be grafted.
+       * @throws std::bad_alloc Thrown if the given tree has to be copied and
+       * memory allocation fails.
        */
-      void graftFront(const TreeIterator<T>& parent, Tree<T>& tree);
+      void graftFront(const TreeIterator<T, Alloc>& parent, Tree<T, Alloc>& tree);
 
       //________________________________________________________________________
 
@@ -365,10 +766,15 @@ class Tree {
        * modified, which means that after the execution of this method, the given
        * tree will be empty.
        *
+       * If the allocators of both trees don't compare equal, the nodes of the
+       * given tree are copied with the allocator of 'this' tree.
+       *
        * @param parent Iterator to the node where we want to graft the given tree.
        * @param tree Tree to be grafted.
+       * @throws std::bad_alloc Thrown if the given tree has to be copied and
+       * memory allocation fails.
        */
-      void graftBack(const TreeIterator<T>& parent, Tree<T>& tree);
+      void graftBack(const TreeIterator<T, Alloc>& parent, Tree<T, Alloc>& tree);
 
       //________________________________________________________________________
 
@@ -382,13 +788,81 @@ class Tree {
        * range checking, which means that the client is responsible for passing
        * a valid iterator as an argument.
        *
+       * If the allocators of both trees don't compare equal, the nodes of the
+       * given tree are copied with the allocator of 'this' tree.
+       *
        * @param parent Iterator to the node where we want to graft the given tree.
        * @param childNode Iterator to the child node where we want to graft the given tree.
        * @param tree Tree to be grafted.
+       * @throws std::bad_alloc Thrown if the given tree has to be copied and
+       * memory allocation fails.
+       */
+      void graftAt(const TreeIterator<T, Alloc>& parent, const TreeIterator<T, Alloc>& childNode, Tree<T, Alloc>& adoptTree);
+
+      //________________________________________________________________________
+
+      /**
+       * Move every node of the tree into a single block of contiguous memory.
+       *
+       * After a long series of insertions, erasures and grafts, the nodes of a
+       * tree end up scattered all over the heap and traversals slow down. This
+       * method places every node, one after the other, in the given order
+       * without changing the logical structure of the tree. Payloads are moved
+       * (or copied if they can't be moved without throwing) and the children
+       * lists are rebuilt, so their slots are allocated in order too. Payloads
+       * kept apart from the nodes (see TreeLayoutTraits) stay where they are,
+       * so the block only holds the topology of the tree.
+       *
+       * Note that every iterator pointing to the tree is invalidated.
+       *
+       * @param order Order in which the nodes are placed in memory.
+       * @throws std::bad_alloc Thrown if memory allocation fails. In that case
+       * the tree is left untouched.
+       */
+      void relayout(TreeLayoutOrder order = TREE_PRE_ORDER_LAYOUT);
+
+      //________________________________________________________________________
+
+      /**
+       * Move every node of a subtree into a single block of contiguous memory.
+       *
+       * It works like relayout() but only the subtree hanging from the given
+       * node is moved. Huge trees can be compacted a subtree at a time (for
+       * instance, one child of the root each time the application is idle) so
+       * that the compaction never causes a long pause.
+       *
+       * Note that every iterator pointing to the subtree is invalidated.
+       *
+       * @param subtreeRoot Iterator to the root of the subtree to be moved.
+       * @param order Order in which the nodes are placed in memory.
+       * @throws std::bad_alloc Thrown if memory allocation fails. In that case
+       * the tree is left untouched.
        */
-      void graftAt(const TreeIterator<T>& parent, const TreeIterator<T>& childNode, Tree<T>& adoptTree);
+      void relayout(const TreeIterator<T, Alloc>& subtreeRoot, TreeLayoutOrder order = TREE_PRE_ORDER_LAYOUT);
 
    private:
+      // =======================================================================
+      //                            FRIEND CLASSES
+      // =======================================================================
+
+
+      /** Parallel transforms build trees of any type (see TreeParallel::transform()). */
+      template <class U, class UAlloc>
+      friend class TreeParallel;
+
+
+      // =======================================================================
+      //                           PRIVATE TYPEDEFS
+      // =======================================================================
+
+
+      /** Allocator used to allocate the nodes of the tree. */
+      typedef typename std::allocator_traits<Alloc>::template rebind_alloc< TreeNode<T, Alloc> > NodeAllocator;
+
+      /** Traits of the node allocator. */
+      typedef std::allocator_traits<NodeAllocator> NodeAllocatorTraits;
+
+
       // =======================================================================
       //                            PRIVATE METHODS
       // =======================================================================
@@ -402,8 +876,10 @@ class Tree {
        * allowed to handle them).
        *
        * @param root Pointer to the tree node that is going to be the root node.
+       * @param alloc Allocator that was used to allocate the nodes hanging from 'root'.
+       * @param leafIndex 'true' if the leaf counts of the nodes are up to date.
        */
-      inline Tree(TreeNode<T>* root);
+      inline Tree(TreeNode<T, Alloc>* root, const NodeAllocator& alloc, bool leafIndex);
 
       //________________________________________________________________________
 
@@ -413,25 +889,186 @@ class Tree {
        * @param source Tree that is going to be copied.
        * @throws std::bad_alloc Thrown if memory allocation fails when copying. 
        */
-      void clone(const Tree<T>& source) throw(std::bad_alloc);
+      void clone(const Tree<T, Alloc>& source);
 
       //________________________________________________________________________
 
       /** Deallocate any memory allocated by the tree */
       inline void clean();
 
+      //________________________________________________________________________
 
-      // =======================================================================
-      //                            PRIVATE FIELDS
-      // =======================================================================
+      /**
+       * Allocate and construct a new node with the allocator of the tree.
+       *
+       * @param data Data to be assigned to the new node.
+       * @param parent Parent of the new node.
+       * @return A pointer to the new node.
+       * @throws std::bad_alloc Thrown if memory allocation for the node fails.
+       */
+      TreeNode<T, Alloc>* createNode(const T& data, TreeNode<T, Alloc>* parent);
 
+      //________________________________________________________________________
 
-      /** Pointer to the root node */
-      TreeNode<T>* _root;
-};
+      /**
+       * Destroy and deallocate a single node with the allocator of the tree.
+       *
+       * If the node belongs to a block of nodes (see relayout()), the block is
+       * deallocated along with its last node.
+       *
+       * @param node Node to be destroyed.
+       */
+      inline void destroyNode(TreeNode<T, Alloc>* node);
 
+      //________________________________________________________________________
 
-// *****************************************************************************
+      /**
+       * Destroy and deallocate every node of the subtree hanging from 'root'.
+       *
+       * When the allocator is monotonic, nodes aren't deallocated (their memory
+       * is released in bulk by the allocator). In that case, this method costs
+       * O(1) if 'T' is trivially destructible, otherwise, the payloads are
+       * destroyed in a single pass that doesn't touch the children lists.
+       *
+       * @param root Root of the subtree to be destroyed.
+       */
+      void destroySubtree(TreeNode<T, Alloc>* root);
+
+      //________________________________________________________________________
+
+      /**
+       * Make a full copy of a subtree using the allocator of 'this' tree.
+       *
+       * If an exception is thrown, every node copied so far is deallocated.
+       *
+       * @param source Root of the subtree to be copied.
+       * @param parent Parent of the new subtree.
+       * @return A pointer to the root of the copy.
+       * @throws std::bad_alloc Thrown if memory allocation fails when copying.
+       */
+      TreeNode<T, Alloc>* copySubtree(TreeNode<T, Alloc>* source, TreeNode<T, Alloc>* parent);
+
+      //________________________________________________________________________
+
+      /**
+       * Take the nodes of a tree that is going to be grafted into 'this' tree.
+       *
+       * If the allocators of both trees compare equal, the nodes are just
+       * adopted, otherwise, they are copied with the allocator of 'this' tree and
+       * the given tree is cleaned. In both cases the given tree ends up empty.
+       *
+       * @param adoptTree Tree to be grafted.
+       * @param parent Node under which the nodes are going to be grafted.
+       * @return A pointer to the root node to be grafted.
+       * @throws std::bad_alloc Thrown if memory allocation fails when copying.
+       */
+      TreeNode<T, Alloc>* adopt(Tree<T, Alloc>& adoptTree, TreeNode<T, Alloc>* parent);
+
+      //________________________________________________________________________
+
+      /**
+       * Move the nodes of a subtree into a single block of memory.
+       *
+       * @param root Root of the subtree to be moved.
+       * @param order Order in which the nodes are placed in memory.
+       * @throws std::bad_alloc Thrown if memory allocation fails.
+       */
+      void relayoutSubtree(TreeNode<T, Alloc>* root, TreeLayoutOrder order);
+
+      //________________________________________________________________________
+
+      /**
+       * List the nodes of a subtree in the order they have to be placed in memory.
+       *
+       * Whatever the order, parents are always listed before their children and
+       * siblings are listed from left to right.
+       *
+       * @param root Root of the subtree.
+       * @param order Order in which the nodes are listed.
+       * @param layout Vector where the nodes are appended.
+       */
+      void gatherLayout(TreeNode<T, Alloc>* root, TreeLayoutOrder order, std::vector< TreeNode<T, Alloc>* >& layout) const;
+
+      //________________________________________________________________________
+
+      /**
+       * List the nodes of a subtree in van Emde Boas order.
+       *
+       * @param root Root of the subtree.
+       * @param height Only nodes at a depth lower than 'height' (relative to
+       * 'root') are listed.
+       * @param layout Vector where the nodes are appended.
+       */
+      void gatherVanEmdeBoas(TreeNode<T, Alloc>* root, std::size_t height, std::vector< TreeNode<T, Alloc>* >& layout) const;
+
+      //________________________________________________________________________
+
+      /**
+       * Compute the number of leaves of every node of a subtree.
+       *
+       * @param root Root of the subtree.
+       */
+      void countLeaves(TreeNode<T, Alloc>* root);
+
+      //________________________________________________________________________
+
+      /**
+       * Update the leaf counts after a subtree has been linked under a node.
+       * Nothing is done if the leaf index is disabled.
+       *
+       * @param parent Node under which the subtree has been linked.
+       * @param nLeaves Number of leaves of the linked subtree.
+       */
+      inline void leavesAttached(TreeNode<T, Alloc>* parent, std::size_t nLeaves);
+
+      //________________________________________________________________________
+
+      /**
+       * Update the leaf counts after a subtree has been unlinked from a node.
+       * Nothing is done if the leaf index is disabled.
+       *
+       * @param parent Node from which the subtree has been unlinked.
+       * @param nLeaves Number of leaves of the unlinked subtree.
+       */
+      inline void leavesDetached(TreeNode<T, Alloc>* parent, std::size_t nLeaves);
+
+      //________________________________________________________________________
+
+      /**
+       * Tell the observers that the nodes of a subtree are about to be destroyed,
+       * moved or given a different path to the root.
+       *
+       * @param root Root of the subtree.
+       */
+      inline void subtreeChanging(TreeNode<T, Alloc>* root) const;
+
+
+      // =======================================================================
+      //                            PRIVATE FIELDS
+      // =======================================================================
+
+
+      /** Pointer to the root node */
+      TreeNode<T, Alloc>* _root;
+
+      //________________________________________________________________________
+
+      /** Allocator used to allocate every node of the tree */
+      NodeAllocator _allocator;
+
+      //________________________________________________________________________
+
+      /** 'true' if the number of leaves of every node is kept up to date */
+      bool _leafIndex;
+
+      //________________________________________________________________________
+
+      /** Objects to be told when some nodes are about to change */
+      std::vector< TreeObserver<T, Alloc>* > _observers;
+};
+
+
+// *****************************************************************************
 // *****************************************************************************
 // *****************************************************************************
 // ***                                                                       ***
@@ -460,17 +1097,24 @@ class Tree {
 // *****************************************************************************
 
 
-template <class T>
-Tree<T>::Tree() : _root(NULL) {
+template <class T, class Alloc>
+Tree<T, Alloc>::Tree() : _root(NULL), _leafIndex(false) {
+   // Nothing to do
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+Tree<T, Alloc>::Tree(const Alloc& alloc) : _root(NULL), _allocator(alloc), _leafIndex(false) {
    // Nothing to do
 }
 
 //______________________________________________________________________________
 
-template <class T>
-Tree<T>::Tree(const T& data) throw (std::bad_alloc) {
+template <class T, class Alloc>
+Tree<T, Alloc>::Tree(const T& data, const Alloc& alloc) : _root(NULL), _allocator(alloc), _leafIndex(false) {
    try {
-      _root = new TreeNode<T>(data);
+      _root = createNode(data, NULL);
    }
    catch(std::bad_alloc& ex) {
       std::cerr << ex.what() << " : Failure to allocate memory for the root node when building the tree" << std::endl;
@@ -483,8 +1127,12 @@ Tree<T>::Tree(const T& data) throw (std::bad_alloc) {
 
 //______________________________________________________________________________
 
-template <class T>
-Tree<T>::Tree(const Tree<T>& source) throw(std::bad_alloc) : _root(NULL) {
+template <class T, class Alloc>
+Tree<T, Alloc>::Tree(const Tree<T, Alloc>& source) :
+   _root(NULL),
+   _allocator(NodeAllocatorTraits::select_on_container_copy_construction(source._allocator)),
+   _leafIndex(source._leafIndex)
+{
    try {
       clone(source);
    }
@@ -502,16 +1150,28 @@ Tree<T>::Tree(const Tree<T>& source) throw(std::bad_alloc) : _root(NULL) {
 
 //______________________________________________________________________________
 
-template <class T>
-Tree<T>::~Tree() {
+template <class T, class Alloc>
+Tree<T, Alloc>::~Tree() {
    clean();
+
+   for(std::size_t i = 0; i < _observers.size(); ++i)
+      _observers[i]->treeDestroyed();
 }
 
 //______________________________________________________________________________
 
-template <class T>
-Tree<T>& Tree<T>::operator=(const Tree<T>& rhs) throw(std::bad_alloc) {
+template <class T, class Alloc>
+Tree<T, Alloc>& Tree<T, Alloc>::operator=(const Tree<T, Alloc>& rhs) {
    if(this != &rhs) {
+      // Our nodes must be deallocated with the allocator that allocated them,
+      // so get rid of them before the allocator is (maybe) replaced
+      clean();
+      if(NodeAllocatorTraits::propagate_on_container_copy_assignment::value)
+         _allocator = rhs._allocator;
+
+      // Leaf counts are copied along with the nodes
+      _leafIndex = rhs._leafIndex;
+
       // No need to check for exceptions. If something fails, memory deallocation
       // will automatically happen because of the execution of the destructor
       clone(rhs);
@@ -522,8 +1182,8 @@ Tree<T>& Tree<T>::operator=(const Tree<T>& rhs) throw(std::bad_alloc) {
 
 //______________________________________________________________________________
 
-template <class T>
-bool Tree<T>::operator==(const Tree<T>& rhs) const {
+template <class T, class Alloc>
+bool Tree<T, Alloc>::operator==(const Tree<T, Alloc>& rhs) const {
    if(this == &rhs) return true;
    if(empty() != rhs.empty()) return false;
 
@@ -538,53 +1198,303 @@ bool Tree<T>::operator==(const Tree<T>& rhs) const {
 
 //______________________________________________________________________________
 
-template <class T>
-bool Tree<T>::operator!=(const Tree<T>& rhs) const {
+template <class T, class Alloc>
+bool Tree<T, Alloc>::operator!=(const Tree<T, Alloc>& rhs) const {
    return !(*this == rhs);
 }
 
 //______________________________________________________________________________
 
-template <class T>
-typename Tree<T>::PreOrderIterator Tree<T>::preBegin() const {
+template <class T, class Alloc>
+typename Tree<T, Alloc>::PreOrderIterator Tree<T, Alloc>::preBegin() const {
    return PreOrderIterator(_root);
 }
 
 //______________________________________________________________________________
 
-template <class T>
-typename Tree<T>::PreOrderIterator Tree<T>::preEnd() const {
+template <class T, class Alloc>
+typename Tree<T, Alloc>::PreOrderIterator Tree<T, Alloc>::preEnd() const {
    return PreOrderIterator(NULL);
 }
 
 //______________________________________________________________________________
 
-template <class T>
-typename Tree<T>::PostOrderIterator Tree<T>::postBegin() const {
+template <class T, class Alloc>
+typename Tree<T, Alloc>::PostOrderIterator Tree<T, Alloc>::postBegin() const {
    return PostOrderIterator(_root);
 }
 
 //______________________________________________________________________________
 
-template <class T>
-typename Tree<T>::PostOrderIterator Tree<T>::postEnd() const {
+template <class T, class Alloc>
+typename Tree<T, Alloc>::PostOrderIterator Tree<T, Alloc>::postEnd() const {
    return PostOrderIterator(NULL);
 }
 
 //______________________________________________________________________________
 
-template <class T>
-bool Tree<T>::empty() const {
+template <class T, class Alloc>
+TreeRange<typename Tree<T, Alloc>::PreOrderIterator> Tree<T, Alloc>::preorder(const TreeIterator<T, Alloc>& subtreeRoot, unsigned int maxDepth) const {
+   return TreeRange<PreOrderIterator>(PreOrderIterator(subtreeRoot._pointer, maxDepth), preEnd());
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+TreeRange<typename Tree<T, Alloc>::PostOrderIterator> Tree<T, Alloc>::postorder(const TreeIterator<T, Alloc>& subtreeRoot, unsigned int maxDepth) const {
+   return TreeRange<PostOrderIterator>(PostOrderIterator(subtreeRoot._pointer, maxDepth), postEnd());
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+TreeRange<typename Tree<T, Alloc>::PreOrderIterator> Tree<T, Alloc>::preorder() const {
+   return TreeRange<PreOrderIterator>(preBegin(), preEnd());
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+TreeRange<typename Tree<T, Alloc>::PostOrderIterator> Tree<T, Alloc>::postorder() const {
+   return TreeRange<PostOrderIterator>(postBegin(), postEnd());
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+TreeRange<typename Tree<T, Alloc>::PreOrderIterator> Tree<T, Alloc>::children(const TreeIterator<T, Alloc>& node) const {
+   // A pre-order traversal one level deep visits the node and then its children
+   PreOrderIterator childIt(node._pointer, 1);
+   return TreeRange<PreOrderIterator>(++childIt, preEnd());
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+typename Tree<T, Alloc>::ReversePreOrderIterator Tree<T, Alloc>::preRBegin() const {
+   return ReversePreOrderIterator(_root);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+typename Tree<T, Alloc>::ReversePreOrderIterator Tree<T, Alloc>::preREnd() const {
+   return ReversePreOrderIterator(NULL);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+typename Tree<T, Alloc>::ReversePostOrderIterator Tree<T, Alloc>::postRBegin() const {
+   return ReversePostOrderIterator(_root);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+typename Tree<T, Alloc>::ReversePostOrderIterator Tree<T, Alloc>::postREnd() const {
+   return ReversePostOrderIterator(NULL);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+TreeRange<typename Tree<T, Alloc>::ReversePreOrderIterator> Tree<T, Alloc>::reversePreorder(const TreeIterator<T, Alloc>& subtreeRoot, unsigned int maxDepth) const {
+   return TreeRange<ReversePreOrderIterator>(ReversePreOrderIterator(subtreeRoot._pointer, maxDepth), preREnd());
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+TreeRange<typename Tree<T, Alloc>::ReversePostOrderIterator> Tree<T, Alloc>::reversePostorder(const TreeIterator<T, Alloc>& subtreeRoot, unsigned int maxDepth) const {
+   return TreeRange<ReversePostOrderIterator>(ReversePostOrderIterator(subtreeRoot._pointer, maxDepth), postREnd());
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+TreeRange<typename Tree<T, Alloc>::ReversePostOrderIterator> Tree<T, Alloc>::reverseChildren(const TreeIterator<T, Alloc>& node) const {
+   // A reverse post-order traversal one level deep visits the node and then its
+   // children from right to left
+   ReversePostOrderIterator childIt(node._pointer, 1);
+   return TreeRange<ReversePostOrderIterator>(++childIt, postREnd());
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+TreeRange<typename Tree<T, Alloc>::AncestorIterator> Tree<T, Alloc>::ancestors(const TreeIterator<T, Alloc>& node) const {
+   return TreeRange<AncestorIterator>(AncestorIterator(node._pointer->_parent), AncestorIterator(NULL));
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+typename Tree<T, Alloc>::EulerTourIterator Tree<T, Alloc>::eulerBegin() const {
+   return EulerTourIterator(_root);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+typename Tree<T, Alloc>::EulerTourIterator Tree<T, Alloc>::eulerEnd() const {
+   return EulerTourIterator(NULL);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+TreeRange<typename Tree<T, Alloc>::EulerTourIterator> Tree<T, Alloc>::eulerTour(const TreeIterator<T, Alloc>& subtreeRoot, unsigned int maxDepth) const {
+   return TreeRange<EulerTourIterator>(EulerTourIterator(subtreeRoot._pointer, maxDepth), eulerEnd());
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+TreeRange<typename Tree<T, Alloc>::EulerTourIterator> Tree<T, Alloc>::eulerTour() const {
+   return TreeRange<EulerTourIterator>(eulerBegin(), eulerEnd());
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+typename Tree<T, Alloc>::LeafIterator Tree<T, Alloc>::leafBegin() const {
+   return LeafIterator(_root);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+typename Tree<T, Alloc>::LeafIterator Tree<T, Alloc>::leafEnd() const {
+   return LeafIterator(NULL);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+TreeRange<typename Tree<T, Alloc>::LeafIterator> Tree<T, Alloc>::leaves(const TreeIterator<T, Alloc>& subtreeRoot) const {
+   return TreeRange<LeafIterator>(LeafIterator(subtreeRoot._pointer), leafEnd());
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+TreeRange<typename Tree<T, Alloc>::LeafIterator> Tree<T, Alloc>::leaves() const {
+   return TreeRange<LeafIterator>(leafBegin(), leafEnd());
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+typename Tree<T, Alloc>::LeafIterator Tree<T, Alloc>::leafAt(const TreeIterator<T, Alloc>& subtreeRoot, std::size_t k) const {
+   TreeNode<T, Alloc>* root = subtreeRoot._pointer;
+
+   if(!_leafIndex) {
+      LeafIterator leafIt(root);
+      for(; k > 0 && leafIt != leafEnd(); --k)
+         ++leafIt;
+
+      return leafIt;
+   }
+
+   if(k >= root->_nLeaves)
+      return leafEnd();
+
+   // Go down picking, at every level, the child whose leaves include the k-th one
+   LeafIterator leafIt;
+   leafIt._cursor = TreeCursor<T, Alloc>(root, root);
+   TreeNode<T, Alloc>*& node = leafIt._cursor._node;
+   while(!node->_children.empty()) {
+      typename TreeNode<T, Alloc>::ChildIterator it = node->_children.begin();
+      for(; k >= (*it)->_nLeaves; ++it)
+         k -= (*it)->_nLeaves;
+
+      node = *it;
+      ++leafIt._cursor._depth;
+   }
+
+   leafIt.setPointer(node);
+   return leafIt;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+bool Tree<T, Alloc>::empty() const {
    return _root == NULL ? true : false;
 }
 
 //______________________________________________________________________________
 
-template <class T>
-void Tree<T>::setRoot(const T& data) throw(std::bad_alloc) {
+template <class T, class Alloc>
+std::size_t Tree<T, Alloc>::nLeaves(const TreeIterator<T, Alloc>& subtreeRoot) const {
+   if(_leafIndex)
+      return subtreeRoot._pointer->_nLeaves;
+
+   std::size_t count = 0;
+   for(LeafIterator leafIt(subtreeRoot._pointer); leafIt != leafEnd(); ++leafIt)
+      ++count;
+
+   return count;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+void Tree<T, Alloc>::enableLeafIndex() {
+   if(!_leafIndex && _root != NULL)
+      countLeaves(_root);
+
+   _leafIndex = true;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+void Tree<T, Alloc>::disableLeafIndex() {
+   _leafIndex = false;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+bool Tree<T, Alloc>::leafIndexEnabled() const {
+   return _leafIndex;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+void Tree<T, Alloc>::addObserver(TreeObserver<T, Alloc>& observer) {
+   _observers.push_back(&observer);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+void Tree<T, Alloc>::removeObserver(TreeObserver<T, Alloc>& observer) {
+   for(std::size_t i = 0; i < _observers.size(); ++i) {
+      if(_observers[i] == &observer) {
+         _observers.erase(_observers.begin() + i);
+         return;
+      }
+   }
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+Alloc Tree<T, Alloc>::getAllocator() const {
+   return Alloc(_allocator);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+void Tree<T, Alloc>::setRoot(const T& data) {
    if(_root == NULL) {
       try {
-         _root = new TreeNode<T>(data);
+         _root = createNode(data, NULL);
       }
       catch(std::bad_alloc& ex) {
          std::cerr << ex.what() << " : Failure to allocate memory for the root node" << std::endl;
@@ -596,78 +1506,84 @@ void Tree<T>::setRoot(const T& data) throw(std::bad_alloc) {
    }
    else {
       // Just assign a new value to the root
-      *_root = data;
+      subtreeChanging(_root);
+      _root->_data.get() = data;
    }
 }
 
 //______________________________________________________________________________
 
-template <class T>
-typename Tree<T>::PreOrderIterator Tree<T>::pushFrontChild(const TreeIterator<T>& parent, const T& data) throw(std::bad_alloc) {
-   TreeNode<T>* child;
+template <class T, class Alloc>
+typename Tree<T, Alloc>::PreOrderIterator Tree<T, Alloc>::pushFrontChild(const TreeIterator<T, Alloc>& parent, const T& data) {
+   TreeNode<T, Alloc>* child = NULL;
    try {
-      child = new TreeNode<T>(data, parent._pointer);
+      child = createNode(data, parent._pointer);
+      parent._pointer->_children.push_front(child);
    }
    catch(std::bad_alloc& ex) {
       std::cerr << ex.what() << " : Failure to allocate memory for the new child" << std::endl;
 
-      // Since we are not inside the constructor, the destructor for this object
-      // will get called, hence, there won't be any memory leak
+      // The child may have been built and not linked to its parent yet
+      if(child != NULL)
+         destroyNode(child);
       throw;
    }
 
-   parent._pointer->_children.push_front(child);
    child->_childIt = parent._pointer->_children.begin();
+   leavesAttached(parent._pointer, 1);
 
    return PreOrderIterator(child);
 }
 
 //______________________________________________________________________________
 
-template <class T>
-typename Tree<T>::PreOrderIterator Tree<T>::pushBackChild(const TreeIterator<T>& parent, const T& data) throw(std::bad_alloc) {
-   TreeNode<T>* child;
+template <class T, class Alloc>
+typename Tree<T, Alloc>::PreOrderIterator Tree<T, Alloc>::pushBackChild(const TreeIterator<T, Alloc>& parent, const T& data) {
+   TreeNode<T, Alloc>* child = NULL;
    try {
-      child = new TreeNode<T>(data, parent._pointer);
+      child = createNode(data, parent._pointer);
+      parent._pointer->_children.push_back(child);
    }
    catch(std::bad_alloc& ex) {
       std::cerr << ex.what() << " : Failure to allocate memory for the new child" << std::endl;
 
-      // Since we are not inside the constructor, the destructor for this object
-      // will get called, hence, there won't be any memory leak
+      // The child may have been built and not linked to its parent yet
+      if(child != NULL)
+         destroyNode(child);
       throw;
    }
 
-   parent._pointer->_children.push_back(child);
    child->_childIt = --(parent._pointer->_children.end());
+   leavesAttached(parent._pointer, 1);
 
    return PreOrderIterator(child);
 }
 
 //______________________________________________________________________________
 
-template <class T>
-typename Tree<T>::PreOrderIterator Tree<T>::insertChild(const TreeIterator<T>& parent,
-                                 const TreeIterator<T>& childNode,
+template <class T, class Alloc>
+typename Tree<T, Alloc>::PreOrderIterator Tree<T, Alloc>::insertChild(const TreeIterator<T, Alloc>& parent,
+                                 const TreeIterator<T, Alloc>& childNode,
                                  const T& data)
-   throw(std::bad_alloc)
 {
 
-   TreeNode<T>* child;
+   typename TreeNode<T, Alloc>::ChildIterator it(childNode._pointer->_childIt);
+   TreeNode<T, Alloc>* child = NULL;
    try {
-      child = new TreeNode<T>(data, parent._pointer);
+      child = createNode(data, parent._pointer);
+      it = parent._pointer->_children.insert(it, child);
    }
    catch(std::bad_alloc& ex) {
       std::cerr << ex.what() << " : Failure to allocate memory for the new child when inserting" << std::endl;
 
-      // Since we are not inside the constructor, the destructor for this object
-      // will get called, hence, there won't be any memory leak
+      // The child may have been built and not linked to its parent yet
+      if(child != NULL)
+         destroyNode(child);
       throw;
    }
 
-   typename std::list< TreeNode<T>* >::iterator it(childNode._pointer->_childIt);
-   parent._pointer->_children.insert(it, child);
-   child->_childIt = --it;
+   child->_childIt = it;
+   leavesAttached(parent._pointer, 1);
 
    return PreOrderIterator(child);
 }
@@ -676,61 +1592,79 @@ typename Tree<T>::PreOrderIterator Tree<T>::insertChild(const TreeIterator<T>& p
 
 // If an iterator pointing to the end is passed (iterator pointing to null) the
 // method will fail. NULL ITERATORS CAN'T BE PASSED AS AN ARGUMENT TO THIS FUNCTION
-template <class T>
-void Tree<T>::erase(TreeIterator<T>& node) throw(RootNotErasableException) {
-   TreeNode<T>* nodePtr(node.getPointer());
+template <class T, class Alloc>
+void Tree<T, Alloc>::erase(TreeIterator<T, Alloc>& node) {
+   TreeNode<T, Alloc>* nodePtr(node.getPointer());
    // By definition a tree has a single root, hence, the root node can't be
    // erased
    if(nodePtr == _root)
       throw RootNotErasableException("Error: Attempting to erase the root node");
 
+   subtreeChanging(nodePtr);
+
    // Insert every child under the position that the iterator of the current
    // node indicates (in the parent node)
-   typename std::list< TreeNode<T>* >::iterator it(nodePtr->_children.begin());
+   typename TreeNode<T, Alloc>::ChildIterator it(nodePtr->_children.begin());
    for(; it != nodePtr->_children.end(); ++it) {
       nodePtr->_parent->_children.insert(nodePtr->_childIt, *it);
-      // Update _childIt for each relinked child
+      // Update _childIt and _parent for each relinked child
       (*it)->_childIt = nodePtr->_childIt;
       --((*it)->_childIt);
+      (*it)->_parent = nodePtr->_parent;
    }
 
-   // Erase the node
+   // Erase the node. If it had children, its leaves are now its parent's, so
+   // the leaf counts only change when a leaf is erased
+   bool isLeaf = nodePtr->_children.empty();
    nodePtr->_parent->_children.erase(nodePtr->_childIt);
-   delete nodePtr;
+   if(isLeaf)
+      leavesDetached(nodePtr->_parent, 1);
+
+   destroyNode(nodePtr);
 }
 
 //______________________________________________________________________________
 
 // If an iterator pointing to the end is passed (iterator pointing to null) the
 // method will fail. NULL ITERATORS CAN'T BE PASSED AS ARGUMENTS
-template <class T>
-Tree<T> Tree<T>::prune(TreeIterator<T>& rootNode) {
-   TreeNode<T>* nodePtr = rootNode.getPointer();
+template <class T, class Alloc>
+Tree<T, Alloc> Tree<T, Alloc>::prune(TreeIterator<T, Alloc>& rootNode) {
+   TreeNode<T, Alloc>* nodePtr = rootNode.getPointer();
+   subtreeChanging(nodePtr);
 
    // Erase the child reference to this node on the parent node if there is a
    // parent node
    nodePtr->_parent->_children.erase(nodePtr->_childIt);
+   leavesDetached(nodePtr->_parent, nodePtr->_nLeaves);
+   nodePtr->_parent = NULL;
 
-   return Tree<T>(nodePtr);
+   // The nodes were allocated by our allocator, so the new tree has to
+   // deallocate them with it
+   return Tree<T, Alloc>(nodePtr, _allocator, _leafIndex);
 }
 
 //______________________________________________________________________________
 
 // If an iterator pointing to the end is passed (iterator pointing to null) the
 // method will fail. NULL ITERATORS CAN'T BE PASSED AS ARGUMENTS
-template <class T>
-void Tree<T>::chop(TreeIterator<T>& rootNode) {
-   TreeNode<T>* rootPtr(rootNode.getPointer());
-   TreeNode<T>* parentPtr(rootPtr->parent());
+template <class T, class Alloc>
+void Tree<T, Alloc>::chop(TreeIterator<T, Alloc>& rootNode) {
+   TreeNode<T, Alloc>* rootPtr(rootNode.getPointer());
+   TreeNode<T, Alloc>* parentPtr(rootPtr->parent());
+   subtreeChanging(rootPtr);
 
    // Erase the child reference to this node on the parent node if there is a
    // parent node
-   if(parentPtr != NULL)
+   if(parentPtr != NULL) {
       parentPtr->_children.erase(rootPtr->_childIt);
+      leavesDetached(parentPtr, rootPtr->_nLeaves);
+   }
+   else {
+      _root = NULL;
+   }
 
    // Deallocate memory for every node under 'rootNode'
-   for(PostOrderIterator postIt(rootPtr); postIt != postEnd(); ++postIt)
-      delete postIt.getPointer();
+   destroySubtree(rootPtr);
 }
 
 //______________________________________________________________________________
@@ -738,13 +1672,26 @@ void Tree<T>::chop(TreeIterator<T>& rootNode) {
 // The passed tree will be a subtree of '*this' tree. The given tree to be grafted
 // will be empty after the execution of this method. '*this' tree will have the
 // responsability of deallocating resources
-template <class T>
-void Tree<T>::graftFront(const TreeIterator<T>& parent, Tree<T>& adoptTree) {
+template <class T, class Alloc>
+void Tree<T, Alloc>::graftFront(const TreeIterator<T, Alloc>& parent, Tree<T, Alloc>& adoptTree) {
+   // The slot is linked first, so that running out of memory leaves both
+   // trees as they were
+   parent._pointer->_children.push_front(NULL);
+
    // The current tree adopts the new tree created and assumes the responsability
    // of liberating the corresponding resources
-   parent._pointer->_children.push_front(adoptTree._root);
-   adoptTree._root->_childIt = parent._pointer->_children.begin();
-   adoptTree._root = NULL;
+   TreeNode<T, Alloc>* adoptRoot;
+   try {
+      adoptRoot = adopt(adoptTree, parent._pointer);
+   }
+   catch(...) {
+      parent._pointer->_children.pop_front();
+      throw;
+   }
+
+   parent._pointer->_children.front() = adoptRoot;
+   adoptRoot->_childIt = parent._pointer->_children.begin();
+   leavesAttached(parent._pointer, adoptRoot->_nLeaves);
 }
 
 //______________________________________________________________________________
@@ -752,100 +1699,449 @@ void Tree<T>::graftFront(const TreeIterator<T>& parent, Tree<T>& adoptTree) {
 // The passed tree will be a subtree of '*this' tree. The given tree to be grafted
 // will be empty after the execution of this method. '*this' tree will have the
 // responsability of deallocating resources
-template <class T>
-void Tree<T>::graftBack(const TreeIterator<T>& parent, Tree<T>& adoptTree) {
+template <class T, class Alloc>
+void Tree<T, Alloc>::graftBack(const TreeIterator<T, Alloc>& parent, Tree<T, Alloc>& adoptTree) {
+   // The slot is linked first, so that running out of memory leaves both
+   // trees as they were
+   parent._pointer->_children.push_back(NULL);
+
    // The current tree adopts the new tree created and assumes the responsability
    // of liberating the corresponding resources
-   parent._pointer->_children.push_back(adoptTree._root);
-   adoptTree._root->_childIt = --(parent._pointer->_children.end());
-   adoptTree._root = NULL;
+   TreeNode<T, Alloc>* adoptRoot;
+   try {
+      adoptRoot = adopt(adoptTree, parent._pointer);
+   }
+   catch(...) {
+      parent._pointer->_children.pop_back();
+      throw;
+   }
+
+   parent._pointer->_children.back() = adoptRoot;
+   adoptRoot->_childIt = --(parent._pointer->_children.end());
+   leavesAttached(parent._pointer, adoptRoot->_nLeaves);
 }
 
 //______________________________________________________________________________
 
-template <class T>
-void Tree<T>::graftAt(const TreeIterator<T>& parent, const TreeIterator<T>& childNode, Tree<T>& adoptTree) {
-   typename std::list< TreeNode<T>* >::iterator it(childNode._pointer->_childIt);
-   parent._pointer->_children.insert(it, adoptTree._root);
-   adoptTree._root->_childIt = --it;
-   adoptTree._root = NULL;
+template <class T, class Alloc>
+void Tree<T, Alloc>::graftAt(const TreeIterator<T, Alloc>& parent, const TreeIterator<T, Alloc>& childNode, Tree<T, Alloc>& adoptTree) {
+   // The slot is linked first, so that running out of memory leaves both
+   // trees as they were
+   typename TreeNode<T, Alloc>::ChildIterator it(childNode._pointer->_childIt);
+   it = parent._pointer->_children.insert(it, NULL);
+
+   TreeNode<T, Alloc>* adoptRoot;
+   try {
+      adoptRoot = adopt(adoptTree, parent._pointer);
+   }
+   catch(...) {
+      parent._pointer->_children.erase(it);
+      throw;
+   }
+
+   *it = adoptRoot;
+   adoptRoot->_childIt = it;
+   leavesAttached(parent._pointer, adoptRoot->_nLeaves);
 }
 
 //______________________________________________________________________________
 
-template <class T>
-Tree<T>::Tree(TreeNode<T>* root) {
-   this->_root = root;
+template <class T, class Alloc>
+void Tree<T, Alloc>::relayout(TreeLayoutOrder order) {
+   if(_root != NULL)
+      relayoutSubtree(_root, order);
 }
 
 //______________________________________________________________________________
 
-template <class T>
-void Tree<T>::clone(const Tree<T>& source) throw(std::bad_alloc) {
-   // If the tree already had data stored, delete it
-   if(_root != NULL) {
-      clean();
-      _root = NULL;
-   }
+template <class T, class Alloc>
+void Tree<T, Alloc>::relayout(const TreeIterator<T, Alloc>& subtreeRoot, TreeLayoutOrder order) {
+   relayoutSubtree(subtreeRoot._pointer, order);
+}
 
-   // This map is going to tell us which node is the parent of who
-   std::map< TreeNode<T>*, TreeNode<T>* > parentMap;
-   parentMap[NULL] = NULL;
+//______________________________________________________________________________
 
-   // Allocate memory for the new root
-   try {
-      _root = new TreeNode<T>(*source.preBegin());
+template <class T, class Alloc>
+Tree<T, Alloc>::Tree(TreeNode<T, Alloc>* root, const NodeAllocator& alloc, bool leafIndex) :
+   _root(root),
+   _allocator(alloc),
+   _leafIndex(leafIndex)
+{
+   // Nothing to do
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+void Tree<T, Alloc>::clone(const Tree<T, Alloc>& source) {
+   // If the tree already had data stored, delete it
+   clean();
+
+   if(source._root != NULL)
+      _root = copySubtree(source._root, NULL);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+void Tree<T, Alloc>::clean() {
+   if(_root != NULL) {
+      subtreeChanging(_root);
+      destroySubtree(_root);
+      _root = NULL;
+   }
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+TreeNode<T, Alloc>* Tree<T, Alloc>::createNode(const T& data, TreeNode<T, Alloc>* parent) {
+   TreeNode<T, Alloc>* node = NodeAllocatorTraits::allocate(_allocator, 1);
+   try {
+      NodeAllocatorTraits::construct(_allocator, node, data, parent, Alloc(_allocator));
+   }
+   catch(...) {
+      // The node was never built, so just give the memory back
+      NodeAllocatorTraits::deallocate(_allocator, node, 1);
+      throw;
+   }
+
+   return node;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+void Tree<T, Alloc>::destroyNode(TreeNode<T, Alloc>* node) {
+   TreeNodeSlab* slab = node->_slab;
+   NodeAllocatorTraits::destroy(_allocator, node);
+
+   if(slab == NULL)
+      NodeAllocatorTraits::deallocate(_allocator, node, 1);
+   else if(--slab->live == 0)
+      // The header sits in the first slot of the block
+      NodeAllocatorTraits::deallocate(_allocator, reinterpret_cast< TreeNode<T, Alloc>* >(slab), slab->count + 1);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+void Tree<T, Alloc>::destroySubtree(TreeNode<T, Alloc>* root) {
+   if(TreeAllocatorTraits<Alloc>::monotonic) {
+      // Memory (children lists included) is released in bulk by the allocator,
+      // the only thing left to do is giving the payloads a chance to clean up
+      if(!std::is_trivially_destructible<T>::value)
+         for(PreOrderIterator preIt(root); preIt != preEnd(); ++preIt)
+            preIt.getPointer()->_data.destroyInPlace();
+
+      return;
+   }
+
+   // Use post-order iterator to erase each node. The iterator stops by itself
+   // once 'root' has been visited and it moves on using the links of the current
+   // node, so it has to leave it before it is destroyed
+   PostOrderIterator postIt(root);
+   while(postIt != postEnd()) {
+      TreeNode<T, Alloc>* node = postIt.getPointer();
+      ++postIt;
+      destroyNode(node);
+   }
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+TreeNode<T, Alloc>* Tree<T, Alloc>::copySubtree(TreeNode<T, Alloc>* source, TreeNode<T, Alloc>* parent) {
+   TreeNode<T, Alloc>* copyRoot;
+   try {
+      copyRoot = createNode(source->_data.get(), parent);
+      copyRoot->_nLeaves = source->_nLeaves;
+   }
+   catch(std::bad_alloc& ex) {
+      std::cerr << ex.what() << " : Failure to allocate memory for the root node when copying a subtree" << std::endl;
+      throw;
+   }
+
+   try {
+      // Both subtrees are travelled at the same time. Every time we visit a node
+      // of the source, the children of its copy are allocated, so the pre-order
+      // iterator of the copy will find them when it goes down
+      for(PreOrderIterator srcIt(source), myIt(copyRoot); srcIt != preEnd(); ++srcIt, ++myIt) {
+         TreeNode<T, Alloc>* myPt = myIt.getPointer();
+         TreeNode<T, Alloc>* srcPt = srcIt.getPointer();
+
+         typename TreeNode<T, Alloc>::ChildIterator it;
+         for(it = srcPt->_children.begin(); it != srcPt->_children.end(); ++it) {
+            TreeNode<T, Alloc>* newChild = createNode((*it)->_data.get(), myPt);
+
+            try {
+               myPt->_children.push_back(newChild);
+            }
+            catch(...) {
+               // The child isn't linked yet, so destroySubtree() wouldn't find it
+               destroyNode(newChild);
+               throw;
+            }
+
+            // Store the parent iterator that points to this child, in the child
+            // so we can erase nodes easily
+            newChild->_childIt = --(myPt->_children.end());
+            newChild->_nLeaves = (*it)->_nLeaves;
+         }
+      }
+   }
+   catch(std::bad_alloc& ex) {
+      std::cerr << ex.what() << " : Failure to allocate memory when copying the children of a subtree" << std::endl;
+
+      // Get rid of every node copied so far
+      destroySubtree(copyRoot);
+      throw;
+   }
+
+   return copyRoot;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+TreeNode<T, Alloc>* Tree<T, Alloc>::adopt(Tree<T, Alloc>& adoptTree, TreeNode<T, Alloc>* parent) {
+   TreeNode<T, Alloc>* adoptRoot;
+
+   if(_allocator == adoptTree._allocator) {
+      // Both allocators can deallocate each other's memory, the nodes can be
+      // adopted as they are
+      adoptTree.subtreeChanging(adoptTree._root);
+      adoptRoot = adoptTree._root;
+      adoptRoot->_parent = parent;
+      adoptTree._root = NULL;
+   }
+   else {
+      // We can't deallocate nodes that come from a different allocator, hence,
+      // the tree is copied into our own memory
+      adoptRoot = copySubtree(adoptTree._root, parent);
+      adoptTree.clean();
+   }
+
+   // Leaf counts come along with the nodes, but they can only be trusted if the
+   // grafted tree kept them up to date
+   if(_leafIndex && !adoptTree._leafIndex)
+      countLeaves(adoptRoot);
+
+   return adoptRoot;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+void Tree<T, Alloc>::relayoutSubtree(TreeNode<T, Alloc>* root, TreeLayoutOrder order) {
+   subtreeChanging(root);
+
+   std::vector< TreeNode<T, Alloc>* > layout;
+   gatherLayout(root, order, layout);
+   std::size_t nNodes = layout.size();
+
+   // The first slot of the block holds its header, the nodes go right after it
+   TreeNode<T, Alloc>* slab;
+   try {
+      slab = NodeAllocatorTraits::allocate(_allocator, nNodes + 1);
    }
    catch(std::bad_alloc& ex) {
-      std::cerr << ex.what() << " : Failure to allocate memory for the root node when executing clone()" << std::endl;
+      std::cerr << ex.what() << " : Failure to allocate memory for the nodes when executing relayout()" << std::endl;
       throw;
    }
-   parentMap[source._root] = _root;
-
-   for(PreOrderIterator srcIt = source.preBegin(), myIt = preBegin(); srcIt != source.preEnd(); ++srcIt, ++myIt) {
-      // Temp variables
-      TreeNode<T>* myPt = myIt.getPointer();
-      TreeNode<T>* srcPt = srcIt.getPointer();
-      PreOrderIterator tmpParent;
-      tmpParent = srcIt.parent();
-
-      // Link the current node to the corresponding parent
-      myPt->_parent = parentMap[tmpParent.getPointer()];
-
-      // Copy node data
-      *myIt = *srcIt;
-
-      // Allocate memory for descendants if any and put them in the dictionary
-      typename std::list< TreeNode<T>* >::iterator it;
-      for(it = srcPt->_children.begin(); it != srcPt->_children.end(); ++it) {
-         TreeNode<T>* newChild;
-         try {
-            newChild = new TreeNode<T>;
+
+   TreeNodeSlab* header = new (static_cast<void*>(slab)) TreeNodeSlab;
+   header->count = nNodes;
+   header->live = nNodes;
+   TreeNode<T, Alloc>* nodes = slab + 1;
+
+   TreeNode<T, Alloc>* rootParent = root->_parent;
+   typename TreeNode<T, Alloc>::ChildIterator rootIt = root->_childIt;
+
+   // Parents are always laid out before their children. Once a node has been
+   // moved, its '_parent' field is overwritten with the address of its new
+   // location, so the new parent of a node is just 'oldNode->_parent->_parent'.
+   std::size_t nMoved = 0;
+   try {
+      for(; nMoved < nNodes; ++nMoved) {
+         TreeNode<T, Alloc>* oldNode = layout[nMoved];
+         TreeNode<T, Alloc>* newNode = nodes + nMoved;
+         TreeNode<T, Alloc>* newParent = nMoved == 0 ? rootParent : oldNode->_parent->_parent;
+
+         NodeAllocatorTraits::construct(_allocator, newNode, std::move(oldNode->_data), newParent, Alloc(_allocator));
+         newNode->_slab = header;
+         newNode->_nLeaves = oldNode->_nLeaves;
+
+         if(nMoved > 0) {
+            try {
+               newParent->_children.push_back(newNode);
+            }
+            catch(...) {
+               oldNode->_data = std::move(newNode->_data);
+               NodeAllocatorTraits::destroy(_allocator, newNode);
+               throw;
+            }
+            newNode->_childIt = --(newParent->_children.end());
          }
-         catch(std::bad_alloc& ex) {
-            std::cerr << ex.what() << " : Failure to allocate memory when creating children in clone()" << std::endl;
-            throw;
+
+         oldNode->_parent = newNode;
+      }
+   }
+   catch(...) {
+      std::cerr << "Failure to move the nodes when executing relayout(), rolling back" << std::endl;
+
+      // Give the payloads and the parents back to the old nodes and get rid of
+      // the new ones
+      for(std::size_t i = 0; i < nMoved; ++i) {
+         layout[i]->_data = std::move(nodes[i]._data);
+         layout[i]->_parent = i == 0 ? rootParent : layout[nodes[i]._parent - nodes];
+      }
+      for(std::size_t i = 0; i < nMoved; ++i)
+         NodeAllocatorTraits::destroy(_allocator, nodes + i);
+
+      NodeAllocatorTraits::deallocate(_allocator, slab, nNodes + 1);
+      throw;
+   }
+
+   // Hang the new subtree where the old one was
+   if(rootParent != NULL) {
+      *rootIt = nodes;
+      nodes->_childIt = rootIt;
+   }
+   else {
+      _root = nodes;
+   }
+
+   // Give the old nodes their parents back so they can be traversed and destroyed
+   for(std::size_t i = 1; i < nNodes; ++i)
+      layout[i]->_parent = layout[nodes[i]._parent - nodes];
+
+   destroySubtree(root);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+void Tree<T, Alloc>::gatherLayout(TreeNode<T, Alloc>* root, TreeLayoutOrder order, std::vector< TreeNode<T, Alloc>* >& layout) const {
+   typename TreeNode<T, Alloc>::ChildIterator it;
+
+   switch(order) {
+      case TREE_PRE_ORDER_LAYOUT:
+         for(PreOrderIterator preIt(root); preIt != preEnd(); ++preIt)
+            layout.push_back(preIt.getPointer());
+         break;
+
+      case TREE_BREADTH_FIRST_LAYOUT:
+         // The vector itself is used as the queue
+         layout.push_back(root);
+         for(std::size_t i = layout.size() - 1; i < layout.size(); ++i)
+            for(it = layout[i]->_children.begin(); it != layout[i]->_children.end(); ++it)
+               layout.push_back(*it);
+         break;
+
+      case TREE_VAN_EMDE_BOAS_LAYOUT: {
+         // Compute the height of the subtree level by level
+         std::vector< TreeNode<T, Alloc>* > level(1, root), nextLevel;
+         std::size_t height = 0;
+         while(!level.empty()) {
+            ++height;
+            nextLevel.clear();
+            for(std::size_t i = 0; i < level.size(); ++i)
+               nextLevel.insert(nextLevel.end(), level[i]->_children.begin(), level[i]->_children.end());
+            level.swap(nextLevel);
          }
 
-         // Allocate memory for a new child
-         myPt->_children.push_back(newChild);
-         // Store the parent iterator that points to this child, in the child
-         // so we can erase nodes easily
-         newChild->_childIt = --(myPt->_children.end());
-         // Make a correspondence in the dictionary
-         parentMap[*it] = newChild;
+         gatherVanEmdeBoas(root, height, layout);
+         break;
       }
    }
 }
 
 //______________________________________________________________________________
 
-template <class T>
-void Tree<T>::clean() {
-   // Use post-order iterator to erase each node
-   if(_root != NULL)
-      for(PostOrderIterator postIt = postBegin(); postIt != postEnd(); ++postIt)
-         delete postIt.getPointer();
+template <class T, class Alloc>
+void Tree<T, Alloc>::gatherVanEmdeBoas(TreeNode<T, Alloc>* root, std::size_t height, std::vector< TreeNode<T, Alloc>* >& layout) const {
+   if(height == 1) {
+      layout.push_back(root);
+      return;
+   }
+
+   // Lay out the top half first
+   std::size_t topHeight = height / 2;
+   gatherVanEmdeBoas(root, topHeight, layout);
+
+   // Find the roots of the bottom subtrees, from left to right
+   std::vector< TreeNode<T, Alloc>* > level(1, root), nextLevel;
+   for(std::size_t depth = 0; depth < topHeight && !level.empty(); ++depth) {
+      nextLevel.clear();
+      for(std::size_t i = 0; i < level.size(); ++i)
+         nextLevel.insert(nextLevel.end(), level[i]->_children.begin(), level[i]->_children.end());
+      level.swap(nextLevel);
+   }
+
+   // And lay out each one of them
+   for(std::size_t i = 0; i < level.size(); ++i)
+      gatherVanEmdeBoas(level[i], height - topHeight, layout);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+void Tree<T, Alloc>::countLeaves(TreeNode<T, Alloc>* root) {
+   // Children are visited before their parents
+   for(PostOrderIterator postIt(root); postIt != postEnd(); ++postIt) {
+      TreeNode<T, Alloc>* node = postIt.getPointer();
+
+      if(node->_children.empty()) {
+         node->_nLeaves = 1;
+      }
+      else {
+         node->_nLeaves = 0;
+         typename TreeNode<T, Alloc>::ChildIterator it;
+         for(it = node->_children.begin(); it != node->_children.end(); ++it)
+            node->_nLeaves += (*it)->_nLeaves;
+      }
+   }
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+void Tree<T, Alloc>::leavesAttached(TreeNode<T, Alloc>* parent, std::size_t nLeaves) {
+   if(!_leafIndex)
+      return;
+
+   // A node that just got its first child stops being a leaf itself
+   if(parent->_children.size() == 1)
+      --nLeaves;
+
+   if(nLeaves > 0)
+      for(TreeNode<T, Alloc>* node = parent; node != NULL; node = node->_parent)
+         node->_nLeaves += nLeaves;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+void Tree<T, Alloc>::leavesDetached(TreeNode<T, Alloc>* parent, std::size_t nLeaves) {
+   if(!_leafIndex)
+      return;
+
+   // A node that just lost its last child becomes a leaf itself
+   if(parent->_children.empty())
+      --nLeaves;
+
+   if(nLeaves > 0)
+      for(TreeNode<T, Alloc>* node = parent; node != NULL; node = node->_parent)
+         node->_nLeaves -= nLeaves;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+void Tree<T, Alloc>::subtreeChanging(TreeNode<T, Alloc>* root) const {
+   for(std::size_t i = 0; i < _observers.size(); ++i)
+      _observers[i]->subtreeChanging(PreOrderIterator(root));
 }
 
 
@@ -898,12 +2194,29 @@ void Tree<T>::clean() {
  * Because an iterator to a tree is very special kind of iterator, it also implements
  * some other features to facilitate navigation through a tree structure.
  *
+ * The standard iterator typedefs are provided, so the derived iterators (which,
+ * unlike this class, can be used by value) work with <algorithm> and <ranges>.
+ * They are forward iterators: they can be copied, compared and incremented, and
+ * a copy goes on through the same traversal independently of the original.
+ *
  * @author Francisco Aisa García
  * @version 0.1
  */
-template <class T>
+template <class T, class Alloc>
 class TreeIterator {
    public:
+      // =======================================================================
+      //                               TYPEDEFS
+      // =======================================================================
+
+
+      typedef std::forward_iterator_tag iterator_category;
+      typedef T value_type;
+      typedef std::ptrdiff_t difference_type;
+      typedef T* pointer;
+      typedef T& reference;
+
+
       // =======================================================================
       //                     CONSTRUCTORS AND DESTRUCTORS
       // =======================================================================
@@ -928,7 +2241,7 @@ class TreeIterator {
        *
        * @param data Pointer to the 'TreeNode' that this iterator will point.
        */
-      inline TreeIterator(TreeNode<T>* data);
+      inline TreeIterator(TreeNode<T, Alloc>* data);
 
       //________________________________________________________________________
 
@@ -937,7 +2250,7 @@ class TreeIterator {
        *
        * @param source Source tree iterator.
        */
-      inline TreeIterator(const TreeIterator<T>& source);
+      inline TreeIterator(const TreeIterator<T, Alloc>& source);
 
       //________________________________________________________________________
 
@@ -956,7 +2269,7 @@ class TreeIterator {
        * @param rhs Right hand side tree iterator to be assigned.
        * @return A reference to 'this' tree iterator.
        */
-      inline TreeIterator<T>& operator=(const TreeIterator<T>& rhs);
+      inline TreeIterator<T, Alloc>& operator=(const TreeIterator<T, Alloc>& rhs);
 
       //________________________________________________________________________
 
@@ -973,7 +2286,7 @@ class TreeIterator {
        *
        * @return A reference to 'this' tree iterator.
        */
-      virtual TreeIterator<T>& operator++() = 0;
+      virtual TreeIterator<T, Alloc>& operator++() = 0;
 
       //________________________________________________________________________
 
@@ -984,7 +2297,7 @@ class TreeIterator {
        * @return 'true' if both iterators point to the same tree node, 'false'
        * otherwise.
        */
-      inline bool operator==(const TreeIterator<T>& rhs) const;
+      inline bool operator==(const TreeIterator<T, Alloc>& rhs) const;
 
       //________________________________________________________________________
 
@@ -995,7 +2308,7 @@ class TreeIterator {
        * @return 'true' if the iterators to be compared are different, 'false'
        * otherwise.
        */
-      inline bool operator!=(const TreeIterator<T>& rhs) const;
+      inline bool operator!=(const TreeIterator<T, Alloc>& rhs) const;
 
       //________________________________________________________________________
 
@@ -1029,7 +2342,7 @@ class TreeIterator {
        * method MUST NEVER be used to modify the returned value, because static
        * value is returned.
        */
-      inline virtual TreeIterator<T>& parent() = 0;
+      inline virtual TreeIterator<T, Alloc>& parent() = 0;
 
       //________________________________________________________________________
 
@@ -1042,7 +2355,7 @@ class TreeIterator {
        * method MUST NEVER be used to modify the returned value, because static
        * value is returned.
        */
-      virtual TreeIterator<T>& firstChild() = 0;
+      virtual TreeIterator<T, Alloc>& firstChild() = 0;
 
       //________________________________________________________________________
 
@@ -1055,7 +2368,7 @@ class TreeIterator {
        * method MUST NEVER be used to modify the returned value, because static
        * value is returned.
        */
-      virtual TreeIterator<T>& lastChild() = 0;
+      virtual TreeIterator<T, Alloc>& lastChild() = 0;
 
       //________________________________________________________________________
 
@@ -1073,7 +2386,7 @@ class TreeIterator {
        * method MUST NEVER be used to modify the returned value, because static
        * value is returned.
        */
-      virtual TreeIterator<T>& nextChild() = 0;
+      virtual TreeIterator<T, Alloc>& nextChild() = 0;
 
       //________________________________________________________________________
 
@@ -1091,7 +2404,7 @@ class TreeIterator {
        * method MUST NEVER be used to modify the returned value, because static
        * value is returned.
        */
-      virtual TreeIterator<T>& previousChild() = 0;
+      virtual TreeIterator<T, Alloc>& previousChild() = 0;
 
 
       // =======================================================================
@@ -1121,7 +2434,7 @@ class TreeIterator {
        *
        * @return A pointer to the 'TreeNode' pointed by 'this' tree iterator.
        */
-      inline TreeNode<T>* getPointer();
+      inline TreeNode<T, Alloc>* getPointer();
 
       //________________________________________________________________________
 
@@ -1131,7 +2444,7 @@ class TreeIterator {
        * @param newPointer Pointer to the new 'TreeNode' that 'this' tree iterator
        * will point to.
        */
-      inline void setPointer(TreeNode<T>* newPointer);
+      inline void setPointer(TreeNode<T, Alloc>* newPointer);
 
       //________________________________________________________________________
 
@@ -1145,7 +2458,7 @@ class TreeIterator {
        * assign a 'TreeIterator'.
        * @return A reference to 'this' tree iterator.
        */
-      inline TreeIterator<T>& operator=(TreeNode<T>* rhs);
+      inline TreeIterator<T, Alloc>& operator=(TreeNode<T, Alloc>* rhs);
 
 
       // =======================================================================
@@ -1162,7 +2475,7 @@ class TreeIterator {
        * during each call, furthermore, this iterator shouldn't be copied when using
        * operator= because we want to enforce the use of firstChild() and lastChild()
        */
-      typename std::list< TreeNode<T>* >::iterator _currentChild;
+      typename TreeNode<T, Alloc>::ChildIterator _currentChild;
 
    private:
       // =======================================================================
@@ -1170,7 +2483,8 @@ class TreeIterator {
       // =======================================================================
 
 
-      friend class Tree<T>;
+      friend class Tree<T, Alloc>;
+      friend class TreeCursor<T, Alloc>;
 
 
       // =======================================================================
@@ -1183,7 +2497,7 @@ class TreeIterator {
        *
        * @param rhs Right hand side tree iterator to be cloned.
        */
-      inline void clone(const TreeIterator<T>& rhs);
+      inline void clone(const TreeIterator<T, Alloc>& rhs);
 
 
       // =======================================================================
@@ -1192,7 +2506,7 @@ class TreeIterator {
 
 
       /** Pointer to the 'TreeNode' that holds the data */
-      TreeNode<T>* _pointer;
+      TreeNode<T, Alloc>* _pointer;
 };
 
 
@@ -1224,108 +2538,2399 @@ class TreeIterator {
 // *****************************************************************************
 // *****************************************************************************
 
-
-template <class T>
-TreeIterator<T>::TreeIterator() : _pointer(NULL) {
+
+template <class T, class Alloc>
+TreeIterator<T, Alloc>::TreeIterator() : _pointer(NULL) {
+   // Nothing to do
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+TreeIterator<T, Alloc>::TreeIterator(TreeNode<T, Alloc>* data) : _pointer(data) {
+   // Nothing to do
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+TreeIterator<T, Alloc>::TreeIterator(const TreeIterator<T, Alloc>& source) : _pointer(source._pointer) {
+   // Nothing to do
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+TreeIterator<T, Alloc>::~TreeIterator() {
+   // Nothing to do
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+TreeIterator<T, Alloc>& TreeIterator<T, Alloc>::operator=(const TreeIterator<T, Alloc>& rhs) {
+   if(this != &rhs)
+      clone(rhs);
+
+   return *this;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+TreeIterator<T, Alloc>& TreeIterator<T, Alloc>::operator=(TreeNode<T, Alloc>* rhs) {
+   if(_pointer != rhs) {
+      _pointer = rhs;
+   }
+
+   return *this;;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+bool TreeIterator<T, Alloc>::operator==(const TreeIterator<T, Alloc>& rhs) const {
+   return _pointer == rhs._pointer;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+bool TreeIterator<T, Alloc>::operator!=(const TreeIterator<T, Alloc>& rhs) const {
+   return _pointer != rhs._pointer;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+T* TreeIterator<T, Alloc>::operator->() const {
+   return &(_pointer->_data.get());
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+T& TreeIterator<T, Alloc>::operator*() const {
+   return *(operator->());
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+unsigned int TreeIterator<T, Alloc>::nChildren() {
+   return _pointer->_children.size();
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+TreeNode<T, Alloc>* TreeIterator<T, Alloc>::getPointer() {
+   return _pointer;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+void TreeIterator<T, Alloc>::setPointer(TreeNode<T, Alloc>* newPointer) {
+   _pointer = newPointer;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+void TreeIterator<T, Alloc>::clone(const TreeIterator<T, Alloc>& rhs) {
+   _pointer = rhs._pointer;
+}
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+// *****************************************************************************
+// *****************************************************************************
+// *****************************************************************************
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                       PRE-ORDER ITERATOR HEADER                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// *****************************************************************************
+// *****************************************************************************
+// *****************************************************************************
+
+/**
+ * Pre-order iterator to iterate on a tree structure.
+ *
+ * This class allows the user to iterate through a tree in a pre-order fashion. It
+ * also lets the user navigate through descendants and ancestors in a secuential fashion.
+ *
+ * The iterator only traverses the subtree hanging from the node it was built
+ * (or assigned) with. It moves through the tree using a 'TreeCursor', so it
+ * doesn't hold any heap state and copying it is as cheap as copying a couple of
+ * pointers. The traversal can be limited to a maximum depth, and the subtree of
+ * the current node can be skipped (see skipChildren()).
+ *
+ * @author Francisco Aisa García
+ * @version 0.1
+ */
+template <class T, class Alloc>
+class Tree<T, Alloc>::PreOrderIterator : public TreeIterator<T, Alloc> {
+   public:
+      // =======================================================================
+      //                     CONSTRUCTORS AND DESTRUCTORS
+      // =======================================================================
+
+
+      /**
+       * Default constructor.
+       *
+       * It makes the iterator pointer point to NULL.
+       */
+      inline PreOrderIterator();
+
+      //________________________________________________________________________
+
+      /**
+       * Conversion constructor.
+       *
+       * It transforms a post-order iterator into a pre-order iterator.
+       *
+       * @param postIt 'PostOrderIterator' to be converted.
+       */
+      inline PreOrderIterator(const PostOrderIterator& postIt);
+
+      //________________________________________________________________________
+
+      /**
+       * Custom constructor.
+       *
+       * @param data Pointer to the 'TreeNode' that this iterator will point.
+       * @param maxDepth Nodes deeper than this (relative to 'data') are not
+       * visited.
+       */
+      PreOrderIterator(TreeNode<T, Alloc>* data, unsigned int maxDepth = TREE_UNLIMITED_DEPTH);
+
+      //________________________________________________________________________
+
+      /**
+       * Copy constructor.
+       *
+       * The copy points to the same node and traverses the same subtree.
+       *
+       * @param source Source pre-order iterator to be copied.
+       */
+      inline PreOrderIterator(const PreOrderIterator& source);
+
+      //________________________________________________________________________
+
+      /** Destructor. */
+      inline virtual ~PreOrderIterator();
+
+
+      // =======================================================================
+      //                               OPERATORS
+      // =======================================================================
+
+
+      /**
+       * Assignment operator.
+       *
+       * A copy of the pointer contained in the right hand side iterator is done,
+       * which means that 'this' iterator will point to the same node. From then
+       * on, only the subtree hanging from that node is traversed.
+       *
+       * @param rhs Right hand side tree iterator to be assigned.
+       * @return A reference to 'this' 'PreOrderIterator'.
+       */
+      PreOrderIterator& operator=(const TreeIterator<T, Alloc>& rhs);
+
+      //________________________________________________________________________
+
+      /**
+       * Copy assignment operator.
+       *
+       * 'this' iterator will point to the same node and traverse the same subtree
+       * as the right hand side iterator.
+       *
+       * @param rhs Right hand side pre-order iterator to be assigned.
+       * @return A reference to 'this' 'PreOrderIterator'.
+       */
+      inline PreOrderIterator& operator=(const PreOrderIterator& rhs);
+
+      //________________________________________________________________________
+
+      /**
+       * Pre-increment operator.
+       *
+       * Each time this operator is executed, the next node (following the pre-order
+       * fashion) will be retrieved.
+       *
+       * @return A reference to 'this' 'PreOrderIterator'.
+       */
+      virtual PreOrderIterator& operator++();
+
+      //________________________________________________________________________
+
+      /**
+       * Post-increment operator.
+       *
+       * Each time this operator is executed, the next node (following the pre-order
+       * fashion) will be retrieved.
+       *
+       * @param notUsed This argument is not used.
+       * @return A 'PreOrderIterator' to the node that the iterator pointed to before
+       * iterating to the next node.
+       */
+      inline PreOrderIterator operator++(int notUsed);
+
+
+      // =======================================================================
+      //                          TRAVERSAL CONTROL
+      // =======================================================================
+
+
+      /**
+       * Don't descend into the children of the current node.
+       *
+       * The next increment moves to the node that follows the subtree of the
+       * current node, none of its descendants is visited (nor touched).
+       */
+      inline void skipChildren();
+
+      //________________________________________________________________________
+
+      /**
+       * Get the depth of the current node.
+       *
+       * @return The distance from the node where the traversal started to the
+       * current node.
+       */
+      inline unsigned int depth() const;
+
+      //________________________________________________________________________
+
+      /**
+       * Prefetch what leads to the next node each time the iterator moves.
+       *
+       * It only pays off when the tree doesn't fit in cache. Copies of the
+       * iterator prefetch too, but assigning a new node to it turns it off.
+       *
+       * @param mode What is prefetched (see 'TreePrefetchMode').
+       */
+      inline void setPrefetch(TreePrefetchMode mode);
+
+
+      // =======================================================================
+      //                            ELEMENT ACCESS
+      // =======================================================================
+
+
+      /**
+       * Returns a tree iterator to the parent node of the node pointed by 'this'
+       * iterator if any.
+       *
+       * @return A 'PreOrderIterator' to the parent node.
+       */
+      inline virtual TreeIterator<T, Alloc>& parent();
+
+      //________________________________________________________________________
+
+      /**
+       * Returns a tree iterator to the first child node of the node pointed by 'this'
+       * iterator.
+       *
+       * @return A 'PreOrderIterator' to the first child of the node pointed by
+       * 'this' iterator.
+       */
+      virtual TreeIterator<T, Alloc>& firstChild();
+
+      //________________________________________________________________________
+
+      /**
+       * Returns a tree iterator to the last child node of the node pointed by 'this'
+       * iterator.
+       *
+       * @return A 'PreOrderIterator' to the last child of the node pointed by 'this'
+       * iterator.
+       */
+      virtual TreeIterator<T, Alloc>& lastChild();
+
+      //________________________________________________________________________
+
+      /**
+       * Returns a tree iterator to the next child node of the node pointed by 'this'
+       * iterator.
+       *
+       * The next child returned will depend on the last access we made to the
+       * current node. Please note that this method doesn't do any kind of range
+       * checking, which means that the client is responsible for iterating through
+       * the node's children safely.
+       *
+       * @return A 'PreOrderIterator' to the next child of the node pointed by 'this'
+       * iterator.
+       */
+      virtual TreeIterator<T, Alloc>& nextChild();
+
+      //________________________________________________________________________
+
+      /**
+       * Returns a tree iterator to the previous child node of the node pointed by 'this'
+       * iterator.
+       *
+       * The previous child returned will depend on the last access we made to the
+       * current node. Please note that this method doesn't do any kind of range
+       * checking, which means that the client is responsible for iterating through
+       * the node's children safely.
+       *
+       * @return A 'PreOrderIterator' to the previous child of the node pointed by 'this'
+       * iterator.
+       */
+      virtual TreeIterator<T, Alloc>& previousChild();
+
+   private:
+      // =======================================================================
+      //                            FRIEND METHODS
+      // =======================================================================
+
+
+      friend PreOrderIterator Tree<T, Alloc>::preBegin() const;
+      friend PreOrderIterator Tree<T, Alloc>::preEnd() const;
+      friend PreOrderIterator Tree<T, Alloc>::pushBackChild(const TreeIterator<T, Alloc>& parent, const T& data);
+      friend PreOrderIterator Tree<T, Alloc>::pushFrontChild(const TreeIterator<T, Alloc>& parent, const T& data);
+      friend PreOrderIterator Tree<T, Alloc>::insertChild(const TreeIterator<T, Alloc>& parent, const TreeIterator<T, Alloc>& childNode, const T& data);
+
+
+      // =======================================================================
+      //                            PRIVATE METHODS
+      // =======================================================================
+
+
+      /**
+       * Point to the given node and start a new traversal from it.
+       *
+       * @param node Pointer to the 'TreeNode' that this iterator will point.
+       */
+      inline void startAt(TreeNode<T, Alloc>* node);
+
+
+      // =======================================================================
+      //                            PRIVATE FIELDS
+      // =======================================================================
+
+
+      /** Cursor that keeps the state of the traversal. */
+      TreeCursor<T, Alloc> _cursor;
+};
+
+
+// *****************************************************************************
+// *****************************************************************************
+// *****************************************************************************
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                   PRE-ORDER ITERATOR IMPLEMENTATION                   ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// *****************************************************************************
+// *****************************************************************************
+// *****************************************************************************
+
+// Parent sets _pointer to NULL
+template <class T, class Alloc>
+Tree<T, Alloc>::PreOrderIterator::PreOrderIterator() {
+   // Nothing to do
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+Tree<T, Alloc>::PreOrderIterator::PreOrderIterator(const PostOrderIterator& postIt) : _cursor(postIt._pointer, postIt._pointer) {
+   TreeIterator<T, Alloc>::setPointer(postIt._pointer);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+Tree<T, Alloc>::PreOrderIterator::PreOrderIterator(TreeNode<T, Alloc>* data, unsigned int maxDepth) :
+   TreeIterator<T, Alloc>(data),
+   _cursor(data, data, maxDepth)
+{
+   // Nothing to do
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+Tree<T, Alloc>::PreOrderIterator::PreOrderIterator(const PreOrderIterator& source) : TreeIterator<T, Alloc>(source), _cursor(source._cursor) {
+   // Nothing to do
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+Tree<T, Alloc>::PreOrderIterator::~PreOrderIterator() {
+   // Nothing to do
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+typename Tree<T, Alloc>::PreOrderIterator& Tree<T, Alloc>::PreOrderIterator::operator=(const TreeIterator<T, Alloc>& rhs) {
+   if(this != &rhs) {
+      TreeIterator<T, Alloc>::operator=(rhs);
+
+      // Start a new traversal from the assigned node
+      startAt(TreeIterator<T, Alloc>::getPointer());
+   }
+
+   return *this;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+typename Tree<T, Alloc>::PreOrderIterator& Tree<T, Alloc>::PreOrderIterator::operator=(const PreOrderIterator& rhs) {
+   if(this != &rhs) {
+      TreeIterator<T, Alloc>::operator=(rhs);
+      _cursor = rhs._cursor;
+   }
+
+   return *this;
+}
+
+//______________________________________________________________________________
+
+// THE CURRENT NODE CAN'T BE NULL
+template <class T, class Alloc>
+typename Tree<T, Alloc>::PreOrderIterator& Tree<T, Alloc>::PreOrderIterator::operator++() {
+   _cursor.nextPreOrder();
+   TreeIterator<T, Alloc>::setPointer(_cursor._node);
+
+   return *this;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+typename Tree<T, Alloc>::PreOrderIterator Tree<T, Alloc>::PreOrderIterator::operator++(int notUsed) {
+   PreOrderIterator tmp(*this);
+   ++(*this);
+   return tmp;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+void Tree<T, Alloc>::PreOrderIterator::skipChildren() {
+   _cursor.skipChildren();
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+unsigned int Tree<T, Alloc>::PreOrderIterator::depth() const {
+   return _cursor.depth();
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+void Tree<T, Alloc>::PreOrderIterator::setPrefetch(TreePrefetchMode mode) {
+   _cursor.setPrefetch(mode);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+void Tree<T, Alloc>::PreOrderIterator::startAt(TreeNode<T, Alloc>* node) {
+   TreeIterator<T, Alloc>::setPointer(node);
+   _cursor = TreeCursor<T, Alloc>(node, node);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+TreeIterator<T, Alloc>& Tree<T, Alloc>::PreOrderIterator::parent() {
+   static Tree<T, Alloc>::PreOrderIterator tmp;
+   tmp.startAt(TreeIterator<T, Alloc>::getPointer()->_parent);
+   return tmp;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+TreeIterator<T, Alloc>& Tree<T, Alloc>::PreOrderIterator::firstChild() {
+   static Tree<T, Alloc>::PreOrderIterator tmp;
+
+   // Update the current child selected
+   TreeIterator<T, Alloc>::_currentChild = TreeIterator<T, Alloc>::getPointer()->_children.begin();
+
+   // Build a pre-order iterator
+   tmp.startAt(*TreeIterator<T, Alloc>::_currentChild);
+   return tmp;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+TreeIterator<T, Alloc>& Tree<T, Alloc>::PreOrderIterator::lastChild() {
+   static Tree<T, Alloc>::PreOrderIterator tmp;
+
+   // Update the current child selected
+   TreeIterator<T, Alloc>::_currentChild = --(TreeIterator<T, Alloc>::getPointer()->_children.end());
+
+   // Build a pre-order iterator
+   tmp.startAt(*TreeIterator<T, Alloc>::_currentChild);
+   return tmp;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+TreeIterator<T, Alloc>& Tree<T, Alloc>::PreOrderIterator::nextChild() {
+   static Tree<T, Alloc>::PreOrderIterator tmp;
+
+   // Update iterator position
+   ++TreeIterator<T, Alloc>::_currentChild;
+
+   tmp.startAt(*TreeIterator<T, Alloc>::_currentChild);
+   return tmp;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+TreeIterator<T, Alloc>& Tree<T, Alloc>::PreOrderIterator::previousChild() {
+   static Tree<T, Alloc>::PreOrderIterator tmp;
+
+   // Update iterator position
+   --TreeIterator<T, Alloc>::_currentChild;
+
+   tmp.startAt(*TreeIterator<T, Alloc>::_currentChild);
+   return tmp;
+}
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+// *****************************************************************************
+// *****************************************************************************
+// *****************************************************************************
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                      POST-ORDER ITERATOR HEADER                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// *****************************************************************************
+// *****************************************************************************
+// *****************************************************************************
+
+/**
+ * Post-order iterator to iterate on a tree structure.
+ *
+ * This class allows the user to iterate through a tree in a post-order fashion. It
+ * also lets the user navigate through descendants and ancestors in a secuential fashion.
+ *
+ * The iterator only traverses the subtree hanging from the node it was built
+ * with. It moves through the tree using a 'TreeCursor', so it doesn't hold any
+ * heap state and copying it is as cheap as copying a couple of pointers. The
+ * traversal can be limited to a maximum depth, in which case the nodes at that
+ * depth are visited as if they were leaves.
+ *
+ * @author Francisco Aisa García
+ * @version 0.1
+ */
+template <class T, class Alloc>
+class Tree<T, Alloc>::PostOrderIterator : public TreeIterator<T, Alloc> {
+   public:
+      // =======================================================================
+      //                     CONSTRUCTORS AND DESTRUCTORS
+      // =======================================================================
+
+
+      /**
+       * Default constructor.
+       *
+       * It makes the iterator pointer point to NULL.
+       */
+      inline PostOrderIterator();
+
+      //________________________________________________________________________
+
+      /**
+       * Conversion constructor.
+       *
+       * It transforms a pre-order iterator into a post-order iterator. In the tree
+       * class, when new nodes are inserted/created, pre-order iterators to them
+       * are returned. For the sake of uniformity, post-order iterators can be used
+       * with those methods thanks to this conversion constructor. Use it with care
+       * since is not as efficient as using a pre-order iterator (due to the construction
+       * of a temporary iterator).
+       *
+       * @param preIt 'PreOrderIterator' to be converted.
+       */
+      PostOrderIterator(const PreOrderIterator& preIt);
+
+      //________________________________________________________________________
+
+      /**
+       * Custom constructor.
+       *
+       * Note that when the post-order iterator is constructed, the iterator actually
+       * doesn't point to the node pointed by the iterator given, instead, it points
+       * to the first node to be retreived in post-order.
+       *
+       * @param data Pointer to the 'TreeNode' that this iterator will point.
+       * @param maxDepth Nodes deeper than this (relative to 'data') are not
+       * visited.
+       */
+      PostOrderIterator(TreeNode<T, Alloc>* data, unsigned int maxDepth = TREE_UNLIMITED_DEPTH);
+
+      //________________________________________________________________________
+
+      /**
+       * Copy constructor.
+       *
+       * The copy points to the same node and traverses the same subtree.
+       *
+       * @param source Source post-order iterator to be copied.
+       */
+      inline PostOrderIterator(const PostOrderIterator& source);
+
+      //________________________________________________________________________
+
+      /** Destructor. */
+      inline virtual ~PostOrderIterator();
+
+
+      // =======================================================================
+      //                               OPERATORS
+      // =======================================================================
+
+
+      /**
+       * Assignment operator.
+       *
+       * 'this' iterator will point to the same node and traverse the same subtree
+       * as the right hand side iterator.
+       *
+       * @param rhs Right hand side 'PostOrderIterator' to be assigned.
+       * @return A reference to 'this' 'PostOrderIterator'.
+       */
+      inline PostOrderIterator& operator=(const PostOrderIterator& rhs);
+
+      //________________________________________________________________________
+
+      /**
+       * Pre-increment operator.
+       *
+       * Each time this operator is executed, the next node (following the post-order
+       * fashion) will be retrieved.
+       *
+       * @return A reference to 'this' 'PostOrderIterator'.
+       */
+      virtual PostOrderIterator& operator++();
+
+      //________________________________________________________________________
+
+      /**
+       * Post-increment operator.
+       *
+       * Each time this operator is executed, the next node (following the post-order
+       * fashion) will be retrieved.
+       *
+       * @param notUsed This argument is not used.
+       * @return A 'PostOrderIterator' to the node that the iterator pointed to before
+       * iterating to the next node.
+       */
+      inline PostOrderIterator operator++(int notUsed);
+
+
+      // =======================================================================
+      //                          TRAVERSAL CONTROL
+      // =======================================================================
+
+
+      /**
+       * Get the depth of the current node.
+       *
+       * @return The distance from the node where the traversal started to the
+       * current node.
+       */
+      inline unsigned int depth() const;
+
+      //________________________________________________________________________
+
+      /**
+       * Prefetch what leads to the next node each time the iterator moves.
+       *
+       * It only pays off when the tree doesn't fit in cache. Copies of the
+       * iterator prefetch too, but assigning a new node to it turns it off.
+       *
+       * @param mode What is prefetched (see 'TreePrefetchMode').
+       */
+      inline void setPrefetch(TreePrefetchMode mode);
+
+
+      // =======================================================================
+      //                            ELEMENT ACCESS
+      // =======================================================================
+
+
+      /**
+       * Returns a tree iterator to the parent node of the node pointed by 'this'
+       * iterator if any.
+       *
+       * @return A 'PostOrderIterator' to the parent node.
+       */
+      inline virtual TreeIterator<T, Alloc>& parent();
+
+      //________________________________________________________________________
+
+      /**
+       * Returns a tree iterator to the first child node of the node pointed by 'this'
+       * iterator.
+       *
+       * @return A 'PostOrderIterator' to the first child of the node pointed by
+       * 'this' iterator.
+       */
+      virtual TreeIterator<T, Alloc>& firstChild();
+
+      //________________________________________________________________________
+
+      /**
+       * Returns a tree iterator to the last child node of the node pointed by 'this'
+       * iterator.
+       *
+       * @return A 'PostOrderIterator' to the last child of the node pointed by 'this'
+       * iterator.
+       */
+      virtual TreeIterator<T, Alloc>& lastChild();
+
+      //________________________________________________________________________
+
+      /**
+       * Returns a tree iterator to the next child node of the node pointed by 'this'
+       * iterator.
+       *
+       * The next child returned will depend on the last access we made to the
+       * current node. Please note that this method doesn't do any kind of range
+       * checking, which means that the client is responsible for iterating through
+       * the node's children safely.
+       *
+       * @return A 'PostOrderIterator' to the next child of the node pointed by 'this'
+       * iterator.
+       */
+      virtual TreeIterator<T, Alloc>& nextChild();
+
+      //________________________________________________________________________
+
+      /**
+       * Returns a tree iterator to the previous child node of the node pointed by 'this'
+       * iterator.
+       *
+       * The previous child returned will depend on the last access we made to the
+       * current node. Please note that this method doesn't do any kind of range
+       * checking, which means that the client is responsible for iterating through
+       * the node's children safely.
+       *
+       * @return A 'PostOrderIterator' to the previous child of the node pointed by 'this'
+       * iterator.
+       */
+      virtual TreeIterator<T, Alloc>& previousChild();
+
+   private:
+      // =======================================================================
+      //                            FRIEND METHODS
+      // =======================================================================
+
+
+      friend PostOrderIterator Tree<T, Alloc>::postBegin() const;
+      friend PostOrderIterator Tree<T, Alloc>::postEnd() const;
+
+
+      // =======================================================================
+      //                            PRIVATE METHODS
+      // =======================================================================
+
+
+      /**
+       * Point to the given node and start a new traversal from it.
+       *
+       * @param node Pointer to the 'TreeNode' that this iterator will point.
+       */
+      inline void startAt(TreeNode<T, Alloc>* node);
+
+
+      // =======================================================================
+      //                            PRIVATE FIELDS
+      // =======================================================================
+
+
+      /** Cursor that keeps the state of the traversal. */
+      TreeCursor<T, Alloc> _cursor;
+};
+
+// *****************************************************************************
+// *****************************************************************************
+// *****************************************************************************
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                  POST-ORDER ITERATOR IMPLEMENTATION                   ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// *****************************************************************************
+// *****************************************************************************
+// *****************************************************************************
+
+// Parent sets _pointer to NULL
+template <class T, class Alloc>
+Tree<T, Alloc>::PostOrderIterator::PostOrderIterator() {
+   // Nothing to do
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+Tree<T, Alloc>::PostOrderIterator::PostOrderIterator(const PreOrderIterator& preIt) : _cursor(preIt._pointer, preIt._pointer) {
+   if(preIt._pointer != NULL)
+      _cursor.firstPostOrder();
+
+   TreeIterator<T, Alloc>::setPointer(_cursor._node);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+Tree<T, Alloc>::PostOrderIterator::PostOrderIterator(TreeNode<T, Alloc>* data, unsigned int maxDepth) :
+   TreeIterator<T, Alloc>(data),
+   _cursor(data, data, maxDepth)
+{
+   if(data != NULL) {
+      _cursor.firstPostOrder();
+      TreeIterator<T, Alloc>::setPointer(_cursor._node);
+   }
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+Tree<T, Alloc>::PostOrderIterator::PostOrderIterator(const PostOrderIterator& source) : TreeIterator<T, Alloc>(source), _cursor(source._cursor) {
+   // Nothing to do
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+Tree<T, Alloc>::PostOrderIterator::~PostOrderIterator() {
+   // Nothing to do
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+typename Tree<T, Alloc>::PostOrderIterator& Tree<T, Alloc>::PostOrderIterator::operator=(const PostOrderIterator& rhs) {
+   if(this != &rhs) {
+      TreeIterator<T, Alloc>::operator=(rhs);
+      _cursor = rhs._cursor;
+   }
+
+   return *this;
+}
+
+//______________________________________________________________________________
+
+// THE CURRENT NODE CAN'T BE NULL
+template <class T, class Alloc>
+typename Tree<T, Alloc>::PostOrderIterator& Tree<T, Alloc>::PostOrderIterator::operator++() {
+   _cursor.nextPostOrder();
+   TreeIterator<T, Alloc>::setPointer(_cursor._node);
+
+   return *this;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+typename Tree<T, Alloc>::PostOrderIterator Tree<T, Alloc>::PostOrderIterator::operator++(int notUsed) {
+   PostOrderIterator tmp(*this);
+   ++(*this);
+   return tmp;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+unsigned int Tree<T, Alloc>::PostOrderIterator::depth() const {
+   return _cursor.depth();
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+void Tree<T, Alloc>::PostOrderIterator::setPrefetch(TreePrefetchMode mode) {
+   _cursor.setPrefetch(mode);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+void Tree<T, Alloc>::PostOrderIterator::startAt(TreeNode<T, Alloc>* node) {
+   TreeIterator<T, Alloc>::setPointer(node);
+   _cursor = TreeCursor<T, Alloc>(node, node);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+TreeIterator<T, Alloc>& Tree<T, Alloc>::PostOrderIterator::parent() {
+   static Tree<T, Alloc>::PostOrderIterator tmp;
+   tmp.startAt(TreeIterator<T, Alloc>::getPointer()->_parent);
+   return tmp;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+TreeIterator<T, Alloc>& Tree<T, Alloc>::PostOrderIterator::firstChild() {
+   static Tree<T, Alloc>::PostOrderIterator tmp;
+
+   // Update the current child selected
+   TreeIterator<T, Alloc>::_currentChild = TreeIterator<T, Alloc>::getPointer()->_children.begin();
+
+   // Build a post-order iterator
+   tmp.startAt(*TreeIterator<T, Alloc>::_currentChild);
+   return tmp;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+TreeIterator<T, Alloc>& Tree<T, Alloc>::PostOrderIterator::lastChild() {
+   static Tree<T, Alloc>::PostOrderIterator tmp;
+
+   // Update the current child selected
+   TreeIterator<T, Alloc>::_currentChild = --(TreeIterator<T, Alloc>::getPointer()->_children.end());
+
+   // Build a post-order iterator
+   tmp.startAt(*TreeIterator<T, Alloc>::_currentChild);
+   return tmp;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+TreeIterator<T, Alloc>& Tree<T, Alloc>::PostOrderIterator::nextChild() {
+   static Tree<T, Alloc>::PostOrderIterator tmp;
+
+   // Update iterator position
+   ++TreeIterator<T, Alloc>::_currentChild;
+
+   tmp.startAt(*TreeIterator<T, Alloc>::_currentChild);
+   return tmp;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+TreeIterator<T, Alloc>& Tree<T, Alloc>::PostOrderIterator::previousChild() {
+   static Tree<T, Alloc>::PostOrderIterator tmp;
+
+   // Update iterator position
+   --TreeIterator<T, Alloc>::_currentChild;
+
+   tmp.startAt(*TreeIterator<T, Alloc>::_currentChild);
+   return tmp;
+}
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+// *****************************************************************************
+// *****************************************************************************
+// *****************************************************************************
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                         LEAF ITERATOR HEADER                          ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// *****************************************************************************
+// *****************************************************************************
+// *****************************************************************************
+
+/**
+ * Leaf iterator to iterate on a tree structure.
+ *
+ * This class allows the user to iterate through the leaves of a tree, from left
+ * to right. It also lets the user navigate through descendants and ancestors in a
+ * secuential fashion.
+ *
+ * The iterator only traverses the leaves of the subtree hanging from the node it
+ * was built with. It jumps from one leaf to the next one going up to the closest
+ * ancestor with a next sibling and down to the leftmost leaf of that sibling, so
+ * interior nodes are crossed at most twice and never visited. Like the other
+ * iterators, it moves through the tree using a 'TreeCursor'.
+ *
+ * @author Francisco Aisa García
+ * @version 0.1
+ */
+template <class T, class Alloc>
+class Tree<T, Alloc>::LeafIterator : public TreeIterator<T, Alloc> {
+   public:
+      // =======================================================================
+      //                     CONSTRUCTORS AND DESTRUCTORS
+      // =======================================================================
+
+
+      /**
+       * Default constructor.
+       *
+       * It makes the iterator pointer point to NULL.
+       */
+      inline LeafIterator();
+
+      //________________________________________________________________________
+
+      /**
+       * Custom constructor.
+       *
+       * Note that when the leaf iterator is constructed, the iterator actually
+       * doesn't point to the node pointed by the iterator given, instead, it points
+       * to the leftmost leaf hanging from it.
+       *
+       * @param data Pointer to the 'TreeNode' whose leaves will be traversed.
+       */
+      LeafIterator(TreeNode<T, Alloc>* data);
+
+      //________________________________________________________________________
+
+      /**
+       * Copy constructor.
+       *
+       * The copy points to the same node and traverses the same subtree.
+       *
+       * @param source Source leaf iterator to be copied.
+       */
+      inline LeafIterator(const LeafIterator& source);
+
+      //________________________________________________________________________
+
+      /** Destructor. */
+      inline virtual ~LeafIterator();
+
+
+      // =======================================================================
+      //                               OPERATORS
+      // =======================================================================
+
+
+      /**
+       * Assignment operator.
+       *
+       * 'this' iterator will point to the same node and traverse the same subtree
+       * as the right hand side iterator.
+       *
+       * @param rhs Right hand side 'LeafIterator' to be assigned.
+       * @return A reference to 'this' 'LeafIterator'.
+       */
+      inline LeafIterator& operator=(const LeafIterator& rhs);
+
+      //________________________________________________________________________
+
+      /**
+       * Pre-increment operator.
+       *
+       * Each time this operator is executed, the next leaf will be retrieved.
+       *
+       * @return A reference to 'this' 'LeafIterator'.
+       */
+      virtual LeafIterator& operator++();
+
+      //________________________________________________________________________
+
+      /**
+       * Post-increment operator.
+       *
+       * Each time this operator is executed, the next leaf will be retrieved.
+       *
+       * @param notUsed This argument is not used.
+       * @return A 'LeafIterator' to the leaf that the iterator pointed to before
+       * iterating to the next leaf.
+       */
+      inline LeafIterator operator++(int notUsed);
+
+
+      // =======================================================================
+      //                          TRAVERSAL CONTROL
+      // =======================================================================
+
+
+      /**
+       * Get the depth of the current node.
+       *
+       * @return The distance from the node where the traversal started to the
+       * current node.
+       */
+      inline unsigned int depth() const;
+
+      //________________________________________________________________________
+
+      /**
+       * Prefetch what leads to the next node each time the iterator moves.
+       *
+       * It only pays off when the tree doesn't fit in cache. Copies of the
+       * iterator prefetch too, but assigning a new node to it turns it off.
+       *
+       * @param mode What is prefetched (see 'TreePrefetchMode').
+       */
+      inline void setPrefetch(TreePrefetchMode mode);
+
+
+      // =======================================================================
+      //                            ELEMENT ACCESS
+      // =======================================================================
+
+
+      /**
+       * Returns a tree iterator to the parent node of the node pointed by 'this'
+       * iterator if any.
+       *
+       * @return A 'LeafIterator' to the parent node.
+       */
+      inline virtual TreeIterator<T, Alloc>& parent();
+
+      //________________________________________________________________________
+
+      /**
+       * Returns a tree iterator to the first child node of the node pointed by 'this'
+       * iterator.
+       *
+       * @return A 'LeafIterator' to the first child of the node pointed by
+       * 'this' iterator.
+       */
+      virtual TreeIterator<T, Alloc>& firstChild();
+
+      //________________________________________________________________________
+
+      /**
+       * Returns a tree iterator to the last child node of the node pointed by 'this'
+       * iterator.
+       *
+       * @return A 'LeafIterator' to the last child of the node pointed by 'this'
+       * iterator.
+       */
+      virtual TreeIterator<T, Alloc>& lastChild();
+
+      //________________________________________________________________________
+
+      /**
+       * Returns a tree iterator to the next child node of the node pointed by 'this'
+       * iterator.
+       *
+       * The next child returned will depend on the last access we made to the
+       * current node. Please note that this method doesn't do any kind of range
+       * checking, which means that the client is responsible for iterating through
+       * the node's children safely.
+       *
+       * @return A 'LeafIterator' to the next child of the node pointed by 'this'
+       * iterator.
+       */
+      virtual TreeIterator<T, Alloc>& nextChild();
+
+      //________________________________________________________________________
+
+      /**
+       * Returns a tree iterator to the previous child node of the node pointed by 'this'
+       * iterator.
+       *
+       * The previous child returned will depend on the last access we made to the
+       * current node. Please note that this method doesn't do any kind of range
+       * checking, which means that the client is responsible for iterating through
+       * the node's children safely.
+       *
+       * @return A 'LeafIterator' to the previous child of the node pointed by 'this'
+       * iterator.
+       */
+      virtual TreeIterator<T, Alloc>& previousChild();
+
+   private:
+      // =======================================================================
+      //                            FRIEND METHODS
+      // =======================================================================
+
+
+      friend LeafIterator Tree<T, Alloc>::leafBegin() const;
+      friend LeafIterator Tree<T, Alloc>::leafEnd() const;
+      friend LeafIterator Tree<T, Alloc>::leafAt(const TreeIterator<T, Alloc>& subtreeRoot, std::size_t k) const;
+
+
+      // =======================================================================
+      //                            PRIVATE METHODS
+      // =======================================================================
+
+
+      /**
+       * Point to the given node and start a new traversal from it.
+       *
+       * @param node Pointer to the 'TreeNode' that this iterator will point.
+       */
+      inline void startAt(TreeNode<T, Alloc>* node);
+
+
+      // =======================================================================
+      //                            PRIVATE FIELDS
+      // =======================================================================
+
+
+      /** Cursor that keeps the state of the traversal. */
+      TreeCursor<T, Alloc> _cursor;
+};
+
+// *****************************************************************************
+// *****************************************************************************
+// *****************************************************************************
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                     LEAF ITERATOR IMPLEMENTATION                      ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// *****************************************************************************
+// *****************************************************************************
+// *****************************************************************************
+
+// Parent sets _pointer to NULL
+template <class T, class Alloc>
+Tree<T, Alloc>::LeafIterator::LeafIterator() {
+   // Nothing to do
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+Tree<T, Alloc>::LeafIterator::LeafIterator(TreeNode<T, Alloc>* data) : TreeIterator<T, Alloc>(data), _cursor(data, data) {
+   if(data != NULL) {
+      _cursor.firstPostOrder();
+      TreeIterator<T, Alloc>::setPointer(_cursor._node);
+   }
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+Tree<T, Alloc>::LeafIterator::LeafIterator(const LeafIterator& source) : TreeIterator<T, Alloc>(source), _cursor(source._cursor) {
+   // Nothing to do
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+Tree<T, Alloc>::LeafIterator::~LeafIterator() {
+   // Nothing to do
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+typename Tree<T, Alloc>::LeafIterator& Tree<T, Alloc>::LeafIterator::operator=(const LeafIterator& rhs) {
+   if(this != &rhs) {
+      TreeIterator<T, Alloc>::operator=(rhs);
+      _cursor = rhs._cursor;
+   }
+
+   return *this;
+}
+
+//______________________________________________________________________________
+
+// THE CURRENT NODE CAN'T BE NULL
+template <class T, class Alloc>
+typename Tree<T, Alloc>::LeafIterator& Tree<T, Alloc>::LeafIterator::operator++() {
+   _cursor.nextLeaf();
+   TreeIterator<T, Alloc>::setPointer(_cursor._node);
+
+   return *this;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+typename Tree<T, Alloc>::LeafIterator Tree<T, Alloc>::LeafIterator::operator++(int notUsed) {
+   LeafIterator tmp(*this);
+   ++(*this);
+   return tmp;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+unsigned int Tree<T, Alloc>::LeafIterator::depth() const {
+   return _cursor.depth();
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+void Tree<T, Alloc>::LeafIterator::setPrefetch(TreePrefetchMode mode) {
+   _cursor.setPrefetch(mode);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+void Tree<T, Alloc>::LeafIterator::startAt(TreeNode<T, Alloc>* node) {
+   TreeIterator<T, Alloc>::setPointer(node);
+   _cursor = TreeCursor<T, Alloc>(node, node);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+TreeIterator<T, Alloc>& Tree<T, Alloc>::LeafIterator::parent() {
+   static Tree<T, Alloc>::LeafIterator tmp;
+   tmp.startAt(TreeIterator<T, Alloc>::getPointer()->_parent);
+   return tmp;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+TreeIterator<T, Alloc>& Tree<T, Alloc>::LeafIterator::firstChild() {
+   static Tree<T, Alloc>::LeafIterator tmp;
+
+   // Update the current child selected
+   TreeIterator<T, Alloc>::_currentChild = TreeIterator<T, Alloc>::getPointer()->_children.begin();
+
+   // Build a leaf iterator
+   tmp.startAt(*TreeIterator<T, Alloc>::_currentChild);
+   return tmp;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+TreeIterator<T, Alloc>& Tree<T, Alloc>::LeafIterator::lastChild() {
+   static Tree<T, Alloc>::LeafIterator tmp;
+
+   // Update the current child selected
+   TreeIterator<T, Alloc>::_currentChild = --(TreeIterator<T, Alloc>::getPointer()->_children.end());
+
+   // Build a leaf iterator
+   tmp.startAt(*TreeIterator<T, Alloc>::_currentChild);
+   return tmp;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+TreeIterator<T, Alloc>& Tree<T, Alloc>::LeafIterator::nextChild() {
+   static Tree<T, Alloc>::LeafIterator tmp;
+
+   // Update iterator position
+   ++TreeIterator<T, Alloc>::_currentChild;
+
+   tmp.startAt(*TreeIterator<T, Alloc>::_currentChild);
+   return tmp;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+TreeIterator<T, Alloc>& Tree<T, Alloc>::LeafIterator::previousChild() {
+   static Tree<T, Alloc>::LeafIterator tmp;
+
+   // Update iterator position
+   --TreeIterator<T, Alloc>::_currentChild;
+
+   tmp.startAt(*TreeIterator<T, Alloc>::_currentChild);
+   return tmp;
+}
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+// *****************************************************************************
+// *****************************************************************************
+// *****************************************************************************
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                   REVERSE PRE-ORDER ITERATOR HEADER                   ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// *****************************************************************************
+// *****************************************************************************
+// *****************************************************************************
+
+/**
+ * Reverse pre-order iterator to iterate on a tree structure.
+ *
+ * This class allows the user to iterate through a tree visiting the nodes in the
+ * opposite order to a pre-order traversal: the rightmost leaf first and the root
+ * last. It also lets the user navigate through descendants and ancestors in a
+ * secuential fashion.
+ *
+ * The iterator only traverses the subtree hanging from the node it was built
+ * with. Like the other iterators it moves through the tree using a 'TreeCursor',
+ * walking the children from right to left, so it doesn't need to materialize the
+ * forward traversal and costs the same as a post-order iterator.
+ *
+ * @author Francisco Aisa García
+ * @version 0.1
+ */
+template <class T, class Alloc>
+class Tree<T, Alloc>::ReversePreOrderIterator : public TreeIterator<T, Alloc> {
+   public:
+      // =======================================================================
+      //                     CONSTRUCTORS AND DESTRUCTORS
+      // =======================================================================
+
+
+      /**
+       * Default constructor.
+       *
+       * It makes the iterator pointer point to NULL.
+       */
+      inline ReversePreOrderIterator();
+
+      //________________________________________________________________________
+
+      /**
+       * Custom constructor.
+       *
+       * Note that when the reverse pre-order iterator is constructed, the iterator
+       * doesn't point to the node given, instead, it points to the last node in
+       * pre-order of the subtree hanging from it (its rightmost leaf).
+       *
+       * @param data Pointer to the 'TreeNode' whose subtree will be traversed.
+       * @param maxDepth Nodes deeper than this (relative to 'data') are not
+       * visited.
+       */
+      ReversePreOrderIterator(TreeNode<T, Alloc>* data, unsigned int maxDepth = TREE_UNLIMITED_DEPTH);
+
+      //________________________________________________________________________
+
+      /**
+       * Copy constructor.
+       *
+       * The copy points to the same node and traverses the same subtree.
+       *
+       * @param source Source reverse pre-order iterator to be copied.
+       */
+      inline ReversePreOrderIterator(const ReversePreOrderIterator& source);
+
+      //________________________________________________________________________
+
+      /** Destructor. */
+      inline virtual ~ReversePreOrderIterator();
+
+
+      // =======================================================================
+      //                               OPERATORS
+      // =======================================================================
+
+
+      /**
+       * Assignment operator.
+       *
+       * 'this' iterator will point to the same node and traverse the same subtree
+       * as the right hand side iterator.
+       *
+       * @param rhs Right hand side 'ReversePreOrderIterator' to be assigned.
+       * @return A reference to 'this' 'ReversePreOrderIterator'.
+       */
+      inline ReversePreOrderIterator& operator=(const ReversePreOrderIterator& rhs);
+
+      //________________________________________________________________________
+
+      /**
+       * Pre-increment operator.
+       *
+       * Each time this operator is executed, the next node (following the reverse pre-order
+       * fashion) will be retrieved.
+       *
+       * @return A reference to 'this' 'ReversePreOrderIterator'.
+       */
+      virtual ReversePreOrderIterator& operator++();
+
+      //________________________________________________________________________
+
+      /**
+       * Post-increment operator.
+       *
+       * Each time this operator is executed, the next node (following the reverse pre-order
+       * fashion) will be retrieved.
+       *
+       * @param notUsed This argument is not used.
+       * @return A 'ReversePreOrderIterator' to the node that the iterator pointed to before
+       * iterating to the next node.
+       */
+      inline ReversePreOrderIterator operator++(int notUsed);
+
+
+      // =======================================================================
+      //                          TRAVERSAL CONTROL
+      // =======================================================================
+
+
+      /**
+       * Get the depth of the current node.
+       *
+       * @return The distance from the node where the traversal started to the
+       * current node.
+       */
+      inline unsigned int depth() const;
+
+
+      // =======================================================================
+      //                            ELEMENT ACCESS
+      // =======================================================================
+
+
+      /**
+       * Returns a tree iterator to the parent node of the node pointed by 'this'
+       * iterator if any.
+       *
+       * @return A 'ReversePreOrderIterator' to the parent node.
+       */
+      inline virtual TreeIterator<T, Alloc>& parent();
+
+      //________________________________________________________________________
+
+      /**
+       * Returns a tree iterator to the first child node of the node pointed by 'this'
+       * iterator.
+       *
+       * @return A 'ReversePreOrderIterator' to the first child of the node pointed by
+       * 'this' iterator.
+       */
+      virtual TreeIterator<T, Alloc>& firstChild();
+
+      //________________________________________________________________________
+
+      /**
+       * Returns a tree iterator to the last child node of the node pointed by 'this'
+       * iterator.
+       *
+       * @return A 'ReversePreOrderIterator' to the last child of the node pointed by 'this'
+       * iterator.
+       */
+      virtual TreeIterator<T, Alloc>& lastChild();
+
+      //________________________________________________________________________
+
+      /**
+       * Returns a tree iterator to the next child node of the node pointed by 'this'
+       * iterator.
+       *
+       * The next child returned will depend on the last access we made to the
+       * current node. Please note that this method doesn't do any kind of range
+       * checking, which means that the client is responsible for iterating through
+       * the node's children safely.
+       *
+       * @return A 'ReversePreOrderIterator' to the next child of the node pointed by 'this'
+       * iterator.
+       */
+      virtual TreeIterator<T, Alloc>& nextChild();
+
+      //________________________________________________________________________
+
+      /**
+       * Returns a tree iterator to the previous child node of the node pointed by 'this'
+       * iterator.
+       *
+       * The previous child returned will depend on the last access we made to the
+       * current node. Please note that this method doesn't do any kind of range
+       * checking, which means that the client is responsible for iterating through
+       * the node's children safely.
+       *
+       * @return A 'ReversePreOrderIterator' to the previous child of the node pointed by 'this'
+       * iterator.
+       */
+      virtual TreeIterator<T, Alloc>& previousChild();
+
+   private:
+      // =======================================================================
+      //                            FRIEND METHODS
+      // =======================================================================
+
+
+      friend ReversePreOrderIterator Tree<T, Alloc>::preRBegin() const;
+      friend ReversePreOrderIterator Tree<T, Alloc>::preREnd() const;
+
+
+      // =======================================================================
+      //                            PRIVATE METHODS
+      // =======================================================================
+
+
+      /**
+       * Point to the given node and start a new traversal from it.
+       *
+       * @param node Pointer to the 'TreeNode' that this iterator will point.
+       */
+      inline void startAt(TreeNode<T, Alloc>* node);
+
+
+      // =======================================================================
+      //                            PRIVATE FIELDS
+      // =======================================================================
+
+
+      /** Cursor that keeps the state of the traversal. */
+      TreeCursor<T, Alloc> _cursor;
+};
+
+// *****************************************************************************
+// *****************************************************************************
+// *****************************************************************************
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***               REVERSE PRE-ORDER ITERATOR IMPLEMENTATION               ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// *****************************************************************************
+// *****************************************************************************
+// *****************************************************************************
+
+// Parent sets _pointer to NULL
+template <class T, class Alloc>
+Tree<T, Alloc>::ReversePreOrderIterator::ReversePreOrderIterator() {
+   // Nothing to do
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+Tree<T, Alloc>::ReversePreOrderIterator::ReversePreOrderIterator(TreeNode<T, Alloc>* data, unsigned int maxDepth) :
+   TreeIterator<T, Alloc>(data),
+   _cursor(data, data, maxDepth)
+{
+   if(data != NULL) {
+      _cursor.lastPreOrder();
+      TreeIterator<T, Alloc>::setPointer(_cursor._node);
+   }
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+Tree<T, Alloc>::ReversePreOrderIterator::ReversePreOrderIterator(const ReversePreOrderIterator& source) : TreeIterator<T, Alloc>(source), _cursor(source._cursor) {
+   // Nothing to do
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+Tree<T, Alloc>::ReversePreOrderIterator::~ReversePreOrderIterator() {
+   // Nothing to do
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+typename Tree<T, Alloc>::ReversePreOrderIterator& Tree<T, Alloc>::ReversePreOrderIterator::operator=(const ReversePreOrderIterator& rhs) {
+   if(this != &rhs) {
+      TreeIterator<T, Alloc>::operator=(rhs);
+      _cursor = rhs._cursor;
+   }
+
+   return *this;
+}
+
+//______________________________________________________________________________
+
+// THE CURRENT NODE CAN'T BE NULL
+template <class T, class Alloc>
+typename Tree<T, Alloc>::ReversePreOrderIterator& Tree<T, Alloc>::ReversePreOrderIterator::operator++() {
+   _cursor.previousPreOrder();
+   TreeIterator<T, Alloc>::setPointer(_cursor._node);
+
+   return *this;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+typename Tree<T, Alloc>::ReversePreOrderIterator Tree<T, Alloc>::ReversePreOrderIterator::operator++(int notUsed) {
+   ReversePreOrderIterator tmp(*this);
+   ++(*this);
+   return tmp;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+unsigned int Tree<T, Alloc>::ReversePreOrderIterator::depth() const {
+   return _cursor.depth();
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+void Tree<T, Alloc>::ReversePreOrderIterator::startAt(TreeNode<T, Alloc>* node) {
+   TreeIterator<T, Alloc>::setPointer(node);
+   _cursor = TreeCursor<T, Alloc>(node, node);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+TreeIterator<T, Alloc>& Tree<T, Alloc>::ReversePreOrderIterator::parent() {
+   static Tree<T, Alloc>::ReversePreOrderIterator tmp;
+   tmp.startAt(TreeIterator<T, Alloc>::getPointer()->_parent);
+   return tmp;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+TreeIterator<T, Alloc>& Tree<T, Alloc>::ReversePreOrderIterator::firstChild() {
+   static Tree<T, Alloc>::ReversePreOrderIterator tmp;
+
+   // Update the current child selected
+   TreeIterator<T, Alloc>::_currentChild = TreeIterator<T, Alloc>::getPointer()->_children.begin();
+
+   // Build a reverse pre-order iterator
+   tmp.startAt(*TreeIterator<T, Alloc>::_currentChild);
+   return tmp;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+TreeIterator<T, Alloc>& Tree<T, Alloc>::ReversePreOrderIterator::lastChild() {
+   static Tree<T, Alloc>::ReversePreOrderIterator tmp;
+
+   // Update the current child selected
+   TreeIterator<T, Alloc>::_currentChild = --(TreeIterator<T, Alloc>::getPointer()->_children.end());
+
+   // Build a reverse pre-order iterator
+   tmp.startAt(*TreeIterator<T, Alloc>::_currentChild);
+   return tmp;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+TreeIterator<T, Alloc>& Tree<T, Alloc>::ReversePreOrderIterator::nextChild() {
+   static Tree<T, Alloc>::ReversePreOrderIterator tmp;
+
+   // Update iterator position
+   ++TreeIterator<T, Alloc>::_currentChild;
+
+   tmp.startAt(*TreeIterator<T, Alloc>::_currentChild);
+   return tmp;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+TreeIterator<T, Alloc>& Tree<T, Alloc>::ReversePreOrderIterator::previousChild() {
+   static Tree<T, Alloc>::ReversePreOrderIterator tmp;
+
+   // Update iterator position
+   --TreeIterator<T, Alloc>::_currentChild;
+
+   tmp.startAt(*TreeIterator<T, Alloc>::_currentChild);
+   return tmp;
+}
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+// *****************************************************************************
+// *****************************************************************************
+// *****************************************************************************
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                  REVERSE POST-ORDER ITERATOR HEADER                   ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// *****************************************************************************
+// *****************************************************************************
+// *****************************************************************************
+
+/**
+ * Reverse post-order iterator to iterate on a tree structure.
+ *
+ * This class allows the user to iterate through a tree visiting the nodes in the
+ * opposite order to a post-order traversal: the root first and then the subtrees
+ * of its children, from right to left. It also lets the user navigate through
+ * descendants and ancestors in a secuential fashion.
+ *
+ * The iterator only traverses the subtree hanging from the node it was built
+ * with. Like the other iterators it moves through the tree using a 'TreeCursor',
+ * walking the children from right to left, so it doesn't need to materialize the
+ * forward traversal and costs the same as a pre-order iterator.
+ *
+ * @author Francisco Aisa García
+ * @version 0.1
+ */
+template <class T, class Alloc>
+class Tree<T, Alloc>::ReversePostOrderIterator : public TreeIterator<T, Alloc> {
+   public:
+      // =======================================================================
+      //                     CONSTRUCTORS AND DESTRUCTORS
+      // =======================================================================
+
+
+      /**
+       * Default constructor.
+       *
+       * It makes the iterator pointer point to NULL.
+       */
+      inline ReversePostOrderIterator();
+
+      //________________________________________________________________________
+
+      /**
+       * Custom constructor.
+       *
+       * @param data Pointer to the 'TreeNode' that this iterator will point.
+       * @param maxDepth Nodes deeper than this (relative to 'data') are not
+       * visited.
+       */
+      ReversePostOrderIterator(TreeNode<T, Alloc>* data, unsigned int maxDepth = TREE_UNLIMITED_DEPTH);
+
+      //________________________________________________________________________
+
+      /**
+       * Copy constructor.
+       *
+       * The copy points to the same node and traverses the same subtree.
+       *
+       * @param source Source reverse post-order iterator to be copied.
+       */
+      inline ReversePostOrderIterator(const ReversePostOrderIterator& source);
+
+      //________________________________________________________________________
+
+      /** Destructor. */
+      inline virtual ~ReversePostOrderIterator();
+
+
+      // =======================================================================
+      //                               OPERATORS
+      // =======================================================================
+
+
+      /**
+       * Assignment operator.
+       *
+       * 'this' iterator will point to the same node and traverse the same subtree
+       * as the right hand side iterator.
+       *
+       * @param rhs Right hand side 'ReversePostOrderIterator' to be assigned.
+       * @return A reference to 'this' 'ReversePostOrderIterator'.
+       */
+      inline ReversePostOrderIterator& operator=(const ReversePostOrderIterator& rhs);
+
+      //________________________________________________________________________
+
+      /**
+       * Pre-increment operator.
+       *
+       * Each time this operator is executed, the next node (following the reverse post-order
+       * fashion) will be retrieved.
+       *
+       * @return A reference to 'this' 'ReversePostOrderIterator'.
+       */
+      virtual ReversePostOrderIterator& operator++();
+
+      //________________________________________________________________________
+
+      /**
+       * Post-increment operator.
+       *
+       * Each time this operator is executed, the next node (following the reverse post-order
+       * fashion) will be retrieved.
+       *
+       * @param notUsed This argument is not used.
+       * @return A 'ReversePostOrderIterator' to the node that the iterator pointed to before
+       * iterating to the next node.
+       */
+      inline ReversePostOrderIterator operator++(int notUsed);
+
+
+      // =======================================================================
+      //                          TRAVERSAL CONTROL
+      // =======================================================================
+
+
+      /**
+       * Get the depth of the current node.
+       *
+       * @return The distance from the node where the traversal started to the
+       * current node.
+       */
+      inline unsigned int depth() const;
+
+
+      // =======================================================================
+      //                            ELEMENT ACCESS
+      // =======================================================================
+
+
+      /**
+       * Returns a tree iterator to the parent node of the node pointed by 'this'
+       * iterator if any.
+       *
+       * @return A 'ReversePostOrderIterator' to the parent node.
+       */
+      inline virtual TreeIterator<T, Alloc>& parent();
+
+      //________________________________________________________________________
+
+      /**
+       * Returns a tree iterator to the first child node of the node pointed by 'this'
+       * iterator.
+       *
+       * @return A 'ReversePostOrderIterator' to the first child of the node pointed by
+       * 'this' iterator.
+       */
+      virtual TreeIterator<T, Alloc>& firstChild();
+
+      //________________________________________________________________________
+
+      /**
+       * Returns a tree iterator to the last child node of the node pointed by 'this'
+       * iterator.
+       *
+       * @return A 'ReversePostOrderIterator' to the last child of the node pointed by 'this'
+       * iterator.
+       */
+      virtual TreeIterator<T, Alloc>& lastChild();
+
+      //________________________________________________________________________
+
+      /**
+       * Returns a tree iterator to the next child node of the node pointed by 'this'
+       * iterator.
+       *
+       * The next child returned will depend on the last access we made to the
+       * current node. Please note that this method doesn't do any kind of range
+       * checking, which means that the client is responsible for iterating through
+       * the node's children safely.
+       *
+       * @return A 'ReversePostOrderIterator' to the next child of the node pointed by 'this'
+       * iterator.
+       */
+      virtual TreeIterator<T, Alloc>& nextChild();
+
+      //________________________________________________________________________
+
+      /**
+       * Returns a tree iterator to the previous child node of the node pointed by 'this'
+       * iterator.
+       *
+       * The previous child returned will depend on the last access we made to the
+       * current node. Please note that this method doesn't do any kind of range
+       * checking, which means that the client is responsible for iterating through
+       * the node's children safely.
+       *
+       * @return A 'ReversePostOrderIterator' to the previous child of the node pointed by 'this'
+       * iterator.
+       */
+      virtual TreeIterator<T, Alloc>& previousChild();
+
+   private:
+      // =======================================================================
+      //                            FRIEND METHODS
+      // =======================================================================
+
+
+      friend ReversePostOrderIterator Tree<T, Alloc>::postRBegin() const;
+      friend ReversePostOrderIterator Tree<T, Alloc>::postREnd() const;
+
+
+      // =======================================================================
+      //                            PRIVATE METHODS
+      // =======================================================================
+
+
+      /**
+       * Point to the given node and start a new traversal from it.
+       *
+       * @param node Pointer to the 'TreeNode' that this iterator will point.
+       */
+      inline void startAt(TreeNode<T, Alloc>* node);
+
+
+      // =======================================================================
+      //                            PRIVATE FIELDS
+      // =======================================================================
+
+
+      /** Cursor that keeps the state of the traversal. */
+      TreeCursor<T, Alloc> _cursor;
+};
+
+// *****************************************************************************
+// *****************************************************************************
+// *****************************************************************************
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***              REVERSE POST-ORDER ITERATOR IMPLEMENTATION               ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// *****************************************************************************
+// *****************************************************************************
+// *****************************************************************************
+
+// Parent sets _pointer to NULL
+template <class T, class Alloc>
+Tree<T, Alloc>::ReversePostOrderIterator::ReversePostOrderIterator() {
    // Nothing to do
 }
 
 //______________________________________________________________________________
 
-template <class T>
-TreeIterator<T>::TreeIterator(TreeNode<T>* data) : _pointer(data) {
+template <class T, class Alloc>
+Tree<T, Alloc>::ReversePostOrderIterator::ReversePostOrderIterator(TreeNode<T, Alloc>* data, unsigned int maxDepth) :
+   TreeIterator<T, Alloc>(data),
+   _cursor(data, data, maxDepth)
+{
    // Nothing to do
 }
 
 //______________________________________________________________________________
 
-template <class T>
-TreeIterator<T>::TreeIterator(const TreeIterator<T>& source) : _pointer(source._pointer) {
+template <class T, class Alloc>
+Tree<T, Alloc>::ReversePostOrderIterator::ReversePostOrderIterator(const ReversePostOrderIterator& source) : TreeIterator<T, Alloc>(source), _cursor(source._cursor) {
    // Nothing to do
 }
 
 //______________________________________________________________________________
 
-template <class T>
-TreeIterator<T>::~TreeIterator() {
+template <class T, class Alloc>
+Tree<T, Alloc>::ReversePostOrderIterator::~ReversePostOrderIterator() {
    // Nothing to do
 }
 
 //______________________________________________________________________________
 
-template <class T>
-TreeIterator<T>& TreeIterator<T>::operator=(const TreeIterator<T>& rhs) {
-   if(this != &rhs)
-      clone(rhs);
+template <class T, class Alloc>
+typename Tree<T, Alloc>::ReversePostOrderIterator& Tree<T, Alloc>::ReversePostOrderIterator::operator=(const ReversePostOrderIterator& rhs) {
+   if(this != &rhs) {
+      TreeIterator<T, Alloc>::operator=(rhs);
+      _cursor = rhs._cursor;
+   }
 
    return *this;
 }
 
 //______________________________________________________________________________
 
-template <class T>
-TreeIterator<T>& TreeIterator<T>::operator=(TreeNode<T>* rhs) {
-   if(_pointer != rhs) {
-      _pointer = rhs;
-   }
+// THE CURRENT NODE CAN'T BE NULL
+template <class T, class Alloc>
+typename Tree<T, Alloc>::ReversePostOrderIterator& Tree<T, Alloc>::ReversePostOrderIterator::operator++() {
+   _cursor.previousPostOrder();
+   TreeIterator<T, Alloc>::setPointer(_cursor._node);
 
-   return *this;;
+   return *this;
 }
 
 //______________________________________________________________________________
 
-template <class T>
-bool TreeIterator<T>::operator==(const TreeIterator<T>& rhs) const {
-   return _pointer == rhs._pointer;
+template <class T, class Alloc>
+typename Tree<T, Alloc>::ReversePostOrderIterator Tree<T, Alloc>::ReversePostOrderIterator::operator++(int notUsed) {
+   ReversePostOrderIterator tmp(*this);
+   ++(*this);
+   return tmp;
 }
 
 //______________________________________________________________________________
 
-template <class T>
-bool TreeIterator<T>::operator!=(const TreeIterator<T>& rhs) const {
-   return _pointer != rhs._pointer;
+template <class T, class Alloc>
+unsigned int Tree<T, Alloc>::ReversePostOrderIterator::depth() const {
+   return _cursor.depth();
 }
 
 //______________________________________________________________________________
 
-template <class T>
-T* TreeIterator<T>::operator->() const {
-   return &(_pointer->_data);
+template <class T, class Alloc>
+void Tree<T, Alloc>::ReversePostOrderIterator::startAt(TreeNode<T, Alloc>* node) {
+   TreeIterator<T, Alloc>::setPointer(node);
+   _cursor = TreeCursor<T, Alloc>(node, node);
 }
 
 //______________________________________________________________________________
 
-template <class T>
-T& TreeIterator<T>::operator*() const {
-   return *(operator->());
+template <class T, class Alloc>
+TreeIterator<T, Alloc>& Tree<T, Alloc>::ReversePostOrderIterator::parent() {
+   static Tree<T, Alloc>::ReversePostOrderIterator tmp;
+   tmp.startAt(TreeIterator<T, Alloc>::getPointer()->_parent);
+   return tmp;
 }
 
 //______________________________________________________________________________
 
-template <class T>
-unsigned int TreeIterator<T>::nChildren() {
-   return _pointer->_children.size();
+template <class T, class Alloc>
+TreeIterator<T, Alloc>& Tree<T, Alloc>::ReversePostOrderIterator::firstChild() {
+   static Tree<T, Alloc>::ReversePostOrderIterator tmp;
+
+   // Update the current child selected
+   TreeIterator<T, Alloc>::_currentChild = TreeIterator<T, Alloc>::getPointer()->_children.begin();
+
+   // Build a reverse post-order iterator
+   tmp.startAt(*TreeIterator<T, Alloc>::_currentChild);
+   return tmp;
 }
 
 //______________________________________________________________________________
 
-template <class T>
-TreeNode<T>* TreeIterator<T>::getPointer() {
-   return _pointer;
+template <class T, class Alloc>
+TreeIterator<T, Alloc>& Tree<T, Alloc>::ReversePostOrderIterator::lastChild() {
+   static Tree<T, Alloc>::ReversePostOrderIterator tmp;
+
+   // Update the current child selected
+   TreeIterator<T, Alloc>::_currentChild = --(TreeIterator<T, Alloc>::getPointer()->_children.end());
+
+   // Build a reverse post-order iterator
+   tmp.startAt(*TreeIterator<T, Alloc>::_currentChild);
+   return tmp;
 }
 
 //______________________________________________________________________________
 
-template <class T>
-void TreeIterator<T>::setPointer(TreeNode<T>* newPointer) {
-   _pointer = newPointer;
+template <class T, class Alloc>
+TreeIterator<T, Alloc>& Tree<T, Alloc>::ReversePostOrderIterator::nextChild() {
+   static Tree<T, Alloc>::ReversePostOrderIterator tmp;
+
+   // Update iterator position
+   ++TreeIterator<T, Alloc>::_currentChild;
+
+   tmp.startAt(*TreeIterator<T, Alloc>::_currentChild);
+   return tmp;
 }
 
 //______________________________________________________________________________
 
-template <class T>
-void TreeIterator<T>::clone(const TreeIterator<T>& rhs) {
-   _pointer = rhs._pointer;
+template <class T, class Alloc>
+TreeIterator<T, Alloc>& Tree<T, Alloc>::ReversePostOrderIterator::previousChild() {
+   static Tree<T, Alloc>::ReversePostOrderIterator tmp;
+
+   // Update iterator position
+   --TreeIterator<T, Alloc>::_currentChild;
+
+   tmp.startAt(*TreeIterator<T, Alloc>::_currentChild);
+   return tmp;
 }
 
 
@@ -1341,6 +4946,8 @@ void TreeIterator<T>::clone(const TreeIterator<T>& rhs) {
 
 
 
+
+
 // *****************************************************************************
 // *****************************************************************************
 // *****************************************************************************
@@ -1354,7 +4961,7 @@ void TreeIterator<T>::clone(const TreeIterator<T>& rhs) {
 // ***                                                                       ***
 // ***                                                                       ***
 // ***                                                                       ***
-// ***                       PRE-ORDER ITERATOR HEADER                       ***
+// ***                       ANCESTOR ITERATOR HEADER                        ***
 // ***                                                                       ***
 // ***                                                                       ***
 // ***                                                                       ***
@@ -1370,16 +4977,20 @@ void TreeIterator<T>::clone(const TreeIterator<T>& rhs) {
 // *****************************************************************************
 
 /**
- * Pre-order iterator to iterate on a tree structure.
+ * Ancestor iterator to iterate on a tree structure.
  *
- * This class allows the user to iterate through a tree in a pre-order fashion. It
- * also lets the user navigate through descendants and ancestors in a secuential fashion.
+ * This class allows the user to walk up a tree, from a node to the root, in a
+ * range based for loop (see Tree::ancestors()). It also lets the user navigate
+ * through descendants and ancestors in a secuential fashion.
+ *
+ * Each increment just follows the link to the parent, so walking up costs as
+ * much as the depth of the node and nothing is allocated.
  *
  * @author Francisco Aisa García
  * @version 0.1
  */
-template <class T>
-class Tree<T>::PreOrderIterator : public TreeIterator<T> {
+template <class T, class Alloc>
+class Tree<T, Alloc>::AncestorIterator : public TreeIterator<T, Alloc> {
    public:
       // =======================================================================
       //                     CONSTRUCTORS AND DESTRUCTORS
@@ -1391,18 +5002,7 @@ class Tree<T>::PreOrderIterator : public TreeIterator<T> {
        *
        * It makes the iterator pointer point to NULL.
        */
-      inline PreOrderIterator();
-
-      //________________________________________________________________________
-
-      /**
-       * Conversion constructor.
-       *
-       * It transforms a post-order iterator into a pre-order iterator.
-       *
-       * @param postIt 'PostOrderIterator' to be converted.
-       */
-      inline PreOrderIterator(const PostOrderIterator& postIt);
+      inline AncestorIterator();
 
       //________________________________________________________________________
 
@@ -1411,21 +5011,23 @@ class Tree<T>::PreOrderIterator : public TreeIterator<T> {
        *
        * @param data Pointer to the 'TreeNode' that this iterator will point.
        */
-      PreOrderIterator(TreeNode<T>* data);
+      AncestorIterator(TreeNode<T, Alloc>* data);
 
       //________________________________________________________________________
 
       /**
        * Copy constructor.
        *
-       * @param source Source pre-order iterator to be copied.
+       * The copy points to the same node.
+       *
+       * @param source Source ancestor iterator to be copied.
        */
-      inline PreOrderIterator(const PreOrderIterator& source);
+      inline AncestorIterator(const AncestorIterator& source);
 
       //________________________________________________________________________
 
       /** Destructor. */
-      inline virtual ~PreOrderIterator();
+      inline virtual ~AncestorIterator();
 
 
       // =======================================================================
@@ -1436,39 +5038,39 @@ class Tree<T>::PreOrderIterator : public TreeIterator<T> {
       /**
        * Assignment operator.
        *
-       * A copy of the pointer contained in the right hand side iterator is done,
-       * which means that 'this' iterator will point to the same node.
+       * 'this' iterator will point to the same node as the right hand side
+       * iterator.
        *
-       * @param rhs Right hand side tree iterator to be assigned.
-       * @return A reference to 'this' 'PreOrderIterator'.
+       * @param rhs Right hand side 'AncestorIterator' to be assigned.
+       * @return A reference to 'this' 'AncestorIterator'.
        */
-      PreOrderIterator& operator=(const TreeIterator<T>& rhs);
+      inline AncestorIterator& operator=(const AncestorIterator& rhs);
 
       //________________________________________________________________________
 
       /**
        * Pre-increment operator.
        *
-       * Each time this operator is executed, the next node (following the pre-order
-       * fashion) will be retrieved.
+       * Each time this operator is executed, the parent of the current node
+       * will be retrieved.
        *
-       * @return A reference to 'this' 'PreOrderIterator'.
+       * @return A reference to 'this' 'AncestorIterator'.
        */
-      virtual PreOrderIterator& operator++();
+      virtual AncestorIterator& operator++();
 
       //________________________________________________________________________
 
       /**
        * Post-increment operator.
        *
-       * Each time this operator is executed, the next node (following the pre-order
-       * fashion) will be retrieved.
+       * Each time this operator is executed, the parent of the current node
+       * will be retrieved.
        *
        * @param notUsed This argument is not used.
-       * @return A 'PreOrderIterator' to the node that the iterator pointed to before
-       * iterating to the next node.
+       * @return A 'AncestorIterator' to the node that the iterator pointed to before
+       * going up.
        */
-      inline PreOrderIterator operator++(int notUsed);
+      inline AncestorIterator operator++(int notUsed);
 
 
       // =======================================================================
@@ -1480,9 +5082,9 @@ class Tree<T>::PreOrderIterator : public TreeIterator<T> {
        * Returns a tree iterator to the parent node of the node pointed by 'this'
        * iterator if any.
        *
-       * @return A 'PreOrderIterator' to the parent node.
+       * @return A 'AncestorIterator' to the parent node.
        */
-      inline virtual TreeIterator<T>& parent();
+      inline virtual TreeIterator<T, Alloc>& parent();
 
       //________________________________________________________________________
 
@@ -1490,10 +5092,10 @@ class Tree<T>::PreOrderIterator : public TreeIterator<T> {
        * Returns a tree iterator to the first child node of the node pointed by 'this'
        * iterator.
        *
-       * @return A 'PreOrderIterator' to the first child of the node pointed by
+       * @return A 'AncestorIterator' to the first child of the node pointed by
        * 'this' iterator.
        */
-      virtual TreeIterator<T>& firstChild();
+      virtual TreeIterator<T, Alloc>& firstChild();
 
       //________________________________________________________________________
 
@@ -1501,10 +5103,10 @@ class Tree<T>::PreOrderIterator : public TreeIterator<T> {
        * Returns a tree iterator to the last child node of the node pointed by 'this'
        * iterator.
        *
-       * @return A 'PreOrderIterator' to the last child of the node pointed by 'this'
+       * @return A 'AncestorIterator' to the last child of the node pointed by 'this'
        * iterator.
        */
-      virtual TreeIterator<T>& lastChild();
+      virtual TreeIterator<T, Alloc>& lastChild();
 
       //________________________________________________________________________
 
@@ -1517,10 +5119,10 @@ class Tree<T>::PreOrderIterator : public TreeIterator<T> {
        * checking, which means that the client is responsible for iterating through
        * the node's children safely.
        *
-       * @return A 'PreOrderIterator' to the next child of the node pointed by 'this'
+       * @return A 'AncestorIterator' to the next child of the node pointed by 'this'
        * iterator.
        */
-      virtual TreeIterator<T>& nextChild();
+      virtual TreeIterator<T, Alloc>& nextChild();
 
       //________________________________________________________________________
 
@@ -1533,10 +5135,10 @@ class Tree<T>::PreOrderIterator : public TreeIterator<T> {
        * checking, which means that the client is responsible for iterating through
        * the node's children safely.
        *
-       * @return A 'PreOrderIterator' to the previous child of the node pointed by 'this'
+       * @return A 'AncestorIterator' to the previous child of the node pointed by 'this'
        * iterator.
        */
-      virtual TreeIterator<T>& previousChild();
+      virtual TreeIterator<T, Alloc>& previousChild();
 
    private:
       // =======================================================================
@@ -1544,23 +5146,22 @@ class Tree<T>::PreOrderIterator : public TreeIterator<T> {
       // =======================================================================
 
 
-      friend PreOrderIterator Tree<T>::preBegin() const;
-      friend PreOrderIterator Tree<T>::preEnd() const;
-      friend PreOrderIterator Tree<T>::pushBackChild(const TreeIterator<T>& parent, const T& data) throw(std::bad_alloc);
-      friend PreOrderIterator Tree<T>::pushFrontChild(const TreeIterator<T>& parent, const T& data) throw(std::bad_alloc);
-      friend PreOrderIterator Tree<T>::insertChild(const TreeIterator<T>& parent, const TreeIterator<T>& childNode, const T& data) throw(std::bad_alloc);
+      friend TreeRange<AncestorIterator> Tree<T, Alloc>::ancestors(const TreeIterator<T, Alloc>& node) const;
 
 
       // =======================================================================
-      //                            PRIVATE FIELDS
+      //                            PRIVATE METHODS
       // =======================================================================
 
 
-      /** Needed to know which is the next node to visit when using operator++ */
-      std::stack< std::pair<TreeNode<T>*, typename std::list< TreeNode<T>* >::iterator> > _pathStack;
+      /**
+       * Point to the given node and start a new traversal from it.
+       *
+       * @param node Pointer to the 'TreeNode' that this iterator will point.
+       */
+      inline void startAt(TreeNode<T, Alloc>* node);
 };
 
-
 // *****************************************************************************
 // *****************************************************************************
 // *****************************************************************************
@@ -1574,7 +5175,7 @@ class Tree<T>::PreOrderIterator : public TreeIterator<T> {
 // ***                                                                       ***
 // ***                                                                       ***
 // ***                                                                       ***
-// ***                   PRE-ORDER ITERATOR IMPLEMENTATION                   ***
+// ***                   ANCESTOR ITERATOR IMPLEMENTATION                    ***
 // ***                                                                       ***
 // ***                                                                       ***
 // ***                                                                       ***
@@ -1590,51 +5191,38 @@ class Tree<T>::PreOrderIterator : public TreeIterator<T> {
 // *****************************************************************************
 
 // Parent sets _pointer to NULL
-template <class T>
-Tree<T>::PreOrderIterator::PreOrderIterator() {
+template <class T, class Alloc>
+Tree<T, Alloc>::AncestorIterator::AncestorIterator() {
    // Nothing to do
 }
 
 //______________________________________________________________________________
 
-template <class T>
-Tree<T>::PreOrderIterator::PreOrderIterator(const PostOrderIterator& postIt) {
-   TreeIterator<T>::setPointer(postIt._pointer);
-}
-
-//______________________________________________________________________________
-
-template <class T>
-Tree<T>::PreOrderIterator::PreOrderIterator(TreeNode<T>* data) : TreeIterator<T>(data) {
+template <class T, class Alloc>
+Tree<T, Alloc>::AncestorIterator::AncestorIterator(TreeNode<T, Alloc>* data) : TreeIterator<T, Alloc>(data) {
    // Nothing to do
 }
 
 //______________________________________________________________________________
 
-template <class T>
-Tree<T>::PreOrderIterator::PreOrderIterator(const PreOrderIterator& source) : TreeIterator<T>(source), _pathStack(source._pathStack) {
+template <class T, class Alloc>
+Tree<T, Alloc>::AncestorIterator::AncestorIterator(const AncestorIterator& source) : TreeIterator<T, Alloc>(source) {
    // Nothing to do
 }
 
 //______________________________________________________________________________
 
-template <class T>
-Tree<T>::PreOrderIterator::~PreOrderIterator() {
+template <class T, class Alloc>
+Tree<T, Alloc>::AncestorIterator::~AncestorIterator() {
    // Nothing to do
 }
 
 //______________________________________________________________________________
 
-template <class T>
-typename Tree<T>::PreOrderIterator& Tree<T>::PreOrderIterator::operator=(const TreeIterator<T>& rhs) {
-   if(this != &rhs) {
-      TreeIterator<T>::operator=(rhs);
-
-      // Clear the stack
-      while(!_pathStack.empty()) {
-         _pathStack.pop();
-      }
-   }
+template <class T, class Alloc>
+typename Tree<T, Alloc>::AncestorIterator& Tree<T, Alloc>::AncestorIterator::operator=(const AncestorIterator& rhs) {
+   if(this != &rhs)
+      TreeIterator<T, Alloc>::operator=(rhs);
 
    return *this;
 }
@@ -1642,132 +5230,89 @@ typename Tree<T>::PreOrderIterator& Tree<T>::PreOrderIterator::operator=(const T
 //______________________________________________________________________________
 
 // THE CURRENT NODE CAN'T BE NULL
-template <class T>
-typename Tree<T>::PreOrderIterator& Tree<T>::PreOrderIterator::operator++() {
-   std::pair< TreeNode<T>*, typename std::list< TreeNode<T>* >::iterator > topNode;
-   typename std::list< TreeNode<T>* >::iterator tmp;
-   // nodePt is the pointer to the TreeNode stored inside the TreeIterator
-   TreeNode<T>* nodePt = TreeIterator<T>::getPointer();
-
-   int nChildren = nodePt->nChildren();
-   // If the current node has children, we must visit them and keep the current
-   // node in the stack in case there are more children
-   if(nChildren > 0) {
-      // If the current node is the one on the top of the stack, get the next
-      // child to visit
-      typename std::list< TreeNode<T>* >::iterator nextChild;
-      if(_pathStack.empty() || nodePt != _pathStack.top().first) {
-         nextChild = nodePt->_children.begin();
-         tmp = nextChild;
-         _pathStack.push(std::pair< TreeNode<T>*, typename std::list< TreeNode<T>* >::iterator >(nodePt, ++tmp));
-      }
-      else {
-         topNode = _pathStack.top();
-         nextChild = topNode.second;
-         tmp = nextChild;
-         _pathStack.top() = std::pair<TreeNode<T>*, typename std::list< TreeNode<T>* >::iterator >(topNode.first, ++tmp);
-      }
-
-      TreeIterator<T>::setPointer(*nextChild);
-   }
-   else {
-      while(!_pathStack.empty()) {
-         topNode = _pathStack.top();
-         // If there are children that haven't been visited
-         if(topNode.second != topNode.first->_children.end()) {
-            // Current node is the next child to visit
-            tmp = topNode.second;
-            TreeIterator<T>::setPointer(*topNode.second);
-            // Update next child to be visited
-            _pathStack.top() = std::pair<TreeNode<T>*, typename std::list< TreeNode<T>* >::iterator>(topNode.first, ++tmp);
-
-            return *this;
-         }
-         // If we have already visited every children of the top node, extract it
-         // from the stack and try with the next one if any. If the stack goes empty
-         // return the NULL iterator (or end iterator)
-         else {
-            _pathStack.pop();
-         }
-      }
-
-      // The stack is empty, meaning that we have no nodes left to visit, hence
-      // the pointer should be NULL indicating that we have reached the end
-      TreeIterator<T>::setPointer(NULL);
-   }
+template <class T, class Alloc>
+typename Tree<T, Alloc>::AncestorIterator& Tree<T, Alloc>::AncestorIterator::operator++() {
+   TreeIterator<T, Alloc>::setPointer(TreeIterator<T, Alloc>::getPointer()->_parent);
 
    return *this;
 }
 
 //______________________________________________________________________________
 
-template <class T>
-typename Tree<T>::PreOrderIterator Tree<T>::PreOrderIterator::operator++(int notUsed) {
-   PreOrderIterator tmp(*this);
+template <class T, class Alloc>
+typename Tree<T, Alloc>::AncestorIterator Tree<T, Alloc>::AncestorIterator::operator++(int notUsed) {
+   AncestorIterator tmp(*this);
    ++(*this);
    return tmp;
 }
 
 //______________________________________________________________________________
 
-template <class T>
-TreeIterator<T>& Tree<T>::PreOrderIterator::parent() {
-   static Tree<T>::PreOrderIterator tmp;
-   tmp.setPointer(TreeIterator<T>::getPointer()->_parent);
+template <class T, class Alloc>
+void Tree<T, Alloc>::AncestorIterator::startAt(TreeNode<T, Alloc>* node) {
+   TreeIterator<T, Alloc>::setPointer(node);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+TreeIterator<T, Alloc>& Tree<T, Alloc>::AncestorIterator::parent() {
+   static Tree<T, Alloc>::AncestorIterator tmp;
+   tmp.startAt(TreeIterator<T, Alloc>::getPointer()->_parent);
    return tmp;
 }
 
 //______________________________________________________________________________
 
-template <class T>
-TreeIterator<T>& Tree<T>::PreOrderIterator::firstChild() {
-   static Tree<T>::PreOrderIterator tmp;
+template <class T, class Alloc>
+TreeIterator<T, Alloc>& Tree<T, Alloc>::AncestorIterator::firstChild() {
+   static Tree<T, Alloc>::AncestorIterator tmp;
 
    // Update the current child selected
-   TreeIterator<T>::_currentChild = TreeIterator<T>::getPointer()->_children.begin();
+   TreeIterator<T, Alloc>::_currentChild = TreeIterator<T, Alloc>::getPointer()->_children.begin();
 
-   // Build a pre-order iterator
-   tmp.setPointer(*TreeIterator<T>::_currentChild);
+   // Build an ancestor iterator
+   tmp.startAt(*TreeIterator<T, Alloc>::_currentChild);
    return tmp;
 }
 
 //______________________________________________________________________________
 
-template <class T>
-TreeIterator<T>& Tree<T>::PreOrderIterator::lastChild() {
-   static Tree<T>::PreOrderIterator tmp;
+template <class T, class Alloc>
+TreeIterator<T, Alloc>& Tree<T, Alloc>::AncestorIterator::lastChild() {
+   static Tree<T, Alloc>::AncestorIterator tmp;
 
    // Update the current child selected
-   TreeIterator<T>::_currentChild = --(TreeIterator<T>::getPointer()->_children.end());
+   TreeIterator<T, Alloc>::_currentChild = --(TreeIterator<T, Alloc>::getPointer()->_children.end());
 
-   // Build a pre-order iterator
-   tmp.setPointer(*TreeIterator<T>::_currentChild);
+   // Build an ancestor iterator
+   tmp.startAt(*TreeIterator<T, Alloc>::_currentChild);
    return tmp;
 }
 
 //______________________________________________________________________________
 
-template <class T>
-TreeIterator<T>& Tree<T>::PreOrderIterator::nextChild() {
-   static Tree<T>::PreOrderIterator tmp;
+template <class T, class Alloc>
+TreeIterator<T, Alloc>& Tree<T, Alloc>::AncestorIterator::nextChild() {
+   static Tree<T, Alloc>::AncestorIterator tmp;
 
    // Update iterator position
-   ++TreeIterator<T>::_currentChild;
+   ++TreeIterator<T, Alloc>::_currentChild;
 
-   tmp.setPointer(*TreeIterator<T>::_currentChild);
+   tmp.startAt(*TreeIterator<T, Alloc>::_currentChild);
    return tmp;
 }
 
 //______________________________________________________________________________
 
-template <class T>
-TreeIterator<T>& Tree<T>::PreOrderIterator::previousChild() {
-   static Tree<T>::PreOrderIterator tmp;
+template <class T, class Alloc>
+TreeIterator<T, Alloc>& Tree<T, Alloc>::AncestorIterator::previousChild() {
+   static Tree<T, Alloc>::AncestorIterator tmp;
 
    // Update iterator position
-   --TreeIterator<T>::_currentChild;
+   --TreeIterator<T, Alloc>::_currentChild;
 
-   tmp.setPointer(*TreeIterator<T>::_currentChild);
+   tmp.startAt(*TreeIterator<T, Alloc>::_currentChild);
    return tmp;
 }
 
@@ -1799,7 +5344,7 @@ TreeIterator<T>& Tree<T>::PreOrderIterator::previousChild() {
 // ***                                                                       ***
 // ***                                                                       ***
 // ***                                                                       ***
-// ***                      POST-ORDER ITERATOR HEADER                       ***
+// ***                      EULER TOUR ITERATOR HEADER                       ***
 // ***                                                                       ***
 // ***                                                                       ***
 // ***                                                                       ***
@@ -1815,16 +5360,25 @@ TreeIterator<T>& Tree<T>::PreOrderIterator::previousChild() {
 // *****************************************************************************
 
 /**
- * Post-order iterator to iterate on a tree structure.
+ * Euler tour iterator to iterate on a tree structure.
  *
- * This class allows the user to iterate through a tree in a post-order fashion. It
- * also lets the user navigate through descendants and ancestors in a secuential fashion.
+ * This class allows the user to walk a tree the way a serializer does: every
+ * node is visited twice, once when it is entered (before its children) and once
+ * when it is exited (after its children). The event and the depth of each step
+ * are available through event() and depth(), so the entering steps follow the
+ * pre-order and the exiting steps follow the post-order of the same subtree. It
+ * also lets the user navigate through descendants and ancestors in a secuential
+ * fashion.
+ *
+ * Both orders come out of a single pass: like the other iterators it moves
+ * through the tree using a 'TreeCursor', so nothing is allocated and every node
+ * is loaded once instead of once per traversal.
  *
  * @author Francisco Aisa García
  * @version 0.1
  */
-template <class T>
-class Tree<T>::PostOrderIterator : public TreeIterator<T> {
+template <class T, class Alloc>
+class Tree<T, Alloc>::EulerTourIterator : public TreeIterator<T, Alloc> {
    public:
       // =======================================================================
       //                     CONSTRUCTORS AND DESTRUCTORS
@@ -1836,55 +5390,36 @@ class Tree<T>::PostOrderIterator : public TreeIterator<T> {
        *
        * It makes the iterator pointer point to NULL.
        */
-      inline PostOrderIterator();
-
-      //________________________________________________________________________
-
-      /**
-       * Conversion constructor.
-       *
-       * It transforms a pre-order iterator into a post-order iterator. In the tree
-       * class, when new nodes are inserted/created, pre-order iterators to them
-       * are returned. For the sake of uniformity, post-order iterators can be used
-       * with those methods thanks to this conversion constructor. Use it with care
-       * since is not as efficient as using a pre-order iterator (due to the construction
-       * of a temporary iterator).
-       *
-       * @param preIt 'PreOrderIterator' to be converted.
-       */
-      PostOrderIterator(const PreOrderIterator& preIt);
+      inline EulerTourIterator();
 
       //________________________________________________________________________
 
       /**
        * Custom constructor.
        *
-       * Note that when the post-order iterator is constructed, the iterator actually
-       * doesn't point to the node pointed by the iterator given, instead, it points
-       * to the first node to be retreived in post-order.
+       * The tour starts entering the node given and ends after exiting it.
        *
-       * @param data Pointer to the 'TreeNode' that this iterator will point.
+       * @param data Pointer to the 'TreeNode' whose subtree will be traversed.
+       * @param maxDepth Nodes deeper than this (relative to 'data') are not
+       * visited.
        */
-      PostOrderIterator(TreeNode<T>* data);
+      EulerTourIterator(TreeNode<T, Alloc>* data, unsigned int maxDepth = TREE_UNLIMITED_DEPTH);
 
       //________________________________________________________________________
 
       /**
        * Copy constructor.
        *
-       * Note that the pointer that this iterator will point to after the construction
-       * won't be the one to which the source iterator points to. Instead, this
-       * iterator will point to the first node to be retreived in post-order (starting
-       * from the node pointed by the given iterator).
+       * The copy points to the same node and traverses the same subtree.
        *
-       * @param source Source post-order iterator to be copied.
+       * @param source Source Euler tour iterator to be copied.
        */
-      PostOrderIterator(const PostOrderIterator& source);
+      inline EulerTourIterator(const EulerTourIterator& source);
 
       //________________________________________________________________________
 
       /** Destructor. */
-      inline virtual ~PostOrderIterator();
+      inline virtual ~EulerTourIterator();
 
 
       // =======================================================================
@@ -1895,45 +5430,98 @@ class Tree<T>::PostOrderIterator : public TreeIterator<T> {
       /**
        * Assignment operator.
        *
-       * Note that the pointer that this iterator will point to after the assignment
-       * won't be the one to which the right hand side iterator points to. Instead, this
-       * iterator will point to the first node to be retreived in post-order (starting
-       * from the node pointed by the given iterator).
+       * 'this' iterator will point to the same node and traverse the same subtree
+       * as the right hand side iterator.
        *
-       * Also, if the assigned iterator to the right has just been copy constructed,
-       * then, the iterator will actually point to the node that the given iterator
-       * points to.
-       *
-       * @param rhs Right hand side 'PostOrderIterator' to be assigned.
-       * @return A reference to 'this' 'PostOrderIterator'.
+       * @param rhs Right hand side 'EulerTourIterator' to be assigned.
+       * @return A reference to 'this' 'EulerTourIterator'.
        */
-      PostOrderIterator& operator=(const PostOrderIterator& rhs);
+      inline EulerTourIterator& operator=(const EulerTourIterator& rhs);
 
       //________________________________________________________________________
 
       /**
        * Pre-increment operator.
        *
-       * Each time this operator is executed, the next node (following the post-order
-       * fashion) will be retrieved.
+       * Each time this operator is executed, the next step of the tour will be
+       * retrieved.
        *
-       * @return A reference to 'this' 'PostOrderIterator'.
+       * @return A reference to 'this' 'EulerTourIterator'.
        */
-      virtual PostOrderIterator& operator++();
+      virtual EulerTourIterator& operator++();
 
       //________________________________________________________________________
 
       /**
        * Post-increment operator.
        *
-       * Each time this operator is executed, the next node (following the post-order
-       * fashion) will be retrieved.
+       * Each time this operator is executed, the next step of the tour will be
+       * retrieved.
        *
        * @param notUsed This argument is not used.
-       * @return A 'PostOrderIterator' to the node that the iterator pointed to before
-       * iterating to the next node.
+       * @return A 'EulerTourIterator' to the step that the iterator was at before
+       * iterating to the next step.
        */
-      inline PostOrderIterator operator++(int notUsed);
+      inline EulerTourIterator operator++(int notUsed);
+
+      //________________________________________________________________________
+
+      /**
+       * Equality operator.
+       *
+       * Entering and exiting a node are different steps of the tour, so unlike
+       * the rest of tree iterators, the event is compared too.
+       *
+       * @param rhs Right hand side Euler tour iterator to be compared.
+       * @return 'true' if both iterators are at the same step, 'false'
+       * otherwise.
+       */
+      inline bool operator==(const EulerTourIterator& rhs) const;
+
+      //________________________________________________________________________
+
+      /**
+       * Inequality operator.
+       *
+       * @param rhs Right hand side Euler tour iterator to be compared.
+       * @return 'true' if the iterators are at different steps, 'false'
+       * otherwise.
+       */
+      inline bool operator!=(const EulerTourIterator& rhs) const;
+
+
+      // =======================================================================
+      //                          TRAVERSAL CONTROL
+      // =======================================================================
+
+
+      /**
+       * Get the event of the current step.
+       *
+       * @return TREE_ENTER if the current node is being entered, TREE_EXIT if it
+       * is being exited.
+       */
+      inline TreeEulerEvent event() const;
+
+      //________________________________________________________________________
+
+      /**
+       * Get the depth of the current node.
+       *
+       * @return The distance from the node where the traversal started to the
+       * current node.
+       */
+      inline unsigned int depth() const;
+
+      //________________________________________________________________________
+
+      /**
+       * Don't descend into the children of the current node.
+       *
+       * Called when the current node is being entered, the next increment exits
+       * it right away, none of its descendants is visited (nor touched).
+       */
+      inline void skipChildren();
 
 
       // =======================================================================
@@ -1945,9 +5533,9 @@ class Tree<T>::PostOrderIterator : public TreeIterator<T> {
        * Returns a tree iterator to the parent node of the node pointed by 'this'
        * iterator if any.
        *
-       * @return A 'PostOrderIterator' to the parent node.
+       * @return An 'EulerTourIterator' to the parent node.
        */
-      inline virtual TreeIterator<T>& parent();
+      inline virtual TreeIterator<T, Alloc>& parent();
 
       //________________________________________________________________________
 
@@ -1955,10 +5543,10 @@ class Tree<T>::PostOrderIterator : public TreeIterator<T> {
        * Returns a tree iterator to the first child node of the node pointed by 'this'
        * iterator.
        *
-       * @return A 'PostOrderIterator' to the first child of the node pointed by
+       * @return An 'EulerTourIterator' to the first child of the node pointed by
        * 'this' iterator.
        */
-      virtual TreeIterator<T>& firstChild();
+      virtual TreeIterator<T, Alloc>& firstChild();
 
       //________________________________________________________________________
 
@@ -1966,10 +5554,10 @@ class Tree<T>::PostOrderIterator : public TreeIterator<T> {
        * Returns a tree iterator to the last child node of the node pointed by 'this'
        * iterator.
        *
-       * @return A 'PostOrderIterator' to the last child of the node pointed by 'this'
+       * @return An 'EulerTourIterator' to the last child of the node pointed by 'this'
        * iterator.
        */
-      virtual TreeIterator<T>& lastChild();
+      virtual TreeIterator<T, Alloc>& lastChild();
 
       //________________________________________________________________________
 
@@ -1982,10 +5570,10 @@ class Tree<T>::PostOrderIterator : public TreeIterator<T> {
        * checking, which means that the client is responsible for iterating through
        * the node's children safely.
        *
-       * @return A 'PostOrderIterator' to the next child of the node pointed by 'this'
+       * @return An 'EulerTourIterator' to the next child of the node pointed by 'this'
        * iterator.
        */
-      virtual TreeIterator<T>& nextChild();
+      virtual TreeIterator<T, Alloc>& nextChild();
 
       //________________________________________________________________________
 
@@ -1998,10 +5586,10 @@ class Tree<T>::PostOrderIterator : public TreeIterator<T> {
        * checking, which means that the client is responsible for iterating through
        * the node's children safely.
        *
-       * @return A 'PostOrderIterator' to the previous child of the node pointed by 'this'
+       * @return An 'EulerTourIterator' to the previous child of the node pointed by 'this'
        * iterator.
        */
-      virtual TreeIterator<T>& previousChild();
+      virtual TreeIterator<T, Alloc>& previousChild();
 
    private:
       // =======================================================================
@@ -2009,25 +5597,30 @@ class Tree<T>::PostOrderIterator : public TreeIterator<T> {
       // =======================================================================
 
 
-      friend PostOrderIterator Tree<T>::postBegin() const;
-      friend PostOrderIterator Tree<T>::postEnd() const;
+      friend EulerTourIterator Tree<T, Alloc>::eulerBegin() const;
+      friend EulerTourIterator Tree<T, Alloc>::eulerEnd() const;
 
 
       // =======================================================================
-      //                            PRIVATE FIELDS
+      //                            PRIVATE METHODS
       // =======================================================================
 
 
-      /** Needed to know which is the next node to visit when using operator++ */
-      std::stack< std::pair<TreeNode<T>*, typename std::list< TreeNode<T>* >::iterator> > _pathStack;
-
-      //________________________________________________________________________
-
       /**
-       * Because copy constructor elision occurs, this field will make sure that
-       * the state of the iterator is correct.
+       * Point to the given node and start a new traversal from it.
+       *
+       * @param node Pointer to the 'TreeNode' that this iterator will point.
        */
-      bool _justCreated;
+      inline void startAt(TreeNode<T, Alloc>* node);
+
+
+      // =======================================================================
+      //                            PRIVATE FIELDS
+      // =======================================================================
+
+
+      /** Cursor that keeps the state of the traversal. */
+      TreeCursor<T, Alloc> _cursor;
 };
 
 // *****************************************************************************
@@ -2043,7 +5636,7 @@ class Tree<T>::PostOrderIterator : public TreeIterator<T> {
 // ***                                                                       ***
 // ***                                                                       ***
 // ***                                                                       ***
-// ***                  POST-ORDER ITERATOR IMPLEMENTATION                   ***
+// ***                  EULER TOUR ITERATOR IMPLEMENTATION                   ***
 // ***                                                                       ***
 // ***                                                                       ***
 // ***                                                                       ***
@@ -2059,185 +5652,171 @@ class Tree<T>::PostOrderIterator : public TreeIterator<T> {
 // *****************************************************************************
 
 // Parent sets _pointer to NULL
-template <class T>
-Tree<T>::PostOrderIterator::PostOrderIterator() : _justCreated(false) {
+template <class T, class Alloc>
+Tree<T, Alloc>::EulerTourIterator::EulerTourIterator() {
    // Nothing to do
 }
 
 //______________________________________________________________________________
 
-template <class T>
-Tree<T>::PostOrderIterator::PostOrderIterator(const PreOrderIterator& preIt) {
-   TreeIterator<T>::setPointer(preIt._pointer);
-   TreeNode<T>* ptr = preIt._pointer;
-   if(ptr != NULL) {
-      _pathStack.push(std::pair<TreeNode<T>*, typename std::list< TreeNode<T>* >::iterator >(ptr, ptr->_children.begin()));
-      operator++();
-      _justCreated = true;
-   }
+template <class T, class Alloc>
+Tree<T, Alloc>::EulerTourIterator::EulerTourIterator(TreeNode<T, Alloc>* data, unsigned int maxDepth) :
+   TreeIterator<T, Alloc>(data),
+   _cursor(data, data, maxDepth)
+{
+   // Nothing to do
 }
 
 //______________________________________________________________________________
 
-template <class T>
-Tree<T>::PostOrderIterator::PostOrderIterator(TreeNode<T>* data) : TreeIterator<T>(data) {
-   TreeNode<T>* ptr = TreeIterator<T>::getPointer();
-   if(ptr != NULL) {
-      _pathStack.push(std::pair<TreeNode<T>*, typename std::list< TreeNode<T>* >::iterator >(ptr, ptr->_children.begin()));
-      operator++();
-      _justCreated = true;
-   }
+template <class T, class Alloc>
+Tree<T, Alloc>::EulerTourIterator::EulerTourIterator(const EulerTourIterator& source) : TreeIterator<T, Alloc>(source), _cursor(source._cursor) {
+   // Nothing to do
 }
 
 //______________________________________________________________________________
 
-template <class T>
-Tree<T>::PostOrderIterator::PostOrderIterator(const PostOrderIterator& source) : TreeIterator<T>(source) {
-   TreeNode<T>* ptr = TreeIterator<T>::getPointer();
-   if(ptr != NULL) {
-      _pathStack.push(std::pair<TreeNode<T>*, typename std::list< TreeNode<T>* >::iterator >(ptr, ptr->_children.begin()));
-      operator++();
-      _justCreated = true;
+template <class T, class Alloc>
+Tree<T, Alloc>::EulerTourIterator::~EulerTourIterator() {
+   // Nothing to do
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+typename Tree<T, Alloc>::EulerTourIterator& Tree<T, Alloc>::EulerTourIterator::operator=(const EulerTourIterator& rhs) {
+   if(this != &rhs) {
+      TreeIterator<T, Alloc>::operator=(rhs);
+      _cursor = rhs._cursor;
    }
+
+   return *this;
 }
 
 //______________________________________________________________________________
 
-template <class T>
-Tree<T>::PostOrderIterator::~PostOrderIterator() {
-   // Nothing to do
+// THE CURRENT NODE CAN'T BE NULL
+template <class T, class Alloc>
+typename Tree<T, Alloc>::EulerTourIterator& Tree<T, Alloc>::EulerTourIterator::operator++() {
+   _cursor.nextEulerTour();
+   TreeIterator<T, Alloc>::setPointer(_cursor._node);
+
+   return *this;
 }
 
 //______________________________________________________________________________
 
-template <class T>
-typename Tree<T>::PostOrderIterator& Tree<T>::PostOrderIterator::operator=(const PostOrderIterator& rhs) {
-   if(this != &rhs) {
-      TreeIterator<T>::operator=(rhs);
-
-      // If the right hand side element has already been used, we copy it normally
-      // if not. We just copy the stack state because the constructor has just been
-      // executed, which means that the state of the iterator has already been set
-      if(!rhs._justCreated) {
-         // Clear the stack
-         while(!_pathStack.empty()) {
-            _pathStack.pop();
-         }
+template <class T, class Alloc>
+typename Tree<T, Alloc>::EulerTourIterator Tree<T, Alloc>::EulerTourIterator::operator++(int notUsed) {
+   EulerTourIterator tmp(*this);
+   ++(*this);
+   return tmp;
+}
 
-         // Put the first element to be printed at the top of the stack
-         TreeNode<T>* rhsPtr(TreeIterator<T>::getPointer());
-         if(rhsPtr != NULL) {
-            _pathStack.push(std::pair<TreeNode<T>*, typename std::list< TreeNode<T>* >::iterator >(rhsPtr, rhsPtr->_children.begin()));
-            operator++();
-         }
-      }
-      else {
-         _pathStack = rhs._pathStack;
-      }
-   }
+//______________________________________________________________________________
 
-   return *this;
+template <class T, class Alloc>
+bool Tree<T, Alloc>::EulerTourIterator::operator==(const EulerTourIterator& rhs) const {
+   return TreeIterator<T, Alloc>::operator==(rhs) && _cursor.event() == rhs._cursor.event();
 }
 
 //______________________________________________________________________________
 
-template <class T>
-typename Tree<T>::PostOrderIterator& Tree<T>::PostOrderIterator::operator++() {
-   typename std::list< TreeNode<T>* >::iterator tmp;
+template <class T, class Alloc>
+bool Tree<T, Alloc>::EulerTourIterator::operator!=(const EulerTourIterator& rhs) const {
+   return !(*this == rhs);
+}
 
-   // Raise a flag indicating that this iterator is no longer on the initialization state
-   _justCreated = false;
-   while(!_pathStack.empty()) {
-      std::pair<TreeNode<T>*, typename std::list< TreeNode<T>* >::iterator> topNode = _pathStack.top();
+//______________________________________________________________________________
 
-      // If there are children nodes non explored, find the last one
-      while(topNode.second != topNode.first->_children.end()) {
-         tmp = topNode.second;
-         _pathStack.top() = std::pair<TreeNode<T>*, typename std::list< TreeNode<T>* >::iterator>(topNode.first, ++tmp);
-         _pathStack.push(std::pair<TreeNode<T>*, typename std::list< TreeNode<T>* >::iterator>(*topNode.second, (*topNode.second)->_children.begin()));
-         topNode = _pathStack.top();
-      }
+template <class T, class Alloc>
+TreeEulerEvent Tree<T, Alloc>::EulerTourIterator::event() const {
+   return _cursor.event();
+}
 
-      _pathStack.pop();
-      TreeIterator<T>::setPointer(topNode.first);
+//______________________________________________________________________________
 
-      return *this;
-   }
+template <class T, class Alloc>
+unsigned int Tree<T, Alloc>::EulerTourIterator::depth() const {
+   return _cursor.depth();
+}
 
-   TreeIterator<T>::setPointer(NULL);
-   return *this;
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+void Tree<T, Alloc>::EulerTourIterator::skipChildren() {
+   _cursor.skipChildren();
 }
 
 //______________________________________________________________________________
 
-template <class T>
-typename Tree<T>::PostOrderIterator Tree<T>::PostOrderIterator::operator++(int notUsed) {
-   PostOrderIterator tmp(*this);
-   ++(*this);
-   return tmp;
+template <class T, class Alloc>
+void Tree<T, Alloc>::EulerTourIterator::startAt(TreeNode<T, Alloc>* node) {
+   TreeIterator<T, Alloc>::setPointer(node);
+   _cursor = TreeCursor<T, Alloc>(node, node);
 }
 
 //______________________________________________________________________________
 
-template <class T>
-TreeIterator<T>& Tree<T>::PostOrderIterator::parent() {
-   static Tree<T>::PostOrderIterator tmp;
-   tmp.setPointer(TreeIterator<T>::getPointer()->_parent);
+template <class T, class Alloc>
+TreeIterator<T, Alloc>& Tree<T, Alloc>::EulerTourIterator::parent() {
+   static Tree<T, Alloc>::EulerTourIterator tmp;
+   tmp.startAt(TreeIterator<T, Alloc>::getPointer()->_parent);
    return tmp;
 }
 
 //______________________________________________________________________________
 
-template <class T>
-TreeIterator<T>& Tree<T>::PostOrderIterator::firstChild() {
-   static Tree<T>::PostOrderIterator tmp;
+template <class T, class Alloc>
+TreeIterator<T, Alloc>& Tree<T, Alloc>::EulerTourIterator::firstChild() {
+   static Tree<T, Alloc>::EulerTourIterator tmp;
 
    // Update the current child selected
-   TreeIterator<T>::_currentChild = TreeIterator<T>::getPointer()->_children.begin();
+   TreeIterator<T, Alloc>::_currentChild = TreeIterator<T, Alloc>::getPointer()->_children.begin();
 
-   // Build a post-order iterator
-   tmp.setPointer(*TreeIterator<T>::_currentChild);
+   // Build an Euler tour iterator
+   tmp.startAt(*TreeIterator<T, Alloc>::_currentChild);
    return tmp;
 }
 
 //______________________________________________________________________________
 
-template <class T>
-TreeIterator<T>& Tree<T>::PostOrderIterator::lastChild() {
-   static Tree<T>::PostOrderIterator tmp;
+template <class T, class Alloc>
+TreeIterator<T, Alloc>& Tree<T, Alloc>::EulerTourIterator::lastChild() {
+   static Tree<T, Alloc>::EulerTourIterator tmp;
 
    // Update the current child selected
-   TreeIterator<T>::_currentChild = --(TreeIterator<T>::getPointer()->_children.end());
+   TreeIterator<T, Alloc>::_currentChild = --(TreeIterator<T, Alloc>::getPointer()->_children.end());
 
-   // Build a post-order iterator
-   tmp.setPointer(*TreeIterator<T>::_currentChild);
+   // Build an Euler tour iterator
+   tmp.startAt(*TreeIterator<T, Alloc>::_currentChild);
    return tmp;
 }
 
 //______________________________________________________________________________
 
-template <class T>
-TreeIterator<T>& Tree<T>::PostOrderIterator::nextChild() {
-   static Tree<T>::PostOrderIterator tmp;
+template <class T, class Alloc>
+TreeIterator<T, Alloc>& Tree<T, Alloc>::EulerTourIterator::nextChild() {
+   static Tree<T, Alloc>::EulerTourIterator tmp;
 
    // Update iterator position
-   ++TreeIterator<T>::_currentChild;
+   ++TreeIterator<T, Alloc>::_currentChild;
 
-   tmp.setPointer(*TreeIterator<T>::_currentChild);
+   tmp.startAt(*TreeIterator<T, Alloc>::_currentChild);
    return tmp;
 }
 
 //______________________________________________________________________________
 
-template <class T>
-TreeIterator<T>& Tree<T>::PostOrderIterator::previousChild() {
-   static Tree<T>::PostOrderIterator tmp;
+template <class T, class Alloc>
+TreeIterator<T, Alloc>& Tree<T, Alloc>::EulerTourIterator::previousChild() {
+   static Tree<T, Alloc>::EulerTourIterator tmp;
 
    // Update iterator position
-   --TreeIterator<T>::_currentChild;
+   --TreeIterator<T, Alloc>::_currentChild;
 
-   tmp.setPointer(*TreeIterator<T>::_currentChild);
+   tmp.startAt(*TreeIterator<T, Alloc>::_currentChild);
    return tmp;
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,39 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version. This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details. You should have received a copy of the GNU
+ * General Public License along with this program; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ * USA.
+ *
+ * Copyright © 2011-2012 Francisco Aisa Garcia
+ */
+
+#ifndef __TREE_ALLOCATOR_TRAITS_H__
+#define __TREE_ALLOCATOR_TRAITS_H__
+
+/**
+ * Describes how a tree may treat the memory handed out by an allocator.
+ *
+ * By default an allocator is expected to get every block back, one by one,
+ * so the tree deallocates each node when it is destroyed. Allocators that
+ * release their memory all at once (arenas, per-request bump allocators...)
+ * should specialize this class and set 'monotonic' to 'true'. In that case,
+ * destroying a tree (or chopping a subtree) doesn't give any memory back and
+ * only the destructors of the payloads are run, none at all if 'T' is
+ * trivially destructible.
+ *
+ * @author Francisco Aisa García
+ * @version 0.1
+ */
+template <class Alloc>
+struct TreeAllocatorTraits {
+   /** 'true' if the memory of the allocator is released in bulk. */
+   static const bool monotonic = false;
+};
+
+#endif
@@ -0,0 +1,206 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version. This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details. You should have received a copy of the GNU
+ * General Public License along with this program; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ * USA.
+ *
+ * Copyright © 2011-2012 Francisco Aisa Garcia
+ */
+
+
+#ifndef __TREE_ARENA_H__
+#define __TREE_ARENA_H__
+
+#include <cstddef>
+#include <new>
+
+/**
+ * Monotonic memory arena meant to hold the nodes of short lived trees.
+ *
+ * Memory is carved out of big blocks by just moving a cursor forward, and it is
+ * never given back one piece at a time. Instead, every piece handed out by the
+ * arena is released at once with release() (or when the arena is destroyed).
+ *
+ * It is meant to be used through 'TreeArenaAllocator', so that every node of a
+ * tree (and of the trees grafted into it) comes from the same arena. Trees built
+ * this way don't deallocate anything when they are destroyed, which means that
+ * building, querying and throwing away a tree costs almost nothing but the
+ * construction of its nodes.
+ *
+ * Please note that the arena MUST outlive every tree that allocates from it,
+ * and that release() MUST NOT be called while any of those trees is still in
+ * use.
+ *
+ * @author Francisco Aisa García
+ * @version 0.1
+ */
+class TreeArena {
+   public:
+      // =======================================================================
+      //                     CONSTRUCTORS AND DESTRUCTORS
+      // =======================================================================
+
+
+      /**
+       * Custom constructor.
+       *
+       * No memory is allocated until the first allocation request.
+       *
+       * @param blockSize Size in bytes of the blocks requested to the system.
+       */
+      explicit TreeArena(std::size_t blockSize = 64 * 1024);
+
+      //________________________________________________________________________
+
+      /** Destructor. It gives every block back to the system. */
+      ~TreeArena();
+
+
+      // =======================================================================
+      //                               MODIFIERS
+      // =======================================================================
+
+
+      /**
+       * Allocate a piece of memory.
+       *
+       * Requests bigger than the block size get a block of their own.
+       *
+       * @param size Size in bytes of the memory requested.
+       * @param alignment Alignment of the memory requested (power of two).
+       * @return A pointer to the memory allocated.
+       * @throws std::bad_alloc Thrown if a new block can't be allocated.
+       */
+      void* allocate(std::size_t size, std::size_t alignment);
+
+      //________________________________________________________________________
+
+      /**
+       * Release every piece of memory handed out by the arena.
+       *
+       * The first block is kept so that the arena can be reused without going
+       * back to the system, the rest of them are deallocated.
+       */
+      void release();
+
+
+      // =======================================================================
+      //                               CAPACITY
+      // =======================================================================
+
+
+      /**
+       * Get how many bytes have been handed out since the last release.
+       *
+       * @return Bytes allocated (padding included).
+       */
+      inline std::size_t bytesAllocated() const;
+
+      //________________________________________________________________________
+
+      /**
+       * Get how many blocks the arena is currently holding.
+       *
+       * @return Number of blocks.
+       */
+      inline std::size_t nBlocks() const;
+
+   private:
+      // =======================================================================
+      //                            PRIVATE TYPES
+      // =======================================================================
+
+
+      /** Header placed at the beginning of every block. */
+      struct Block {
+         /** Next (older) block. */
+         Block* next;
+
+         /** Size of the block in bytes (header included). */
+         std::size_t size;
+      };
+
+
+      // =======================================================================
+      //                            PRIVATE METHODS
+      // =======================================================================
+
+
+      /**
+       * The copy constructor and the operator= haven't been implemented because
+       * trees keep pointers to the arena they allocate from.
+       */
+      TreeArena(const TreeArena& source);
+      TreeArena& operator=(const TreeArena& rhs);
+
+      //________________________________________________________________________
+
+      /**
+       * Request a new block to the system and link it to the list of blocks.
+       *
+       * @param size Minimum usable size of the block in bytes.
+       * @param makeCurrent 'true' if following allocations should be served
+       * from the new block.
+       * @return A pointer to the first usable byte of the new block.
+       * @throws std::bad_alloc Thrown if memory allocation fails.
+       */
+      char* newBlock(std::size_t size, bool makeCurrent);
+
+
+      // =======================================================================
+      //                            PRIVATE FIELDS
+      // =======================================================================
+
+
+      /** Newest block, from which memory is being served. */
+      Block* _head;
+
+      //________________________________________________________________________
+
+      /** Next free byte of the current block. */
+      char* _cursor;
+
+      //________________________________________________________________________
+
+      /** End of the current block. */
+      char* _end;
+
+      //________________________________________________________________________
+
+      /** Size of the blocks requested to the system. */
+      std::size_t _blockSize;
+
+      //________________________________________________________________________
+
+      /** Bytes handed out since the last release. */
+      std::size_t _bytesAllocated;
+
+      //________________________________________________________________________
+
+      /** Number of blocks being held. */
+      std::size_t _nBlocks;
+};
+
+
+// *****************************************************************************
+//                            INLINE IMPLEMENTATION
+// *****************************************************************************
+
+
+inline std::size_t TreeArena::bytesAllocated() const {
+   return _bytesAllocated;
+}
+
+//______________________________________________________________________________
+
+inline std::size_t TreeArena::nBlocks() const {
+   return _nBlocks;
+}
+
+#endif
@@ -0,0 +1,281 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version. This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details. You should have received a copy of the GNU
+ * General Public License along with this program; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ * USA.
+ *
+ * Copyright © 2011-2012 Francisco Aisa Garcia
+ */
+
+
+#ifndef __TREE_ARENA_ALLOCATOR_H__
+#define __TREE_ARENA_ALLOCATOR_H__
+
+#include "TreeAllocatorTraits.h"
+#include "TreeArena.h"
+#include <cstddef>
+
+
+// *****************************************************************************
+// *****************************************************************************
+// *****************************************************************************
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                HEADER                                 ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// *****************************************************************************
+// *****************************************************************************
+// *****************************************************************************
+
+
+/**
+ * Allocator that takes its memory from a 'TreeArena'.
+ *
+ * A tree declared as 'Tree< T, TreeArenaAllocator<T> >' allocates every node
+ * and every slot of its children lists from the arena given in the
+ * constructor. deallocate() does nothing, the memory comes back when the arena
+ * is released.
+ *
+ * Two allocators compare equal if they use the same arena, so trees built on
+ * the same arena can be grafted into each other without copying a single node.
+ *
+ * @author Francisco Aisa García
+ * @version 0.1
+ */
+template <class T>
+class TreeArenaAllocator {
+   public:
+      // =======================================================================
+      //                              TYPEDEFS
+      // =======================================================================
+
+
+      typedef T value_type;
+      typedef T* pointer;
+      typedef const T* const_pointer;
+      typedef std::size_t size_type;
+      typedef std::ptrdiff_t difference_type;
+
+      template <class U>
+      struct rebind {
+         typedef TreeArenaAllocator<U> other;
+      };
+
+
+      // =======================================================================
+      //                     CONSTRUCTORS AND DESTRUCTORS
+      // =======================================================================
+
+
+      /**
+       * Custom constructor.
+       *
+       * @param arena Arena from which memory is going to be taken.
+       */
+      inline TreeArenaAllocator(TreeArena& arena);
+
+      //________________________________________________________________________
+
+      /**
+       * Conversion constructor.
+       *
+       * @param source Allocator (of any type) whose arena is going to be used.
+       */
+      template <class U>
+      inline TreeArenaAllocator(const TreeArenaAllocator<U>& source);
+
+
+      // =======================================================================
+      //                               OPERATORS
+      // =======================================================================
+
+
+      /**
+       * Equality operator.
+       *
+       * @param rhs Right hand side allocator to be compared.
+       * @return 'true' if both allocators use the same arena.
+       */
+      template <class U>
+      inline bool operator==(const TreeArenaAllocator<U>& rhs) const;
+
+      //________________________________________________________________________
+
+      /**
+       * Inequality operator.
+       *
+       * @param rhs Right hand side allocator to be compared.
+       * @return 'true' if the allocators use different arenas.
+       */
+      template <class U>
+      inline bool operator!=(const TreeArenaAllocator<U>& rhs) const;
+
+
+      // =======================================================================
+      //                               MODIFIERS
+      // =======================================================================
+
+
+      /**
+       * Allocate memory for 'n' objects.
+       *
+       * @param n Number of objects.
+       * @return A pointer to uninitialized memory.
+       * @throws std::bad_alloc Thrown if the arena runs out of memory.
+       */
+      inline T* allocate(std::size_t n);
+
+      //________________________________________________________________________
+
+      /**
+       * Does nothing, the memory is given back when the arena is released.
+       *
+       * @param p Pointer to the memory.
+       * @param n Number of objects.
+       */
+      inline void deallocate(T* p, std::size_t n);
+
+
+      // =======================================================================
+      //                            ELEMENT ACCESS
+      // =======================================================================
+
+
+      /**
+       * Get the arena used by the allocator.
+       *
+       * @return A reference to the arena.
+       */
+      inline TreeArena& arena() const;
+
+   private:
+      // =======================================================================
+      //                            FRIEND CLASSES
+      // =======================================================================
+
+
+      template <class U>
+      friend class TreeArenaAllocator;
+
+
+      // =======================================================================
+      //                            PRIVATE FIELDS
+      // =======================================================================
+
+
+      /** Arena from which memory is taken. */
+      TreeArena* _arena;
+};
+
+//______________________________________________________________________________
+
+/** Memory of an arena is released in bulk. */
+template <class T>
+struct TreeAllocatorTraits< TreeArenaAllocator<T> > {
+   static const bool monotonic = true;
+};
+
+
+// *****************************************************************************
+// *****************************************************************************
+// *****************************************************************************
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                            IMPLEMENTATION                             ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// *****************************************************************************
+// *****************************************************************************
+// *****************************************************************************
+
+
+template <class T>
+TreeArenaAllocator<T>::TreeArenaAllocator(TreeArena& arena) : _arena(&arena) {
+   // Nothing to do
+}
+
+//______________________________________________________________________________
+
+template <class T>
+template <class U>
+TreeArenaAllocator<T>::TreeArenaAllocator(const TreeArenaAllocator<U>& source) : _arena(source._arena) {
+   // Nothing to do
+}
+
+//______________________________________________________________________________
+
+template <class T>
+template <class U>
+bool TreeArenaAllocator<T>::operator==(const TreeArenaAllocator<U>& rhs) const {
+   return _arena == rhs._arena;
+}
+
+//______________________________________________________________________________
+
+template <class T>
+template <class U>
+bool TreeArenaAllocator<T>::operator!=(const TreeArenaAllocator<U>& rhs) const {
+   return _arena != rhs._arena;
+}
+
+//______________________________________________________________________________
+
+template <class T>
+T* TreeArenaAllocator<T>::allocate(std::size_t n) {
+   return static_cast<T*>(_arena->allocate(n * sizeof(T), alignof(T)));
+}
+
+//______________________________________________________________________________
+
+template <class T>
+void TreeArenaAllocator<T>::deallocate(T* p, std::size_t n) {
+   // Nothing to do
+}
+
+//______________________________________________________________________________
+
+template <class T>
+TreeArena& TreeArenaAllocator<T>::arena() const {
+   return *_arena;
+}
+
+#endif
@@ -0,0 +1,2140 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version. This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details. You should have received a copy of the GNU
+ * General Public License along with this program; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ * USA.
+ *
+ * Copyright © 2011-2012 Francisco Aisa Garcia
+ */
+
+
+
+#ifndef __TREE_CONCURRENT_H__
+#define __TREE_CONCURRENT_H__
+
+#include "RootNotErasableException.h"
+#include "Tree.h"
+#include "TreeEpoch.h"
+#include "TreeRange.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+
+// *****************************************************************************
+//                             FORWARD DELCARATIONS
+// *****************************************************************************
+
+
+template <class T, class Alloc = std::allocator<T> >
+class TreeConcurrent;
+
+template <class T, class Alloc = std::allocator<T> >
+class TreeMutationQueue;
+
+
+// *****************************************************************************
+// *****************************************************************************
+// *****************************************************************************
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                HEADER                                 ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// *****************************************************************************
+// *****************************************************************************
+// *****************************************************************************
+
+
+/**
+ * Tree that many threads read while a writer modifies it, without locks on
+ * the side of the readers (read-copy-update).
+ *
+ * Every node links to its first child and to its next sibling, and every link
+ * is published with a single atomic store once whatever it points to is fully
+ * built. Hence, readers see every children list either before or after any
+ * change, never half linked: new children (and grafted trees, which are built
+ * apart first) appear at once, and removed ones disappear at once. Payloads
+ * are replaced the same way (see set()).
+ *
+ * Readers wrap their accesses in a 'TreeEpoch::Guard'. Nodes and payloads the
+ * writer removes are kept until every reader that might still be looking at
+ * them has left its guard (see 'TreeEpoch'), so a reader can go on walking
+ * from a node that has just been removed: its links still lead back into the
+ * tree. Removed memory is released by the writer every now and then, or on
+ * demand (see reclaim()).
+ *
+ * Each reader sees each link as it was at some point during its guard, so a
+ * traversal that runs while the tree changes sees some of the changes and
+ * misses others. When a node is erased its children are linked after the last
+ * one to the rest of the siblings of the node before they replace it, so a
+ * reader that is already walking those children goes on to the siblings of
+ * the erased node, as it would have done anyway.
+ *
+ * By default only one thread may modify the tree at a time. Once concurrent
+ * writers are enabled (see enableConcurrentWriters()) many threads can modify
+ * it at once, as long as none of them removes nodes the others are using:
+ * every change only locks the node whose children list changes (and the node
+ * itself, when a node is erased), so writers working on different branches
+ * seldom wait for each other. Children can also be appended without any lock
+ * at all (see appendChild()).
+ *
+ * The tree MUST NOT be destroyed while somebody is reading it.
+ *
+ * Example:
+ * <pre>
+ *    TreeConcurrent<Route> routes(Route("/"));
+ *
+ *    // Writers
+ *    routes.enableConcurrentWriters();
+ *    const TreeConcurrent<Route>::Node* api = routes.pushBackChild(routes.root(), Route("api"));
+ *    routes.graftBack(api, handlers);
+ *
+ *    // Readers
+ *    TreeEpoch::Guard guard;
+ *    for(const Route& route : routes.preorder())
+ *       match(route);
+ * </pre>
+ *
+ * @author Francisco Aisa García
+ * @version 0.1
+ */
+template <class T, class Alloc>
+class TreeConcurrent {
+   public:
+      // =======================================================================
+      //                          INNER DECLARATIONS
+      // =======================================================================
+
+
+      class Node;
+      class PreOrderIterator;
+      class ChildIterator;
+
+
+      // =======================================================================
+      //                     CONSTRUCTORS AND DESTRUCTORS
+      // =======================================================================
+
+
+      /**
+       * Custom constructor. It builds an empty tree.
+       *
+       * @param alloc Allocator the nodes and their payloads are allocated with.
+       */
+      inline explicit TreeConcurrent(const Alloc& alloc = Alloc());
+
+      //________________________________________________________________________
+
+      /**
+       * Custom constructor. It builds a tree with a single node.
+       *
+       * @param data Data to be assigned to the root node.
+       * @param alloc Allocator the nodes and their payloads are allocated with.
+       * @throws std::bad_alloc Thrown if memory allocation for the root node fails.
+       */
+      explicit TreeConcurrent(const T& data, const Alloc& alloc = Alloc());
+
+      //________________________________________________________________________
+
+      /**
+       * Destructor. Every node is released, the ones already removed included.
+       *
+       * Nobody may be reading the tree anymore.
+       */
+      ~TreeConcurrent();
+
+
+      // =======================================================================
+      //                               ITERATORS
+      // =======================================================================
+
+
+      /**
+       * Get the root node. Readers MUST hold a guard.
+       *
+       * @return The root node, NULL if the tree is empty.
+       */
+      inline const Node* root() const;
+
+      //________________________________________________________________________
+
+      /**
+       * Retrieve an iterator to the first node of a pre-order traversal.
+       *
+       * @param subtreeRoot Root of the subtree to be traversed, NULL for an
+       * empty traversal.
+       * @return A 'PreOrderIterator' to 'subtreeRoot'.
+       */
+      inline PreOrderIterator preBegin(const Node* subtreeRoot) const;
+
+      //________________________________________________________________________
+
+      /**
+       * Retrieve an iterator that marks the end of pre-order traversals.
+       *
+       * @return A 'PreOrderIterator' to NULL.
+       */
+      inline PreOrderIterator preEnd() const;
+
+      //________________________________________________________________________
+
+      /**
+       * Get the nodes of a subtree in pre-order.
+       *
+       * @param subtreeRoot Root of the subtree to be traversed.
+       * @return A range that goes over the subtree in pre-order.
+       */
+      inline TreeRange<PreOrderIterator> preorder(const Node* subtreeRoot) const;
+
+      //________________________________________________________________________
+
+      /**
+       * Get every node of the tree in pre-order.
+       *
+       * @return A range that goes over the whole tree in pre-order.
+       */
+      inline TreeRange<PreOrderIterator> preorder() const;
+
+      //________________________________________________________________________
+
+      /**
+       * Get the children of a node.
+       *
+       * @param parent Node whose children are wanted.
+       * @return A range that goes over the children of 'parent' in order.
+       */
+      inline TreeRange<ChildIterator> children(const Node* parent) const;
+
+
+      // =======================================================================
+      //                               CAPACITY
+      // =======================================================================
+
+
+      /**
+       * Check whether the tree is empty.
+       *
+       * @return 'true' if the tree doesn't have any node, 'false' otherwise.
+       */
+      inline bool empty() const;
+
+      //________________________________________________________________________
+
+      /**
+       * Get how many removed nodes and payloads are waiting to be released.
+       *
+       * @return The number of nodes (or subtrees) and payloads removed and not
+       * released yet.
+       */
+      inline std::size_t nRetired() const;
+
+
+      // =======================================================================
+      //                               ALLOCATOR
+      // =======================================================================
+
+
+      /**
+       * Get a copy of the allocator of the tree.
+       *
+       * @return The allocator the nodes are allocated with.
+       */
+      inline Alloc getAllocator() const;
+
+
+      // =======================================================================
+      //                           CONCURRENT WRITERS
+      // =======================================================================
+
+
+      /**
+       * Let many threads modify the tree at once.
+       *
+       * Locks are spread over a fixed number of stripes, nodes are mapped to
+       * them by address. Modifications lock at most two stripes, always in the
+       * same order, so writers can't deadlock.
+       *
+       * It MUST NOT be called while somebody is modifying the tree.
+       *
+       * @throws std::bad_alloc Thrown if memory allocation for the locks fails.
+       */
+      void enableConcurrentWriters();
+
+      //________________________________________________________________________
+
+      /**
+       * Go back to a single writer, which doesn't lock anything.
+       *
+       * It MUST NOT be called while somebody is modifying the tree.
+       */
+      void disableConcurrentWriters();
+
+      //________________________________________________________________________
+
+      /**
+       * Check whether many threads can modify the tree at once.
+       *
+       * @return 'true' if concurrent writers are enabled, 'false' otherwise.
+       */
+      inline bool concurrentWriters() const;
+
+
+      // =======================================================================
+      //                               MODIFIERS
+      // =======================================================================
+
+
+      /**
+       * Set the root value.
+       *
+       * If the tree is empty, this method creates a new root node, otherwise it
+       * replaces the payload of the root (see set()).
+       *
+       * @param data Data to be assigned to the root node.
+       * @throws std::bad_alloc Thrown if memory allocation fails.
+       */
+      void setRoot(const T& data);
+
+      //________________________________________________________________________
+
+      /**
+       * Replace the payload of a node.
+       *
+       * The new payload is built apart and published at once, readers see
+       * either the old payload or the new one. The old one is released once
+       * nobody can be reading it.
+       *
+       * @param node Node whose payload is replaced.
+       * @param data New data of the node.
+       * @throws std::bad_alloc Thrown if memory allocation fails. In that case
+       * the node is left untouched.
+       */
+      void set(const Node* node, const T& data);
+
+      //________________________________________________________________________
+
+      /**
+       * Given a value and a node, create a new child at the front of its
+       * children list.
+       *
+       * @param parent Node to which the new node is attached.
+       * @param data Data to be assigned to the new node.
+       * @return The new node.
+       * @throws std::bad_alloc Thrown if memory allocation for the node fails.
+       */
+      const Node* pushFrontChild(const Node* parent, const T& data);
+
+      //________________________________________________________________________
+
+      /**
+       * Given a value and a node, create a new child at the end of its children
+       * list.
+       *
+       * @param parent Node to which the new node is attached.
+       * @param data Data to be assigned to the new node.
+       * @return The new node.
+       * @throws std::bad_alloc Thrown if memory allocation for the node fails.
+       */
+      const Node* pushBackChild(const Node* parent, const T& data);
+
+      //________________________________________________________________________
+
+      /**
+       * Given a value and a node, create a new child right before one of its
+       * children.
+       *
+       * @param parent Node to which the new node is attached.
+       * @param childNode Child of 'parent' before which the new node is placed.
+       * @param data Data to be assigned to the new node.
+       * @return The new node.
+       * @throws std::bad_alloc Thrown if memory allocation for the node fails.
+       */
+      const Node* insertChild(const Node* parent, const Node* childNode, const T& data);
+
+      //________________________________________________________________________
+
+      /**
+       * Given a value and a node, create a new child at the end of its children
+       * list without taking any lock.
+       *
+       * Many threads can append children to the same node at once: the new
+       * child is linked after the last one with a compare-and-swap, and readers
+       * see the children list either with it or without it. Appended children
+       * are ordered as their compare-and-swaps succeed.
+       *
+       * It MUST NOT run while the children list of 'parent' is modified by
+       * anything but other calls to appendChild() (other nodes can be modified
+       * at the same time if concurrent writers are enabled).
+       *
+       * @param parent Node to which the new node is attached.
+       * @param data Data to be moved into the new node.
+       * @return The new node.
+       * @throws std::bad_alloc Thrown if memory allocation for the node fails.
+       */
+      const Node* appendChild(const Node* parent, T&& data);
+
+      //________________________________________________________________________
+
+      /**
+       * Erase a single node, relinking its children to its parent in its place.
+       *
+       * @param node Node to be erased.
+       * @throws RootNotErasableException Thrown if the given node is the root.
+       * @throws std::bad_alloc Thrown if there is no memory to keep the node
+       * until it can be released. In that case the tree is left untouched.
+       */
+      void erase(const Node* node);
+
+      //________________________________________________________________________
+
+      /**
+       * Prune a subtree.
+       *
+       * The subtree disappears from the tree at once and is returned as a
+       * regular tree. Readers may still be walking it, so its nodes are copied
+       * into the new tree and released later.
+       *
+       * @param rootNode Root of the subtree to be pruned.
+       * @return A copy of the subtree.
+       * @throws std::bad_alloc Thrown if memory allocation fails. In that case
+       * the tree is left untouched.
+       */
+      Tree<T, Alloc> prune(const Node* rootNode);
+
+      //________________________________________________________________________
+
+      /**
+       * Erase a subtree.
+       *
+       * The subtree disappears from the tree at once, and its nodes are
+       * released once nobody can be reading them.
+       *
+       * @param rootNode Root of the subtree to be erased.
+       * @throws std::bad_alloc Thrown if there is no memory to keep the subtree
+       * until it can be released. In that case the tree is left untouched.
+       */
+      void chop(const Node* rootNode);
+
+      //________________________________________________________________________
+
+      /**
+       * Graft a tree and attach it to the front of the children list of a node.
+       *
+       * The tree is copied apart and published at once, readers see either all
+       * of it or none of it. The given tree is left empty.
+       *
+       * @param parent Node where the tree is grafted.
+       * @param tree Tree to be grafted.
+       * @throws std::bad_alloc Thrown if memory allocation fails. In that case
+       * both trees are left untouched.
+       */
+      void graftFront(const Node* parent, Tree<T, Alloc>& tree);
+
+      //________________________________________________________________________
+
+      /**
+       * Graft a tree and attach it to the back of the children list of a node.
+       *
+       * @param parent Node where the tree is grafted.
+       * @param tree Tree to be grafted.
+       * @throws std::bad_alloc Thrown if memory allocation fails. In that case
+       * both trees are left untouched.
+       * @see graftFront()
+       */
+      void graftBack(const Node* parent, Tree<T, Alloc>& tree);
+
+      //________________________________________________________________________
+
+      /**
+       * Graft a tree and insert it into the children list of a node, right
+       * before one of its children.
+       *
+       * @param parent Node where the tree is grafted.
+       * @param childNode Child of 'parent' before which the tree is placed.
+       * @param tree Tree to be grafted.
+       * @throws std::bad_alloc Thrown if memory allocation fails. In that case
+       * both trees are left untouched.
+       * @see graftFront()
+       */
+      void graftAt(const Node* parent, const Node* childNode, Tree<T, Alloc>& tree);
+
+      //________________________________________________________________________
+
+      /**
+       * Release the removed nodes and payloads nobody can be reading anymore.
+       *
+       * It is called every now and then by the modifiers, so it only has to be
+       * called to release memory right away (for instance, when the writer is
+       * about to be idle for a while).
+       */
+      void reclaim();
+
+   private:
+      // =======================================================================
+      //                            FRIEND CLASSES
+      // =======================================================================
+
+
+      friend class TreeMutationQueue<T, Alloc>;
+
+
+      // =======================================================================
+      //                            PRIVATE TYPES
+      // =======================================================================
+
+
+      /** Allocator used for the nodes (rebound from 'Alloc'). */
+      typedef typename std::allocator_traits<Alloc>::template rebind_alloc<Node> NodeAllocator;
+
+      /** Traits of the allocator used for the nodes. */
+      typedef std::allocator_traits<NodeAllocator> NodeAllocatorTraits;
+
+      /** Traits of the allocator used for the payloads. */
+      typedef std::allocator_traits<Alloc> DataAllocatorTraits;
+
+      //________________________________________________________________________
+
+      /** Lock of a stripe, padded so that stripes don't share cache lines. */
+      struct alignas(64) Stripe {
+         /** Lock of the children lists of the nodes of the stripe. */
+         std::mutex lock;
+      };
+
+      //________________________________________________________________________
+
+      /**
+       * Locks of the stripes of up to two nodes, held while the object lives.
+       * Nothing is locked when concurrent writers are disabled.
+       */
+      class StripeLock {
+         public:
+            /**
+             * Custom constructor. It locks the stripes in increasing order.
+             *
+             * @param tree Tree the nodes belong to.
+             * @param first Node to be locked, NULL for the root of the tree.
+             * @param second Another node to be locked, NULL if there isn't one.
+             */
+            StripeLock(TreeConcurrent<T, Alloc>& tree, const Node* first, const Node* second = NULL);
+
+            /** Destructor. It unlocks the stripes. */
+            ~StripeLock();
+
+         private:
+            /**
+             * The copy constructor and the operator= haven't been implemented
+             * because the locks can't be shared.
+             */
+            StripeLock(const StripeLock& source);
+            StripeLock& operator=(const StripeLock& rhs);
+
+            /** Lock taken first, NULL if nothing is locked. */
+            std::mutex* _first;
+
+            /** Lock taken second, NULL if there is only one. */
+            std::mutex* _second;
+      };
+
+      //________________________________________________________________________
+
+      /** Something removed from the tree, waiting to be released. */
+      struct Retired {
+         /** Node removed (with its subtree if 'subtree' is set), or NULL. */
+         Node* node;
+
+         /** Payload removed, or NULL. */
+         T* data;
+
+         /** Whether the whole subtree of 'node' has to be released. */
+         bool subtree;
+
+         /** Epoch it was removed in (see TreeEpoch::advance()). */
+         unsigned long long epoch;
+      };
+
+
+      // =======================================================================
+      //                           PRIVATE CONSTANTS
+      // =======================================================================
+
+
+      /** Things removed before the first attempt to release them. */
+      static const std::size_t RECLAIM_INTERVAL = 64;
+
+      //________________________________________________________________________
+
+      /** Number of stripes of locks used by concurrent writers. */
+      static const std::size_t N_STRIPES = 64;
+
+
+      // =======================================================================
+      //                            PRIVATE METHODS
+      // =======================================================================
+
+
+      /**
+       * The copy constructor and the operator= haven't been implemented
+       * because readers hold pointers to the nodes.
+       */
+      TreeConcurrent(const TreeConcurrent<T, Alloc>& source);
+      TreeConcurrent<T, Alloc>& operator=(const TreeConcurrent<T, Alloc>& rhs);
+
+      //________________________________________________________________________
+
+      /**
+       * Allocate and build a payload.
+       *
+       * @param data Data to be copied (or moved) into the payload.
+       * @return The new payload.
+       * @throws std::bad_alloc Thrown if memory allocation fails.
+       */
+      template <class Data>
+      T* createData(Data&& data);
+
+      //________________________________________________________________________
+
+      /**
+       * Destroy and deallocate a payload.
+       *
+       * @param data Payload to be released.
+       */
+      inline void destroyData(T* data);
+
+      //________________________________________________________________________
+
+      /**
+       * Allocate and build a node that isn't linked yet.
+       *
+       * @param data Data to be copied (or moved) into the node.
+       * @param parent Parent of the node.
+       * @return The new node.
+       * @throws std::bad_alloc Thrown if memory allocation fails.
+       */
+      template <class Data>
+      Node* createNode(Data&& data, Node* parent);
+
+      //________________________________________________________________________
+
+      /**
+       * Destroy and deallocate a node and its payload.
+       *
+       * @param node Node to be released.
+       */
+      inline void destroyNode(Node* node);
+
+      //________________________________________________________________________
+
+      /**
+       * Destroy and deallocate every node of a subtree, without recursion.
+       *
+       * @param root Root of the subtree to be released.
+       */
+      void destroySubtree(Node* root);
+
+      //________________________________________________________________________
+
+      /**
+       * Copy a regular tree into nodes that aren't linked yet.
+       *
+       * @param source Tree to be copied, it MUST NOT be empty.
+       * @param parent Parent of the copy.
+       * @return The root of the copy.
+       * @throws std::bad_alloc Thrown if memory allocation fails. In that case
+       * nothing is left allocated.
+       */
+      Node* copyIn(const Tree<T, Alloc>& source, Node* parent);
+
+      //________________________________________________________________________
+
+      /**
+       * Publish a chain of siblings that is fully built as children of a node.
+       *
+       * @param parent Parent of the chain.
+       * @param before Child of 'parent' the chain goes before, NULL to append it.
+       * @param first First node of the chain.
+       * @param last Last node of the chain ('first' for a single node).
+       */
+      void link(Node* parent, Node* before, Node* first, Node* last);
+
+      //________________________________________________________________________
+
+      /**
+       * Take a node out of the tree, relinking its children to its parent in
+       * its place.
+       *
+       * @param node Node to be taken out, it MUST NOT be the root.
+       */
+      void detach(Node* node);
+
+      //________________________________________________________________________
+
+      /**
+       * Take a node (and its subtree) out of its children list at once.
+       *
+       * @param node Node to be taken out.
+       */
+      void unlink(Node* node);
+
+      //________________________________________________________________________
+
+      /**
+       * Graft a tree among the children of a node.
+       *
+       * @param parent Node where the tree is grafted.
+       * @param before Child of 'parent' the tree goes before, NULL to append it.
+       * @param atFront Whether the tree goes before every child ('before' is
+       * ignored then).
+       * @param tree Tree to be grafted.
+       */
+      void graft(Node* parent, Node* before, bool atFront, Tree<T, Alloc>& tree);
+
+      //________________________________________________________________________
+
+      /**
+       * Get the lock of the stripe a node belongs to.
+       *
+       * @param node Node whose lock is wanted, NULL for the root of the tree.
+       * @return The lock of the stripe of 'node'.
+       */
+      inline std::mutex& lockOf(const Node* node);
+
+      //________________________________________________________________________
+
+      /**
+       * Make room for things to be retired, before unlinking them (so that
+       * nothing can fail once they are unlinked).
+       *
+       * @param count Number of things that will be retired.
+       * @throws std::bad_alloc Thrown if memory allocation fails.
+       */
+      void reserveRetired(std::size_t count = 1);
+
+      //________________________________________________________________________
+
+      /**
+       * Keep something that has just been unlinked until it can be released.
+       *
+       * Room for it MUST have been reserved before unlinking (see
+       * reserveRetired()).
+       *
+       * @param node Node unlinked, or NULL.
+       * @param data Payload unlinked, or NULL.
+       * @param subtree Whether the whole subtree of 'node' was unlinked.
+       */
+      void retire(Node* node, T* data, bool subtree);
+
+      //________________________________________________________________________
+
+      /**
+       * Release what nobody can be reading anymore. '_retiredLock' MUST be
+       * held.
+       */
+      void releaseRetired();
+
+      //________________________________________________________________________
+
+      /**
+       * Release something that nobody can be reading anymore.
+       *
+       * @param retired What is to be released.
+       */
+      void release(const Retired& retired);
+
+
+      // =======================================================================
+      //                            PRIVATE FIELDS
+      // =======================================================================
+
+
+      /** Root node, NULL if the tree is empty. */
+      std::atomic<Node*> _root;
+
+      //________________________________________________________________________
+
+      /** Allocator used for the nodes. */
+      NodeAllocator _allocator;
+
+      //________________________________________________________________________
+
+      /** Allocator used for the payloads. */
+      Alloc _dataAllocator;
+
+      //________________________________________________________________________
+
+      /** Nodes and payloads removed, oldest first. */
+      std::vector<Retired> _retired;
+
+      //________________________________________________________________________
+
+      /** Number of things removed at which reclaim() is called next. */
+      std::size_t _reclaimAt;
+
+      //________________________________________________________________________
+
+      /** Room reserved in '_retired' by modifications in progress. */
+      std::size_t _nReserved;
+
+      //________________________________________________________________________
+
+      /** Lock of the removed nodes and payloads, taken after any stripe. */
+      mutable std::mutex _retiredLock;
+
+      //________________________________________________________________________
+
+      /** Locks of the stripes, NULL while concurrent writers are disabled. */
+      Stripe* _stripes;
+};
+
+
+// *****************************************************************************
+// *****************************************************************************
+
+
+/**
+ * Node of a concurrent tree, as seen by readers.
+ *
+ * Readers only get const nodes and follow their links, each of them read
+ * atomically. Everything is only valid while the reader holds a guard.
+ *
+ * @author Francisco Aisa García
+ * @version 0.1
+ */
+template <class T, class Alloc>
+class TreeConcurrent<T, Alloc>::Node {
+   public:
+      // =======================================================================
+      //                            ELEMENT ACCESS
+      // =======================================================================
+
+
+      /**
+       * Get the payload of the node.
+       *
+       * @return The payload of the node when it is read.
+       */
+      inline const T& data() const;
+
+      //________________________________________________________________________
+
+      /**
+       * Get the parent node.
+       *
+       * @return The parent node, NULL for the root.
+       */
+      inline const Node* parent() const;
+
+      //________________________________________________________________________
+
+      /**
+       * Get the first child.
+       *
+       * @return The first child, NULL if the node is a leaf.
+       */
+      inline const Node* firstChild() const;
+
+      //________________________________________________________________________
+
+      /**
+       * Get the next sibling.
+       *
+       * @return The next sibling, NULL if the node is the last child.
+       */
+      inline const Node* nextSibling() const;
+
+   private:
+      // =======================================================================
+      //                            FRIEND CLASSES
+      // =======================================================================
+
+
+      friend class TreeConcurrent<T, Alloc>;
+      friend class TreeMutationQueue<T, Alloc>;
+
+
+      // =======================================================================
+      //                            PRIVATE METHODS
+      // =======================================================================
+
+
+      /**
+       * Custom constructor.
+       *
+       * @param data Payload of the node.
+       * @param parent Parent node.
+       */
+      inline Node(T* data, Node* parent);
+
+
+      // =======================================================================
+      //                            PRIVATE FIELDS
+      // =======================================================================
+
+
+      /** Parent node (the links are read by readers, written by the writer). */
+      std::atomic<Node*> _parent;
+
+      //________________________________________________________________________
+
+      /** First child. */
+      std::atomic<Node*> _firstChild;
+
+      //________________________________________________________________________
+
+      /** Next sibling. */
+      std::atomic<Node*> _nextSibling;
+
+      //________________________________________________________________________
+
+      /** Payload, replaced at once (see TreeConcurrent::set()). */
+      std::atomic<T*> _data;
+
+      //________________________________________________________________________
+
+      /**
+       * Last child, only used by writers. It may be behind while children are
+       * being appended (see TreeConcurrent::appendChild()).
+       */
+      std::atomic<Node*> _lastChild;
+
+      //________________________________________________________________________
+
+      /** Previous sibling, only used by the writer. */
+      Node* _previousSibling;
+};
+
+
+// *****************************************************************************
+// *****************************************************************************
+
+
+/**
+ * Iterator that goes over a subtree of a concurrent tree in pre-order.
+ *
+ * It only keeps the current node and the root of the subtree, and moves
+ * following the links of the nodes, so it MUST only be used while holding a
+ * guard.
+ *
+ * @author Francisco Aisa García
+ * @version 0.1
+ */
+template <class T, class Alloc>
+class TreeConcurrent<T, Alloc>::PreOrderIterator {
+   public:
+      // =======================================================================
+      //                               TYPEDEFS
+      // =======================================================================
+
+
+      typedef std::forward_iterator_tag iterator_category;
+      typedef T value_type;
+      typedef std::ptrdiff_t difference_type;
+      typedef const T* pointer;
+      typedef const T& reference;
+
+
+      // =======================================================================
+      //                     CONSTRUCTORS AND DESTRUCTORS
+      // =======================================================================
+
+
+      /** Default constructor. It builds an iterator to the end. */
+      inline PreOrderIterator();
+
+      //________________________________________________________________________
+
+      /**
+       * Custom constructor.
+       *
+       * @param subtreeRoot Root of the subtree to be traversed.
+       */
+      inline explicit PreOrderIterator(const Node* subtreeRoot);
+
+
+      // =======================================================================
+      //                               OPERATORS
+      // =======================================================================
+
+
+      /**
+       * Pre-increment operator. It moves to the next node in pre-order.
+       *
+       * @return A reference to 'this' iterator.
+       */
+      PreOrderIterator& operator++();
+
+      //________________________________________________________________________
+
+      /**
+       * Post-increment operator.
+       *
+       * @return A copy of 'this' iterator before moving.
+       */
+      inline PreOrderIterator operator++(int);
+
+      //________________________________________________________________________
+
+      /**
+       * Equality operator.
+       *
+       * @param rhs Iterator to be compared.
+       * @return 'true' if both iterators point to the same node.
+       */
+      inline bool operator==(const PreOrderIterator& rhs) const;
+
+      //________________________________________________________________________
+
+      /**
+       * Inequality operator.
+       *
+       * @param rhs Iterator to be compared.
+       * @return 'true' if the iterators point to different nodes.
+       */
+      inline bool operator!=(const PreOrderIterator& rhs) const;
+
+      //________________________________________________________________________
+
+      /**
+       * Dereference operator.
+       *
+       * @return The payload of the current node.
+       */
+      inline const T& operator*() const;
+
+      //________________________________________________________________________
+
+      /**
+       * Reference operator.
+       *
+       * @return A pointer to the payload of the current node.
+       */
+      inline const T* operator->() const;
+
+
+      // =======================================================================
+      //                            ELEMENT ACCESS
+      // =======================================================================
+
+
+      /**
+       * Get the current node.
+       *
+       * @return The current node, NULL at the end.
+       */
+      inline const Node* node() const;
+
+   private:
+      // =======================================================================
+      //                            PRIVATE FIELDS
+      // =======================================================================
+
+
+      /** Current node. */
+      const Node* _node;
+
+      //________________________________________________________________________
+
+      /** Root of the subtree being traversed. */
+      const Node* _root;
+};
+
+
+// *****************************************************************************
+// *****************************************************************************
+
+
+/**
+ * Iterator that goes over the children of a node of a concurrent tree.
+ *
+ * It MUST only be used while holding a guard.
+ *
+ * @author Francisco Aisa García
+ * @version 0.1
+ */
+template <class T, class Alloc>
+class TreeConcurrent<T, Alloc>::ChildIterator {
+   public:
+      // =======================================================================
+      //                               TYPEDEFS
+      // =======================================================================
+
+
+      typedef std::forward_iterator_tag iterator_category;
+      typedef T value_type;
+      typedef std::ptrdiff_t difference_type;
+      typedef const T* pointer;
+      typedef const T& reference;
+
+
+      // =======================================================================
+      //                     CONSTRUCTORS AND DESTRUCTORS
+      // =======================================================================
+
+
+      /** Default constructor. It builds an iterator to the end. */
+      inline ChildIterator();
+
+      //________________________________________________________________________
+
+      /**
+       * Custom constructor.
+       *
+       * @param node Child the iterator points to.
+       */
+      inline explicit ChildIterator(const Node* node);
+
+
+      // =======================================================================
+      //                               OPERATORS
+      // =======================================================================
+
+
+      /**
+       * Pre-increment operator. It moves to the next sibling.
+       *
+       * @return A reference to 'this' iterator.
+       */
+      inline ChildIterator& operator++();
+
+      //________________________________________________________________________
+
+      /**
+       * Post-increment operator.
+       *
+       * @return A copy of 'this' iterator before moving.
+       */
+      inline ChildIterator operator++(int);
+
+      //________________________________________________________________________
+
+      /**
+       * Equality operator.
+       *
+       * @param rhs Iterator to be compared.
+       * @return 'true' if both iterators point to the same node.
+       */
+      inline bool operator==(const ChildIterator& rhs) const;
+
+      //________________________________________________________________________
+
+      /**
+       * Inequality operator.
+       *
+       * @param rhs Iterator to be compared.
+       * @return 'true' if the iterators point to different nodes.
+       */
+      inline bool operator!=(const ChildIterator& rhs) const;
+
+      //________________________________________________________________________
+
+      /**
+       * Dereference operator.
+       *
+       * @return The payload of the current node.
+       */
+      inline const T& operator*() const;
+
+      //________________________________________________________________________
+
+      /**
+       * Reference operator.
+       *
+       * @return A pointer to the payload of the current node.
+       */
+      inline const T* operator->() const;
+
+
+      // =======================================================================
+      //                            ELEMENT ACCESS
+      // =======================================================================
+
+
+      /**
+       * Get the current node.
+       *
+       * @return The current node, NULL at the end.
+       */
+      inline const Node* node() const;
+
+   private:
+      // =======================================================================
+      //                            PRIVATE FIELDS
+      // =======================================================================
+
+
+      /** Current node. */
+      const Node* _node;
+};
+
+
+// *****************************************************************************
+// *****************************************************************************
+// *****************************************************************************
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                            IMPLEMENTATION                             ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// *****************************************************************************
+// *****************************************************************************
+// *****************************************************************************
+
+
+template <class T, class Alloc>
+TreeConcurrent<T, Alloc>::TreeConcurrent(const Alloc& alloc) :
+   _root(NULL),
+   _allocator(alloc),
+   _dataAllocator(alloc),
+   _reclaimAt(RECLAIM_INTERVAL),
+   _nReserved(0),
+   _stripes(NULL)
+{
+   // Nothing to do
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+TreeConcurrent<T, Alloc>::TreeConcurrent(const T& data, const Alloc& alloc) :
+   _root(NULL),
+   _allocator(alloc),
+   _dataAllocator(alloc),
+   _reclaimAt(RECLAIM_INTERVAL),
+   _nReserved(0),
+   _stripes(NULL)
+{
+   try {
+      _root.store(createNode(data, NULL), std::memory_order_relaxed);
+   }
+   catch(std::bad_alloc& ex) {
+      std::cerr << ex.what() << " : Failure to allocate memory for the root node when building the tree" << std::endl;
+      throw;
+   }
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+TreeConcurrent<T, Alloc>::~TreeConcurrent() {
+   Node* root = _root.load(std::memory_order_relaxed);
+   if(root != NULL)
+      destroySubtree(root);
+
+   for(std::size_t i = 0; i < _retired.size(); ++i)
+      release(_retired[i]);
+
+   delete[] _stripes;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+const typename TreeConcurrent<T, Alloc>::Node* TreeConcurrent<T, Alloc>::root() const {
+   return _root.load(std::memory_order_acquire);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+typename TreeConcurrent<T, Alloc>::PreOrderIterator TreeConcurrent<T, Alloc>::preBegin(const Node* subtreeRoot) const {
+   return PreOrderIterator(subtreeRoot);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+typename TreeConcurrent<T, Alloc>::PreOrderIterator TreeConcurrent<T, Alloc>::preEnd() const {
+   return PreOrderIterator();
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+TreeRange<typename TreeConcurrent<T, Alloc>::PreOrderIterator> TreeConcurrent<T, Alloc>::preorder(const Node* subtreeRoot) const {
+   return TreeRange<PreOrderIterator>(preBegin(subtreeRoot), preEnd());
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+TreeRange<typename TreeConcurrent<T, Alloc>::PreOrderIterator> TreeConcurrent<T, Alloc>::preorder() const {
+   return preorder(root());
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+TreeRange<typename TreeConcurrent<T, Alloc>::ChildIterator> TreeConcurrent<T, Alloc>::children(const Node* parent) const {
+   return TreeRange<ChildIterator>(ChildIterator(parent->firstChild()), ChildIterator());
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+bool TreeConcurrent<T, Alloc>::empty() const {
+   return _root.load(std::memory_order_acquire) == NULL;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+std::size_t TreeConcurrent<T, Alloc>::nRetired() const {
+   std::lock_guard<std::mutex> lock(_retiredLock);
+   return _retired.size();
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+Alloc TreeConcurrent<T, Alloc>::getAllocator() const {
+   return _dataAllocator;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+void TreeConcurrent<T, Alloc>::enableConcurrentWriters() {
+   if(_stripes == NULL)
+      _stripes = new Stripe[N_STRIPES];
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+void TreeConcurrent<T, Alloc>::disableConcurrentWriters() {
+   delete[] _stripes;
+   _stripes = NULL;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+bool TreeConcurrent<T, Alloc>::concurrentWriters() const {
+   return _stripes != NULL;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+void TreeConcurrent<T, Alloc>::setRoot(const T& data) {
+   Node* root = _root.load(std::memory_order_acquire);
+   if(root != NULL) {
+      set(root, data);
+      return;
+   }
+
+   try {
+      root = createNode(data, NULL);
+   }
+   catch(std::bad_alloc& ex) {
+      std::cerr << ex.what() << " : Failure to allocate memory for the root node" << std::endl;
+      throw;
+   }
+
+   // Another writer may have created the root meanwhile
+   Node* current;
+   {
+      StripeLock lock(*this, NULL);
+      current = _root.load(std::memory_order_relaxed);
+      if(current == NULL)
+         _root.store(root, std::memory_order_release);
+   }
+
+   if(current != NULL) {
+      destroyNode(root);
+      set(current, data);
+   }
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+void TreeConcurrent<T, Alloc>::set(const Node* node, const T& data) {
+   Node* target = const_cast<Node*>(node);
+
+   T* copy = createData(data);
+   try {
+      reserveRetired();
+   }
+   catch(...) {
+      destroyData(copy);
+      throw;
+   }
+
+   T* old = target->_data.exchange(copy, std::memory_order_acq_rel);
+   retire(NULL, old, false);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+const typename TreeConcurrent<T, Alloc>::Node* TreeConcurrent<T, Alloc>::pushFrontChild(const Node* parent, const T& data) {
+   Node* target = const_cast<Node*>(parent);
+   Node* child;
+   try {
+      child = createNode(data, target);
+   }
+   catch(std::bad_alloc& ex) {
+      std::cerr << ex.what() << " : Failure to allocate memory for the new child" << std::endl;
+      throw;
+   }
+
+   StripeLock lock(*this, target);
+   link(target, target->_firstChild.load(std::memory_order_relaxed), child, child);
+   return child;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+const typename TreeConcurrent<T, Alloc>::Node* TreeConcurrent<T, Alloc>::pushBackChild(const Node* parent, const T& data) {
+   Node* target = const_cast<Node*>(parent);
+   Node* child;
+   try {
+      child = createNode(data, target);
+   }
+   catch(std::bad_alloc& ex) {
+      std::cerr << ex.what() << " : Failure to allocate memory for the new child" << std::endl;
+      throw;
+   }
+
+   StripeLock lock(*this, target);
+   link(target, NULL, child, child);
+   return child;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+const typename TreeConcurrent<T, Alloc>::Node* TreeConcurrent<T, Alloc>::insertChild(const Node* parent, const Node* childNode, const T& data) {
+   Node* target = const_cast<Node*>(parent);
+   Node* child;
+   try {
+      child = createNode(data, target);
+   }
+   catch(std::bad_alloc& ex) {
+      std::cerr << ex.what() << " : Failure to allocate memory for the new child when inserting" << std::endl;
+      throw;
+   }
+
+   StripeLock lock(*this, target);
+   link(target, const_cast<Node*>(childNode), child, child);
+   return child;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+const typename TreeConcurrent<T, Alloc>::Node* TreeConcurrent<T, Alloc>::appendChild(const Node* parent, T&& data) {
+   Node* target = const_cast<Node*>(parent);
+   Node* child;
+   try {
+      child = createNode(std::move(data), target);
+   }
+   catch(std::bad_alloc& ex) {
+      std::cerr << ex.what() << " : Failure to allocate memory for the new child when appending" << std::endl;
+      throw;
+   }
+
+   // The last child is only a hint: the child is linked wherever the list
+   // really ends, and whoever sees the hint behind moves it forward
+   while(true) {
+      Node* last = target->_lastChild.load(std::memory_order_acquire);
+      std::atomic<Node*>& end = last != NULL ? last->_nextSibling : target->_firstChild;
+
+      Node* next = end.load(std::memory_order_acquire);
+      if(next != NULL) {
+         target->_lastChild.compare_exchange_weak(last, next, std::memory_order_release, std::memory_order_relaxed);
+         continue;
+      }
+
+      child->_previousSibling = last;
+      if(end.compare_exchange_weak(next, child, std::memory_order_release, std::memory_order_relaxed)) {
+         target->_lastChild.compare_exchange_strong(last, child, std::memory_order_release, std::memory_order_relaxed);
+         return child;
+      }
+   }
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+void TreeConcurrent<T, Alloc>::erase(const Node* node) {
+   Node* target = const_cast<Node*>(node);
+
+   // Only the root lacks a parent, and nodes never become the root
+   if(target->_parent.load(std::memory_order_acquire) == NULL)
+      throw RootNotErasableException("Error: Attempting to erase the root node");
+
+   reserveRetired();
+   detach(target);
+   retire(target, NULL, false);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+Tree<T, Alloc> TreeConcurrent<T, Alloc>::prune(const Node* rootNode) {
+   Node* target = const_cast<Node*>(rootNode);
+
+   // The copy is built level by level following the links, the iterators of
+   // the parents of the nodes being copied are kept in a stack
+   Tree<T, Alloc> copy(*target->_data.load(std::memory_order_relaxed), _dataAllocator);
+   std::vector<typename Tree<T, Alloc>::PreOrderIterator> parents;
+   parents.push_back(copy.preBegin());
+
+   Node* node = target->_firstChild.load(std::memory_order_relaxed);
+   while(node != NULL) {
+      typename Tree<T, Alloc>::PreOrderIterator it = copy.pushBackChild(parents.back(), *node->_data.load(std::memory_order_relaxed));
+
+      Node* child = node->_firstChild.load(std::memory_order_relaxed);
+      if(child != NULL) {
+         parents.push_back(it);
+         node = child;
+         continue;
+      }
+
+      // Go up until a node with a next sibling is found
+      while(node != target && node->_nextSibling.load(std::memory_order_relaxed) == NULL) {
+         node = node->_parent.load(std::memory_order_relaxed);
+         parents.pop_back();
+      }
+
+      node = node != target ? node->_nextSibling.load(std::memory_order_relaxed) : NULL;
+   }
+
+   chop(target);
+   return copy;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+void TreeConcurrent<T, Alloc>::chop(const Node* rootNode) {
+   Node* target = const_cast<Node*>(rootNode);
+   reserveRetired();
+
+   while(true) {
+      Node* parent = target->_parent.load(std::memory_order_acquire);
+      StripeLock lock(*this, parent);
+      if(target->_parent.load(std::memory_order_relaxed) != parent)
+         continue;
+
+      if(parent != NULL)
+         unlink(target);
+      else
+         _root.store(NULL, std::memory_order_release);
+
+      break;
+   }
+
+   retire(target, NULL, true);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+void TreeConcurrent<T, Alloc>::graftFront(const Node* parent, Tree<T, Alloc>& tree) {
+   graft(const_cast<Node*>(parent), NULL, true, tree);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+void TreeConcurrent<T, Alloc>::graftBack(const Node* parent, Tree<T, Alloc>& tree) {
+   graft(const_cast<Node*>(parent), NULL, false, tree);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+void TreeConcurrent<T, Alloc>::graftAt(const Node* parent, const Node* childNode, Tree<T, Alloc>& tree) {
+   graft(const_cast<Node*>(parent), const_cast<Node*>(childNode), false, tree);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+void TreeConcurrent<T, Alloc>::reclaim() {
+   std::lock_guard<std::mutex> lock(_retiredLock);
+   releaseRetired();
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+template <class Data>
+T* TreeConcurrent<T, Alloc>::createData(Data&& data) {
+   T* copy = DataAllocatorTraits::allocate(_dataAllocator, 1);
+   try {
+      DataAllocatorTraits::construct(_dataAllocator, copy, std::forward<Data>(data));
+   }
+   catch(...) {
+      DataAllocatorTraits::deallocate(_dataAllocator, copy, 1);
+      throw;
+   }
+
+   return copy;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+void TreeConcurrent<T, Alloc>::destroyData(T* data) {
+   DataAllocatorTraits::destroy(_dataAllocator, data);
+   DataAllocatorTraits::deallocate(_dataAllocator, data, 1);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+template <class Data>
+typename TreeConcurrent<T, Alloc>::Node* TreeConcurrent<T, Alloc>::createNode(Data&& data, Node* parent) {
+   T* copy = createData(std::forward<Data>(data));
+
+   Node* node;
+   try {
+      node = NodeAllocatorTraits::allocate(_allocator, 1);
+   }
+   catch(...) {
+      destroyData(copy);
+      throw;
+   }
+
+   // Building the node can't fail
+   ::new(static_cast<void*>(node)) Node(copy, parent);
+   return node;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+void TreeConcurrent<T, Alloc>::destroyNode(Node* node) {
+   destroyData(node->_data.load(std::memory_order_relaxed));
+   node->~Node();
+   NodeAllocatorTraits::deallocate(_allocator, node, 1);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+void TreeConcurrent<T, Alloc>::destroySubtree(Node* root) {
+   // Nobody else sees the subtree anymore: the first child of every node is
+   // taken out before going down into it, so the parent links are enough to
+   // come back
+   Node* node = root;
+   while(true) {
+      Node* child = node->_firstChild.load(std::memory_order_relaxed);
+      if(child != NULL) {
+         node->_firstChild.store(child->_nextSibling.load(std::memory_order_relaxed), std::memory_order_relaxed);
+         node = child;
+         continue;
+      }
+
+      Node* parent = node->_parent.load(std::memory_order_relaxed);
+      bool done = node == root;
+      destroyNode(node);
+      if(done)
+         break;
+
+      node = parent;
+   }
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+typename TreeConcurrent<T, Alloc>::Node* TreeConcurrent<T, Alloc>::copyIn(const Tree<T, Alloc>& source, Node* parent) {
+   // The copy isn't published yet, so it is linked without caring about the
+   // readers
+   Node* root = NULL;
+   std::vector<Node*> parents;
+   parents.push_back(parent);
+
+   try {
+      typename Tree<T, Alloc>::EulerTourIterator it = source.eulerBegin();
+      for(; it != source.eulerEnd(); ++it) {
+         if(it.event() == TREE_EXIT) {
+            parents.pop_back();
+            continue;
+         }
+
+         Node* up = parents.back();
+         Node* node = createNode(*it, up);
+         if(root == NULL) {
+            root = node;
+         }
+         else {
+            Node* last = up->_lastChild.load(std::memory_order_relaxed);
+            if(last == NULL)
+               up->_firstChild.store(node, std::memory_order_relaxed);
+            else
+               last->_nextSibling.store(node, std::memory_order_relaxed);
+
+            node->_previousSibling = last;
+            up->_lastChild.store(node, std::memory_order_relaxed);
+         }
+
+         parents.push_back(node);
+      }
+   }
+   catch(...) {
+      if(root != NULL)
+         destroySubtree(root);
+      throw;
+   }
+
+   return root;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+void TreeConcurrent<T, Alloc>::link(Node* parent, Node* before, Node* first, Node* last) {
+   Node* previous = before != NULL ? before->_previousSibling : parent->_lastChild.load(std::memory_order_relaxed);
+   last->_nextSibling.store(before, std::memory_order_relaxed);
+   first->_previousSibling = previous;
+
+   // The release store publishes the chain, and everything hanging from it,
+   // at once
+   if(previous != NULL)
+      previous->_nextSibling.store(first, std::memory_order_release);
+   else
+      parent->_firstChild.store(first, std::memory_order_release);
+
+   if(before != NULL)
+      before->_previousSibling = last;
+   else
+      parent->_lastChild.store(last, std::memory_order_relaxed);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+void TreeConcurrent<T, Alloc>::detach(Node* node) {
+   // The parent may change (its own parent may be erased) until it is locked
+   while(true) {
+      Node* parent = node->_parent.load(std::memory_order_acquire);
+      StripeLock lock(*this, parent, node);
+      if(node->_parent.load(std::memory_order_relaxed) != parent)
+         continue;
+
+      Node* first = node->_firstChild.load(std::memory_order_relaxed);
+      if(first == NULL) {
+         unlink(node);
+         break;
+      }
+
+      // The children are chained to the rest of the siblings first, then
+      // they replace the node with a single store
+      Node* last = node->_lastChild.load(std::memory_order_relaxed);
+      Node* next = node->_nextSibling.load(std::memory_order_relaxed);
+      Node* previous = node->_previousSibling;
+      for(Node* child = first; child != NULL; child = child->_nextSibling.load(std::memory_order_relaxed)) {
+         child->_parent.store(parent, std::memory_order_release);
+         if(child == last)
+            break;
+      }
+
+      last->_nextSibling.store(next, std::memory_order_release);
+      if(previous != NULL)
+         previous->_nextSibling.store(first, std::memory_order_release);
+      else
+         parent->_firstChild.store(first, std::memory_order_release);
+
+      first->_previousSibling = previous;
+      if(next != NULL)
+         next->_previousSibling = last;
+      else
+         parent->_lastChild.store(last, std::memory_order_relaxed);
+
+      break;
+   }
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+void TreeConcurrent<T, Alloc>::unlink(Node* node) {
+   Node* parent = node->_parent.load(std::memory_order_relaxed);
+   Node* previous = node->_previousSibling;
+   Node* next = node->_nextSibling.load(std::memory_order_relaxed);
+
+   // The links of the node are left as they are, readers standing on it go on
+   // to the rest of the siblings
+   if(previous != NULL)
+      previous->_nextSibling.store(next, std::memory_order_release);
+   else
+      parent->_firstChild.store(next, std::memory_order_release);
+
+   if(next != NULL)
+      next->_previousSibling = previous;
+   else
+      parent->_lastChild.store(previous, std::memory_order_relaxed);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+void TreeConcurrent<T, Alloc>::graft(Node* parent, Node* before, bool atFront, Tree<T, Alloc>& tree) {
+   if(tree.empty())
+      return;
+
+   Node* root;
+   try {
+      root = copyIn(tree, parent);
+   }
+   catch(std::bad_alloc& ex) {
+      std::cerr << ex.what() << " : Failure to allocate memory when copying the grafted tree" << std::endl;
+      throw;
+   }
+
+   {
+      StripeLock lock(*this, parent);
+      link(parent, atFront ? parent->_firstChild.load(std::memory_order_relaxed) : before, root, root);
+   }
+
+   typename Tree<T, Alloc>::PreOrderIterator treeRoot = tree.preBegin();
+   tree.chop(treeRoot);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+std::mutex& TreeConcurrent<T, Alloc>::lockOf(const Node* node) {
+   return _stripes[reinterpret_cast<std::uintptr_t>(node) / sizeof(Node) % N_STRIPES].lock;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+void TreeConcurrent<T, Alloc>::reserveRetired(std::size_t count) {
+   // Other writers may be between their reservation and their retire(), so
+   // their room is kept too
+   std::lock_guard<std::mutex> lock(_retiredLock);
+   _retired.reserve(_retired.size() + _nReserved + count);
+   _nReserved += count;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+void TreeConcurrent<T, Alloc>::retire(Node* node, T* data, bool subtree) {
+   std::lock_guard<std::mutex> lock(_retiredLock);
+
+   // Tags are taken with the lock held, so they grow along the list
+   Retired retired = {node, data, subtree, TreeEpoch::advance()};
+   _retired.push_back(retired);
+   --_nReserved;
+
+   // Readers that stay long in their guards hold everything back, so attempts
+   // are spaced out as the list grows
+   if(_retired.size() >= _reclaimAt) {
+      releaseRetired();
+      _reclaimAt = 2 * _retired.size() > RECLAIM_INTERVAL ? 2 * _retired.size() : RECLAIM_INTERVAL;
+   }
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+void TreeConcurrent<T, Alloc>::releaseRetired() {
+   // Things are retired in increasing epochs, so the ones that can be
+   // released are always the first ones
+   unsigned long long oldest = TreeEpoch::oldest();
+   std::size_t nReleased = 0;
+   while(nReleased < _retired.size() && _retired[nReleased].epoch < oldest) {
+      release(_retired[nReleased]);
+      ++nReleased;
+   }
+
+   _retired.erase(_retired.begin(), _retired.begin() + nReleased);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+void TreeConcurrent<T, Alloc>::release(const Retired& retired) {
+   if(retired.data != NULL)
+      destroyData(retired.data);
+
+   if(retired.node == NULL)
+      return;
+
+   if(retired.subtree)
+      destroySubtree(retired.node);
+   else
+      destroyNode(retired.node);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+TreeConcurrent<T, Alloc>::StripeLock::StripeLock(TreeConcurrent<T, Alloc>& tree, const Node* first, const Node* second) : _first(NULL), _second(NULL) {
+   if(tree._stripes == NULL)
+      return;
+
+   // Stripes are always locked in the order they are laid out in memory
+   _first = &tree.lockOf(first);
+   if(second != NULL && &tree.lockOf(second) != _first) {
+      _second = &tree.lockOf(second);
+      if(_second < _first)
+         std::swap(_first, _second);
+   }
+
+   _first->lock();
+   if(_second != NULL)
+      _second->lock();
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+TreeConcurrent<T, Alloc>::StripeLock::~StripeLock() {
+   if(_second != NULL)
+      _second->unlock();
+   if(_first != NULL)
+      _first->unlock();
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+TreeConcurrent<T, Alloc>::Node::Node(T* data, Node* parent) :
+   _parent(parent),
+   _firstChild(NULL),
+   _nextSibling(NULL),
+   _data(data),
+   _lastChild(NULL),
+   _previousSibling(NULL)
+{
+   // Nothing to do
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+const T& TreeConcurrent<T, Alloc>::Node::data() const {
+   return *_data.load(std::memory_order_acquire);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+const typename TreeConcurrent<T, Alloc>::Node* TreeConcurrent<T, Alloc>::Node::parent() const {
+   return _parent.load(std::memory_order_acquire);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+const typename TreeConcurrent<T, Alloc>::Node* TreeConcurrent<T, Alloc>::Node::firstChild() const {
+   return _firstChild.load(std::memory_order_acquire);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+const typename TreeConcurrent<T, Alloc>::Node* TreeConcurrent<T, Alloc>::Node::nextSibling() const {
+   return _nextSibling.load(std::memory_order_acquire);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+TreeConcurrent<T, Alloc>::PreOrderIterator::PreOrderIterator() : _node(NULL), _root(NULL) {
+   // Nothing to do
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+TreeConcurrent<T, Alloc>::PreOrderIterator::PreOrderIterator(const Node* subtreeRoot) : _node(subtreeRoot), _root(subtreeRoot) {
+   // Nothing to do
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+typename TreeConcurrent<T, Alloc>::PreOrderIterator& TreeConcurrent<T, Alloc>::PreOrderIterator::operator++() {
+   const Node* child = _node->firstChild();
+   if(child != NULL) {
+      _node = child;
+      return *this;
+   }
+
+   // Go up until a node with a next sibling is found. If the root of the
+   // subtree is erased meanwhile the traversal goes on up to the root of the
+   // tree
+   while(_node != _root) {
+      const Node* next = _node->nextSibling();
+      if(next != NULL) {
+         _node = next;
+         return *this;
+      }
+
+      _node = _node->parent();
+      if(_node == NULL)
+         return *this;
+   }
+
+   _node = NULL;
+   return *this;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+typename TreeConcurrent<T, Alloc>::PreOrderIterator TreeConcurrent<T, Alloc>::PreOrderIterator::operator++(int) {
+   PreOrderIterator old(*this);
+   ++(*this);
+   return old;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+bool TreeConcurrent<T, Alloc>::PreOrderIterator::operator==(const PreOrderIterator& rhs) const {
+   return _node == rhs._node;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+bool TreeConcurrent<T, Alloc>::PreOrderIterator::operator!=(const PreOrderIterator& rhs) const {
+   return _node != rhs._node;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+const T& TreeConcurrent<T, Alloc>::PreOrderIterator::operator*() const {
+   return _node->data();
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+const T* TreeConcurrent<T, Alloc>::PreOrderIterator::operator->() const {
+   return &_node->data();
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+const typename TreeConcurrent<T, Alloc>::Node* TreeConcurrent<T, Alloc>::PreOrderIterator::node() const {
+   return _node;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+TreeConcurrent<T, Alloc>::ChildIterator::ChildIterator() : _node(NULL) {
+   // Nothing to do
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+TreeConcurrent<T, Alloc>::ChildIterator::ChildIterator(const Node* node) : _node(node) {
+   // Nothing to do
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+typename TreeConcurrent<T, Alloc>::ChildIterator& TreeConcurrent<T, Alloc>::ChildIterator::operator++() {
+   _node = _node->nextSibling();
+   return *this;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+typename TreeConcurrent<T, Alloc>::ChildIterator TreeConcurrent<T, Alloc>::ChildIterator::operator++(int) {
+   ChildIterator old(*this);
+   ++(*this);
+   return old;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+bool TreeConcurrent<T, Alloc>::ChildIterator::operator==(const ChildIterator& rhs) const {
+   return _node == rhs._node;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+bool TreeConcurrent<T, Alloc>::ChildIterator::operator!=(const ChildIterator& rhs) const {
+   return _node != rhs._node;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+const T& TreeConcurrent<T, Alloc>::ChildIterator::operator*() const {
+   return _node->data();
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+const T* TreeConcurrent<T, Alloc>::ChildIterator::operator->() const {
+   return &_node->data();
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+const typename TreeConcurrent<T, Alloc>::Node* TreeConcurrent<T, Alloc>::ChildIterator::node() const {
+   return _node;
+}
+
+#endif
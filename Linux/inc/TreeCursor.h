@@ -0,0 +1,896 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version. This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details. You should have received a copy of the GNU
+ * General Public License along with this program; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ * USA.
+ *
+ * Copyright © 2011-2012 Francisco Aisa Garcia
+ */
+
+
+
+#ifndef __TREE_CURSOR_H__
+#define __TREE_CURSOR_H__
+
+#include "TreeNode.h"
+#include <cstddef>
+
+
+// *****************************************************************************
+//                                  CONSTANTS
+// *****************************************************************************
+
+
+/** Maximum depth of a traversal that goes all the way down to the leaves. */
+const unsigned int TREE_UNLIMITED_DEPTH = static_cast<unsigned int>(-1);
+
+
+// *****************************************************************************
+//                                 ENUMERATIONS
+// *****************************************************************************
+
+
+/** What a traversal asks the CPU to load before it gets there. */
+enum TreePrefetchMode {
+   /** Nothing is prefetched (default). */
+   TREE_NO_PREFETCH,
+
+   /**
+    * As soon as a node is reached, the slot of the children list that leads to
+    * the next one is prefetched: the one of its first child if the traversal
+    * goes down, or else the one of its next sibling. Only addresses held by the
+    * node reached and by its own slot are used, so finding out what to
+    * prefetch never waits for memory.
+    */
+   TREE_PREFETCH_NODES,
+
+   /**
+    * Like TREE_PREFETCH_NODES, and the payload of the node reached is
+    * prefetched as well if it is kept apart from the node (see
+    * 'TreeLayoutTraits'). Inline payloads share the line of their node, so it
+    * is the same as TREE_PREFETCH_NODES for them.
+    */
+   TREE_PREFETCH_PAYLOADS
+};
+
+//______________________________________________________________________________
+
+/** Events of an Euler tour: every node is entered and, after its subtree, exited. */
+enum TreeEulerEvent {
+   /** The node is reached for the first time, before its children. */
+   TREE_ENTER,
+
+   /** The node is left for the last time, after its children. */
+   TREE_EXIT
+};
+
+
+// *****************************************************************************
+// *****************************************************************************
+// *****************************************************************************
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                HEADER                                 ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// *****************************************************************************
+// *****************************************************************************
+// *****************************************************************************
+
+
+/**
+ * Lightweight cursor to traverse a subtree in pre-order or post-order.
+ *
+ * A cursor is just a pointer to the current node plus a pointer to the root of
+ * the subtree being traversed (its boundary). It doesn't keep any kind of stack,
+ * it moves from one node to the next one using the links to the parent and to
+ * the position in the parent's list of children that every node already has.
+ * Hence, creating, copying or comparing a cursor costs as much as doing so with
+ * a couple of pointers and never allocates memory.
+ *
+ * The cursor also keeps track of the depth of the current node (relative to the
+ * root of the subtree) so traversals can be limited to a given depth, and a
+ * pre-order traversal can be told not to descend below the current node (see
+ * skipChildren()). Nodes that are not visited are not touched at all, so a
+ * pruned traversal only costs as much as the part of the tree it visits.
+ *
+ * Walking a tree is a chain of dependent loads (node, slot of the children
+ * list, next node...), so traversals of trees that don't fit in cache spend most
+ * of their time waiting for memory. A cursor can be told to prefetch the slot
+ * of the children list that leads to the next node (see setPrefetch()), so that
+ * its load overlaps with the work done on the current node. It is off by
+ * default, since it's just wasted bandwidth when the tree is small enough to
+ * stay in cache.
+ *
+ * Every move has a mirrored counterpart that walks the children from right to
+ * left, so reverse traversals cost the same as forward ones: the previous node
+ * in pre-order is found like the next node in post-order and vice versa.
+ *
+ * The pre-order and post-order iterators of 'Tree' are built on top of it.
+ *
+ * @author Francisco Aisa García
+ * @version 0.1
+ */
+template <class T, class Alloc>
+class TreeCursor {
+   public:
+      // =======================================================================
+      //                     CONSTRUCTORS AND DESTRUCTORS
+      // =======================================================================
+
+
+      /**
+       * Default constructor.
+       *
+       * It builds an end cursor.
+       */
+      inline TreeCursor();
+
+      //________________________________________________________________________
+
+      /**
+       * Custom constructor.
+       *
+       * The cursor points to the node pointed by the given iterator and only the
+       * subtree hanging from that node is traversed.
+       *
+       * @param subtreeRoot Iterator to the root of the subtree to traverse.
+       * @param maxDepth Nodes deeper than this (the root of the subtree being at
+       * depth 0) are not visited.
+       */
+      inline explicit TreeCursor(const TreeIterator<T, Alloc>& subtreeRoot, unsigned int maxDepth = TREE_UNLIMITED_DEPTH);
+
+
+      // =======================================================================
+      //                               OPERATORS
+      // =======================================================================
+
+
+      /**
+       * Equality operator.
+       *
+       * @param rhs Right hand side cursor to be compared.
+       * @return 'true' if both cursors point to the same node, 'false' otherwise.
+       */
+      inline bool operator==(const TreeCursor<T, Alloc>& rhs) const;
+
+      //________________________________________________________________________
+
+      /**
+       * Inequality operator.
+       *
+       * @param rhs Right hand side cursor to be compared.
+       * @return 'true' if the cursors point to different nodes, 'false' otherwise.
+       */
+      inline bool operator!=(const TreeCursor<T, Alloc>& rhs) const;
+
+      //________________________________________________________________________
+
+      /**
+       * Reference operator.
+       *
+       * @return A pointer to the data contained in the current node.
+       */
+      inline T* operator->() const;
+
+      //________________________________________________________________________
+
+      /**
+       * Dereference operator.
+       *
+       * @return The data contained in the current node.
+       */
+      inline T& operator*() const;
+
+
+      // =======================================================================
+      //                               MODIFIERS
+      // =======================================================================
+
+
+      /**
+       * Move the cursor to the next node in pre-order. When the whole subtree
+       * has been traversed, the cursor becomes an end cursor.
+       */
+      inline void nextPreOrder();
+
+      //________________________________________________________________________
+
+      /**
+       * Prevent the next call to nextPreOrder() (or nextEulerTour(), when
+       * entering a node) from descending into the children of the current
+       * node. Its whole subtree is skipped.
+       */
+      inline void skipChildren();
+
+      //________________________________________________________________________
+
+      /**
+       * Move the cursor to the next node in post-order. When the whole subtree
+       * has been traversed, the cursor becomes an end cursor.
+       */
+      inline void nextPostOrder();
+
+      //________________________________________________________________________
+
+      /**
+       * Move the cursor to the next leaf. Interior nodes are only crossed, on the
+       * way up to the next sibling and on the way down to its leftmost leaf. When
+       * the whole subtree has been traversed, the cursor becomes an end cursor.
+       */
+      inline void nextLeaf();
+
+      //________________________________________________________________________
+
+      /**
+       * Move the cursor down to the first node, in post-order, of the subtree
+       * hanging from the current node (its leftmost leaf, or the leftmost node
+       * at the maximum depth).
+       */
+      inline void firstPostOrder();
+
+      //________________________________________________________________________
+
+      /**
+       * Move the cursor to the previous node in pre-order (the next node of a
+       * reverse pre-order traversal). When the root of the subtree has been
+       * left behind, the cursor becomes an end cursor.
+       */
+      inline void previousPreOrder();
+
+      //________________________________________________________________________
+
+      /**
+       * Move the cursor to the previous node in post-order (the next node of a
+       * reverse post-order traversal). When the whole subtree has been
+       * traversed, the cursor becomes an end cursor.
+       */
+      inline void previousPostOrder();
+
+      //________________________________________________________________________
+
+      /**
+       * Move the cursor down to the last node, in pre-order, of the subtree
+       * hanging from the current node (its rightmost leaf, or the rightmost node
+       * at the maximum depth).
+       */
+      inline void lastPreOrder();
+
+      //________________________________________________________________________
+
+      /**
+       * Move the cursor to the next event of an Euler tour: entering a node
+       * goes on to enter its first child (or to exit the node if it doesn't
+       * have any, or the children are skipped or too deep), exiting a node goes
+       * on to enter its next sibling (or to exit its parent). After exiting the
+       * root of the subtree, the cursor becomes an end cursor.
+       */
+      inline void nextEulerTour();
+
+      //________________________________________________________________________
+
+      /**
+       * Set what the cursor prefetches each time it moves.
+       *
+       * @param mode Prefetch mode, TREE_NO_PREFETCH turns it off.
+       */
+      inline void setPrefetch(TreePrefetchMode mode);
+
+
+      // =======================================================================
+      //                               CAPACITY
+      // =======================================================================
+
+
+      /**
+       * Check whether the traversal is over.
+       *
+       * @return 'true' if the cursor doesn't point to any node, 'false' otherwise.
+       */
+      inline bool atEnd() const;
+
+      //________________________________________________________________________
+
+      /**
+       * Get the depth of the current node.
+       *
+       * @return The distance from the root of the subtree to the current node.
+       */
+      inline unsigned int depth() const;
+
+      //________________________________________________________________________
+
+      /**
+       * Get the maximum depth of the traversal.
+       *
+       * @return The depth below which nodes are not visited.
+       */
+      inline unsigned int maxDepth() const;
+
+      //________________________________________________________________________
+
+      /**
+       * Get what the cursor prefetches each time it moves.
+       *
+       * @return The prefetch mode of the cursor.
+       */
+      inline TreePrefetchMode prefetch() const;
+
+      //________________________________________________________________________
+
+      /**
+       * Get the event of an Euler tour the cursor is at.
+       *
+       * @return TREE_EXIT if the current node is being left, TREE_ENTER
+       * otherwise.
+       */
+      inline TreeEulerEvent event() const;
+
+   private:
+      // =======================================================================
+      //                            FRIEND CLASSES
+      // =======================================================================
+
+
+      friend class Tree<T, Alloc>;
+      friend class TreeInterleaver<T, Alloc>;
+      friend class TreeParallel<T, Alloc>;
+
+
+      // =======================================================================
+      //                            PRIVATE METHODS
+      // =======================================================================
+
+
+      /**
+       * Custom constructor.
+       *
+       * @param node Node the cursor points to.
+       * @param boundary Root of the subtree being traversed.
+       * @param maxDepth Nodes deeper than this are not visited.
+       */
+      inline TreeCursor(TreeNode<T, Alloc>* node, TreeNode<T, Alloc>* boundary, unsigned int maxDepth = TREE_UNLIMITED_DEPTH);
+
+      //________________________________________________________________________
+
+      /**
+       * Get the next sibling of a node.
+       *
+       * @param node Node whose sibling is requested, it must have a parent.
+       * @return A pointer to the next sibling, NULL if it is the last child.
+       */
+      static inline TreeNode<T, Alloc>* nextSibling(TreeNode<T, Alloc>* node);
+
+      //________________________________________________________________________
+
+      /**
+       * Get the previous sibling of a node.
+       *
+       * @param node Node whose sibling is requested, it must have a parent.
+       * @return A pointer to the previous sibling, NULL if it is the first child.
+       */
+      static inline TreeNode<T, Alloc>* previousSibling(TreeNode<T, Alloc>* node);
+
+      //________________________________________________________________________
+
+      /**
+       * Prefetch what the next move is going to load, if prefetching is
+       * enabled. Called right after the cursor reaches a node.
+       *
+       * @param firstChild 'true' if the first child of the current node may be
+       * the next node (pre-order), 'false' if only its next sibling may be.
+       * @param slotLoaded 'true' if the move has loaded the slot of the current
+       * node in the children list of its parent, 'false' if it came up from a
+       * child.
+       */
+      inline void prefetchNext(bool firstChild, bool slotLoaded) const;
+
+      //________________________________________________________________________
+
+      /**
+       * Prefetch the slot of a children list without reading it.
+       *
+       * @param slot Iterator to the slot.
+       */
+      static inline void prefetchSlot(typename TreeNode<T, Alloc>::ChildIterator slot);
+
+      //________________________________________________________________________
+
+      /**
+       * Prefetch a node.
+       *
+       * @param node Node to be prefetched.
+       */
+      static inline void prefetchNode(TreeNode<T, Alloc>* node);
+
+      //________________________________________________________________________
+
+      /**
+       * Prefetch the payload of a node if it is kept apart from the node,
+       * otherwise it does nothing.
+       *
+       * The address of the payload is held by the node, so the line of the
+       * node should be in cache already.
+       *
+       * @param node Node whose payload is prefetched.
+       */
+      static inline void prefetchPayload(TreeNode<T, Alloc>* node);
+
+
+      // =======================================================================
+      //                            PRIVATE FIELDS
+      // =======================================================================
+
+
+      /** Current node, NULL once the traversal is over. */
+      TreeNode<T, Alloc>* _node;
+
+      //________________________________________________________________________
+
+      /** Root of the subtree being traversed. */
+      TreeNode<T, Alloc>* _boundary;
+
+      //________________________________________________________________________
+
+      /** Depth of the current node. */
+      unsigned int _depth;
+
+      //________________________________________________________________________
+
+      /** Nodes deeper than this are not visited. */
+      unsigned int _maxDepth;
+
+      //________________________________________________________________________
+
+      /** 'true' if the next pre-order step must not descend. */
+      bool _skipChildren;
+
+      //________________________________________________________________________
+
+      /** What is prefetched each time the cursor moves. */
+      TreePrefetchMode _prefetch;
+
+      //________________________________________________________________________
+
+      /** Event of an Euler tour the cursor is at. */
+      TreeEulerEvent _event;
+};
+
+
+// *****************************************************************************
+// *****************************************************************************
+// *****************************************************************************
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                            IMPLEMENTATION                             ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// *****************************************************************************
+// *****************************************************************************
+// *****************************************************************************
+
+
+template <class T, class Alloc>
+TreeCursor<T, Alloc>::TreeCursor() :
+   _node(NULL),
+   _boundary(NULL),
+   _depth(0),
+   _maxDepth(TREE_UNLIMITED_DEPTH),
+   _skipChildren(false),
+   _prefetch(TREE_NO_PREFETCH),
+   _event(TREE_ENTER)
+{
+   // Nothing to do
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+TreeCursor<T, Alloc>::TreeCursor(const TreeIterator<T, Alloc>& subtreeRoot, unsigned int maxDepth) :
+   _node(subtreeRoot._pointer),
+   _boundary(subtreeRoot._pointer),
+   _depth(0),
+   _maxDepth(maxDepth),
+   _skipChildren(false),
+   _prefetch(TREE_NO_PREFETCH),
+   _event(TREE_ENTER)
+{
+   // Nothing to do
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+TreeCursor<T, Alloc>::TreeCursor(TreeNode<T, Alloc>* node, TreeNode<T, Alloc>* boundary, unsigned int maxDepth) :
+   _node(node),
+   _boundary(boundary),
+   _depth(0),
+   _maxDepth(maxDepth),
+   _skipChildren(false),
+   _prefetch(TREE_NO_PREFETCH),
+   _event(TREE_ENTER)
+{
+   // Nothing to do
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+bool TreeCursor<T, Alloc>::operator==(const TreeCursor<T, Alloc>& rhs) const {
+   return _node == rhs._node;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+bool TreeCursor<T, Alloc>::operator!=(const TreeCursor<T, Alloc>& rhs) const {
+   return _node != rhs._node;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+T* TreeCursor<T, Alloc>::operator->() const {
+   return &(_node->_data.get());
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+T& TreeCursor<T, Alloc>::operator*() const {
+   return _node->_data.get();
+}
+
+//______________________________________________________________________________
+
+// THE CURRENT NODE CAN'T BE NULL
+template <class T, class Alloc>
+void TreeCursor<T, Alloc>::nextPreOrder() {
+   // Go down if possible
+   if(!_skipChildren && _depth < _maxDepth && !_node->_children.empty()) {
+      _node = _node->_children.front();
+      ++_depth;
+      prefetchNext(true, true);
+      return;
+   }
+
+   _skipChildren = false;
+
+   // Otherwise climb until an ancestor with siblings left to visit is found
+   while(_node != _boundary) {
+      TreeNode<T, Alloc>* sibling = nextSibling(_node);
+      if(sibling != NULL) {
+         _node = sibling;
+         prefetchNext(true, true);
+         return;
+      }
+
+      _node = _node->_parent;
+      --_depth;
+   }
+
+   // Back to the root of the subtree, the traversal is over
+   _node = NULL;
+}
+
+//______________________________________________________________________________
+
+// THE CURRENT NODE CAN'T BE NULL
+template <class T, class Alloc>
+void TreeCursor<T, Alloc>::nextPostOrder() {
+   if(_node == _boundary) {
+      _node = NULL;
+      return;
+   }
+
+   // The next sibling's subtree goes before the parent
+   TreeNode<T, Alloc>* sibling = nextSibling(_node);
+   if(sibling != NULL) {
+      _node = sibling;
+      firstPostOrder();
+      prefetchNext(false, true);
+   }
+   else {
+      _node = _node->_parent;
+      --_depth;
+      prefetchNext(false, false);
+   }
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+void TreeCursor<T, Alloc>::skipChildren() {
+   _skipChildren = true;
+}
+
+//______________________________________________________________________________
+
+// THE CURRENT NODE CAN'T BE NULL
+template <class T, class Alloc>
+void TreeCursor<T, Alloc>::nextLeaf() {
+   // Climb until an ancestor with a next sibling is found and go down to the
+   // leftmost leaf of that sibling
+   while(_node != _boundary) {
+      TreeNode<T, Alloc>* sibling = nextSibling(_node);
+      if(sibling != NULL) {
+         _node = sibling;
+         firstPostOrder();
+         prefetchNext(false, true);
+         return;
+      }
+
+      _node = _node->_parent;
+      --_depth;
+   }
+
+   _node = NULL;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+void TreeCursor<T, Alloc>::firstPostOrder() {
+   while(_depth < _maxDepth && !_node->_children.empty()) {
+      _node = _node->_children.front();
+      ++_depth;
+   }
+}
+
+//______________________________________________________________________________
+
+// THE CURRENT NODE CAN'T BE NULL
+template <class T, class Alloc>
+void TreeCursor<T, Alloc>::previousPreOrder() {
+   if(_node == _boundary) {
+      _node = NULL;
+      return;
+   }
+
+   // The previous sibling's subtree goes after the parent
+   TreeNode<T, Alloc>* sibling = previousSibling(_node);
+   if(sibling != NULL) {
+      _node = sibling;
+      lastPreOrder();
+   }
+   else {
+      _node = _node->_parent;
+      --_depth;
+   }
+}
+
+//______________________________________________________________________________
+
+// THE CURRENT NODE CAN'T BE NULL
+template <class T, class Alloc>
+void TreeCursor<T, Alloc>::previousPostOrder() {
+   // Go down to the last child if possible
+   if(_depth < _maxDepth && !_node->_children.empty()) {
+      _node = _node->_children.back();
+      ++_depth;
+      return;
+   }
+
+   // Otherwise climb until an ancestor with siblings left to visit is found
+   while(_node != _boundary) {
+      TreeNode<T, Alloc>* sibling = previousSibling(_node);
+      if(sibling != NULL) {
+         _node = sibling;
+         return;
+      }
+
+      _node = _node->_parent;
+      --_depth;
+   }
+
+   _node = NULL;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+void TreeCursor<T, Alloc>::lastPreOrder() {
+   while(_depth < _maxDepth && !_node->_children.empty()) {
+      _node = _node->_children.back();
+      ++_depth;
+   }
+}
+
+//______________________________________________________________________________
+
+// THE CURRENT NODE CAN'T BE NULL
+template <class T, class Alloc>
+void TreeCursor<T, Alloc>::nextEulerTour() {
+   if(_event == TREE_ENTER) {
+      // Go down if possible, otherwise the node is left right away
+      if(!_skipChildren && _depth < _maxDepth && !_node->_children.empty()) {
+         _node = _node->_children.front();
+         ++_depth;
+      }
+      else {
+         _event = TREE_EXIT;
+      }
+
+      _skipChildren = false;
+      return;
+   }
+
+   if(_node == _boundary) {
+      _node = NULL;
+      _event = TREE_ENTER;
+      return;
+   }
+
+   // After leaving a node comes its next sibling or, if there isn't any, leaving
+   // its parent
+   TreeNode<T, Alloc>* sibling = nextSibling(_node);
+   if(sibling != NULL) {
+      _node = sibling;
+      _event = TREE_ENTER;
+   }
+   else {
+      _node = _node->_parent;
+      --_depth;
+   }
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+void TreeCursor<T, Alloc>::setPrefetch(TreePrefetchMode mode) {
+   _prefetch = mode;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+bool TreeCursor<T, Alloc>::atEnd() const {
+   return _node == NULL;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+unsigned int TreeCursor<T, Alloc>::depth() const {
+   return _depth;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+unsigned int TreeCursor<T, Alloc>::maxDepth() const {
+   return _maxDepth;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+TreePrefetchMode TreeCursor<T, Alloc>::prefetch() const {
+   return _prefetch;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+TreeEulerEvent TreeCursor<T, Alloc>::event() const {
+   return _event;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+TreeNode<T, Alloc>* TreeCursor<T, Alloc>::nextSibling(TreeNode<T, Alloc>* node) {
+   typename TreeNode<T, Alloc>::ChildIterator it = node->_childIt;
+   ++it;
+
+   return it != node->_parent->_children.end() ? *it : NULL;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+TreeNode<T, Alloc>* TreeCursor<T, Alloc>::previousSibling(TreeNode<T, Alloc>* node) {
+   typename TreeNode<T, Alloc>::ChildIterator it = node->_childIt;
+   return it != node->_parent->_children.begin() ? *--it : NULL;
+}
+
+//______________________________________________________________________________
+
+// THE CURRENT NODE CAN'T BE NULL
+template <class T, class Alloc>
+void TreeCursor<T, Alloc>::prefetchNext(bool firstChild, bool slotLoaded) const {
+   if(_prefetch == TREE_NO_PREFETCH)
+      return;
+
+   // Only the current node (about to be visited anyway) and its slot are read.
+   // The slots that lead further are just prefetched, the next move reads them
+   // and the one after it uses what they hold
+   if(firstChild && _depth < _maxDepth && !_node->_children.empty()) {
+      prefetchSlot(_node->_children.begin());
+   }
+   else if(_node != _boundary) {
+      typename TreeNode<T, Alloc>::ChildIterator it = _node->_childIt;
+      if(!slotLoaded)
+         prefetchSlot(it);
+      else if(++it != _node->_parent->_children.end())
+         prefetchSlot(it);
+   }
+
+   if(_prefetch == TREE_PREFETCH_PAYLOADS)
+      prefetchPayload(_node);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+void TreeCursor<T, Alloc>::prefetchSlot(typename TreeNode<T, Alloc>::ChildIterator slot) {
+#if defined(__GNUC__)
+   // Taking the address of the element doesn't read it. A prefetch has no
+   // visible effect, so without the empty asm GCC takes the functions that
+   // only prefetch for pure ones and drops the calls to them
+   __builtin_prefetch(&*slot);
+   __asm__ __volatile__("");
+#endif
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+void TreeCursor<T, Alloc>::prefetchNode(TreeNode<T, Alloc>* node) {
+#if defined(__GNUC__)
+   __builtin_prefetch(node);
+   __asm__ __volatile__("");
+#endif
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+void TreeCursor<T, Alloc>::prefetchPayload(TreeNode<T, Alloc>* node) {
+#if defined(__GNUC__)
+   if(TreeLayoutTraits<T>::coldPayload) {
+      __builtin_prefetch(&node->_data.get());
+      __asm__ __volatile__("");
+   }
+#endif
+}
+
+#endif
@@ -0,0 +1,181 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version. This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details. You should have received a copy of the GNU
+ * General Public License along with this program; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ * USA.
+ *
+ * Copyright © 2011-2012 Francisco Aisa Garcia
+ */
+
+
+#ifndef __TREE_EPOCH_H__
+#define __TREE_EPOCH_H__
+
+#include <atomic>
+
+/**
+ * Epoch based reclamation of the memory that concurrent readers may still be
+ * using (see 'TreeConcurrent').
+ *
+ * Readers announce that they are reading (see 'Guard') by publishing the epoch
+ * they started in, which costs a store and a fence and never blocks. A writer
+ * that unlinks something tags it with the current epoch and moves the epoch
+ * forward (see advance()). Readers that start after that can't reach it
+ * anymore, so it can be released once every reader still announced started in
+ * a later epoch (see oldest()).
+ *
+ * There is a single epoch for the whole process, so a thread can read any
+ * number of concurrent trees within the same guard. Guards can be nested.
+ *
+ * Writers MUST NOT wait for the readers (see synchronize()) while they are
+ * reading themselves.
+ *
+ * @author Francisco Aisa García
+ * @version 0.1
+ */
+class TreeEpoch {
+   public:
+      // =======================================================================
+      //                          INNER DECLARATIONS
+      // =======================================================================
+
+
+      /**
+       * Read-side critical section: nothing reachable when it starts is
+       * released until it ends.
+       */
+      class Guard {
+         public:
+            /** Default constructor. It enters the critical section. */
+            inline Guard();
+
+            /** Destructor. It leaves the critical section. */
+            inline ~Guard();
+
+         private:
+            /**
+             * The copy constructor and the operator= haven't been implemented
+             * because the guard belongs to the calling thread.
+             */
+            Guard(const Guard& source);
+            Guard& operator=(const Guard& rhs);
+      };
+
+
+      // =======================================================================
+      //                               MODIFIERS
+      // =======================================================================
+
+
+      /** Enter a read-side critical section (see Guard). */
+      static void enter();
+
+      //________________________________________________________________________
+
+      /** Leave a read-side critical section (see Guard). */
+      static void leave();
+
+      //________________________________________________________________________
+
+      /**
+       * Move the epoch forward.
+       *
+       * It MUST be called after unlinking what is to be released.
+       *
+       * @return The epoch to tag what has just been unlinked with.
+       */
+      static unsigned long long advance();
+
+      //________________________________________________________________________
+
+      /**
+       * Wait until every read-side critical section that may have started
+       * before the call has ended.
+       */
+      static void synchronize();
+
+
+      // =======================================================================
+      //                               CAPACITY
+      // =======================================================================
+
+
+      /**
+       * Get the epoch of the oldest reader.
+       *
+       * Whatever was tagged with an epoch older than it can be released.
+       *
+       * @return The epoch the oldest reader started in, or the greatest epoch
+       * if nobody is reading.
+       */
+      static unsigned long long oldest();
+
+   private:
+      // =======================================================================
+      //                            PRIVATE TYPES
+      // =======================================================================
+
+
+      /** Announcement of a thread (see enter()). */
+      struct Record;
+
+      /** Owner of the record of a thread, it gives the record back when the thread ends. */
+      struct Owner;
+
+
+      // =======================================================================
+      //                            PRIVATE METHODS
+      // =======================================================================
+
+
+      /**
+       * Get the record of the calling thread, taking a free one the first time.
+       *
+       * @return The record of the calling thread.
+       */
+      static Record& local();
+
+
+      // =======================================================================
+      //                            PRIVATE FIELDS
+      // =======================================================================
+
+
+      /** Current epoch (epochs start at 1, 0 means not reading). */
+      static std::atomic<unsigned long long> _epoch;
+
+      //________________________________________________________________________
+
+      /** Records of the threads that have ever read, never released. */
+      static std::atomic<Record*> _records;
+
+      //________________________________________________________________________
+
+      /** Owner of the record of the calling thread. */
+      static thread_local Owner _owner;
+};
+
+
+// *****************************************************************************
+//                            INLINE IMPLEMENTATION
+// *****************************************************************************
+
+
+inline TreeEpoch::Guard::Guard() {
+   TreeEpoch::enter();
+}
+
+//______________________________________________________________________________
+
+inline TreeEpoch::Guard::~Guard() {
+   TreeEpoch::leave();
+}
+
+
+#endif
@@ -0,0 +1,335 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version. This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details. You should have received a copy of the GNU
+ * General Public License along with this program; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ * USA.
+ *
+ * Copyright © 2011-2012 Francisco Aisa Garcia
+ */
+
+
+#ifndef __TREE_EXECUTOR_H__
+#define __TREE_EXECUTOR_H__
+
+#include <atomic>
+#include <cstddef>
+#include <exception>
+
+/**
+ * Interface of whatever runs the tasks of the parallel tree operations (see
+ * 'TreeParallel').
+ *
+ * Every parallel operation is handed an executor instead of starting threads
+ * of its own, so all of them share the same threads and the tree work of a
+ * process stays within the threads it is given. 'TreeWorkStealingPool' is the
+ * default one; an application with a scheduler of its own can run the tasks on
+ * it by implementing this interface.
+ *
+ * Tasks are spawned in groups and the thread that waits for a group should run
+ * pending tasks meanwhile instead of blocking, since tasks spawn and wait for
+ * other tasks: an executor that blocks the waiting thread needs a thread per
+ * level of nesting. Implementations use runTask() to run a task and finish()
+ * once its group is done, which take care of the bookkeeping of the group.
+ *
+ * @author Francisco Aisa García
+ * @version 0.1
+ */
+class TreeExecutor {
+   public:
+      // =======================================================================
+      //                          INNER DECLARATIONS
+      // =======================================================================
+
+
+      class Group;
+
+      //________________________________________________________________________
+
+      /**
+       * Unit of work run by the executor.
+       *
+       * The task MUST outlive its execution, that is, the group it was spawned
+       * in must be waited for before the task is destroyed.
+       */
+      class Task {
+         public:
+            /** Default constructor. */
+            inline Task();
+
+            /** Destructor. */
+            inline virtual ~Task();
+
+            /** Do the work of the task. It is run by any thread of the executor. */
+            virtual void execute() = 0;
+
+         private:
+            friend class TreeExecutor;
+
+            /** Group the task was spawned in. */
+            Group* _group;
+      };
+
+      //________________________________________________________________________
+
+      /**
+       * Set of tasks that are waited for at once (see wait()).
+       *
+       * If any of its tasks throws an exception, the first one is kept and
+       * thrown again by wait() once every task of the group is done.
+       */
+      class Group {
+         public:
+            /** Default constructor. */
+            inline Group();
+
+            /**
+             * Check whether every task of the group has been run.
+             *
+             * @return 'true' if there aren't any pending tasks, 'false'
+             * otherwise.
+             */
+            inline bool done() const;
+
+         private:
+            friend class TreeExecutor;
+
+            /**
+             * The copy constructor and the operator= haven't been implemented
+             * because tasks keep a pointer to their group.
+             */
+            Group(const Group& source);
+            Group& operator=(const Group& rhs);
+
+            /** Number of tasks spawned in the group that haven't been run yet. */
+            std::atomic<std::size_t> _pending;
+
+            /** Whether any of the tasks has thrown an exception. */
+            std::atomic<bool> _failed;
+
+            /** First exception thrown by a task of the group. */
+            std::exception_ptr _error;
+      };
+
+
+      // =======================================================================
+      //                     CONSTRUCTORS AND DESTRUCTORS
+      // =======================================================================
+
+
+      /** Default constructor. */
+      inline TreeExecutor();
+
+      //________________________________________________________________________
+
+      /** Destructor. */
+      inline virtual ~TreeExecutor();
+
+
+      // =======================================================================
+      //                               MODIFIERS
+      // =======================================================================
+
+
+      /**
+       * Hand a task over to the executor.
+       *
+       * @param task Task to be run, it MUST outlive its execution.
+       * @param group Group the task belongs to.
+       */
+      virtual void spawn(Task& task, Group& group) = 0;
+
+      //________________________________________________________________________
+
+      /**
+       * Wait until every task of a group is done.
+       *
+       * @param group Group to wait for.
+       * @throws Any exception thrown by a task of the group (the first one).
+       */
+      virtual void wait(Group& group) = 0;
+
+
+      // =======================================================================
+      //                               CAPACITY
+      // =======================================================================
+
+
+      /**
+       * Get the number of threads that run tasks.
+       *
+       * @return The number of threads, including the one that waits.
+       */
+      virtual unsigned int concurrency() const = 0;
+
+      //________________________________________________________________________
+
+      /**
+       * Check whether any thread is looking for work.
+       *
+       * Tasks should only split their work when it returns 'true', since
+       * spawning tasks nobody is going to run is just overhead.
+       *
+       * @return 'true' if splitting the work of the calling task would pay off,
+       * 'false' otherwise.
+       */
+      virtual bool hungry() const = 0;
+
+      //________________________________________________________________________
+
+      /**
+       * Check whether the calling thread may spawn tasks and wait for them.
+       *
+       * @return 'false' if the calling task should run its work by itself,
+       * 'true' otherwise.
+       */
+      virtual bool mayWait() const = 0;
+
+
+      // =======================================================================
+      //                            ELEMENT ACCESS
+      // =======================================================================
+
+
+      /**
+       * Get the executor used by the parallel operations that aren't given one.
+       *
+       * @return A reference to the executor set with setGlobal(), or to
+       * TreeWorkStealingPool::global() if none has been set.
+       */
+      static TreeExecutor& global();
+
+      //________________________________________________________________________
+
+      /**
+       * Set the executor used by the parallel operations that aren't given one.
+       *
+       * Setting it before any parallel operation runs keeps the default pool
+       * from ever being started. Operations already running keep the executor
+       * they started with.
+       *
+       * @param executor Executor to be used, it MUST outlive every operation
+       * that uses it. NULL restores the default pool.
+       */
+      static void setGlobal(TreeExecutor* executor);
+
+   protected:
+      // =======================================================================
+      //                           PROTECTED METHODS
+      // =======================================================================
+
+
+      /**
+       * Add a task to a group, before it is queued.
+       *
+       * @param task Task spawned.
+       * @param group Group the task belongs to.
+       */
+      static inline void bind(Task& task, Group& group);
+
+      //________________________________________________________________________
+
+      /**
+       * Run a task and mark it as done in its group. Exceptions thrown by the
+       * task are kept in the group.
+       *
+       * The task may be destroyed as soon as it returns, and so may its group if
+       * it was the last one: a thread that sleeps in wait() has to be woken up
+       * then.
+       *
+       * @param task Task to be run.
+       * @return 'true' if it was the last pending task of its group, 'false'
+       * otherwise.
+       */
+      static bool runTask(Task& task);
+
+      //________________________________________________________________________
+
+      /**
+       * Throw again the exception kept by a group, if any, once it is done.
+       *
+       * @param group Group waited for.
+       * @throws The first exception thrown by a task of the group.
+       */
+      static void finish(Group& group);
+
+   private:
+      // =======================================================================
+      //                            PRIVATE METHODS
+      // =======================================================================
+
+
+      /**
+       * The copy constructor and the operator= haven't been implemented because
+       * tasks keep running on the executor they were spawned on.
+       */
+      TreeExecutor(const TreeExecutor& source);
+      TreeExecutor& operator=(const TreeExecutor& rhs);
+
+
+      // =======================================================================
+      //                            PRIVATE FIELDS
+      // =======================================================================
+
+
+      /** Executor set with setGlobal(), NULL for the default pool. */
+      static std::atomic<TreeExecutor*> _global;
+};
+
+
+// *****************************************************************************
+//                            INLINE IMPLEMENTATION
+// *****************************************************************************
+
+
+inline TreeExecutor::Task::Task() : _group(NULL) {
+   // Nothing to do
+}
+
+//______________________________________________________________________________
+
+inline TreeExecutor::Task::~Task() {
+   // Nothing to do
+}
+
+//______________________________________________________________________________
+
+inline TreeExecutor::Group::Group() : _pending(0), _failed(false) {
+   // Nothing to do
+}
+
+//______________________________________________________________________________
+
+inline bool TreeExecutor::Group::done() const {
+   // Sequentially consistent, so that a thread that announces it is going to
+   // sleep and then checks the group either sees it done or is seen by the
+   // thread that finishes it
+   return _pending.load() == 0;
+}
+
+//______________________________________________________________________________
+
+inline TreeExecutor::TreeExecutor() {
+   // Nothing to do
+}
+
+//______________________________________________________________________________
+
+inline TreeExecutor::~TreeExecutor() {
+   // Nothing to do
+}
+
+//______________________________________________________________________________
+
+inline void TreeExecutor::bind(Task& task, Group& group) {
+   task._group = &group;
+   group._pending.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+#endif
@@ -0,0 +1,386 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version. This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details. You should have received a copy of the GNU
+ * General Public License along with this program; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ * USA.
+ *
+ * Copyright © 2011-2012 Francisco Aisa Garcia
+ */
+
+
+
+#ifndef __TREE_INTERLEAVER_H__
+#define __TREE_INTERLEAVER_H__
+
+#include "Tree.h"
+#include "TreeCursor.h"
+#include <cstddef>
+#include <vector>
+
+
+// *****************************************************************************
+// *****************************************************************************
+// *****************************************************************************
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                HEADER                                 ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// *****************************************************************************
+// *****************************************************************************
+// *****************************************************************************
+
+
+/**
+ * Runs the same traversal over many subtrees (usually the roots of many small
+ * independent trees) interleaving their steps.
+ *
+ * Walking a tree that is not in cache is a chain of dependent loads: the next
+ * node can't be requested until the current one has arrived, so a single walk
+ * keeps the memory system almost idle. Walks over different trees don't depend
+ * on each other though. The interleaver keeps up to 'width' cursors (lanes)
+ * going at once and moves them round-robin, one node each time. Every time a
+ * lane moves, the node it lands on is prefetched, and it isn't visited until
+ * the other lanes have had their turn, so the loads of up to 'width' trees are
+ * in flight at the same time. Payloads kept apart from their nodes are
+ * prefetched too with TREE_PREFETCH_PAYLOADS, a lane ahead of their visit, once
+ * the node that holds their address has arrived. When a lane finishes its
+ * subtree, it picks up the next one that hasn't been started.
+ *
+ * The nodes of each subtree are visited in order, but the visits to different
+ * subtrees are interleaved, so the visitor gets the index of the subtree (the
+ * order in which it was added) along with the data of the node. It must not
+ * modify the structure of any of the trees.
+ *
+ * Example:
+ * <pre>
+ *    TreeInterleaver<int> interleaver;
+ *    for(std::size_t i = 0; i < trees.size(); ++i)
+ *       interleaver.add(trees[i].preBegin());
+ *
+ *    interleaver.preOrder(SumPerTree(sums)); // sums[i] += data
+ * </pre>
+ *
+ * @author Francisco Aisa García
+ * @version 0.1
+ */
+template <class T, class Alloc>
+class TreeInterleaver {
+   public:
+      // =======================================================================
+      //                     CONSTRUCTORS AND DESTRUCTORS
+      // =======================================================================
+
+
+      /**
+       * Custom constructor.
+       *
+       * @param width Number of subtrees traversed at the same time. Around 8 to
+       * 16 is usually enough to keep the memory system busy, going beyond the
+       * number of outstanding cache misses the CPU can handle doesn't pay off.
+       * @param prefetch What is prefetched when a lane moves to a node.
+       */
+      explicit TreeInterleaver(unsigned int width = 8, TreePrefetchMode prefetch = TREE_PREFETCH_NODES);
+
+
+      // =======================================================================
+      //                               MODIFIERS
+      // =======================================================================
+
+
+      /**
+       * Add a subtree to be traversed.
+       *
+       * @param subtreeRoot Iterator to the root of the subtree.
+       * @return The index the visitor will get for the nodes of this subtree.
+       */
+      inline std::size_t add(const TreeIterator<T, Alloc>& subtreeRoot);
+
+      //________________________________________________________________________
+
+      /** Remove every subtree. */
+      inline void clear();
+
+
+      // =======================================================================
+      //                               CAPACITY
+      // =======================================================================
+
+
+      /**
+       * Get the number of subtrees to be traversed.
+       *
+       * @return The number of subtrees added so far.
+       */
+      inline std::size_t size() const;
+
+      //________________________________________________________________________
+
+      /**
+       * Get the number of subtrees traversed at the same time.
+       *
+       * @return The width of the interleaver.
+       */
+      inline unsigned int width() const;
+
+
+      // =======================================================================
+      //                              TRAVERSALS
+      // =======================================================================
+
+
+      /**
+       * Traverse every subtree in pre-order.
+       *
+       * @param visitor Function object called as 'visitor(index, data)' for
+       * every node, 'index' being the index of its subtree.
+       * @return The visitor, after visiting every node.
+       */
+      template <class Visitor>
+      Visitor preOrder(Visitor visitor) const;
+
+      //________________________________________________________________________
+
+      /**
+       * Traverse every subtree in post-order.
+       *
+       * @param visitor Function object called as 'visitor(index, data)' for
+       * every node, 'index' being the index of its subtree.
+       * @return The visitor, after visiting every node.
+       */
+      template <class Visitor>
+      Visitor postOrder(Visitor visitor) const;
+
+   private:
+      // =======================================================================
+      //                            PRIVATE TYPES
+      // =======================================================================
+
+
+      /** Traversal in progress. */
+      struct Lane {
+         /** Cursor of the traversal. */
+         TreeCursor<T, Alloc> cursor;
+
+         /** Index of the subtree being traversed. */
+         std::size_t index;
+      };
+
+
+      // =======================================================================
+      //                            PRIVATE METHODS
+      // =======================================================================
+
+
+      /**
+       * Traverse every subtree.
+       *
+       * @param visitor Function object called for every node.
+       * @param postOrder 'true' to traverse in post-order, 'false' to traverse
+       * in pre-order.
+       */
+      template <class Visitor>
+      void run(Visitor& visitor, bool postOrder) const;
+
+      //________________________________________________________________________
+
+      /**
+       * Make a lane start the next subtree that hasn't been started.
+       *
+       * @param lane Lane to be set up.
+       * @param next Index of the next subtree to start, it is moved past the
+       * subtrees that get started (empty ones are skipped).
+       * @param postOrder 'true' if the traversal is in post-order.
+       * @return 'true' if a subtree was started, 'false' if there are none left.
+       */
+      bool startLane(Lane& lane, std::size_t& next, bool postOrder) const;
+
+
+      // =======================================================================
+      //                            PRIVATE FIELDS
+      // =======================================================================
+
+
+      /** Cursors at the roots of the subtrees to be traversed. */
+      std::vector<TreeCursor<T, Alloc> > _roots;
+
+      //________________________________________________________________________
+
+      /** Number of subtrees traversed at the same time. */
+      unsigned int _width;
+
+      //________________________________________________________________________
+
+      /** What is prefetched when a lane moves to a node. */
+      TreePrefetchMode _prefetch;
+};
+
+
+// *****************************************************************************
+// *****************************************************************************
+// *****************************************************************************
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                            IMPLEMENTATION                             ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// *****************************************************************************
+// *****************************************************************************
+// *****************************************************************************
+
+
+template <class T, class Alloc>
+TreeInterleaver<T, Alloc>::TreeInterleaver(unsigned int width, TreePrefetchMode prefetch) :
+   _width(width > 0 ? width : 1),
+   _prefetch(prefetch)
+{
+   // Nothing to do
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+std::size_t TreeInterleaver<T, Alloc>::add(const TreeIterator<T, Alloc>& subtreeRoot) {
+   _roots.push_back(TreeCursor<T, Alloc>(subtreeRoot));
+   return _roots.size() - 1;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+void TreeInterleaver<T, Alloc>::clear() {
+   _roots.clear();
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+std::size_t TreeInterleaver<T, Alloc>::size() const {
+   return _roots.size();
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+unsigned int TreeInterleaver<T, Alloc>::width() const {
+   return _width;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+template <class Visitor>
+Visitor TreeInterleaver<T, Alloc>::preOrder(Visitor visitor) const {
+   run(visitor, false);
+   return visitor;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+template <class Visitor>
+Visitor TreeInterleaver<T, Alloc>::postOrder(Visitor visitor) const {
+   run(visitor, true);
+   return visitor;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+template <class Visitor>
+void TreeInterleaver<T, Alloc>::run(Visitor& visitor, bool postOrder) const {
+   std::vector<Lane> lanes(_width);
+   std::size_t next = 0;
+   std::size_t nLanes = 0;
+   while(nLanes < _width && startLane(lanes[nLanes], next, postOrder))
+      ++nLanes;
+
+   // Every lane visits its node (prefetched a round ago) and moves to the next
+   // one, then it is the turn of the next lane. The node of the next lane is
+   // in cache by now, so its payload can be prefetched too
+   while(nLanes > 0) {
+      for(std::size_t i = 0; i < nLanes;) {
+         Lane& lane = lanes[i];
+         if(_prefetch == TREE_PREFETCH_PAYLOADS)
+            TreeCursor<T, Alloc>::prefetchPayload(lanes[i + 1 < nLanes ? i + 1 : 0].cursor._node);
+
+         visitor(lane.index, *lane.cursor);
+
+         if(postOrder)
+            lane.cursor.nextPostOrder();
+         else
+            lane.cursor.nextPreOrder();
+
+         // Finished lanes take a new subtree or leave their slot to the last lane
+         if(lane.cursor.atEnd() && !startLane(lane, next, postOrder)) {
+            lane = lanes[--nLanes];
+            continue;
+         }
+
+         if(_prefetch != TREE_NO_PREFETCH)
+            TreeCursor<T, Alloc>::prefetchNode(lane.cursor._node);
+         ++i;
+      }
+   }
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+bool TreeInterleaver<T, Alloc>::startLane(Lane& lane, std::size_t& next, bool postOrder) const {
+   for(; next < _roots.size(); ++next) {
+      if(_roots[next].atEnd())
+         continue;
+
+      lane.cursor = _roots[next];
+      lane.index = next++;
+      if(postOrder)
+         lane.cursor.firstPostOrder();
+
+      if(_prefetch != TREE_NO_PREFETCH)
+         TreeCursor<T, Alloc>::prefetchNode(lane.cursor._node);
+      return true;
+   }
+
+   return false;
+}
+
+#endif
@@ -0,0 +1,41 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version. This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details. You should have received a copy of the GNU
+ * General Public License along with this program; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ * USA.
+ *
+ * Copyright © 2011-2012 Francisco Aisa Garcia
+ */
+
+
+
+#ifndef __TREE_LAYOUT_TRAITS_H__
+#define __TREE_LAYOUT_TRAITS_H__
+
+/**
+ * Describes how the nodes of a tree storing values of type 'T' are laid out.
+ *
+ * By default the payload of a node is stored inline, next to the links to its
+ * parent and children. Traversals only look at those links, so when 'T' is
+ * large, every node they visit drags the payload into the cache along with it.
+ * Types with big payloads should specialize this class and set 'coldPayload'
+ * to 'true'. In that case nodes only keep the topology of the tree plus a
+ * pointer to the payload, which is allocated apart from the nodes (through the
+ * allocator of the tree). Iterators dereference the payload transparently.
+ *
+ * @author Francisco Aisa García
+ * @version 0.1
+ */
+template <class T>
+struct TreeLayoutTraits {
+   /** 'true' if the payload is kept apart from the node. */
+   static const bool coldPayload = false;
+};
+
+#endif
@@ -0,0 +1,850 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version. This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details. You should have received a copy of the GNU
+ * General Public License along with this program; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ * USA.
+ *
+ * Copyright © 2011-2012 Francisco Aisa Garcia
+ */
+
+
+
+#ifndef __TREE_MUTATION_QUEUE_H__
+#define __TREE_MUTATION_QUEUE_H__
+
+#include "RootNotErasableException.h"
+#include "Tree.h"
+#include "TreeConcurrent.h"
+#include "TreeEpoch.h"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <thread>
+#include <vector>
+
+
+// *****************************************************************************
+// *****************************************************************************
+// *****************************************************************************
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                HEADER                                 ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// *****************************************************************************
+// *****************************************************************************
+// *****************************************************************************
+
+
+/**
+ * Queue of modifications of a concurrent tree, submitted by many threads and
+ * applied in batches by a single one.
+ *
+ * Producers never lock anything: they build whatever the modification needs
+ * (new nodes, copies of grafted trees, new payloads) on their own and push the
+ * modification onto the queue with a compare-and-swap. New nodes are returned
+ * right away, so later modifications can refer to them before they have been
+ * applied.
+ *
+ * The applier takes every queued modification at once (see apply()) and
+ * coalesces the redundant ones: only the last payload set on a node is kept,
+ * payloads set on nodes erased by the same batch are dropped, nodes erased
+ * many times by the same batch are erased once, and nodes both created and
+ * erased by the same batch are never linked. The rest is applied payloads
+ * first, then new children grouped by parent (the children appended to a node
+ * by a batch are published with a single store), then the children inserted at
+ * a given position and finally the erased nodes.
+ *
+ * Readers that need to see every batch whole read through read(), which runs
+ * again whatever was read while a batch was being applied.
+ *
+ * Producers allocate nodes and payloads, so the allocator of the tree MUST be
+ * safe to use from many threads. Only one thread may apply modifications at a
+ * time. Other threads can still modify the tree directly if it has concurrent
+ * writers enabled, but read() only keeps batches whole.
+ *
+ * Example:
+ * <pre>
+ *    TreeConcurrent<Event> events(Event("all"));
+ *    TreeMutationQueue<Event> queue(events);
+ *
+ *    // Producers
+ *    const TreeConcurrent<Event>::Node* session = queue.pushBackChild(events.root(), Event("session"));
+ *    queue.pushBackChild(session, Event("login"));
+ *
+ *    // Applier
+ *    while(running)
+ *       queue.apply();
+ * </pre>
+ *
+ * @author Francisco Aisa García
+ * @version 0.1
+ */
+template <class T, class Alloc>
+class TreeMutationQueue {
+   public:
+      // =======================================================================
+      //                              TYPEDEFS
+      // =======================================================================
+
+
+      /** Node of the tree the modifications are applied to. */
+      typedef typename TreeConcurrent<T, Alloc>::Node Node;
+
+
+      // =======================================================================
+      //                     CONSTRUCTORS AND DESTRUCTORS
+      // =======================================================================
+
+
+      /**
+       * Custom constructor.
+       *
+       * @param tree Tree the modifications are applied to. It MUST outlive the
+       * queue.
+       */
+      inline explicit TreeMutationQueue(TreeConcurrent<T, Alloc>& tree);
+
+      //________________________________________________________________________
+
+      /**
+       * Destructor. Modifications that haven't been applied are discarded.
+       *
+       * Nobody may be submitting modifications anymore.
+       */
+      ~TreeMutationQueue();
+
+
+      // =======================================================================
+      //                               MODIFIERS
+      // =======================================================================
+
+
+      /**
+       * Queue the creation of a new child at the end of the children list of a
+       * node.
+       *
+       * @param parent Node to which the new node is attached, it may have been
+       * created by a modification that hasn't been applied yet.
+       * @param data Data to be assigned to the new node.
+       * @return The new node, which can be used by later modifications but
+       * isn't part of the tree until the modification is applied.
+       * @throws std::bad_alloc Thrown if memory allocation fails.
+       */
+      const Node* pushBackChild(const Node* parent, const T& data);
+
+      //________________________________________________________________________
+
+      /**
+       * Queue the erasure of a single node (see TreeConcurrent::erase()).
+       *
+       * @param node Node to be erased. It may be queued for erasure again until
+       * the batch that erases it is applied, but it MUST NOT be referred to by
+       * any modification after that, since it may have been released.
+       * @throws RootNotErasableException Thrown if the given node is the root.
+       * @throws std::bad_alloc Thrown if memory allocation fails.
+       */
+      void erase(const Node* node);
+
+      //________________________________________________________________________
+
+      /**
+       * Queue a graft at the end of the children list of a node.
+       *
+       * The tree is copied right away and left empty.
+       *
+       * @param parent Node where the tree is grafted.
+       * @param tree Tree to be grafted.
+       * @throws std::bad_alloc Thrown if memory allocation fails. In that case
+       * the tree is left untouched.
+       */
+      void graftBack(const Node* parent, Tree<T, Alloc>& tree);
+
+      //________________________________________________________________________
+
+      /**
+       * Queue a graft right before one of the children of a node.
+       *
+       * The tree is copied right away and left empty.
+       *
+       * @param parent Node where the tree is grafted.
+       * @param childNode Child of 'parent' before which the tree is placed. If
+       * it has moved up by the time the modification is applied (because its
+       * parent has been erased), the tree is placed before it anyway.
+       * @param tree Tree to be grafted.
+       * @throws std::bad_alloc Thrown if memory allocation fails. In that case
+       * the tree is left untouched.
+       */
+      void graftAt(const Node* parent, const Node* childNode, Tree<T, Alloc>& tree);
+
+      //________________________________________________________________________
+
+      /**
+       * Queue the replacement of the payload of a node.
+       *
+       * @param node Node whose payload is replaced.
+       * @param data New data of the node.
+       * @throws std::bad_alloc Thrown if memory allocation fails.
+       */
+      void set(const Node* node, const T& data);
+
+      //________________________________________________________________________
+
+      /**
+       * Apply every modification queued so far as a single batch.
+       *
+       * @return The number of modifications taken from the queue (coalesced
+       * ones included).
+       * @throws std::bad_alloc Thrown if there is no memory to prepare the
+       * batch. In that case nothing is applied, and the modifications are
+       * applied by the next call.
+       */
+      std::size_t apply();
+
+
+      // =======================================================================
+      //                               READERS
+      // =======================================================================
+
+
+      /**
+       * Get the number of batches applied so far, times two (plus one while a
+       * batch is being applied).
+       *
+       * @return The version of the tree.
+       */
+      inline unsigned long long version() const;
+
+      //________________________________________________________________________
+
+      /**
+       * Read the tree while no batch is being applied.
+       *
+       * The function is run within a guard (see TreeEpoch) and, if a batch
+       * was being applied meanwhile, it is run again. Hence, it MUST start
+       * from scratch every time and keep what it reads to itself until read()
+       * returns.
+       *
+       * @param function Function called with no arguments, that reads the
+       * tree.
+       */
+      template <class Function>
+      void read(Function function) const;
+
+   private:
+      // =======================================================================
+      //                            PRIVATE TYPES
+      // =======================================================================
+
+
+      /** Kind of modification. */
+      enum EditKind {
+         /** Append the subtree of 'node' to 'parent'. */
+         EDIT_APPEND,
+
+         /** Insert the subtree of 'node' into 'parent', before 'position'. */
+         EDIT_INSERT,
+
+         /** Erase 'node'. */
+         EDIT_ERASE,
+
+         /** Replace the payload of 'node' with 'data'. */
+         EDIT_SET
+      };
+
+      //________________________________________________________________________
+
+      /** Modification waiting to be applied. */
+      struct Edit {
+         /** Kind of modification. */
+         EditKind kind;
+
+         /** Node whose children list changes, if any. */
+         Node* parent;
+
+         /** Node created, erased or modified. */
+         Node* node;
+
+         /** Child the new node goes before, for insertions. */
+         Node* position;
+
+         /** New payload, for replacements. */
+         T* data;
+
+         /** Next modification of the queue. */
+         Edit* next;
+      };
+
+
+      // =======================================================================
+      //                            PRIVATE METHODS
+      // =======================================================================
+
+
+      /**
+       * The copy constructor and the operator= haven't been implemented
+       * because producers hold pointers to the queue.
+       */
+      TreeMutationQueue(const TreeMutationQueue<T, Alloc>& source);
+      TreeMutationQueue<T, Alloc>& operator=(const TreeMutationQueue<T, Alloc>& rhs);
+
+      //________________________________________________________________________
+
+      /**
+       * Allocate a modification and push it onto the queue.
+       *
+       * @param kind Kind of modification.
+       * @param parent Node whose children list changes, if any.
+       * @param node Node created, erased or modified.
+       * @param position Child the new node goes before, for insertions.
+       * @param data New payload, for replacements.
+       * @throws std::bad_alloc Thrown if memory allocation fails. In that case
+       * nothing is queued, and the caller still owns 'node' and 'data'.
+       */
+      void submit(EditKind kind, Node* parent, Node* node, Node* position, T* data);
+
+      //________________________________________________________________________
+
+      /**
+       * Release a modification that won't be applied, and whatever it owns.
+       *
+       * @param edit Modification to be released.
+       */
+      void discard(Edit* edit);
+
+      //________________________________________________________________________
+
+      /**
+       * Sort the modifications of the batch and find the redundant ones.
+       *
+       * @throws std::bad_alloc Thrown if memory allocation fails.
+       */
+      void prepare();
+
+      //________________________________________________________________________
+
+      /**
+       * Check whether a node is in a sorted list.
+       *
+       * @param nodes Sorted list of nodes.
+       * @param node Node to be looked for.
+       * @return 'true' if 'node' is in 'nodes'.
+       */
+      static inline bool contains(const std::vector<Node*>& nodes, Node* node);
+
+      //________________________________________________________________________
+
+      /** Order modifications by the parent they modify. */
+      static inline bool byParent(const Edit* lhs, const Edit* rhs);
+
+      //________________________________________________________________________
+
+      /** Order modifications by the node they modify. */
+      static inline bool byNode(const Edit* lhs, const Edit* rhs);
+
+      //________________________________________________________________________
+
+      /** Check whether two modifications modify the same node. */
+      static inline bool sameNode(const Edit* lhs, const Edit* rhs);
+
+
+      // =======================================================================
+      //                            PRIVATE FIELDS
+      // =======================================================================
+
+
+      /** Tree the modifications are applied to. */
+      TreeConcurrent<T, Alloc>& _tree;
+
+      //________________________________________________________________________
+
+      /** Modifications submitted, the last one first. */
+      std::atomic<Edit*> _pending;
+
+      //________________________________________________________________________
+
+      /** Modifications taken from the queue and not applied yet, in order. */
+      Edit* _batch;
+
+      //________________________________________________________________________
+
+      /** Version of the tree (see version()). */
+      std::atomic<unsigned long long> _version;
+
+      //________________________________________________________________________
+
+      /**
+       * Modifications of the batch by kind. They are only used by the applier
+       * and kept between batches, so that they don't have to grow every time.
+       */
+      std::vector<Edit*> _appends;
+      std::vector<Edit*> _inserts;
+      std::vector<Edit*> _erases;
+      std::vector<Edit*> _sets;
+
+      //________________________________________________________________________
+
+      /** Nodes erased by the batch, sorted and without repetitions. */
+      std::vector<Node*> _erased;
+
+      //________________________________________________________________________
+
+      /** Nodes created by the batch that are parents or positions of others, sorted. */
+      std::vector<Node*> _referenced;
+
+      //________________________________________________________________________
+
+      /** Nodes both created and erased by the batch, sorted. */
+      std::vector<Node*> _cancelled;
+};
+
+
+// *****************************************************************************
+// *****************************************************************************
+// *****************************************************************************
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                            IMPLEMENTATION                             ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// *****************************************************************************
+// *****************************************************************************
+// *****************************************************************************
+
+
+template <class T, class Alloc>
+TreeMutationQueue<T, Alloc>::TreeMutationQueue(TreeConcurrent<T, Alloc>& tree) :
+   _tree(tree),
+   _pending(NULL),
+   _batch(NULL),
+   _version(0)
+{
+   // Nothing to do
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+TreeMutationQueue<T, Alloc>::~TreeMutationQueue() {
+   Edit* edits[2] = {_batch, _pending.load(std::memory_order_acquire)};
+   for(int i = 0; i < 2; ++i) {
+      while(edits[i] != NULL) {
+         Edit* next = edits[i]->next;
+         discard(edits[i]);
+         edits[i] = next;
+      }
+   }
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+const typename TreeMutationQueue<T, Alloc>::Node* TreeMutationQueue<T, Alloc>::pushBackChild(const Node* parent, const T& data) {
+   Node* target = const_cast<Node*>(parent);
+   Node* child;
+   try {
+      child = _tree.createNode(data, target);
+   }
+   catch(std::bad_alloc& ex) {
+      std::cerr << ex.what() << " : Failure to allocate memory for the new child" << std::endl;
+      throw;
+   }
+
+   try {
+      submit(EDIT_APPEND, target, child, NULL, NULL);
+   }
+   catch(...) {
+      _tree.destroyNode(child);
+      throw;
+   }
+
+   return child;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+void TreeMutationQueue<T, Alloc>::erase(const Node* node) {
+   if(node->parent() == NULL)
+      throw RootNotErasableException("Error: Attempting to erase the root node");
+
+   submit(EDIT_ERASE, NULL, const_cast<Node*>(node), NULL, NULL);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+void TreeMutationQueue<T, Alloc>::graftBack(const Node* parent, Tree<T, Alloc>& tree) {
+   graftAt(parent, NULL, tree);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+void TreeMutationQueue<T, Alloc>::graftAt(const Node* parent, const Node* childNode, Tree<T, Alloc>& tree) {
+   if(tree.empty())
+      return;
+
+   Node* target = const_cast<Node*>(parent);
+   Node* root;
+   try {
+      root = _tree.copyIn(tree, target);
+   }
+   catch(std::bad_alloc& ex) {
+      std::cerr << ex.what() << " : Failure to allocate memory when copying the grafted tree" << std::endl;
+      throw;
+   }
+
+   try {
+      if(childNode != NULL)
+         submit(EDIT_INSERT, target, root, const_cast<Node*>(childNode), NULL);
+      else
+         submit(EDIT_APPEND, target, root, NULL, NULL);
+   }
+   catch(...) {
+      _tree.destroySubtree(root);
+      throw;
+   }
+
+   typename Tree<T, Alloc>::PreOrderIterator treeRoot = tree.preBegin();
+   tree.chop(treeRoot);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+void TreeMutationQueue<T, Alloc>::set(const Node* node, const T& data) {
+   T* copy = _tree.createData(data);
+   try {
+      submit(EDIT_SET, NULL, const_cast<Node*>(node), NULL, copy);
+   }
+   catch(...) {
+      _tree.destroyData(copy);
+      throw;
+   }
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+std::size_t TreeMutationQueue<T, Alloc>::apply() {
+   // The queue holds the last modification first, it is turned around and
+   // added to what is left from a batch that couldn't be prepared
+   Edit* taken = _pending.exchange(NULL, std::memory_order_acquire);
+   Edit* ordered = NULL;
+   while(taken != NULL) {
+      Edit* next = taken->next;
+      taken->next = ordered;
+      ordered = taken;
+      taken = next;
+   }
+
+   Edit** end = &_batch;
+   while(*end != NULL)
+      end = &(*end)->next;
+   *end = ordered;
+
+   if(_batch == NULL)
+      return 0;
+
+   prepare();
+
+   typedef typename TreeConcurrent<T, Alloc>::StripeLock StripeLock;
+   unsigned long long version = _version.load(std::memory_order_relaxed);
+   _version.store(version + 1, std::memory_order_relaxed);
+   std::atomic_thread_fence(std::memory_order_release);
+
+   // Payloads: only the last one set on each node is kept
+   for(std::size_t i = 0; i < _sets.size(); ++i) {
+      Edit* edit = _sets[i];
+      bool replaced = i + 1 < _sets.size() && _sets[i + 1]->node == edit->node;
+      if(replaced || contains(_erased, edit->node))
+         _tree.retire(NULL, edit->data, false);
+      else
+         _tree.retire(NULL, edit->node->_data.exchange(edit->data, std::memory_order_acq_rel), false);
+   }
+
+   // New children: the ones of the same parent are chained and published at
+   // once
+   std::size_t first = 0;
+   while(first < _appends.size()) {
+      Node* parent = _appends[first]->parent;
+      Node* head = NULL;
+      Node* tail = NULL;
+      std::size_t last = first;
+      for(; last < _appends.size() && _appends[last]->parent == parent; ++last) {
+         Node* node = _appends[last]->node;
+         if(contains(_cancelled, node))
+            continue;
+
+         if(tail != NULL) {
+            tail->_nextSibling.store(node, std::memory_order_relaxed);
+            node->_previousSibling = tail;
+         }
+         else {
+            head = node;
+         }
+         tail = node;
+      }
+
+      if(head != NULL) {
+         StripeLock lock(_tree, parent);
+         _tree.link(parent, NULL, head, tail);
+      }
+
+      first = last;
+   }
+
+   // Erasures queued before an insertion may have moved its position up, so
+   // the parent is the one the position has now
+   for(std::size_t i = 0; i < _inserts.size(); ++i) {
+      Edit* edit = _inserts[i];
+      if(contains(_cancelled, edit->node))
+         continue;
+
+      while(true) {
+         Node* parent = edit->position->_parent.load(std::memory_order_acquire);
+         StripeLock lock(_tree, parent);
+         if(edit->position->_parent.load(std::memory_order_relaxed) != parent)
+            continue;
+
+         edit->node->_parent.store(parent, std::memory_order_relaxed);
+         _tree.link(parent, edit->position, edit->node, edit->node);
+         break;
+      }
+   }
+
+   // Nodes created by the batch were never published, but they are retired
+   // anyway to use up the room reserved for them
+   for(std::size_t i = 0; i < _erases.size(); ++i) {
+      Node* node = _erases[i]->node;
+      if(contains(_cancelled, node)) {
+         _tree.retire(node, NULL, true);
+      }
+      else {
+         _tree.detach(node);
+         _tree.retire(node, NULL, false);
+      }
+   }
+
+   _version.store(version + 2, std::memory_order_release);
+
+   std::size_t nEdits = 0;
+   while(_batch != NULL) {
+      Edit* next = _batch->next;
+      delete _batch;
+      _batch = next;
+      ++nEdits;
+   }
+
+   return nEdits;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+unsigned long long TreeMutationQueue<T, Alloc>::version() const {
+   return _version.load(std::memory_order_acquire);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+template <class Function>
+void TreeMutationQueue<T, Alloc>::read(Function function) const {
+   while(true) {
+      unsigned long long started = _version.load(std::memory_order_acquire);
+      if(started % 2 == 0) {
+         {
+            TreeEpoch::Guard guard;
+            function();
+         }
+
+         // Anything the function read from a batch being applied makes the
+         // version differ
+         std::atomic_thread_fence(std::memory_order_acquire);
+         if(_version.load(std::memory_order_relaxed) == started)
+            return;
+      }
+
+      std::this_thread::yield();
+   }
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+void TreeMutationQueue<T, Alloc>::submit(EditKind kind, Node* parent, Node* node, Node* position, T* data) {
+   Edit* edit = new Edit;
+   edit->kind = kind;
+   edit->parent = parent;
+   edit->node = node;
+   edit->position = position;
+   edit->data = data;
+
+   edit->next = _pending.load(std::memory_order_relaxed);
+   while(!_pending.compare_exchange_weak(edit->next, edit, std::memory_order_release, std::memory_order_relaxed));
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+void TreeMutationQueue<T, Alloc>::discard(Edit* edit) {
+   if(edit->kind == EDIT_APPEND || edit->kind == EDIT_INSERT)
+      _tree.destroySubtree(edit->node);
+   else if(edit->kind == EDIT_SET)
+      _tree.destroyData(edit->data);
+
+   delete edit;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+void TreeMutationQueue<T, Alloc>::prepare() {
+   _appends.clear();
+   _inserts.clear();
+   _erases.clear();
+   _sets.clear();
+   _erased.clear();
+   _referenced.clear();
+   _cancelled.clear();
+
+   std::size_t nAppends = 0;
+   std::size_t nInserts = 0;
+   std::size_t nErases = 0;
+   std::size_t nSets = 0;
+   for(Edit* edit = _batch; edit != NULL; edit = edit->next) {
+      nAppends += edit->kind == EDIT_APPEND;
+      nInserts += edit->kind == EDIT_INSERT;
+      nErases += edit->kind == EDIT_ERASE;
+      nSets += edit->kind == EDIT_SET;
+   }
+
+   // Everything that may fail is done before touching the tree
+   _appends.reserve(nAppends);
+   _inserts.reserve(nInserts);
+   _erases.reserve(nErases);
+   _sets.reserve(nSets);
+   _erased.reserve(nErases);
+   _referenced.reserve(nAppends + 2 * nInserts);
+   _cancelled.reserve(nErases);
+
+   for(Edit* edit = _batch; edit != NULL; edit = edit->next) {
+      if(edit->kind == EDIT_APPEND) {
+         _appends.push_back(edit);
+         _referenced.push_back(edit->parent);
+      }
+      else if(edit->kind == EDIT_INSERT) {
+         _inserts.push_back(edit);
+         _referenced.push_back(edit->parent);
+         _referenced.push_back(edit->position);
+      }
+      else if(edit->kind == EDIT_ERASE) {
+         _erases.push_back(edit);
+      }
+      else {
+         _sets.push_back(edit);
+      }
+   }
+
+   // Grouping by parent keeps the order of the children of each parent
+   std::stable_sort(_appends.begin(), _appends.end(), byParent);
+   std::stable_sort(_sets.begin(), _sets.end(), byNode);
+   std::sort(_referenced.begin(), _referenced.end());
+
+   // Producers that don't know about each other may erase the same node, it is
+   // only erased once. The result of the erasures doesn't depend on their
+   // order, so they are applied sorted by node
+   std::stable_sort(_erases.begin(), _erases.end(), byNode);
+   _erases.erase(std::unique(_erases.begin(), _erases.end(), sameNode), _erases.end());
+   for(std::size_t i = 0; i < _erases.size(); ++i)
+      _erased.push_back(_erases[i]->node);
+
+   _tree.reserveRetired(_erases.size() + nSets);
+
+   // A node created and erased by the batch is left out, unless something
+   // else of the batch hangs from it or goes next to it
+   for(std::size_t i = 0; i < _appends.size(); ++i) {
+      Node* node = _appends[i]->node;
+      if(contains(_erased, node) && node->_firstChild.load(std::memory_order_relaxed) == NULL && !contains(_referenced, node))
+         _cancelled.push_back(node);
+   }
+   for(std::size_t i = 0; i < _inserts.size(); ++i) {
+      Node* node = _inserts[i]->node;
+      if(contains(_erased, node) && node->_firstChild.load(std::memory_order_relaxed) == NULL && !contains(_referenced, node))
+         _cancelled.push_back(node);
+   }
+   std::sort(_cancelled.begin(), _cancelled.end());
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+bool TreeMutationQueue<T, Alloc>::contains(const std::vector<Node*>& nodes, Node* node) {
+   return std::binary_search(nodes.begin(), nodes.end(), node);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+bool TreeMutationQueue<T, Alloc>::byParent(const Edit* lhs, const Edit* rhs) {
+   return std::less<Node*>()(lhs->parent, rhs->parent);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+bool TreeMutationQueue<T, Alloc>::byNode(const Edit* lhs, const Edit* rhs) {
+   return std::less<Node*>()(lhs->node, rhs->node);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+bool TreeMutationQueue<T, Alloc>::sameNode(const Edit* lhs, const Edit* rhs) {
+   return lhs->node == rhs->node;
+}
+
+#endif
@@ -17,8 +17,12 @@
 #ifndef __TREE_NODE_H__
 #define __TREE_NODE_H__
 
+#include "TreePayload.h"
+#include <cstddef>
 #include <iostream>
 #include <list>
+#include <memory>
+#include <utility>
 
 
 // *****************************************************************************
@@ -26,17 +30,46 @@
 // *****************************************************************************
 
 
-template <class T>
+template <class T, class Alloc = std::allocator<T> >
 class TreeNode;
 
-template <class T>
+template <class T, class Alloc = std::allocator<T> >
 class TreeIterator;
 
-template <class T>
+template <class T, class Alloc = std::allocator<T> >
 class Tree;
 
-template <class T>
-std::ostream& operator<< (std::ostream &out, const TreeNode<T>& node);
+template <class T, class Alloc = std::allocator<T> >
+class TreeCursor;
+
+template <class T, class Alloc = std::allocator<T> >
+class TreeInterleaver;
+
+template <class T, class Alloc = std::allocator<T> >
+class TreeParallel;
+
+template <class T, class Alloc>
+std::ostream& operator<< (std::ostream &out, const TreeNode<T, Alloc>& node);
+
+
+// *****************************************************************************
+//                                 SLAB HEADER
+// *****************************************************************************
+
+
+/**
+ * Header of a block of nodes allocated at once (see Tree::relayout()).
+ *
+ * The header lives in the first slot of the block, right before the nodes.
+ * The block is given back to the allocator when its last node is destroyed.
+ */
+struct TreeNodeSlab {
+   /** Number of nodes the block was allocated for. */
+   std::size_t count;
+
+   /** Number of nodes of the block that haven't been destroyed yet. */
+   std::size_t live;
+};
 
 
 // *****************************************************************************
@@ -77,28 +110,58 @@ std::ostream& operator<< (std::ostream &out, const TreeNode<T>& node);
  * The copy constructor and the operator= haven't been implemented because when
  * a TreeNode is copied, the memory allocation needed to copy the references
  * is handled by the tree (to which the node belongs to).
+ *
+ * Nodes are allocated by the tree through 'Alloc' (rebound to 'TreeNode'), and
+ * the list of children is rebound from the same allocator, so every piece of
+ * memory owned by a tree comes from the allocator the tree was built with.
+ *
+ * The fields that describe the topology of the tree come first. The payload is
+ * stored inline after them or, if 'TreeLayoutTraits<T>::coldPayload' is set,
+ * apart from the node (see TreePayload).
  * 
  * @author Francisco Aisa García
  * @version 0.1
  */
-template <class T>
+template <class T, class Alloc>
 class TreeNode {
    public:
+      // =======================================================================
+      //                              TYPEDEFS
+      // =======================================================================
+
+
+      /** Allocator used by the list of children (rebound from 'Alloc'). */
+      typedef typename std::allocator_traits<Alloc>::template rebind_alloc< TreeNode<T, Alloc>* > ChildAllocator;
+
+      /** List of pointers to children nodes. */
+      typedef std::list< TreeNode<T, Alloc>*, ChildAllocator > ChildList;
+
+      /** Iterator to a position of the list of children. */
+      typedef typename ChildList::iterator ChildIterator;
+
+      /** Payload of the node (inline or apart from the node). */
+      typedef TreePayload<T, Alloc> Payload;
+
+
       // =======================================================================
       //                     CONSTRUCTORS AND DESTRUCTORS
       // =======================================================================
 
 
-      /** Default constructor. */
-      inline TreeNode();
+      /**
+       * Default constructor.
+       * @param alloc Allocator used by the list of children.
+       */
+      inline explicit TreeNode(const Alloc& alloc = Alloc());
 
       //________________________________________________________________________
 
       /**
        * Custom constructor.
        * @param data Data to initialize the data content of the node.
+       * @param alloc Allocator used by the list of children.
        */
-      inline TreeNode(const T& data);
+      inline explicit TreeNode(const T& data, const Alloc& alloc = Alloc());
 
       //________________________________________________________________________
 
@@ -106,8 +169,19 @@ class TreeNode {
        * Custom constructor.
        * @param data Data to initialize the data content of the node.
        * @param parent Parent node of the node to be constructed.
+       * @param alloc Allocator used by the list of children.
        */
-      inline TreeNode(const T& data, TreeNode<T>* parent);
+      inline TreeNode(const T& data, TreeNode<T, Alloc>* parent, const Alloc& alloc = Alloc());
+
+      //________________________________________________________________________
+
+      /**
+       * Custom constructor.
+       * @param data Payload to be moved into the node.
+       * @param parent Parent node of the node to be constructed.
+       * @param alloc Allocator used by the list of children.
+       */
+      inline TreeNode(Payload&& data, TreeNode<T, Alloc>* parent, const Alloc& alloc = Alloc());
 
       //________________________________________________________________________
 
@@ -125,7 +199,7 @@ class TreeNode {
        * @param out Ostream stream.
        * @param node *This.
        */
-      friend std::ostream& operator<< <T>(std::ostream& out, const TreeNode<T>& node);
+      friend std::ostream& operator<< <T, Alloc>(std::ostream& out, const TreeNode<T, Alloc>& node);
 
 
       // =======================================================================
@@ -137,7 +211,7 @@ class TreeNode {
        * Get the parent node of this node.
        * @return A pointer to the parent node.
        */
-      inline TreeNode<T>* const parent() const;
+      inline TreeNode<T, Alloc>* const parent() const;
 
 
       // =======================================================================
@@ -157,8 +231,11 @@ class TreeNode {
       // =======================================================================
 
 
-      friend class Tree<T>;
-      friend class TreeIterator<T>;
+      friend class Tree<T, Alloc>;
+      friend class TreeIterator<T, Alloc>;
+      friend class TreeCursor<T, Alloc>;
+      template <class U, class UAlloc>
+      friend class TreeParallel;
 
 
       // =======================================================================
@@ -166,13 +243,8 @@ class TreeNode {
       // =======================================================================
 
 
-      /** Data to be stored in the node. */
-      T _data;
-
-      //________________________________________________________________________
-
       /** Pointer to parent node. */
-      TreeNode<T>* _parent;
+      TreeNode<T, Alloc>* _parent;
 
       //________________________________________________________________________
 
@@ -186,12 +258,43 @@ class TreeNode {
        * This field is not set by the TreeNode class, instead, it is handled by
        * the Tree class (to which this node belongs to).
        */
-      typename std::list< TreeNode<T>* >::iterator _childIt;
+      ChildIterator _childIt;
 
       //________________________________________________________________________
 
       /** List of pointers to children nodes.  */
-      std::list< TreeNode<T>* > _children;
+      ChildList _children;
+
+      //________________________________________________________________________
+
+      /**
+       * Block of nodes this node belongs to, NULL if the node was allocated on
+       * its own.
+       *
+       * This field is not set by the TreeNode class, instead, it is handled by
+       * the Tree class (to which this node belongs to).
+       */
+      TreeNodeSlab* _slab;
+
+      //________________________________________________________________________
+
+      /**
+       * Number of leaves of the subtree hanging from this node (1 for a leaf).
+       *
+       * It is only kept up to date by trees with their leaf index enabled (see
+       * Tree::enableLeafIndex()).
+       */
+      std::size_t _nLeaves;
+
+      //________________________________________________________________________
+
+      /**
+       * Data to be stored in the node.
+       *
+       * It is the last field, so nothing can fail after it has been constructed
+       * and the node destructor is always in charge of releasing it.
+       */
+      Payload _data;
 };
 
 
@@ -224,52 +327,83 @@ class TreeNode {
 // *****************************************************************************
 
 
-template <class T>
-TreeNode<T>::TreeNode() : _parent(NULL) {
+template <class T, class Alloc>
+TreeNode<T, Alloc>::TreeNode(const Alloc& alloc) :
+   _parent(NULL),
+   _children(ChildAllocator(alloc)),
+   _slab(NULL),
+   _nLeaves(1),
+   _data(alloc)
+{
    // Nothing to do
 }
 
 //______________________________________________________________________________
 
-template <class T>
-TreeNode<T>::TreeNode(const T& data) : _data(data), _parent(NULL) {
+template <class T, class Alloc>
+TreeNode<T, Alloc>::TreeNode(const T& data, const Alloc& alloc) :
+   _parent(NULL),
+   _children(ChildAllocator(alloc)),
+   _slab(NULL),
+   _nLeaves(1),
+   _data(data, alloc)
+{
    // Nothing to do
 }
 
 //______________________________________________________________________________
 
-template <class T>
-TreeNode<T>::TreeNode(const T& data, TreeNode<T>* parent) : _data(data), _parent(parent) {
+template <class T, class Alloc>
+TreeNode<T, Alloc>::TreeNode(const T& data, TreeNode<T, Alloc>* parent, const Alloc& alloc) :
+   _parent(parent),
+   _children(ChildAllocator(alloc)),
+   _slab(NULL),
+   _nLeaves(1),
+   _data(data, alloc)
+{
    // Nothing to do
 }
 
 //______________________________________________________________________________
 
-template <class T>
-TreeNode<T>::~TreeNode() {
+template <class T, class Alloc>
+TreeNode<T, Alloc>::TreeNode(Payload&& data, TreeNode<T, Alloc>* parent, const Alloc& alloc) :
+   _parent(parent),
+   _children(ChildAllocator(alloc)),
+   _slab(NULL),
+   _nLeaves(1),
+   _data(std::move(data))
+{
    // Nothing to do
 }
 
 //______________________________________________________________________________
 
-template <class T>
-std::ostream& operator<<(std::ostream& out, const TreeNode<T>& node) {
-   out << node._data;
+template <class T, class Alloc>
+TreeNode<T, Alloc>::~TreeNode() {
+   _data.release(Alloc(_children.get_allocator()));
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+std::ostream& operator<<(std::ostream& out, const TreeNode<T, Alloc>& node) {
+   out << node._data.get();
 
    return out;
 }
 
 //______________________________________________________________________________
 
-template <class T>
-TreeNode<T>* const TreeNode<T>::parent() const {
+template <class T, class Alloc>
+TreeNode<T, Alloc>* const TreeNode<T, Alloc>::parent() const {
    return _parent;
 }
 
 //______________________________________________________________________________
 
-template <class T>
-unsigned int TreeNode<T>::nChildren() const {
+template <class T, class Alloc>
+unsigned int TreeNode<T, Alloc>::nChildren() const {
    return _children.size();
 }
 
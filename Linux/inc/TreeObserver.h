@@ -0,0 +1,141 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version. This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details. You should have received a copy of the GNU
+ * General Public License along with this program; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ * USA.
+ *
+ * Copyright © 2011-2012 Francisco Aisa Garcia
+ */
+
+
+
+
+#ifndef __TREE_OBSERVER_H__
+#define __TREE_OBSERVER_H__
+
+#include "TreeNode.h"
+
+
+// *****************************************************************************
+// *****************************************************************************
+// *****************************************************************************
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                HEADER                                 ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// *****************************************************************************
+// *****************************************************************************
+// *****************************************************************************
+
+
+/**
+ * Interface for objects that keep information derived from the nodes of a tree
+ * (caches, indexes...) and need to know when it goes stale.
+ *
+ * Observers are registered with Tree::addObserver(). The tree tells them right
+ * before the nodes of a subtree are destroyed, moved to a different address or
+ * given a different path to the root, which happens when they are erased (the
+ * children of an erased node hang from its parent afterwards), pruned, chopped,
+ * relaid out, grafted into another tree or replaced by the nodes of another
+ * tree on assignment. Adding nodes (pushing children, grafting a tree into the
+ * observed one) doesn't change anything for the nodes already in the tree, so
+ * observers are not told about it. Neither are they told about changes to the
+ * payloads made through iterators, since the tree can't see them.
+ *
+ * @author Francisco Aisa García
+ * @version 0.1
+ */
+template <class T, class Alloc = std::allocator<T> >
+class TreeObserver {
+   public:
+      // =======================================================================
+      //                     CONSTRUCTORS AND DESTRUCTORS
+      // =======================================================================
+
+
+      /** Destructor. */
+      inline virtual ~TreeObserver();
+
+
+      // =======================================================================
+      //                             NOTIFICATIONS
+      // =======================================================================
+
+
+      /**
+       * Called right before the nodes of a subtree are destroyed, moved or given
+       * a different path to the root. When the call is made the subtree is still
+       * intact and it can be traversed.
+       *
+       * @param subtreeRoot Iterator to the root of the subtree.
+       */
+      virtual void subtreeChanging(const TreeIterator<T, Alloc>& subtreeRoot) = 0;
+
+      //________________________________________________________________________
+
+      /**
+       * Called when the observed tree is destroyed. The observer is unregistered
+       * automatically and it must not use the tree anymore.
+       */
+      virtual void treeDestroyed() = 0;
+};
+
+
+// *****************************************************************************
+// *****************************************************************************
+// *****************************************************************************
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                            IMPLEMENTATION                             ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// *****************************************************************************
+// *****************************************************************************
+// *****************************************************************************
+
+
+template <class T, class Alloc>
+TreeObserver<T, Alloc>::~TreeObserver() {
+   // Nothing to do
+}
+
+#endif
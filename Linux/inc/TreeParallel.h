@@ -0,0 +1,2670 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version. This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details. You should have received a copy of the GNU
+ * General Public License along with this program; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ * USA.
+ *
+ * Copyright © 2011-2012 Francisco Aisa Garcia
+ */
+
+
+
+#ifndef __TREE_PARALLEL_H__
+#define __TREE_PARALLEL_H__
+
+#include "Tree.h"
+#include "TreeCursor.h"
+#include "TreeExecutor.h"
+#include "TreeWorkStealingPool.h"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+
+/** Order in which a parallel traversal visits a node and its descendants. */
+enum TreeParallelOrder {
+   /** A node is visited before any of its descendants (like in pre-order). */
+   TREE_TOP_DOWN,
+
+   /** A node is visited after all its descendants (like in post-order). */
+   TREE_BOTTOM_UP
+};
+
+//______________________________________________________________________________
+
+/** How the partial results of a parallel reduction are grouped. */
+enum TreeReduceMode {
+   /**
+    * Work is split wherever threads happen to be idle, so the grouping of the
+    * partial results changes from run to run (default).
+    */
+   TREE_REDUCE_FAST,
+
+   /**
+    * Work is split depending only on the shape of the tree and the grain, so
+    * the partial results are grouped the same way on every run, whatever the
+    * number of threads. Results are reproducible bit by bit, even when the
+    * combination is only approximately associative (floating point sums).
+    */
+   TREE_REDUCE_DETERMINISTIC
+};
+
+//______________________________________________________________________________
+
+/** Position of a node in a subtree, as computed by a parallel scan. */
+template <class Value>
+struct TreeScanInfo {
+   /** Depth of the node (0 for the root of the subtree). */
+   std::size_t depth;
+
+   /** Index of the node in pre-order (0 for the root of the subtree). */
+   std::size_t preorder;
+
+   /** Number of nodes of the subtree hanging from the node (1 for a leaf). */
+   std::size_t size;
+
+   /** Values of the nodes from the root of the subtree down to the node, combined. */
+   Value prefix;
+};
+
+
+// *****************************************************************************
+// *****************************************************************************
+// *****************************************************************************
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                HEADER                                 ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// *****************************************************************************
+// *****************************************************************************
+// *****************************************************************************
+
+
+/**
+ * Runs operations over the nodes of a tree on the threads of a 'TreeExecutor',
+ * by default the 'TreeWorkStealingPool' shared by the whole process.
+ *
+ * Each task walks part of the tree with a 'TreeCursor', exactly as a serial
+ * traversal would. Work is only split when some thread of the executor is
+ * idle (see TreeExecutor::hungry()): the task gives away the siblings of its
+ * range it hasn't started, or else the right siblings of the highest node of
+ * its path that has any, and goes on with the rest. Hence, balanced trees are
+ * split close to the root into a few big tasks, and skewed trees are split
+ * wherever the work happens to be, without deciding anything up front.
+ *
+ * Before a piece of work is given away its size is estimated, counting its
+ * nodes up to the grain: pieces smaller than the grain aren't worth a task and
+ * are kept. Counting stops at the grain, so a failed attempt costs as much as
+ * visiting a grain of nodes, and attempts become less frequent while they keep
+ * failing.
+ *
+ * In bottom-up traversals a node is only visited once everything hanging from
+ * it has been visited, including the parts given away to other threads.
+ *
+ * Reductions fold the value of every node in pre-order: each task folds the
+ * nodes it visits, and the results of the pieces it gave away are folded in
+ * where they belong in pre-order once they are done. Hence, the combination
+ * only has to be associative, not commutative. Deterministic reductions split
+ * wherever a piece is big enough, whether threads are idle or not (pieces that
+ * can't be handed over are run by the task itself), so the grouping only
+ * depends on the tree.
+ *
+ * Transforms build a tree with the same shape: every task builds the copies of
+ * the children of the nodes it visits, so each children list is only written
+ * by one thread, and the copies are placed in a single block of memory sized
+ * up front.
+ *
+ * Contractions evaluate a tree bottom-up in O(log n) rounds whatever its shape
+ * (see contract()), for trees whose shape defeats splitting along the subtrees:
+ * long chains split into a piece per node at best, and a single huge fan-out
+ * is folded by a single task.
+ *
+ * Scans number the nodes with an Euler tour, linked through the slots of the
+ * nodes in parallel and cut in runs that are scanned by separate tasks and then
+ * chained (see scan()).
+ *
+ * Apart from the nodes built by transforms and the slots of contractions and
+ * scans, nothing is allocated per node nor per task: tasks live in the stack
+ * frame of the task that splits them, which waits for them before returning.
+ *
+ * The structure of the tree MUST NOT be modified while a parallel operation is
+ * running on it.
+ *
+ * Example:
+ * <pre>
+ *    TreeParallel<Record> parallel;
+ *    parallel.forEach(tree.preBegin(), Normalize());
+ *
+ *    TreeWorkStealingPool pool(4);
+ *    TreeParallel<Record>(pool).forEach(tree.preBegin(), Normalize());
+ *    parallelForEach(pool, tree, Normalize());
+ *
+ *    parallelForEach(tree, Normalize(), TREE_BOTTOM_UP);
+ *    long bytes = parallelReduce(tree, FileSize(), std::plus<long>());
+ *    Tree<Summary> summaries = parallelTransform<Summary>(tree, Summarize());
+ *    double result = parallelContract(expression, Arithmetic());
+ *    parallelScan(tree, Cost(), std::plus<long>(), std::negate<long>(), StorePosition());
+ * </pre>
+ *
+ * @author Francisco Aisa García
+ * @version 0.1
+ */
+template <class T, class Alloc>
+class TreeParallel {
+   public:
+      // =======================================================================
+      //                     CONSTRUCTORS AND DESTRUCTORS
+      // =======================================================================
+
+
+      /**
+       * Custom constructor.
+       *
+       * @param executor Executor whose threads run the operations.
+       * @param grain Smallest number of nodes worth running in a task of its
+       * own. The cheaper the work per node, the bigger it should be.
+       */
+      explicit TreeParallel(TreeExecutor& executor = TreeExecutor::global(), std::size_t grain = 1024);
+
+
+      // =======================================================================
+      //                               CAPACITY
+      // =======================================================================
+
+
+      /**
+       * Get the executor whose threads run the operations.
+       *
+       * @return A reference to the executor.
+       */
+      inline TreeExecutor& executor() const;
+
+      //________________________________________________________________________
+
+      /**
+       * Get the smallest number of nodes worth running in a task of its own.
+       *
+       * @return The grain.
+       */
+      inline std::size_t grain() const;
+
+
+      // =======================================================================
+      //                              TRAVERSALS
+      // =======================================================================
+
+
+      /**
+       * Apply a function to every node of a subtree, in parallel.
+       *
+       * The function is called from many threads at the same time, each node
+       * being visited exactly once.
+       *
+       * @param subtreeRoot Iterator to the root of the subtree.
+       * @param function Function object called as 'function(data)' for every
+       * node.
+       * @param order Whether each node is visited before (top-down) or after
+       * (bottom-up) its descendants.
+       * @throws Any exception thrown by the function (the first one), after
+       * every task has finished.
+       */
+      template <class Function>
+      void forEach(const TreeIterator<T, Alloc>& subtreeRoot, Function function, TreeParallelOrder order = TREE_TOP_DOWN) const;
+
+
+      // =======================================================================
+      //                              REDUCTIONS
+      // =======================================================================
+
+
+      /** Type of the values a leaf function gives for the nodes. */
+      template <class LeafFunction>
+      struct LeafResult {
+         typedef typename std::decay<decltype(std::declval<LeafFunction&>()(std::declval<T&>()))>::type type;
+      };
+
+      //________________________________________________________________________
+
+      /**
+       * Fold the values of the nodes of a subtree, in parallel.
+       *
+       * The result is 'leaf(n1) + leaf(n2) + ... + leaf(nk)', where n1...nk are
+       * the nodes of the subtree in pre-order and '+' stands for 'combine'. The
+       * value of a node is hence combined with the results of its children from
+       * left to right, and so forth. The order of the operands is always kept,
+       * but they are grouped in any way.
+       *
+       * Partial results live in the tasks, nothing is allocated per node. The
+       * type of the values must be default constructible and assignable.
+       *
+       * @param subtreeRoot Iterator to the root of the subtree.
+       * @param leaf Function object called as 'leaf(data)' to get the value of
+       * every node.
+       * @param combine Associative function object called as 'combine(a, b)'
+       * to combine two values ('a' coming before 'b' in pre-order).
+       * @param mode Whether the grouping may change from run to run.
+       * @return The result of the reduction, a value initialized value if the
+       * subtree is empty.
+       * @throws Any exception thrown by the function objects (the first one),
+       * after every task has finished.
+       */
+      template <class LeafFunction, class CombineFunction>
+      typename LeafResult<LeafFunction>::type reduce(const TreeIterator<T, Alloc>& subtreeRoot, LeafFunction leaf, CombineFunction combine,
+                                                     TreeReduceMode mode = TREE_REDUCE_FAST) const;
+
+
+      // =======================================================================
+      //                              TRANSFORMS
+      // =======================================================================
+
+
+      /**
+       * Allocator of the trees built by transform() when none is given.
+       *
+       * It is never the allocator of the source tree rebound to 'U': the new
+       * tree is allocated from every thread of the executor at once, and the
+       * arenas and pools of the source tree may only be used by one thread at
+       * a time.
+       */
+      template <class U>
+      struct TransformAllocator {
+         typedef std::allocator<U> type;
+      };
+
+      //________________________________________________________________________
+
+      /**
+       * Build a tree with the same shape as a subtree, in parallel.
+       *
+       * Every node of the new tree holds 'function(data)' for the node at the
+       * same position in the subtree (its root matching the root of the
+       * subtree), and children keep the order of their siblings.
+       *
+       * The nodes of the subtree are counted first (in parallel) and the new
+       * nodes are placed in a single block of memory of that size (see
+       * Tree::relayout()). Tasks claim the slots of the block a few at a time,
+       * so siblings end up next to each other. Nodes that don't fit in the
+       * block (some slots are left unused at the end of the tasks) are
+       * allocated on their own. Children lists are still allocated node by
+       * node, so the allocator MUST be safe to use from many threads at the
+       * same time (std::allocator is, arenas usually aren't).
+       *
+       * @param subtreeRoot Iterator to the root of the subtree.
+       * @param function Function object called as 'function(data)' for every
+       * node, its result is converted to 'U'.
+       * @param alloc Allocator of the new tree.
+       * @return The new tree, empty if the subtree is empty.
+       * @throws std::bad_alloc Thrown if memory allocation fails.
+       * @throws Any exception thrown by the function (the first one), after
+       * every task has finished. The nodes built so far are destroyed.
+       */
+      template <class U, class UAlloc, class Function>
+      Tree<U, UAlloc> transform(const TreeIterator<T, Alloc>& subtreeRoot, Function function, const UAlloc& alloc) const;
+
+      //________________________________________________________________________
+
+      /**
+       * Build a tree with the same shape as a subtree, in parallel, using
+       * std::allocator (see TransformAllocator and the method above).
+       *
+       * @param subtreeRoot Iterator to the root of the subtree.
+       * @param function Function object called as 'function(data)' for every
+       * node, its result is converted to 'U'.
+       * @return The new tree, empty if the subtree is empty.
+       * @throws std::bad_alloc Thrown if memory allocation fails.
+       * @throws Any exception thrown by the function (the first one), after
+       * every task has finished.
+       */
+      template <class U, class Function>
+      Tree<U, typename TransformAllocator<U>::type> transform(const TreeIterator<T, Alloc>& subtreeRoot, Function function) const;
+
+
+      // =======================================================================
+      //                              CONTRACTION
+      // =======================================================================
+
+
+      /**
+       * Evaluate a subtree bottom-up by tree contraction (rake and compress), in
+       * parallel.
+       *
+       * The value of a node is its start value, with the values of its children
+       * folded in from left to right:
+       * <pre>
+       *    value(n) = fold(n, ... fold(n, fold(n, start(n), value(c1)), value(c2)) ..., value(ck))
+       * </pre>
+       * so the value of a leaf is just its start value.
+       *
+       * Each fold is a cell of a binary tree with 2n - 1 cells, whose leaves are
+       * the start values. Every round, the cells whose children are known are
+       * evaluated and the cells with a single known child become unary
+       * functions of the other one (rake), then chains of unary cells are
+       * merged by composing their functions, pairing them at random (compress).
+       * The number of rounds expected is O(log n) whatever the shape of the
+       * tree, chains and huge fan-outs included, and the work is O(n).
+       *
+       * The algebra describes the values and the functions of the unary cells:
+       * <pre>
+       *    struct Algebra {
+       *       typedef ... Value;
+       *       typedef ... Function;
+       *
+       *       // Value of a node before its children are folded in
+       *       Value start(const T& data);
+       *       // Fold the value of a child into the partial value of its parent
+       *       Value fold(const T& data, const Value& partial, const Value& child);
+       *       // x -> fold(data, x, child)
+       *       Function foldChild(const T& data, const Value& child);
+       *       // x -> fold(data, partial, x)
+       *       Function foldInto(const T& data, const Value& partial);
+       *       // x -> outer(inner(x))
+       *       Function compose(const Function& outer, const Function& inner);
+       *       // function(x)
+       *       Value apply(const Function& function, const Value& x);
+       *    };
+       * </pre>
+       * For arithmetic expressions with '+' and '*', for instance, values are
+       * numbers and functions are 'a * x + b', which compose into functions of
+       * the same kind. The grouping of the operations changes from run to run,
+       * so the functions have to describe the folds exactly. Both types must be
+       * default constructible and assignable, and the methods are called from
+       * many threads at the same time.
+       *
+       * @param subtreeRoot Iterator to the root of the subtree.
+       * @param algebra Algebra the subtree is evaluated with.
+       * @return The value of the root of the subtree, a value initialized value
+       * if the subtree is empty.
+       * @throws std::bad_alloc Thrown if memory allocation for the cells fails.
+       * @throws Any exception thrown by the algebra (the first one), after every
+       * task has finished.
+       */
+      template <class Algebra>
+      typename Algebra::Value contract(const TreeIterator<T, Alloc>& subtreeRoot, Algebra algebra) const;
+
+
+      // =======================================================================
+      //                                 SCANS
+      // =======================================================================
+
+
+      /**
+       * Compute the depth, pre-order index and size of every node of a subtree,
+       * and the values combined along its path from the root, in parallel.
+       *
+       * The nodes are numbered with an Euler tour, which enters every node
+       * before its descendants and exits it after them. The tour is linked in
+       * parallel, cut in runs of about twice the grain that are scanned by
+       * separate tasks, and the runs are chained and fixed up in a second pass.
+       * The work is O(n) whatever the shape of the tree.
+       *
+       * The prefix of a node is 'leaf(r) + ... + leaf(n)', where r...n are the
+       * nodes of the path from the root of the subtree down to the node and '+'
+       * stands for 'combine'. Entering a node combines its value and exiting it
+       * combines the inverse of its value, so 'combine' and 'inverse' must form
+       * a group: associative, with 'combine(combine(a, b), inverse(b))' equal
+       * to 'a'. Sums of integers are exact, sums of floating point numbers
+       * carry the rounding of the subtrees left behind.
+       *
+       * Once every node is numbered, 'function(data, info)' is called for each
+       * of them with its TreeScanInfo, in any order. The leaf function is
+       * called twice per node. All of them are called from many threads at
+       * the same time.
+       *
+       * @param subtreeRoot Iterator to the root of the subtree.
+       * @param leaf Function object called as 'leaf(data)' to get the value of
+       * every node.
+       * @param combine Associative function object called as 'combine(a, b)'
+       * to combine two values ('a' coming before 'b' along the path).
+       * @param inverse Function object called as 'inverse(a)' to get the value
+       * that undoes 'a'.
+       * @param function Function object called as 'function(data, info)' for
+       * every node.
+       * @throws std::bad_alloc Thrown if memory allocation for the tour fails.
+       * @throws Any exception thrown by the function objects (the first one),
+       * after every task has finished. 'function' may have been called for
+       * some of the nodes.
+       */
+      template <class LeafFunction, class CombineFunction, class InverseFunction, class Function>
+      void scan(const TreeIterator<T, Alloc>& subtreeRoot, LeafFunction leaf, CombineFunction combine, InverseFunction inverse,
+                Function function) const;
+
+   private:
+      // =======================================================================
+      //                            PRIVATE TYPES
+      // =======================================================================
+
+
+      /**
+       * Traversal that applies a function to every node.
+       *
+       * Every job defines the partial result of a task ('Partial'), how a node
+       * is added to it (visit()), how the result of a piece given away is added
+       * to it (append()), how the partial result of a piece is set up before
+       * it is given away (handOver()), and whether the pieces have to be
+       * appended in pre-order ('ORDERED').
+       */
+      template <class Function>
+      struct ForEachJob {
+         /** Nothing is accumulated. */
+         struct Partial {};
+
+         /** Nodes can be visited in any order. */
+         static const bool ORDERED = false;
+
+         /** Apply the function to a node. */
+         inline void visit(Partial& partial, TreeNode<T, Alloc>* node) const;
+
+         /** Nothing to do. */
+         inline void append(Partial& partial, Partial& piece) const;
+
+         /** Nothing to do. */
+         inline void handOver(const Partial& partial, TreeNode<T, Alloc>* first, Partial& piece) const;
+
+         /** Function applied to every node. */
+         Function* function;
+      };
+
+      //________________________________________________________________________
+
+      /** Reduction of the values of the nodes. */
+      template <class Value, class LeafFunction, class CombineFunction>
+      struct ReduceJob {
+         /** Fold of the nodes visited so far. */
+         struct Partial {
+            /** Default constructor. */
+            inline Partial();
+
+            /** Whether nothing has been folded yet. */
+            bool empty;
+
+            /** Result of the fold. */
+            Value value;
+         };
+
+         /** Results are folded in pre-order. */
+         static const bool ORDERED = true;
+
+         /** Fold the value of a node. */
+         inline void visit(Partial& partial, TreeNode<T, Alloc>* node) const;
+
+         /** Fold the result of a piece that comes after the partial result. */
+         inline void append(Partial& partial, Partial& piece) const;
+
+         /** Nothing to do, pieces start empty. */
+         inline void handOver(const Partial& partial, TreeNode<T, Alloc>* first, Partial& piece) const;
+
+         /** Function that gives the value of a node. */
+         LeafFunction* leaf;
+
+         /** Function that combines two values. */
+         CombineFunction* combine;
+      };
+
+      //________________________________________________________________________
+
+      /**
+       * Copy of the shape of a tree into a tree of another type.
+       *
+       * A task knows the copy of the last node it visited. The next node it
+       * visits is either the first child of that node, or the right sibling of
+       * the node or of one of its ancestors, so the copy of the next node is
+       * found by moving the same way on both trees.
+       */
+      template <class U, class UAlloc, class Function>
+      struct TransformJob {
+         /** Node of the new tree. */
+         typedef TreeNode<U, UAlloc> CopyNode;
+
+         /** Allocator of the nodes of the new tree. */
+         typedef typename Tree<U, UAlloc>::NodeAllocator NodeAllocator;
+
+         /** Traits of the node allocator. */
+         typedef std::allocator_traits<NodeAllocator> NodeAllocatorTraits;
+
+         /** Position of a task on both trees and slots it has claimed. */
+         struct Partial {
+            /** Default constructor. */
+            inline Partial();
+
+            /** Last node visited (or the first one to be visited). */
+            TreeNode<T, Alloc>* source;
+
+            /** Copy of 'source'. */
+            CopyNode* copy;
+
+            /** Next slot claimed and not used yet. */
+            CopyNode* next;
+
+            /** End of the slots claimed. */
+            CopyNode* end;
+
+            /** Number of nodes built in the block. */
+            std::size_t nBuilt;
+         };
+
+         /** Nodes can be visited in any order. */
+         static const bool ORDERED = false;
+
+         /** Build the copies of the children of a node. */
+         void visit(Partial& partial, TreeNode<T, Alloc>* node) const;
+
+         /** Count the nodes built by a piece. */
+         inline void append(Partial& partial, Partial& piece) const;
+
+         /** Find the copy of the first node of a piece. */
+         inline void handOver(const Partial& partial, TreeNode<T, Alloc>* first, Partial& piece) const;
+
+         /** Claim a slot of the block, NULL if the block is full. */
+         inline CopyNode* claim(Partial& partial) const;
+
+         /** Move a position on both trees to a node visited after it. */
+         static void mirror(TreeNode<T, Alloc>*& source, CopyNode*& copy, TreeNode<T, Alloc>* node);
+
+         /** Function that gives the data of the copies. */
+         Function* function;
+
+         /** Allocator of the new tree. */
+         NodeAllocator* allocator;
+
+         /** Header of the block. */
+         TreeNodeSlab* header;
+
+         /** Slots of the block. */
+         CopyNode* slots;
+
+         /** Number of slots of the block. */
+         std::size_t nSlots;
+
+         /** Number of slots claimed so far (it may go past 'nSlots'). */
+         std::atomic<std::size_t>* nClaimed;
+      };
+
+      //________________________________________________________________________
+
+      /** Leaf function of the reduction that counts the nodes of a subtree. */
+      struct CountNode {
+         /** Every node counts as one. */
+         inline std::size_t operator()(const T& data) const;
+      };
+
+      //________________________________________________________________________
+
+      /** Kinds of the cells of a contraction. */
+      enum ContractKind {
+         /** Unused, or merged into its parent. */
+         CONTRACT_DEAD,
+
+         /** Its value is known. */
+         CONTRACT_LEAF,
+
+         /** Function of the value of its left child. */
+         CONTRACT_UNARY,
+
+         /** Fold of the values of both children. */
+         CONTRACT_BINARY
+      };
+
+      //________________________________________________________________________
+
+      /**
+       * Fold of the value of a node into the partial value of its parent.
+       *
+       * Cells are numbered after the slots of the nodes: cell 2 * i is the
+       * start value of slot i, which is always known, and cell 2 * i + 1 the
+       * fold of slot i. The left child of a fold is the fold of the previous
+       * sibling (the start value of the parent for the first child), and its
+       * right child the fold of the last child of the node (its start value if
+       * it is a leaf).
+       */
+      template <class Algebra>
+      struct ContractCell {
+         /** Kind of the cell (a ContractKind), the parent reads it while it changes. */
+         std::atomic<unsigned char> kind;
+
+         /** Round in which the cell became a leaf. */
+         unsigned int round;
+
+         /** Left child (the only child of unary cells). */
+         std::size_t left;
+
+         /** Right child. */
+         std::size_t right;
+
+         /** Parent node, whose data is used to fold. */
+         TreeNode<T, Alloc>* node;
+
+         /** Value of the cell once it is a leaf. */
+         typename Algebra::Value value;
+
+         /** Function of the value of the child while the cell is unary. */
+         typename Algebra::Function function;
+      };
+
+      //________________________________________________________________________
+
+      /** Cells of a node and links to find the slots of its neighbours. */
+      template <class Algebra>
+      struct ContractSlot {
+         /** Value of the node before its children are folded in. */
+         typename Algebra::Value start;
+
+         /** Fold of the value of the node into its parent. */
+         ContractCell<Algebra> fold;
+
+         /** Slot of the first child. */
+         std::size_t first;
+
+         /** Slot of the next sibling. */
+         std::size_t next;
+
+         /** Slot of the parent. */
+         std::size_t up;
+      };
+
+      //________________________________________________________________________
+
+      /**
+       * Numbering of the nodes of a subtree, for the operations that keep
+       * something per node (contractions and scans).
+       *
+       * The task that visits a node claims the slots of its children. Like in
+       * transforms, a task knows the slot of the last node it visited and finds
+       * the slot of the next one moving the same way, through the links of the
+       * slots ('first', 'next' and 'up').
+       */
+      template <class Slot>
+      struct SlotJob {
+         /** Position of a task and slots it has claimed. */
+         struct Partial {
+            /** Default constructor. */
+            inline Partial();
+
+            /** Last node visited (or the first one to be visited). */
+            TreeNode<T, Alloc>* source;
+
+            /** Slot of 'source'. */
+            std::size_t slot;
+
+            /** Next slot claimed and not used yet. */
+            std::size_t next;
+
+            /** End of the slots claimed. */
+            std::size_t end;
+         };
+
+         /** Nodes can be visited in any order. */
+         static const bool ORDERED = false;
+
+         /** Nothing to do. */
+         inline void append(Partial& partial, Partial& piece) const;
+
+         /** Find the slot of the first node of a piece. */
+         inline void handOver(const Partial& partial, TreeNode<T, Alloc>* first, Partial& piece) const;
+
+         /** Claim a slot. */
+         inline std::size_t claim(Partial& partial) const;
+
+         /** Move a position to a node visited after it. */
+         void mirror(TreeNode<T, Alloc>*& source, std::size_t& slot, TreeNode<T, Alloc>* node) const;
+
+         /** Slots of the nodes. */
+         Slot* slots;
+
+         /** Number of slots claimed so far. */
+         std::atomic<std::size_t>* nClaimed;
+
+         /** Number of slots below which they are claimed CLAIM_SIZE at a time. */
+         std::size_t limit;
+      };
+
+      //________________________________________________________________________
+
+      /** Set up of the cells of a contraction. */
+      template <class Algebra>
+      struct ContractJob : public SlotJob< ContractSlot<Algebra> > {
+         typedef typename SlotJob< ContractSlot<Algebra> >::Partial Partial;
+
+         /** Set up the cells of a node and link the folds of its children. */
+         void visit(Partial& partial, TreeNode<T, Alloc>* node) const;
+
+         /** Algebra the tree is evaluated with. */
+         Algebra* algebra;
+      };
+
+      //________________________________________________________________________
+
+      /**
+       * Steps of the Euler tour of a node and where they are once scanned.
+       *
+       * Steps are numbered after the slots of the nodes: step 2 * i enters the
+       * node of slot i and step 2 * i + 1 exits it.
+       */
+      template <class Value>
+      struct ScanSlot {
+         /** Node of the slot, NULL if the slot is unused. */
+         TreeNode<T, Alloc>* node;
+
+         /** Slot of the first child, NO_SLOT for a leaf. */
+         std::size_t first;
+
+         /** Slot of the next sibling, NO_SLOT for the last child. */
+         std::size_t next;
+
+         /** Slot of the parent. */
+         std::size_t up;
+
+         /** Position in the tour of the step that enters the node. */
+         std::size_t enter;
+
+         /** Position in the tour of the step that exits the node. */
+         std::size_t exit;
+
+         /** Nodes entered minus nodes exited, up to entering the node. */
+         std::size_t depth;
+
+         /** Values combined up to entering the node. */
+         Value prefix;
+      };
+
+      //________________________________________________________________________
+
+      /** Set up of the Euler tour of a scan. */
+      template <class Value>
+      struct ScanJob : public SlotJob< ScanSlot<Value> > {
+         typedef typename SlotJob< ScanSlot<Value> >::Partial Partial;
+
+         /** Link the slots of the children of a node. */
+         void visit(Partial& partial, TreeNode<T, Alloc>* node) const;
+      };
+
+      //________________________________________________________________________
+
+      /**
+       * Run of the Euler tour of a scan, scanned by a single task.
+       *
+       * Run i starts entering the node of slot i * spacing, and goes on until
+       * the start of another run.
+       */
+      template <class Value>
+      struct ScanRun {
+         /** Number of steps of the run. */
+         std::size_t length;
+
+         /** Nodes entered minus nodes exited over the run. */
+         std::size_t depth;
+
+         /** Values combined over the run. */
+         Value total;
+
+         /** Next run, NO_SLOT for the last one. */
+         std::size_t next;
+
+         /** Steps before the run. */
+         std::size_t offset;
+
+         /** Nodes entered minus nodes exited before the run. */
+         std::size_t depthOffset;
+
+         /** Values combined before the run. */
+         Value prefix;
+
+         /** Whether there is anything before the run. */
+         bool hasPrefix;
+      };
+
+      //________________________________________________________________________
+
+      /** Step of a scan, run over ranges of runs (or of slots). */
+      template <class Value, class LeafFunction, class CombineFunction, class InverseFunction, class Function>
+      struct ScanStep {
+         /** What the step does. */
+         enum Phase {
+            /** Scan runs on their own. */
+            LOCAL,
+
+            /** Add what comes before the runs. */
+            GLOBAL,
+
+            /** Call the function for the nodes of a range of slots. */
+            REPORT
+         };
+
+         /** Run the step over a range of runs (or of slots). */
+         void operator()(std::size_t first, std::size_t last) const;
+
+         /** Scan a run on its own. */
+         void local(std::size_t run) const;
+
+         /** Add what comes before a run. */
+         void global(std::size_t run) const;
+
+         /** Step of the tour after another one, NO_SLOT after the last one. */
+         inline std::size_t after(std::size_t step) const;
+
+         /** Whether a step starts a run. */
+         inline bool starts(std::size_t step) const;
+
+         /** What the step does. */
+         Phase phase;
+
+         /** Leaf function of the scan. */
+         LeafFunction* leaf;
+
+         /** Combination of the scan. */
+         CombineFunction* combine;
+
+         /** Inverse of the combination. */
+         InverseFunction* inverse;
+
+         /** Function called for every node. */
+         Function* function;
+
+         /** Slots of the nodes. */
+         ScanSlot<Value>* slots;
+
+         /** Runs of the tour. */
+         ScanRun<Value>* runs;
+
+         /** Slots between the starts of two runs. */
+         std::size_t spacing;
+      };
+
+      //________________________________________________________________________
+
+      /** Step of a round of a contraction, run over ranges of the live folds. */
+      template <class Algebra>
+      struct ContractStep {
+         /** What the step does. */
+         enum Phase {
+            /** Evaluate or turn unary the folds with known children. */
+            RAKE,
+
+            /** Merge unary folds with their unary children. */
+            COMPRESS,
+
+            /** Count the folds left in every block of the live folds. */
+            COUNT,
+
+            /** Copy the folds left into the new list. */
+            SCATTER
+         };
+
+         /** Run the step over a range of live folds (or of blocks). */
+         void operator()(std::size_t first, std::size_t last) const;
+
+         /** Slot of a live fold. */
+         inline std::size_t entry(std::size_t i) const;
+
+         /** Value of a cell known before this round, NULL if it isn't known. */
+         inline const typename Algebra::Value* known(std::size_t cell) const;
+
+         /** Coin flipped by a fold this round. */
+         inline bool heads(std::size_t slot) const;
+
+         /** Rake the children of a fold. */
+         void rake(std::size_t slot) const;
+
+         /** Merge a unary fold with its unary child if the coins allow it. */
+         void compress(std::size_t slot) const;
+
+         /** What the step does. */
+         Phase phase;
+
+         /** Number of the round (from 1). */
+         unsigned int round;
+
+         /** Algebra the tree is evaluated with. */
+         Algebra* algebra;
+
+         /** Slots of the nodes. */
+         ContractSlot<Algebra>* slots;
+
+         /** Slots of the live folds, NULL if every slot is in the list. */
+         const std::size_t* live;
+
+         /** Number of live folds. */
+         std::size_t nLive;
+
+         /** Live folds after the round. */
+         std::size_t* compacted;
+
+         /** Folds left per block, then where each block copies them. */
+         std::size_t* offsets;
+
+         /** Number of live folds per block. */
+         std::size_t block;
+      };
+
+      //________________________________________________________________________
+
+      /** Task that runs a step over a range, giving halves away. */
+      template <class Step>
+      class RangeTask : public TreeExecutor::Task {
+         public:
+            /** Run the step over the range. */
+            virtual void execute();
+
+            /** Step to be run. */
+            const Step* step;
+
+            /** Executor running the tasks. */
+            TreeExecutor* executor;
+
+            /** Smallest range worth a task. */
+            std::size_t grain;
+
+            /** Beginning of the range. */
+            std::size_t first;
+
+            /** End of the range. */
+            std::size_t last;
+      };
+
+      //________________________________________________________________________
+
+      /** Settings shared by every task of a traversal. */
+      template <class Job>
+      struct Walk {
+         /** Job done on the nodes. */
+         const Job* job;
+
+         /** Whether nodes are visited before or after their descendants. */
+         TreeParallelOrder order;
+
+         /** Whether work is split depending only on the shape of the tree. */
+         bool deterministic;
+
+         /** Executor running the tasks. */
+         TreeExecutor* executor;
+
+         /** Smallest number of nodes worth a task. */
+         std::size_t grain;
+      };
+
+      //________________________________________________________________________
+
+      /** Task that traverses a range of siblings and their subtrees. */
+      template <class Job>
+      class WalkTask : public TreeExecutor::Task {
+         public:
+            /** Traverse the range. */
+            virtual void execute();
+
+            /** Settings of the traversal. */
+            const Walk<Job>* walk;
+
+            /** First sibling of the range. */
+            TreeNode<T, Alloc>* first;
+
+            /** Last sibling of the range. */
+            TreeNode<T, Alloc>* last;
+
+            /** Number of pieces the range is nested in. */
+            unsigned int depth;
+
+            /** Result of the traversal of the range. */
+            typename Job::Partial partial;
+      };
+
+      //________________________________________________________________________
+
+      /** Piece of work given away by a task. */
+      template <class Job>
+      struct Split {
+         /** Task that traverses the piece. */
+         WalkTask<Job> task;
+
+         /** Group to wait for the task. */
+         TreeExecutor::Group group;
+
+         /** Node whose right siblings were given away (NULL for ranges). */
+         TreeNode<T, Alloc>* point;
+
+         /**
+          * Whether the task was handed over to the executor. Otherwise, it is
+          * run when it is joined.
+          */
+         bool spawned;
+      };
+
+
+      // =======================================================================
+      //                           PRIVATE CONSTANTS
+      // =======================================================================
+
+
+      /** Maximum number of pieces of each kind a task may give away. */
+      static const unsigned int MAX_SPLITS = 32;
+
+      /** Nodes visited between the first two attempts to split. */
+      static const std::size_t SPLIT_INTERVAL = 64;
+
+      /** Slots of the block of a transform claimed at once by a task. */
+      static const std::size_t CLAIM_SIZE = 64;
+
+      /** Slot linked from nowhere. */
+      static const std::size_t NO_SLOT = static_cast<std::size_t>(-1);
+
+      /**
+       * Pieces nested this deep don't split in deterministic traversals, as
+       * the pieces they give away may have to be run by themselves.
+       */
+      static const unsigned int MAX_SPLIT_DEPTH = 16;
+
+
+      // =======================================================================
+      //                            PRIVATE METHODS
+      // =======================================================================
+
+
+      /**
+       * Start a traversal of a subtree.
+       *
+       * @param subtreeRoot Iterator to the root of the subtree.
+       * @param job Job done on the nodes.
+       * @param order Whether nodes are visited before or after their descendants.
+       * @param deterministic Whether work is split depending only on the shape
+       * of the tree.
+       * @param partial Where the result of the traversal is added.
+       */
+      template <class Job>
+      void start(const TreeIterator<T, Alloc>& subtreeRoot, const Job& job, TreeParallelOrder order, bool deterministic, typename Job::Partial& partial) const;
+
+      //________________________________________________________________________
+
+      /**
+       * Traverse a range of siblings and their subtrees, giving parts away when
+       * other threads are idle.
+       *
+       * @param walk Settings of the traversal.
+       * @param first First sibling of the range.
+       * @param last Last sibling of the range.
+       * @param depth Number of pieces the range is nested in.
+       * @param partial Where the result of the traversal is added.
+       */
+      template <class Job>
+      static void walk(const Walk<Job>& walk, TreeNode<T, Alloc>* first, TreeNode<T, Alloc>* last, unsigned int depth, typename Job::Partial& partial);
+
+      //________________________________________________________________________
+
+      /**
+       * Give away part of the work left to a task.
+       *
+       * @param walk Settings of the traversal.
+       * @param cursor Cursor of the task, at the node just visited. Its
+       * boundary is moved down if the right siblings of a node of its path are
+       * given away.
+       * @param root Sibling of the range being traversed.
+       * @param last Last sibling of the range, moved back if the end of the
+       * range is given away.
+       * @param depth Number of pieces the range is nested in.
+       * @param partial Partial result of the task.
+       * @param ranges Ends of the range given away so far.
+       * @param nRanges Number of ends of the range given away so far.
+       * @param points Right siblings given away so far, the deepest last.
+       * @param nPoints Number of right siblings given away so far.
+       * @return 'true' if something was given away, 'false' otherwise.
+       */
+      template <class Job>
+      static bool split(const Walk<Job>& walk, TreeCursor<T, Alloc>& cursor, TreeNode<T, Alloc>* root, TreeNode<T, Alloc>*& last, unsigned int depth,
+                        const typename Job::Partial& partial, Split<Job>* ranges, unsigned int& nRanges, Split<Job>* points, unsigned int& nPoints);
+
+      //________________________________________________________________________
+
+      /**
+       * Hand a piece of work over to the executor, or keep it to be run when it
+       * is joined if the calling thread can't wait for more tasks.
+       *
+       * @param walk Settings of the traversal.
+       * @param piece Piece of work, its range already set up.
+       * @param depth Number of pieces the range being split is nested in.
+       * @param partial Partial result of the task that splits.
+       */
+      template <class Job>
+      static void giveAway(const Walk<Job>& walk, Split<Job>& piece, unsigned int depth, const typename Job::Partial& partial);
+
+      //________________________________________________________________________
+
+      /**
+       * Run a step over a range, in parallel.
+       *
+       * @param first Beginning of the range.
+       * @param last End of the range.
+       * @param grain Smallest range worth a task.
+       * @param step Step called as 'step(begin, end)' over subranges.
+       * @throws The first exception thrown by the step.
+       */
+      template <class Step>
+      void forRange(std::size_t first, std::size_t last, std::size_t grain, const Step& step) const;
+
+      //________________________________________________________________________
+
+      /**
+       * Count the nodes hanging from a range of siblings (the siblings
+       * included), up to a limit.
+       *
+       * @param first First sibling of the range.
+       * @param last Last sibling of the range.
+       * @param limit Counting stops when it is reached.
+       * @return The number of nodes, or 'limit' if there are more.
+       */
+      static std::size_t count(TreeNode<T, Alloc>* first, TreeNode<T, Alloc>* last, std::size_t limit);
+
+      //________________________________________________________________________
+
+      /**
+       * Wait for the last piece of work given away and append its result.
+       *
+       * @param walk Settings of the traversal.
+       * @param splits Pieces given away.
+       * @param nSplits Number of pieces, decreased by one.
+       * @param partial Where the result of the piece is appended.
+       * @throws Any exception thrown by the task of the piece.
+       */
+      template <class Job>
+      static void joinLast(const Walk<Job>& walk, Split<Job>* splits, unsigned int& nSplits, typename Job::Partial& partial);
+
+      //________________________________________________________________________
+
+      /**
+       * Wait for every piece of work given away, the last one first, and append
+       * their results.
+       *
+       * @param walk Settings of the traversal.
+       * @param splits Pieces given away.
+       * @param nSplits Number of pieces, set to 0.
+       * @param partial Where the results of the pieces are appended.
+       * @throws The first exception thrown by any of the tasks.
+       */
+      template <class Job>
+      static void join(const Walk<Job>& walk, Split<Job>* splits, unsigned int& nSplits, typename Job::Partial& partial);
+
+
+      // =======================================================================
+      //                            PRIVATE FIELDS
+      // =======================================================================
+
+
+      /** Executor whose threads run the operations. */
+      TreeExecutor* _executor;
+
+      //________________________________________________________________________
+
+      /** Smallest number of nodes worth running in a task of its own. */
+      std::size_t _grain;
+};
+
+
+// *****************************************************************************
+//                             FUNCTION DECLARATIONS
+// *****************************************************************************
+
+
+/**
+ * Apply a function to every node of a tree, in parallel, on the default
+ * executor (see TreeParallel::forEach()).
+ *
+ * @param tree Tree to be traversed.
+ * @param function Function object called as 'function(data)' for every node.
+ * @param order Whether each node is visited before (top-down) or after
+ * (bottom-up) its descendants.
+ */
+template <class T, class Alloc, class Function>
+void parallelForEach(Tree<T, Alloc>& tree, Function function, TreeParallelOrder order = TREE_TOP_DOWN);
+
+//______________________________________________________________________________
+
+/**
+ * Apply a function to every node of a tree, in parallel, on a given executor
+ * (see TreeParallel::forEach()).
+ *
+ * @param executor Executor whose threads run the operation.
+ * @param tree Tree to be traversed.
+ * @param function Function object called as 'function(data)' for every node.
+ * @param order Whether each node is visited before (top-down) or after
+ * (bottom-up) its descendants.
+ */
+template <class T, class Alloc, class Function>
+void parallelForEach(TreeExecutor& executor, Tree<T, Alloc>& tree, Function function, TreeParallelOrder order = TREE_TOP_DOWN);
+
+//______________________________________________________________________________
+
+/**
+ * Fold the values of the nodes of a tree, in parallel, on the default
+ * executor (see TreeParallel::reduce()).
+ *
+ * @param tree Tree to be reduced.
+ * @param leaf Function object called as 'leaf(data)' to get the value of every
+ * node.
+ * @param combine Associative function object called as 'combine(a, b)' to
+ * combine two values.
+ * @param mode Whether the grouping may change from run to run.
+ * @return The result of the reduction.
+ */
+template <class T, class Alloc, class LeafFunction, class CombineFunction>
+typename TreeParallel<T, Alloc>::template LeafResult<LeafFunction>::type parallelReduce(Tree<T, Alloc>& tree, LeafFunction leaf, CombineFunction combine,
+                                                                                          TreeReduceMode mode = TREE_REDUCE_FAST);
+
+//______________________________________________________________________________
+
+/**
+ * Fold the values of the nodes of a tree, in parallel, on a given executor (see
+ * TreeParallel::reduce()).
+ *
+ * @param executor Executor whose threads run the operation.
+ * @param tree Tree to be reduced.
+ * @param leaf Function object called as 'leaf(data)' to get the value of every
+ * node.
+ * @param combine Associative function object called as 'combine(a, b)' to
+ * combine two values.
+ * @param mode Whether the grouping may change from run to run.
+ * @return The result of the reduction.
+ */
+template <class T, class Alloc, class LeafFunction, class CombineFunction>
+typename TreeParallel<T, Alloc>::template LeafResult<LeafFunction>::type parallelReduce(TreeExecutor& executor, Tree<T, Alloc>& tree, LeafFunction leaf, CombineFunction combine,
+                                                                                          TreeReduceMode mode = TREE_REDUCE_FAST);
+
+//______________________________________________________________________________
+
+/**
+ * Build a tree with the same shape as another one, in parallel, on the default
+ * executor (see TreeParallel::transform()). The new tree uses std::allocator,
+ * whatever the allocator of the given tree.
+ *
+ * @param tree Tree to be transformed.
+ * @param function Function object called as 'function(data)' for every node,
+ * its result is converted to 'U'.
+ * @return The new tree.
+ */
+template <class U, class T, class Alloc, class Function>
+Tree<U, typename TreeParallel<T, Alloc>::template TransformAllocator<U>::type> parallelTransform(Tree<T, Alloc>& tree, Function function);
+
+//______________________________________________________________________________
+
+/**
+ * Build a tree with the same shape as another one, in parallel, on a given
+ * executor (see TreeParallel::transform()). The new tree uses std::allocator,
+ * whatever the allocator of the given tree.
+ *
+ * @param executor Executor whose threads run the operation.
+ * @param tree Tree to be transformed.
+ * @param function Function object called as 'function(data)' for every node,
+ * its result is converted to 'U'.
+ * @return The new tree.
+ */
+template <class U, class T, class Alloc, class Function>
+Tree<U, typename TreeParallel<T, Alloc>::template TransformAllocator<U>::type> parallelTransform(TreeExecutor& executor, Tree<T, Alloc>& tree, Function function);
+
+//______________________________________________________________________________
+
+/**
+ * Evaluate a tree by tree contraction, in parallel, on the default executor
+ * (see TreeParallel::contract()).
+ *
+ * @param tree Tree to be evaluated.
+ * @param algebra Algebra the tree is evaluated with.
+ * @return The value of the root of the tree.
+ */
+template <class T, class Alloc, class Algebra>
+typename Algebra::Value parallelContract(Tree<T, Alloc>& tree, Algebra algebra);
+
+//______________________________________________________________________________
+
+/**
+ * Evaluate a tree by tree contraction, in parallel, on a given executor (see
+ * TreeParallel::contract()).
+ *
+ * @param executor Executor whose threads run the operation.
+ * @param tree Tree to be evaluated.
+ * @param algebra Algebra the tree is evaluated with.
+ * @return The value of the root of the tree.
+ */
+template <class T, class Alloc, class Algebra>
+typename Algebra::Value parallelContract(TreeExecutor& executor, Tree<T, Alloc>& tree, Algebra algebra);
+
+//______________________________________________________________________________
+
+/**
+ * Compute the position of every node of a tree and the values combined along
+ * its path from the root, in parallel, on the default executor (see
+ * TreeParallel::scan()).
+ *
+ * @param tree Tree to be scanned.
+ * @param leaf Function object called as 'leaf(data)' to get the value of every
+ * node.
+ * @param combine Associative function object called as 'combine(a, b)' to
+ * combine two values.
+ * @param inverse Function object called as 'inverse(a)' to get the value that
+ * undoes 'a'.
+ * @param function Function object called as 'function(data, info)' for every
+ * node.
+ */
+template <class T, class Alloc, class LeafFunction, class CombineFunction, class InverseFunction, class Function>
+void parallelScan(Tree<T, Alloc>& tree, LeafFunction leaf, CombineFunction combine, InverseFunction inverse, Function function);
+
+//______________________________________________________________________________
+
+/**
+ * Compute the position of every node of a tree and the values combined along
+ * its path from the root, in parallel, on a given executor (see
+ * TreeParallel::scan()).
+ *
+ * @param executor Executor whose threads run the operation.
+ * @param tree Tree to be scanned.
+ * @param leaf Function object called as 'leaf(data)' to get the value of every
+ * node.
+ * @param combine Associative function object called as 'combine(a, b)' to
+ * combine two values.
+ * @param inverse Function object called as 'inverse(a)' to get the value that
+ * undoes 'a'.
+ * @param function Function object called as 'function(data, info)' for every
+ * node.
+ */
+template <class T, class Alloc, class LeafFunction, class CombineFunction, class InverseFunction, class Function>
+void parallelScan(TreeExecutor& executor, Tree<T, Alloc>& tree, LeafFunction leaf, CombineFunction combine, InverseFunction inverse, Function function);
+
+
+// *****************************************************************************
+// *****************************************************************************
+// *****************************************************************************
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                            IMPLEMENTATION                             ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// *****************************************************************************
+// *****************************************************************************
+// *****************************************************************************
+
+
+template <class T, class Alloc>
+TreeParallel<T, Alloc>::TreeParallel(TreeExecutor& executor, std::size_t grain) :
+   _executor(&executor),
+   _grain(grain > 0 ? grain : 1)
+{
+   // Nothing to do
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+TreeExecutor& TreeParallel<T, Alloc>::executor() const {
+   return *_executor;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+std::size_t TreeParallel<T, Alloc>::grain() const {
+   return _grain;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+template <class Function>
+void TreeParallel<T, Alloc>::forEach(const TreeIterator<T, Alloc>& subtreeRoot, Function function, TreeParallelOrder order) const {
+   ForEachJob<Function> job = {&function};
+   typename ForEachJob<Function>::Partial partial;
+   start(subtreeRoot, job, order, false, partial);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+template <class LeafFunction, class CombineFunction>
+typename TreeParallel<T, Alloc>::template LeafResult<LeafFunction>::type TreeParallel<T, Alloc>::reduce(const TreeIterator<T, Alloc>& subtreeRoot, LeafFunction leaf,
+                                                                                                        CombineFunction combine, TreeReduceMode mode) const
+{
+   typedef ReduceJob<typename LeafResult<LeafFunction>::type, LeafFunction, CombineFunction> Job;
+
+   Job job = {&leaf, &combine};
+   typename Job::Partial partial;
+   start(subtreeRoot, job, TREE_TOP_DOWN, mode == TREE_REDUCE_DETERMINISTIC, partial);
+
+   return partial.value;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+template <class U, class UAlloc, class Function>
+Tree<U, UAlloc> TreeParallel<T, Alloc>::transform(const TreeIterator<T, Alloc>& subtreeRoot, Function function, const UAlloc& alloc) const {
+   typedef TransformJob<U, UAlloc, Function> Job;
+   typedef typename Job::CopyNode CopyNode;
+
+   TreeCursor<T, Alloc> root(subtreeRoot);
+   if(root.atEnd())
+      return Tree<U, UAlloc>(alloc);
+
+   // The first slot of the block holds its header, the nodes go right after it
+   std::size_t nNodes = reduce(subtreeRoot, CountNode(), std::plus<std::size_t>());
+   typename Job::NodeAllocator allocator(alloc);
+   CopyNode* block = Job::NodeAllocatorTraits::allocate(allocator, nNodes + 1);
+
+   // The block can't be given back while it is being filled, as it can't hold
+   // more than 'nNodes' nodes
+   TreeNodeSlab* header = new (static_cast<void*>(block)) TreeNodeSlab;
+   header->count = nNodes;
+   header->live = nNodes + 1;
+   CopyNode* slots = block + 1;
+
+   try {
+      Job::NodeAllocatorTraits::construct(allocator, slots, function(root._node->_data.get()), static_cast<CopyNode*>(NULL), UAlloc(allocator));
+   }
+   catch(...) {
+      Job::NodeAllocatorTraits::deallocate(allocator, block, nNodes + 1);
+      throw;
+   }
+   slots->_slab = header;
+
+   std::atomic<std::size_t> nClaimed(1);
+   Job job = {&function, &allocator, header, slots, nNodes, &nClaimed};
+   typename Job::Partial partial;
+   partial.source = root._node;
+   partial.copy = slots;
+
+   try {
+      start(subtreeRoot, job, TREE_TOP_DOWN, false, partial);
+   }
+   catch(...) {
+      // The tasks that failed don't report the nodes they built, so the block
+      // is kept until every node has been destroyed and given back afterwards
+      {
+         Tree<U, UAlloc> partialCopy(slots, allocator, false);
+      }
+      Job::NodeAllocatorTraits::deallocate(allocator, block, nNodes + 1);
+      throw;
+   }
+
+   header->live = partial.nBuilt + 1;
+   return Tree<U, UAlloc>(slots, allocator, false);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+template <class U, class Function>
+Tree<U, typename TreeParallel<T, Alloc>::template TransformAllocator<U>::type> TreeParallel<T, Alloc>::transform(const TreeIterator<T, Alloc>& subtreeRoot,
+                                                                                                             Function function) const
+{
+   return transform<U>(subtreeRoot, function, typename TransformAllocator<U>::type());
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+template <class Algebra>
+typename Algebra::Value TreeParallel<T, Alloc>::contract(const TreeIterator<T, Alloc>& subtreeRoot, Algebra algebra) const {
+   typedef ContractJob<Algebra> Job;
+   typedef ContractStep<Algebra> Step;
+
+   TreeCursor<T, Alloc> root(subtreeRoot);
+   if(root.atEnd())
+      return typename Algebra::Value();
+
+   // Claims end up below 'nNodes' and there is a slot per child past it (see
+   // SlotJob::claim())
+   std::size_t nNodes = reduce(subtreeRoot, CountNode(), std::plus<std::size_t>());
+   std::vector< ContractSlot<Algebra> > slots(2 * nNodes);
+
+   // The fold of the root isn't used, it just points to the cell whose value
+   // is the result
+   std::atomic<std::size_t> nClaimed(1);
+   Job job;
+   job.algebra = &algebra;
+   job.slots = &slots[0];
+   job.nClaimed = &nClaimed;
+   job.limit = nNodes;
+   typename Job::Partial partial;
+   partial.source = root._node;
+   partial.slot = 0;
+   start(subtreeRoot, job, TREE_TOP_DOWN, false, partial);
+
+   // Every slot claimed is live in the first round, unused ones are dropped
+   // along with the root
+   std::size_t nLive = std::min(nClaimed.load(), slots.size());
+   std::vector<std::size_t> live(nLive);
+   std::vector<std::size_t> compacted(nLive);
+   std::vector<std::size_t> offsets(nLive / _grain + 2);
+
+   Step step;
+   step.algebra = &algebra;
+   step.slots = &slots[0];
+   step.live = NULL;
+   step.block = _grain;
+
+   for(unsigned int round = 1; nLive > 0; ++round) {
+      step.round = round;
+      step.nLive = nLive;
+      step.compacted = &compacted[0];
+      step.offsets = &offsets[0];
+
+      step.phase = Step::RAKE;
+      forRange(0, nLive, _grain, step);
+      step.phase = Step::COMPRESS;
+      forRange(0, nLive, _grain, step);
+
+      // Folds that became leaves or were merged leave the list
+      std::size_t nBlocks = (nLive + _grain - 1) / _grain;
+      step.phase = Step::COUNT;
+      forRange(0, nBlocks, 1, step);
+
+      std::size_t nLeft = 0;
+      for(std::size_t i = 0; i < nBlocks; ++i) {
+         std::size_t count = offsets[i];
+         offsets[i] = nLeft;
+         nLeft += count;
+      }
+
+      step.phase = Step::SCATTER;
+      forRange(0, nBlocks, 1, step);
+
+      live.swap(compacted);
+      step.live = &live[0];
+      nLive = nLeft;
+   }
+
+   std::size_t top = slots[0].fold.right;
+   return top % 2 == 0 ? slots[top / 2].start : slots[top / 2].fold.value;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+template <class LeafFunction, class CombineFunction, class InverseFunction, class Function>
+void TreeParallel<T, Alloc>::scan(const TreeIterator<T, Alloc>& subtreeRoot, LeafFunction leaf, CombineFunction combine, InverseFunction inverse,
+                                  Function function) const
+{
+   typedef typename LeafResult<LeafFunction>::type Value;
+   typedef ScanJob<Value> Job;
+   typedef ScanStep<Value, LeafFunction, CombineFunction, InverseFunction, Function> Step;
+
+   TreeCursor<T, Alloc> root(subtreeRoot);
+   if(root.atEnd())
+      return;
+
+   // Same numbering as contractions (see contract())
+   std::size_t nNodes = reduce(subtreeRoot, CountNode(), std::plus<std::size_t>());
+   std::vector< ScanSlot<Value> > slots(2 * nNodes);
+
+   std::atomic<std::size_t> nClaimed(1);
+   Job job;
+   job.slots = &slots[0];
+   job.nClaimed = &nClaimed;
+   job.limit = nNodes;
+   typename Job::Partial partial;
+   partial.source = root._node;
+   partial.slot = 0;
+   start(subtreeRoot, job, TREE_TOP_DOWN, false, partial);
+
+   // Unused slots don't start runs
+   std::size_t nSlots = std::min(nClaimed.load(), slots.size());
+   std::size_t nRuns = (nSlots + _grain - 1) / _grain;
+   std::vector< ScanRun<Value> > runs(nRuns);
+
+   Step step;
+   step.leaf = &leaf;
+   step.combine = &combine;
+   step.inverse = &inverse;
+   step.function = &function;
+   step.slots = &slots[0];
+   step.runs = &runs[0];
+   step.spacing = _grain;
+
+   step.phase = Step::LOCAL;
+   forRange(0, nRuns, 1, step);
+
+   // The tour starts with the first run, there is a run every 'spacing' slots
+   // so following them is cheap
+   std::size_t offset = 0;
+   std::size_t depth = 0;
+   Value prefix = Value();
+   bool hasPrefix = false;
+   for(std::size_t i = 0; i != NO_SLOT; i = runs[i].next) {
+      ScanRun<Value>& run = runs[i];
+      run.offset = offset;
+      run.depthOffset = depth;
+      run.prefix = prefix;
+      run.hasPrefix = hasPrefix;
+
+      offset += run.length;
+      depth += run.depth;
+      prefix = hasPrefix ? combine(prefix, run.total) : run.total;
+      hasPrefix = true;
+   }
+
+   step.phase = Step::GLOBAL;
+   forRange(0, nRuns, 1, step);
+   step.phase = Step::REPORT;
+   forRange(0, nSlots, _grain, step);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+template <class Function>
+void TreeParallel<T, Alloc>::ForEachJob<Function>::visit(Partial& partial, TreeNode<T, Alloc>* node) const {
+   (*function)(node->_data.get());
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+template <class Function>
+void TreeParallel<T, Alloc>::ForEachJob<Function>::append(Partial& partial, Partial& piece) const {
+   // Nothing to do
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+template <class Function>
+void TreeParallel<T, Alloc>::ForEachJob<Function>::handOver(const Partial& partial, TreeNode<T, Alloc>* first, Partial& piece) const {
+   // Nothing to do
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+template <class Value, class LeafFunction, class CombineFunction>
+TreeParallel<T, Alloc>::ReduceJob<Value, LeafFunction, CombineFunction>::Partial::Partial() : empty(true), value() {
+   // Nothing to do
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+template <class Value, class LeafFunction, class CombineFunction>
+void TreeParallel<T, Alloc>::ReduceJob<Value, LeafFunction, CombineFunction>::visit(Partial& partial, TreeNode<T, Alloc>* node) const {
+   if(partial.empty) {
+      partial.value = (*leaf)(node->_data.get());
+      partial.empty = false;
+   }
+   else {
+      partial.value = (*combine)(std::move(partial.value), (*leaf)(node->_data.get()));
+   }
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+template <class Value, class LeafFunction, class CombineFunction>
+void TreeParallel<T, Alloc>::ReduceJob<Value, LeafFunction, CombineFunction>::append(Partial& partial, Partial& piece) const {
+   if(piece.empty)
+      return;
+
+   if(partial.empty) {
+      partial.value = std::move(piece.value);
+      partial.empty = false;
+   }
+   else {
+      partial.value = (*combine)(std::move(partial.value), std::move(piece.value));
+   }
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+template <class Value, class LeafFunction, class CombineFunction>
+void TreeParallel<T, Alloc>::ReduceJob<Value, LeafFunction, CombineFunction>::handOver(const Partial& partial, TreeNode<T, Alloc>* first,
+                                                                                      Partial& piece) const
+{
+   // Nothing to do
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+template <class U, class UAlloc, class Function>
+TreeParallel<T, Alloc>::TransformJob<U, UAlloc, Function>::Partial::Partial() : source(NULL), copy(NULL), next(NULL), end(NULL), nBuilt(0) {
+   // Nothing to do
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+template <class U, class UAlloc, class Function>
+void TreeParallel<T, Alloc>::TransformJob<U, UAlloc, Function>::visit(Partial& partial, TreeNode<T, Alloc>* node) const {
+   mirror(partial.source, partial.copy, node);
+
+   // The copies of the children are built and linked by the task that visits
+   // their parent, the tasks that visit them later on only read the list
+   CopyNode* parent = partial.copy;
+   typename TreeNode<T, Alloc>::ChildIterator it;
+   for(it = node->_children.begin(); it != node->_children.end(); ++it) {
+      CopyNode* child = claim(partial);
+      bool inBlock = child != NULL;
+      if(!inBlock)
+         child = NodeAllocatorTraits::allocate(*allocator, 1);
+
+      try {
+         NodeAllocatorTraits::construct(*allocator, child, (*function)((*it)->_data.get()), parent, UAlloc(*allocator));
+      }
+      catch(...) {
+         // Slots of the block that aren't built are just left unused
+         if(!inBlock)
+            NodeAllocatorTraits::deallocate(*allocator, child, 1);
+         throw;
+      }
+
+      try {
+         parent->_children.push_back(child);
+      }
+      catch(...) {
+         // The child isn't linked, so it wouldn't be found when the new tree
+         // is destroyed
+         NodeAllocatorTraits::destroy(*allocator, child);
+         if(!inBlock)
+            NodeAllocatorTraits::deallocate(*allocator, child, 1);
+         throw;
+      }
+
+      child->_childIt = --(parent->_children.end());
+      if(inBlock) {
+         child->_slab = header;
+         ++partial.nBuilt;
+      }
+   }
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+template <class U, class UAlloc, class Function>
+void TreeParallel<T, Alloc>::TransformJob<U, UAlloc, Function>::append(Partial& partial, Partial& piece) const {
+   partial.nBuilt += piece.nBuilt;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+template <class U, class UAlloc, class Function>
+void TreeParallel<T, Alloc>::TransformJob<U, UAlloc, Function>::handOver(const Partial& partial, TreeNode<T, Alloc>* first, Partial& piece) const {
+   // Pieces are right siblings of the node just visited or of its ancestors
+   piece.source = partial.source;
+   piece.copy = partial.copy;
+   mirror(piece.source, piece.copy, first);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+template <class U, class UAlloc, class Function>
+typename TreeParallel<T, Alloc>::template TransformJob<U, UAlloc, Function>::CopyNode* TreeParallel<T, Alloc>::TransformJob<U, UAlloc, Function>::claim(Partial& partial) const {
+   if(partial.next == partial.end) {
+      // Once the block is full, the rest of the nodes are allocated on their own
+      if(nClaimed->load(std::memory_order_relaxed) >= nSlots)
+         return NULL;
+
+      std::size_t first = nClaimed->fetch_add(CLAIM_SIZE, std::memory_order_relaxed);
+      if(first >= nSlots)
+         return NULL;
+
+      partial.next = slots + first;
+      partial.end = slots + std::min(first + CLAIM_SIZE, nSlots);
+   }
+
+   return partial.next++;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+template <class U, class UAlloc, class Function>
+void TreeParallel<T, Alloc>::TransformJob<U, UAlloc, Function>::mirror(TreeNode<T, Alloc>*& source, CopyNode*& copy, TreeNode<T, Alloc>* node) {
+   if(source == node)
+      return;
+
+   // Both positions go down to the first child, or up to the level of 'node',
+   // and then right until 'node' is reached
+   if(node->_parent == source) {
+      source = source->_children.front();
+      copy = copy->_children.front();
+   }
+   else {
+      while(source->_parent != node->_parent) {
+         source = source->_parent;
+         copy = copy->_parent;
+      }
+   }
+
+   while(source != node) {
+      source = TreeCursor<T, Alloc>::nextSibling(source);
+
+      typename CopyNode::ChildIterator it = copy->_childIt;
+      copy = *++it;
+   }
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+std::size_t TreeParallel<T, Alloc>::CountNode::operator()(const T& data) const {
+   return 1;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+template <class Slot>
+TreeParallel<T, Alloc>::SlotJob<Slot>::Partial::Partial() : source(NULL), slot(0), next(0), end(0) {
+   // Nothing to do
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+template <class Slot>
+void TreeParallel<T, Alloc>::SlotJob<Slot>::append(Partial& partial, Partial& piece) const {
+   // Nothing to do
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+template <class Slot>
+void TreeParallel<T, Alloc>::SlotJob<Slot>::handOver(const Partial& partial, TreeNode<T, Alloc>* first, Partial& piece) const {
+   piece.source = partial.source;
+   piece.slot = partial.slot;
+   mirror(piece.source, piece.slot, first);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+template <class Slot>
+std::size_t TreeParallel<T, Alloc>::SlotJob<Slot>::claim(Partial& partial) const {
+   // The slots left unused by the tasks can't run past the limit, once it is
+   // reached every slot claimed is used
+   if(partial.next == partial.end) {
+      std::size_t first = nClaimed->load(std::memory_order_relaxed);
+      do {
+         if(first + CLAIM_SIZE > limit)
+            return nClaimed->fetch_add(1, std::memory_order_relaxed);
+      } while(!nClaimed->compare_exchange_weak(first, first + CLAIM_SIZE, std::memory_order_relaxed));
+
+      partial.next = first;
+      partial.end = first + CLAIM_SIZE;
+   }
+
+   return partial.next++;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+template <class Slot>
+void TreeParallel<T, Alloc>::SlotJob<Slot>::mirror(TreeNode<T, Alloc>*& source, std::size_t& slot, TreeNode<T, Alloc>* node) const {
+   if(source == node)
+      return;
+
+   // Same moves as TransformJob::mirror()
+   if(node->_parent == source) {
+      source = source->_children.front();
+      slot = slots[slot].first;
+   }
+   else {
+      while(source->_parent != node->_parent) {
+         source = source->_parent;
+         slot = slots[slot].up;
+      }
+   }
+
+   while(source != node) {
+      source = TreeCursor<T, Alloc>::nextSibling(source);
+      slot = slots[slot].next;
+   }
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+template <class Algebra>
+void TreeParallel<T, Alloc>::ContractJob<Algebra>::visit(Partial& partial, TreeNode<T, Alloc>* node) const {
+   this->mirror(partial.source, partial.slot, node);
+
+   ContractSlot<Algebra>* slots = this->slots;
+   ContractSlot<Algebra>& slot = slots[partial.slot];
+   slot.start = algebra->start(node->_data.get());
+
+   // Each child folds into the fold of its previous sibling, the fold of the
+   // last one gives the value of the node
+   std::size_t previous = 2 * partial.slot;
+   std::size_t previousSlot = 0;
+   typename TreeNode<T, Alloc>::ChildIterator it;
+   for(it = node->_children.begin(); it != node->_children.end(); ++it) {
+      std::size_t childSlot = this->claim(partial);
+      ContractSlot<Algebra>& child = slots[childSlot];
+      child.up = partial.slot;
+      child.fold.left = previous;
+      child.fold.node = node;
+      child.fold.kind.store(CONTRACT_BINARY, std::memory_order_relaxed);
+
+      if(it == node->_children.begin())
+         slot.first = childSlot;
+      else
+         slots[previousSlot].next = childSlot;
+
+      previous = 2 * childSlot + 1;
+      previousSlot = childSlot;
+   }
+
+   slot.fold.right = previous;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+template <class Value>
+void TreeParallel<T, Alloc>::ScanJob<Value>::visit(Partial& partial, TreeNode<T, Alloc>* node) const {
+   this->mirror(partial.source, partial.slot, node);
+
+   ScanSlot<Value>* slots = this->slots;
+   ScanSlot<Value>& slot = slots[partial.slot];
+   slot.node = node;
+   slot.first = NO_SLOT;
+
+   // The links of a slot are written by the task that visits its parent, the
+   // rest by the task that visits its node
+   std::size_t previous = NO_SLOT;
+   typename TreeNode<T, Alloc>::ChildIterator it;
+   for(it = node->_children.begin(); it != node->_children.end(); ++it) {
+      std::size_t childSlot = this->claim(partial);
+      slots[childSlot].up = partial.slot;
+      slots[childSlot].next = NO_SLOT;
+
+      if(previous == NO_SLOT)
+         slot.first = childSlot;
+      else
+         slots[previous].next = childSlot;
+
+      previous = childSlot;
+   }
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+template <class Value, class LeafFunction, class CombineFunction, class InverseFunction, class Function>
+void TreeParallel<T, Alloc>::ScanStep<Value, LeafFunction, CombineFunction, InverseFunction, Function>::operator()(std::size_t first, std::size_t last) const {
+   switch(phase) {
+      case LOCAL:
+         for(std::size_t i = first; i < last; ++i)
+            local(i);
+         break;
+
+      case GLOBAL:
+         for(std::size_t i = first; i < last; ++i)
+            global(i);
+         break;
+
+      case REPORT:
+         for(std::size_t i = first; i < last; ++i) {
+            const ScanSlot<Value>& slot = slots[i];
+            if(slot.node == NULL)
+               continue;
+
+            // Entering a node at depth d after k nodes adds up to 2k - d steps
+            TreeScanInfo<Value> info;
+            info.depth = slot.depth - 1;
+            info.preorder = (slot.enter + info.depth) / 2;
+            info.size = (slot.exit - slot.enter + 1) / 2;
+            info.prefix = slot.prefix;
+            (*function)(slot.node->_data.get(), info);
+         }
+         break;
+   }
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+template <class Value, class LeafFunction, class CombineFunction, class InverseFunction, class Function>
+void TreeParallel<T, Alloc>::ScanStep<Value, LeafFunction, CombineFunction, InverseFunction, Function>::local(std::size_t run) const {
+   std::size_t step = 2 * run * spacing;
+   if(slots[step / 2].node == NULL)
+      return;
+
+   // Depths are kept modulo the size of 'std::size_t', runs may exit more
+   // nodes than they enter
+   std::size_t length = 0;
+   std::size_t depth = 0;
+   Value total = Value();
+   do {
+      ScanSlot<Value>& slot = slots[step / 2];
+      Value value = (*leaf)(slot.node->_data.get());
+
+      if(step % 2 == 0) {
+         total = length == 0 ? value : (*combine)(total, value);
+         slot.enter = length;
+         slot.depth = ++depth;
+         slot.prefix = total;
+      }
+      else {
+         total = (*combine)(total, (*inverse)(value));
+         slot.exit = length;
+         --depth;
+      }
+
+      ++length;
+      step = after(step);
+   } while(step != NO_SLOT && !starts(step));
+
+   ScanRun<Value>& scanned = runs[run];
+   scanned.length = length;
+   scanned.depth = depth;
+   scanned.total = total;
+   scanned.next = step != NO_SLOT ? step / 2 / spacing : NO_SLOT;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+template <class Value, class LeafFunction, class CombineFunction, class InverseFunction, class Function>
+void TreeParallel<T, Alloc>::ScanStep<Value, LeafFunction, CombineFunction, InverseFunction, Function>::global(std::size_t run) const {
+   std::size_t step = 2 * run * spacing;
+   if(slots[step / 2].node == NULL)
+      return;
+
+   const ScanRun<Value>& scanned = runs[run];
+   do {
+      ScanSlot<Value>& slot = slots[step / 2];
+      if(step % 2 == 0) {
+         slot.enter += scanned.offset;
+         slot.depth += scanned.depthOffset;
+         if(scanned.hasPrefix)
+            slot.prefix = (*combine)(scanned.prefix, slot.prefix);
+      }
+      else {
+         slot.exit += scanned.offset;
+      }
+
+      step = after(step);
+   } while(step != NO_SLOT && !starts(step));
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+template <class Value, class LeafFunction, class CombineFunction, class InverseFunction, class Function>
+std::size_t TreeParallel<T, Alloc>::ScanStep<Value, LeafFunction, CombineFunction, InverseFunction, Function>::after(std::size_t step) const {
+   const ScanSlot<Value>& slot = slots[step / 2];
+
+   // A node is followed by its first child, or exited if it is a leaf, and
+   // exiting it leads to its next sibling or back to its parent
+   if(step % 2 == 0)
+      return slot.first != NO_SLOT ? 2 * slot.first : step + 1;
+   if(step == 1)
+      return NO_SLOT;
+
+   return slot.next != NO_SLOT ? 2 * slot.next : 2 * slot.up + 1;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+template <class Value, class LeafFunction, class CombineFunction, class InverseFunction, class Function>
+bool TreeParallel<T, Alloc>::ScanStep<Value, LeafFunction, CombineFunction, InverseFunction, Function>::starts(std::size_t step) const {
+   return step % 2 == 0 && step / 2 % spacing == 0;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+template <class Algebra>
+void TreeParallel<T, Alloc>::ContractStep<Algebra>::operator()(std::size_t first, std::size_t last) const {
+   switch(phase) {
+      case RAKE:
+         for(std::size_t i = first; i < last; ++i)
+            rake(entry(i));
+         break;
+
+      case COMPRESS:
+         for(std::size_t i = first; i < last; ++i)
+            compress(entry(i));
+         break;
+
+      case COUNT:
+         for(std::size_t b = first; b < last; ++b) {
+            std::size_t count = 0;
+            for(std::size_t i = b * block; i < std::min((b + 1) * block, nLive); ++i) {
+               unsigned char kind = slots[entry(i)].fold.kind.load(std::memory_order_relaxed);
+               if(kind == CONTRACT_UNARY || kind == CONTRACT_BINARY)
+                  ++count;
+            }
+            offsets[b] = count;
+         }
+         break;
+
+      case SCATTER:
+         for(std::size_t b = first; b < last; ++b) {
+            std::size_t out = offsets[b];
+            for(std::size_t i = b * block; i < std::min((b + 1) * block, nLive); ++i) {
+               unsigned char kind = slots[entry(i)].fold.kind.load(std::memory_order_relaxed);
+               if(kind == CONTRACT_UNARY || kind == CONTRACT_BINARY)
+                  compacted[out++] = entry(i);
+            }
+         }
+         break;
+   }
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+template <class Algebra>
+std::size_t TreeParallel<T, Alloc>::ContractStep<Algebra>::entry(std::size_t i) const {
+   return live != NULL ? live[i] : i;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+template <class Algebra>
+const typename Algebra::Value* TreeParallel<T, Alloc>::ContractStep<Algebra>::known(std::size_t cell) const {
+   if(cell % 2 == 0)
+      return &slots[cell / 2].start;
+
+   // Cells that become leaves during the round may be read by their parents
+   // right away, but they are left for the next round so that every round
+   // does the same whatever the threads do
+   const ContractCell<Algebra>& fold = slots[cell / 2].fold;
+   if(fold.kind.load(std::memory_order_acquire) == CONTRACT_LEAF && fold.round < round)
+      return &fold.value;
+
+   return NULL;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+template <class Algebra>
+bool TreeParallel<T, Alloc>::ContractStep<Algebra>::heads(std::size_t slot) const {
+   unsigned long long h = (slot + 1) * 0x9E3779B97F4A7C15ULL ^ round * 0xC2B2AE3D27D4EB4FULL;
+   h ^= h >> 29;
+   h *= 0xBF58476D1CE4E5B9ULL;
+   return (h >> 32) & 1;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+template <class Algebra>
+void TreeParallel<T, Alloc>::ContractStep<Algebra>::rake(std::size_t slot) const {
+   ContractCell<Algebra>& fold = slots[slot].fold;
+   unsigned char kind = fold.kind.load(std::memory_order_relaxed);
+   if(kind != CONTRACT_UNARY && kind != CONTRACT_BINARY)
+      return;
+
+   const typename Algebra::Value* left = known(fold.left);
+   const typename Algebra::Value* right = kind == CONTRACT_BINARY ? known(fold.right) : NULL;
+
+   // The value is written before the kind, which is what the parent reads
+   if(kind == CONTRACT_UNARY) {
+      if(left == NULL)
+         return;
+
+      fold.value = algebra->apply(fold.function, *left);
+   }
+   else if(left != NULL && right != NULL) {
+      fold.value = algebra->fold(fold.node->_data.get(), *left, *right);
+   }
+   else {
+      if(left != NULL) {
+         fold.function = algebra->foldInto(fold.node->_data.get(), *left);
+         fold.left = fold.right;
+      }
+      else if(right != NULL) {
+         fold.function = algebra->foldChild(fold.node->_data.get(), *right);
+      }
+      else {
+         return;
+      }
+
+      fold.kind.store(CONTRACT_UNARY, std::memory_order_relaxed);
+      return;
+   }
+
+   fold.round = round;
+   fold.kind.store(CONTRACT_LEAF, std::memory_order_release);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+template <class Algebra>
+void TreeParallel<T, Alloc>::ContractStep<Algebra>::compress(std::size_t slot) const {
+   ContractCell<Algebra>& fold = slots[slot].fold;
+   if(fold.kind.load(std::memory_order_relaxed) != CONTRACT_UNARY || !heads(slot))
+      return;
+
+   // A fold that flips heads takes the place of its child if it flips tails,
+   // so every fold is merged at most once and nobody else touches the child
+   std::size_t cell = fold.left;
+   if(cell % 2 == 0 || heads(cell / 2))
+      return;
+
+   ContractCell<Algebra>& child = slots[cell / 2].fold;
+   if(child.kind.load(std::memory_order_relaxed) != CONTRACT_UNARY)
+      return;
+
+   fold.function = algebra->compose(fold.function, child.function);
+   fold.left = child.left;
+   child.kind.store(CONTRACT_DEAD, std::memory_order_relaxed);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+template <class Step>
+void TreeParallel<T, Alloc>::RangeTask<Step>::execute() {
+   RangeTask<Step> pieces[MAX_SPLITS];
+   TreeExecutor::Group group;
+   unsigned int nPieces = 0;
+
+   // The second half is given away while the range is worth splitting
+   while(last - first > grain && nPieces < MAX_SPLITS && executor->mayWait()) {
+      std::size_t middle = first + (last - first) / 2;
+      RangeTask<Step>& piece = pieces[nPieces++];
+      piece.step = step;
+      piece.executor = executor;
+      piece.grain = grain;
+      piece.first = middle;
+      piece.last = last;
+      executor->spawn(piece, group);
+
+      last = middle;
+   }
+
+   try {
+      (*step)(first, last);
+   }
+   catch(...) {
+      // The pieces live in this frame, they have to be done before leaving it
+      if(nPieces > 0) {
+         try {
+            executor->wait(group);
+         }
+         catch(...) {}
+      }
+      throw;
+   }
+
+   if(nPieces > 0)
+      executor->wait(group);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+template <class Job>
+void TreeParallel<T, Alloc>::WalkTask<Job>::execute() {
+   TreeParallel<T, Alloc>::walk(*walk, first, last, depth, partial);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+template <class Job>
+void TreeParallel<T, Alloc>::start(const TreeIterator<T, Alloc>& subtreeRoot, const Job& job, TreeParallelOrder order, bool deterministic,
+                                   typename Job::Partial& partial) const
+{
+   TreeCursor<T, Alloc> root(subtreeRoot);
+   if(root.atEnd())
+      return;
+
+   Walk<Job> settings = {&job, order, deterministic, _executor, _grain};
+   walk(settings, root._node, root._node, 0, partial);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+template <class Job>
+void TreeParallel<T, Alloc>::walk(const Walk<Job>& walk, TreeNode<T, Alloc>* first, TreeNode<T, Alloc>* last, unsigned int depth,
+                                  typename Job::Partial& partial)
+{
+   Split<Job> ranges[MAX_SPLITS];
+   Split<Job> points[MAX_SPLITS];
+   unsigned int nRanges = 0;
+   unsigned int nPoints = 0;
+
+   bool bottomUp = walk.order == TREE_BOTTOM_UP;
+   bool eager = walk.deterministic && depth < MAX_SPLIT_DEPTH;
+   std::size_t interval = SPLIT_INTERVAL;
+   std::size_t countdown = interval;
+
+   try {
+      for(TreeNode<T, Alloc>* root = first; root != NULL; root = root != last ? TreeCursor<T, Alloc>::nextSibling(root) : NULL) {
+         TreeCursor<T, Alloc> cursor(root, root);
+         if(bottomUp)
+            cursor.firstPostOrder();
+
+         while(!cursor.atEnd()) {
+            walk.job->visit(partial, cursor._node);
+
+            // Attempts to split that fail are spaced out, up to once per grain
+            if(--countdown == 0) {
+               bool attempt = walk.deterministic ? eager : walk.executor->hungry();
+               if(attempt && split(walk, cursor, root, last, depth, partial, ranges, nRanges, points, nPoints))
+                  interval = SPLIT_INTERVAL;
+               else if(interval < walk.grain)
+                  interval *= 2;
+
+               countdown = interval;
+            }
+
+            if(bottomUp)
+               cursor.nextPostOrder();
+            else
+               cursor.nextPreOrder();
+         }
+
+         // The cursor stops at the deepest node whose right siblings were given
+         // away, the ancestors of that node are visited once the nodes given
+         // away below each of them are done
+         if(bottomUp) {
+            for(TreeNode<T, Alloc>* node = cursor._boundary; node != root;) {
+               node = node->_parent;
+               while(nPoints > 0 && points[nPoints - 1].point->_parent == node)
+                  joinLast(walk, points, nPoints, partial);
+
+               walk.job->visit(partial, node);
+            }
+         }
+         // The right siblings given away come right after the subtree in
+         // pre-order, the deepest ones first
+         else if(Job::ORDERED) {
+            join(walk, points, nPoints, partial);
+         }
+      }
+
+      join(walk, points, nPoints, partial);
+      join(walk, ranges, nRanges, partial);
+   }
+   catch(...) {
+      // The tasks given away live in this frame, so they have to be done
+      // before leaving it
+      std::exception_ptr error = std::current_exception();
+      try {
+         join(walk, points, nPoints, partial);
+      }
+      catch(...) {}
+      try {
+         join(walk, ranges, nRanges, partial);
+      }
+      catch(...) {}
+
+      std::rethrow_exception(error);
+   }
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+template <class Job>
+bool TreeParallel<T, Alloc>::split(const Walk<Job>& walk, TreeCursor<T, Alloc>& cursor, TreeNode<T, Alloc>* root, TreeNode<T, Alloc>*& last, unsigned int depth,
+                                   const typename Job::Partial& partial, Split<Job>* ranges, unsigned int& nRanges, Split<Job>* points, unsigned int& nPoints)
+{
+   // The siblings of the range that haven't been started come first, they are
+   // the biggest pieces of work left
+   if(root != last && nRanges < MAX_SPLITS) {
+      std::size_t nLeft = 0;
+      for(TreeNode<T, Alloc>* node = root; node != last; node = TreeCursor<T, Alloc>::nextSibling(node))
+         ++nLeft;
+
+      // Keep the first half, give away the second one
+      TreeNode<T, Alloc>* keep = root;
+      for(std::size_t i = 0; i < nLeft / 2; ++i)
+         keep = TreeCursor<T, Alloc>::nextSibling(keep);
+
+      TreeNode<T, Alloc>* give = TreeCursor<T, Alloc>::nextSibling(keep);
+      if(count(give, last, walk.grain) >= walk.grain) {
+         Split<Job>& range = ranges[nRanges++];
+         range.task.first = give;
+         range.task.last = last;
+         range.point = NULL;
+         last = keep;
+
+         giveAway(walk, range, depth, partial);
+         return true;
+      }
+   }
+
+   // Otherwise, the right siblings of the highest node of the path that has
+   // any. Nothing is left to the right of the path above it, so the cursor can
+   // stop there
+   if(nPoints < MAX_SPLITS) {
+      TreeNode<T, Alloc>* point = NULL;
+      for(TreeNode<T, Alloc>* node = cursor._node; node != cursor._boundary; node = node->_parent) {
+         if(TreeCursor<T, Alloc>::nextSibling(node) != NULL)
+            point = node;
+      }
+
+      if(point != NULL) {
+         TreeNode<T, Alloc>* give = TreeCursor<T, Alloc>::nextSibling(point);
+         TreeNode<T, Alloc>* end = point->_parent->_children.back();
+         if(count(give, end, walk.grain) >= walk.grain) {
+            Split<Job>& piece = points[nPoints++];
+            piece.task.first = give;
+            piece.task.last = end;
+            piece.point = point;
+            cursor._boundary = point;
+
+            giveAway(walk, piece, depth, partial);
+            return true;
+         }
+      }
+   }
+
+   return false;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+template <class Job>
+void TreeParallel<T, Alloc>::giveAway(const Walk<Job>& walk, Split<Job>& piece, unsigned int depth, const typename Job::Partial& partial) {
+   piece.task.walk = &walk;
+   piece.task.depth = depth + 1;
+   piece.task.partial = typename Job::Partial();
+   walk.job->handOver(partial, piece.task.first, piece.task.partial);
+
+   // Deterministic traversals split even if the piece can't be handed over, so
+   // that the grouping of the results doesn't depend on the threads (that is
+   // why they stop splitting past MAX_SPLIT_DEPTH)
+   piece.spawned = walk.executor->mayWait();
+   if(piece.spawned)
+      walk.executor->spawn(piece.task, piece.group);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+template <class Step>
+void TreeParallel<T, Alloc>::forRange(std::size_t first, std::size_t last, std::size_t grain, const Step& step) const {
+   RangeTask<Step> task;
+   task.step = &step;
+   task.executor = _executor;
+   task.grain = grain;
+   task.first = first;
+   task.last = last;
+   task.execute();
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+std::size_t TreeParallel<T, Alloc>::count(TreeNode<T, Alloc>* first, TreeNode<T, Alloc>* last, std::size_t limit) {
+   std::size_t n = 0;
+   for(TreeNode<T, Alloc>* node = first; ; node = TreeCursor<T, Alloc>::nextSibling(node)) {
+      for(TreeCursor<T, Alloc> cursor(node, node); !cursor.atEnd(); cursor.nextPreOrder()) {
+         if(++n >= limit)
+            return limit;
+      }
+
+      if(node == last)
+         return n;
+   }
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+template <class Job>
+void TreeParallel<T, Alloc>::joinLast(const Walk<Job>& walk, Split<Job>* splits, unsigned int& nSplits, typename Job::Partial& partial) {
+   Split<Job>& piece = splits[--nSplits];
+   if(piece.spawned)
+      walk.executor->wait(piece.group);
+   else
+      piece.task.execute();
+
+   walk.job->append(partial, piece.task.partial);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+template <class Job>
+void TreeParallel<T, Alloc>::join(const Walk<Job>& walk, Split<Job>* splits, unsigned int& nSplits, typename Job::Partial& partial) {
+   std::exception_ptr error;
+   while(nSplits > 0) {
+      try {
+         joinLast(walk, splits, nSplits, partial);
+      }
+      catch(...) {
+         if(!error)
+            error = std::current_exception();
+      }
+   }
+
+   if(error)
+      std::rethrow_exception(error);
+}
+
+
+// *****************************************************************************
+//                             FUNCTION DEFINITIONS
+// *****************************************************************************
+
+
+template <class T, class Alloc, class Function>
+void parallelForEach(Tree<T, Alloc>& tree, Function function, TreeParallelOrder order) {
+   TreeParallel<T, Alloc>().forEach(tree.preBegin(), function, order);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc, class Function>
+void parallelForEach(TreeExecutor& executor, Tree<T, Alloc>& tree, Function function, TreeParallelOrder order) {
+   TreeParallel<T, Alloc>(executor).forEach(tree.preBegin(), function, order);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc, class LeafFunction, class CombineFunction>
+typename TreeParallel<T, Alloc>::template LeafResult<LeafFunction>::type parallelReduce(Tree<T, Alloc>& tree, LeafFunction leaf, CombineFunction combine,
+                                                                                          TreeReduceMode mode)
+{
+   return TreeParallel<T, Alloc>().reduce(tree.preBegin(), leaf, combine, mode);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc, class LeafFunction, class CombineFunction>
+typename TreeParallel<T, Alloc>::template LeafResult<LeafFunction>::type parallelReduce(TreeExecutor& executor, Tree<T, Alloc>& tree, LeafFunction leaf, CombineFunction combine,
+                                                                                          TreeReduceMode mode)
+{
+   return TreeParallel<T, Alloc>(executor).reduce(tree.preBegin(), leaf, combine, mode);
+}
+
+//______________________________________________________________________________
+
+template <class U, class T, class Alloc, class Function>
+Tree<U, typename TreeParallel<T, Alloc>::template TransformAllocator<U>::type> parallelTransform(Tree<T, Alloc>& tree, Function function) {
+   return TreeParallel<T, Alloc>().template transform<U>(tree.preBegin(), function);
+}
+
+//______________________________________________________________________________
+
+template <class U, class T, class Alloc, class Function>
+Tree<U, typename TreeParallel<T, Alloc>::template TransformAllocator<U>::type> parallelTransform(TreeExecutor& executor, Tree<T, Alloc>& tree, Function function) {
+   return TreeParallel<T, Alloc>(executor).template transform<U>(tree.preBegin(), function);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc, class Algebra>
+typename Algebra::Value parallelContract(Tree<T, Alloc>& tree, Algebra algebra) {
+   return TreeParallel<T, Alloc>().contract(tree.preBegin(), algebra);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc, class Algebra>
+typename Algebra::Value parallelContract(TreeExecutor& executor, Tree<T, Alloc>& tree, Algebra algebra) {
+   return TreeParallel<T, Alloc>(executor).contract(tree.preBegin(), algebra);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc, class LeafFunction, class CombineFunction, class InverseFunction, class Function>
+void parallelScan(Tree<T, Alloc>& tree, LeafFunction leaf, CombineFunction combine, InverseFunction inverse, Function function) {
+   TreeParallel<T, Alloc>().scan(tree.preBegin(), leaf, combine, inverse, function);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc, class LeafFunction, class CombineFunction, class InverseFunction, class Function>
+void parallelScan(TreeExecutor& executor, Tree<T, Alloc>& tree, LeafFunction leaf, CombineFunction combine, InverseFunction inverse, Function function) {
+   TreeParallel<T, Alloc>(executor).scan(tree.preBegin(), leaf, combine, inverse, function);
+}
+
+#endif
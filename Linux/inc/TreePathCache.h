@@ -0,0 +1,369 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version. This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details. You should have received a copy of the GNU
+ * General Public License along with this program; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ * USA.
+ *
+ * Copyright © 2011-2012 Francisco Aisa Garcia
+ */
+
+
+
+
+
+#ifndef __TREE_PATH_CACHE_H__
+#define __TREE_PATH_CACHE_H__
+
+#include "Tree.h"
+#include "TreeObserver.h"
+#include <cstddef>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+
+// *****************************************************************************
+// *****************************************************************************
+// *****************************************************************************
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                HEADER                                 ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// *****************************************************************************
+// *****************************************************************************
+// *****************************************************************************
+
+
+/**
+ * Cache of keys computed along the path from the root of a tree to each node
+ * (path strings, hashes of the path, accumulated transforms...).
+ *
+ * The key of a node is 'keyFunction(parentKey, data)', where 'parentKey' is the
+ * key of its parent ('rootParentKey' for the root) and 'data' is the payload of
+ * the node. Keys are computed on demand and memoized: asking for the key of a
+ * node only computes the keys of the ancestors that are not cached yet, so
+ * asking for the keys of many nodes that share most of their path costs O(1)
+ * per node once the common ancestors are cached.
+ *
+ * The cache observes the tree (see 'TreeObserver'), so the keys of a subtree are
+ * dropped when its nodes are erased, pruned, chopped, relaid out or get another
+ * path to the root. Other nodes keep their keys. Payloads modified through
+ * iterators are not noticed by the tree, so if a key depends on them, the
+ * subtree of the modified node must be invalidated by hand.
+ *
+ * Example:
+ * <pre>
+ *    TreePathCache<std::string, std::string> paths(tree, joinPath);
+ *    log << paths.get(it) << ...; // "/usr/local/bin"
+ * </pre>
+ *
+ * @author Francisco Aisa García
+ * @version 0.1
+ */
+template <class T, class Key, class Alloc = std::allocator<T> >
+class TreePathCache : public TreeObserver<T, Alloc> {
+   public:
+      // =======================================================================
+      //                               TYPEDEFS
+      // =======================================================================
+
+
+      typedef std::function<Key (const Key& parentKey, const T& data)> KeyFunction;
+
+
+      // =======================================================================
+      //                     CONSTRUCTORS AND DESTRUCTORS
+      // =======================================================================
+
+
+      /**
+       * Custom constructor.
+       *
+       * @param tree Tree whose paths are cached. The cache registers itself as
+       * an observer of the tree.
+       * @param keyFunction Function that computes the key of a node from the key
+       * of its parent and the data of the node.
+       * @param rootParentKey Key passed to the key function for the root.
+       */
+      TreePathCache(Tree<T, Alloc>& tree, const KeyFunction& keyFunction, const Key& rootParentKey = Key());
+
+      //________________________________________________________________________
+
+      /** Destructor. */
+      virtual ~TreePathCache();
+
+
+      // =======================================================================
+      //                            ELEMENT ACCESS
+      // =======================================================================
+
+
+      /**
+       * Get the key of a node, computing (and caching) the keys of the ancestors
+       * that are not cached yet.
+       *
+       * @param node Iterator to a node of the tree.
+       * @return The key of the node. The reference stays valid until the node
+       * is invalidated.
+       */
+      const Key& get(const TreeIterator<T, Alloc>& node);
+
+
+      // =======================================================================
+      //                               MODIFIERS
+      // =======================================================================
+
+
+      /**
+       * Drop the keys of every node of a subtree.
+       *
+       * @param subtreeRoot Iterator to the root of the subtree.
+       */
+      void invalidate(const TreeIterator<T, Alloc>& subtreeRoot);
+
+      //________________________________________________________________________
+
+      /** Drop every key. */
+      inline void clear();
+
+
+      // =======================================================================
+      //                               CAPACITY
+      // =======================================================================
+
+
+      /**
+       * Get the number of keys cached.
+       *
+       * @return The number of nodes whose key is cached.
+       */
+      inline std::size_t size() const;
+
+
+      // =======================================================================
+      //                             NOTIFICATIONS
+      // =======================================================================
+
+
+      /**
+       * Drop the keys of a subtree whose nodes are about to change.
+       *
+       * @param subtreeRoot Iterator to the root of the subtree.
+       */
+      virtual void subtreeChanging(const TreeIterator<T, Alloc>& subtreeRoot);
+
+      //________________________________________________________________________
+
+      /** Drop every key and forget about the tree. */
+      virtual void treeDestroyed();
+
+   private:
+      // =======================================================================
+      //                            PRIVATE METHODS
+      // =======================================================================
+
+
+      /**
+       * Copy constructor.
+       *
+       * It is left unimplemented on purpose, a cache is bound to its tree.
+       *
+       * @param source Source cache.
+       */
+      TreePathCache(const TreePathCache<T, Key, Alloc>& source);
+
+      //________________________________________________________________________
+
+      /**
+       * Assignment operator.
+       *
+       * It is left unimplemented on purpose, a cache is bound to its tree.
+       *
+       * @param rhs Right hand side cache.
+       * @return A reference to 'this' cache.
+       */
+      TreePathCache<T, Key, Alloc>& operator=(const TreePathCache<T, Key, Alloc>& rhs);
+
+
+      // =======================================================================
+      //                            PRIVATE FIELDS
+      // =======================================================================
+
+
+      /** Observed tree, NULL once it has been destroyed. */
+      Tree<T, Alloc>* _tree;
+
+      //________________________________________________________________________
+
+      /** Function that computes the key of a node. */
+      KeyFunction _keyFunction;
+
+      //________________________________________________________________________
+
+      /** Key passed to the key function for the root. */
+      Key _rootParentKey;
+
+      //________________________________________________________________________
+
+      /** Cached keys, indexed by the address of the payload of each node. */
+      std::unordered_map<const T*, Key> _keys;
+
+      //________________________________________________________________________
+
+      /** Nodes whose key has to be computed (kept to avoid allocating on each miss). */
+      std::vector<const T*> _path;
+};
+
+
+// *****************************************************************************
+// *****************************************************************************
+// *****************************************************************************
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                            IMPLEMENTATION                             ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// *****************************************************************************
+// *****************************************************************************
+// *****************************************************************************
+
+
+template <class T, class Key, class Alloc>
+TreePathCache<T, Key, Alloc>::TreePathCache(Tree<T, Alloc>& tree, const KeyFunction& keyFunction, const Key& rootParentKey) :
+   _tree(&tree),
+   _keyFunction(keyFunction),
+   _rootParentKey(rootParentKey)
+{
+   tree.addObserver(*this);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Key, class Alloc>
+TreePathCache<T, Key, Alloc>::~TreePathCache() {
+   if(_tree != NULL)
+      _tree->removeObserver(*this);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Key, class Alloc>
+const Key& TreePathCache<T, Key, Alloc>::get(const TreeIterator<T, Alloc>& node) {
+   typename std::unordered_map<const T*, Key>::iterator found = _keys.find(&*node);
+   if(found != _keys.end())
+      return found->second;
+
+   // Climb until a node whose key is known is found (or the root is left behind)
+   _path.clear();
+   _path.push_back(&*node);
+   const Key* key = &_rootParentKey;
+
+   TreeRange<typename Tree<T, Alloc>::AncestorIterator> path = _tree->ancestors(node);
+   for(typename Tree<T, Alloc>::AncestorIterator it = path.begin(); it != path.end(); ++it) {
+      found = _keys.find(&*it);
+      if(found != _keys.end()) {
+         key = &found->second;
+         break;
+      }
+
+      _path.push_back(&*it);
+   }
+
+   // Compute the keys on the way down. The elements of an unordered map don't
+   // move when it grows, so 'key' remains valid
+   for(std::size_t i = _path.size(); i > 0; --i)
+      key = &(_keys.insert(std::make_pair(_path[i - 1], _keyFunction(*key, *_path[i - 1]))).first->second);
+
+   return *key;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Key, class Alloc>
+void TreePathCache<T, Key, Alloc>::invalidate(const TreeIterator<T, Alloc>& subtreeRoot) {
+   if(_keys.empty())
+      return;
+
+   // Dropping the keys of the whole tree is cheaper than looking them up
+   if(subtreeRoot == _tree->preBegin()) {
+      _keys.clear();
+      return;
+   }
+
+   TreeRange<typename Tree<T, Alloc>::PreOrderIterator> subtree = _tree->preorder(subtreeRoot);
+   for(typename Tree<T, Alloc>::PreOrderIterator it = subtree.begin(); it != subtree.end(); ++it) {
+      // A node whose key isn't cached can't have descendants with a cached key
+      if(_keys.erase(&*it) == 0)
+         it.skipChildren();
+   }
+}
+
+//______________________________________________________________________________
+
+template <class T, class Key, class Alloc>
+void TreePathCache<T, Key, Alloc>::clear() {
+   _keys.clear();
+}
+
+//______________________________________________________________________________
+
+template <class T, class Key, class Alloc>
+std::size_t TreePathCache<T, Key, Alloc>::size() const {
+   return _keys.size();
+}
+
+//______________________________________________________________________________
+
+template <class T, class Key, class Alloc>
+void TreePathCache<T, Key, Alloc>::subtreeChanging(const TreeIterator<T, Alloc>& subtreeRoot) {
+   invalidate(subtreeRoot);
+}
+
+//______________________________________________________________________________
+
+template <class T, class Key, class Alloc>
+void TreePathCache<T, Key, Alloc>::treeDestroyed() {
+   _keys.clear();
+   _tree = NULL;
+}
+
+#endif
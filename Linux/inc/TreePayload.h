@@ -0,0 +1,477 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version. This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details. You should have received a copy of the GNU
+ * General Public License along with this program; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ * USA.
+ *
+ * Copyright © 2011-2012 Francisco Aisa Garcia
+ */
+
+
+
+#ifndef __TREE_PAYLOAD_H__
+#define __TREE_PAYLOAD_H__
+
+#include "TreeLayoutTraits.h"
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+
+// *****************************************************************************
+// *****************************************************************************
+// *****************************************************************************
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                HEADER                                 ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// *****************************************************************************
+// *****************************************************************************
+// *****************************************************************************
+
+
+/**
+ * Payload of a tree node, stored inline.
+ *
+ * The value lives inside the node. This is the layout used unless
+ * 'TreeLayoutTraits<T>::coldPayload' is 'true' (see the specialization below).
+ *
+ * Payloads are never copied, only moved from one node to another (see
+ * Tree::relayout()). Moving falls back to a copy of the value when moving
+ * 'T' may throw.
+ *
+ * @author Francisco Aisa García
+ * @version 0.1
+ */
+template <class T, class Alloc, bool Cold = TreeLayoutTraits<T>::coldPayload>
+class TreePayload {
+   public:
+      // =======================================================================
+      //                     CONSTRUCTORS AND DESTRUCTORS
+      // =======================================================================
+
+
+      /**
+       * Default constructor.
+       * @param alloc Allocator of the tree (unused).
+       */
+      inline explicit TreePayload(const Alloc& alloc);
+
+      //________________________________________________________________________
+
+      /**
+       * Custom constructor.
+       * @param data Value to be copied into the payload.
+       * @param alloc Allocator of the tree (unused).
+       */
+      inline TreePayload(const T& data, const Alloc& alloc);
+
+      //________________________________________________________________________
+
+      /**
+       * Move constructor.
+       * @param source Payload whose value is going to be moved.
+       */
+      inline TreePayload(TreePayload<T, Alloc, Cold>&& source) noexcept(std::is_nothrow_move_constructible<T>::value);
+
+
+      // =======================================================================
+      //                               OPERATORS
+      // =======================================================================
+
+
+      /**
+       * Move assignment operator.
+       * @param source Payload whose value is going to be moved.
+       * @return A reference to *this.
+       */
+      inline TreePayload<T, Alloc, Cold>& operator=(TreePayload<T, Alloc, Cold>&& source);
+
+
+      // =======================================================================
+      //                            ELEMENT ACCESS
+      // =======================================================================
+
+
+      /**
+       * Get the value of the payload.
+       * @return A reference to the value.
+       */
+      inline T& get();
+
+      //________________________________________________________________________
+
+      /**
+       * Get the value of the payload.
+       * @return A const reference to the value.
+       */
+      inline const T& get() const;
+
+
+      // =======================================================================
+      //                               MODIFIERS
+      // =======================================================================
+
+
+      /**
+       * Release the resources held by the payload. Called by the node right
+       * before being destroyed.
+       * @param alloc Allocator of the tree (unused).
+       */
+      inline void release(const Alloc& alloc);
+
+      //________________________________________________________________________
+
+      /**
+       * Run the destructor of the value without giving any memory back. Used
+       * when the memory of the tree is released in bulk, in which case the
+       * node is never destroyed.
+       */
+      inline void destroyInPlace();
+
+   private:
+      // =======================================================================
+      //                       NON IMPLEMENTED FUNCTIONS
+      // =======================================================================
+
+
+      TreePayload(const TreePayload<T, Alloc, Cold>& source);
+      TreePayload<T, Alloc, Cold>& operator=(const TreePayload<T, Alloc, Cold>& source);
+
+
+      // =======================================================================
+      //                            PRIVATE FIELDS
+      // =======================================================================
+
+
+      /** Value stored in the node. */
+      T _data;
+};
+
+//______________________________________________________________________________
+
+/**
+ * Payload of a tree node, stored apart from the node.
+ *
+ * The node only holds a pointer to the value, which is allocated through the
+ * allocator of the tree when the node is created and given back when the node
+ * is destroyed. Moving the payload from one node to another just hands over the
+ * pointer, the value itself stays where it is.
+ *
+ * @author Francisco Aisa García
+ * @version 0.1
+ */
+template <class T, class Alloc>
+class TreePayload<T, Alloc, true> {
+   public:
+      // =======================================================================
+      //                              TYPEDEFS
+      // =======================================================================
+
+
+      /** Allocator used by the value (rebound from 'Alloc'). */
+      typedef typename std::allocator_traits<Alloc>::template rebind_alloc<T> ValueAllocator;
+
+      /** Traits of the allocator used by the value. */
+      typedef std::allocator_traits<ValueAllocator> ValueAllocatorTraits;
+
+
+      // =======================================================================
+      //                     CONSTRUCTORS AND DESTRUCTORS
+      // =======================================================================
+
+
+      /**
+       * Default constructor.
+       * @param alloc Allocator used to allocate the value.
+       * @throws std::bad_alloc Thrown if memory allocation fails.
+       */
+      inline explicit TreePayload(const Alloc& alloc);
+
+      //________________________________________________________________________
+
+      /**
+       * Custom constructor.
+       * @param data Value to be copied into the payload.
+       * @param alloc Allocator used to allocate the value.
+       * @throws std::bad_alloc Thrown if memory allocation fails.
+       */
+      inline TreePayload(const T& data, const Alloc& alloc);
+
+      //________________________________________________________________________
+
+      /**
+       * Move constructor. The source is left empty.
+       * @param source Payload whose value is going to be taken.
+       */
+      inline TreePayload(TreePayload<T, Alloc, true>&& source) noexcept;
+
+
+      // =======================================================================
+      //                               OPERATORS
+      // =======================================================================
+
+
+      /**
+       * Move assignment operator. The values of both payloads are swapped.
+       * @param source Payload whose value is going to be taken.
+       * @return A reference to *this.
+       */
+      inline TreePayload<T, Alloc, true>& operator=(TreePayload<T, Alloc, true>&& source) noexcept;
+
+
+      // =======================================================================
+      //                            ELEMENT ACCESS
+      // =======================================================================
+
+
+      /**
+       * Get the value of the payload.
+       * @return A reference to the value.
+       */
+      inline T& get();
+
+      //________________________________________________________________________
+
+      /**
+       * Get the value of the payload.
+       * @return A const reference to the value.
+       */
+      inline const T& get() const;
+
+
+      // =======================================================================
+      //                               MODIFIERS
+      // =======================================================================
+
+
+      /**
+       * Destroy the value and give its memory back. Called by the node right
+       * before being destroyed.
+       * @param alloc Allocator the value was allocated with.
+       */
+      inline void release(const Alloc& alloc);
+
+      //________________________________________________________________________
+
+      /**
+       * Run the destructor of the value without giving any memory back. Used
+       * when the memory of the tree is released in bulk, in which case the
+       * node is never destroyed.
+       */
+      inline void destroyInPlace();
+
+   private:
+      // =======================================================================
+      //                       NON IMPLEMENTED FUNCTIONS
+      // =======================================================================
+
+
+      TreePayload(const TreePayload<T, Alloc, true>& source);
+      TreePayload<T, Alloc, true>& operator=(const TreePayload<T, Alloc, true>& source);
+
+
+      // =======================================================================
+      //                            PRIVATE FIELDS
+      // =======================================================================
+
+
+      /** Pointer to the value, NULL if the payload has been moved. */
+      T* _data;
+};
+
+
+// *****************************************************************************
+// *****************************************************************************
+// *****************************************************************************
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                            IMPLEMENTATION                             ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// *****************************************************************************
+// *****************************************************************************
+// *****************************************************************************
+
+
+template <class T, class Alloc, bool Cold>
+TreePayload<T, Alloc, Cold>::TreePayload(const Alloc& alloc) : _data() {
+   // Nothing to do
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc, bool Cold>
+TreePayload<T, Alloc, Cold>::TreePayload(const T& data, const Alloc& alloc) : _data(data) {
+   // Nothing to do
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc, bool Cold>
+TreePayload<T, Alloc, Cold>::TreePayload(TreePayload<T, Alloc, Cold>&& source) noexcept(std::is_nothrow_move_constructible<T>::value) :
+   _data(std::move_if_noexcept(source._data))
+{
+   // Nothing to do
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc, bool Cold>
+TreePayload<T, Alloc, Cold>& TreePayload<T, Alloc, Cold>::operator=(TreePayload<T, Alloc, Cold>&& source) {
+   _data = std::move_if_noexcept(source._data);
+
+   return *this;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc, bool Cold>
+T& TreePayload<T, Alloc, Cold>::get() {
+   return _data;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc, bool Cold>
+const T& TreePayload<T, Alloc, Cold>::get() const {
+   return _data;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc, bool Cold>
+void TreePayload<T, Alloc, Cold>::release(const Alloc& alloc) {
+   // Nothing to do, the value is destroyed along with the node
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc, bool Cold>
+void TreePayload<T, Alloc, Cold>::destroyInPlace() {
+   _data.~T();
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+TreePayload<T, Alloc, true>::TreePayload(const Alloc& alloc) {
+   ValueAllocator valueAlloc(alloc);
+   _data = ValueAllocatorTraits::allocate(valueAlloc, 1);
+
+   try {
+      ValueAllocatorTraits::construct(valueAlloc, _data);
+   }
+   catch(...) {
+      ValueAllocatorTraits::deallocate(valueAlloc, _data, 1);
+      throw;
+   }
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+TreePayload<T, Alloc, true>::TreePayload(const T& data, const Alloc& alloc) {
+   ValueAllocator valueAlloc(alloc);
+   _data = ValueAllocatorTraits::allocate(valueAlloc, 1);
+
+   try {
+      ValueAllocatorTraits::construct(valueAlloc, _data, data);
+   }
+   catch(...) {
+      ValueAllocatorTraits::deallocate(valueAlloc, _data, 1);
+      throw;
+   }
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+TreePayload<T, Alloc, true>::TreePayload(TreePayload<T, Alloc, true>&& source) noexcept : _data(source._data) {
+   source._data = NULL;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+TreePayload<T, Alloc, true>& TreePayload<T, Alloc, true>::operator=(TreePayload<T, Alloc, true>&& source) noexcept {
+   std::swap(_data, source._data);
+
+   return *this;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+T& TreePayload<T, Alloc, true>::get() {
+   return *_data;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+const T& TreePayload<T, Alloc, true>::get() const {
+   return *_data;
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+void TreePayload<T, Alloc, true>::release(const Alloc& alloc) {
+   if(_data != NULL) {
+      ValueAllocator valueAlloc(alloc);
+      ValueAllocatorTraits::destroy(valueAlloc, _data);
+      ValueAllocatorTraits::deallocate(valueAlloc, _data, 1);
+      _data = NULL;
+   }
+}
+
+//______________________________________________________________________________
+
+template <class T, class Alloc>
+void TreePayload<T, Alloc, true>::destroyInPlace() {
+   if(_data != NULL)
+      _data->~T();
+}
+
+#endif
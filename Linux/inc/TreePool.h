@@ -0,0 +1,362 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version. This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details. You should have received a copy of the GNU
+ * General Public License along with this program; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ * USA.
+ *
+ * Copyright © 2011-2012 Francisco Aisa Garcia
+ */
+
+
+#ifndef __TREE_POOL_H__
+#define __TREE_POOL_H__
+
+#include <cstddef>
+#include <new>
+
+/**
+ * Pool of recycled memory blocks meant to hold the nodes of trees that are
+ * constantly changing (erase(), chop() and pushBackChild() at a high rate,
+ * while the size of the tree stays more or less the same).
+ *
+ * Blocks given back to the pool aren't deallocated, they are kept in a free
+ * list (one per size class) so that the next allocation of the same size can
+ * reuse them without going back to the system. The number of blocks that the
+ * pool may keep is bounded by a cap, and shrink() gives every block kept back
+ * to the system.
+ *
+ * Every block is allocated with the global operator new, which means that a
+ * block allocated by one pool can be safely given back to any other pool.
+ * Blocks that need more alignment than the global operator new gives by
+ * default are allocated with its aligned form and never recycled. The
+ * pool is not thread safe, use one per tree or the one that each thread owns
+ * (see local()).
+ *
+ * It is meant to be used through 'TreePoolAllocator'.
+ *
+ * @author Francisco Aisa García
+ * @version 0.1
+ */
+class TreePool {
+   public:
+      // =======================================================================
+      //                     CONSTRUCTORS AND DESTRUCTORS
+      // =======================================================================
+
+
+      /**
+       * Custom constructor.
+       *
+       * @param cap Maximum number of blocks that the pool may keep.
+       */
+      explicit TreePool(std::size_t cap = 64 * 1024);
+
+      //________________________________________________________________________
+
+      /** Destructor. It gives every block kept back to the system. */
+      ~TreePool();
+
+
+      // =======================================================================
+      //                               MODIFIERS
+      // =======================================================================
+
+
+      /**
+       * Allocate a block, reusing a recycled one if possible.
+       *
+       * @param size Size in bytes of the block.
+       * @param alignment Alignment of the block (power of two).
+       * @return A pointer to the block.
+       * @throws std::bad_alloc Thrown if memory allocation fails.
+       */
+      void* allocate(std::size_t size, std::size_t alignment = alignof(std::max_align_t));
+
+      //________________________________________________________________________
+
+      /**
+       * Give a block back to the pool.
+       *
+       * The block is kept for later reuse unless the pool is full, in which
+       * case it is deallocated.
+       *
+       * @param block Block to be given back.
+       * @param size Size in bytes of the block.
+       * @param alignment Alignment the block was allocated with.
+       */
+      void deallocate(void* block, std::size_t size, std::size_t alignment = alignof(std::max_align_t));
+
+      //________________________________________________________________________
+
+      /** Give every block kept by the pool back to the system. */
+      void shrink();
+
+      //________________________________________________________________________
+
+      /**
+       * Set the maximum number of blocks that the pool may keep.
+       *
+       * If the pool is keeping more blocks than the new cap, the extra ones are
+       * given back to the system.
+       *
+       * @param cap Maximum number of blocks.
+       */
+      void setCap(std::size_t cap);
+
+      //________________________________________________________________________
+
+      /** Reset the counters of the pool. */
+      inline void resetCounters();
+
+
+      // =======================================================================
+      //                               CAPACITY
+      // =======================================================================
+
+
+      /**
+       * Get the maximum number of blocks that the pool may keep.
+       *
+       * @return The cap of the pool.
+       */
+      inline std::size_t cap() const;
+
+      //________________________________________________________________________
+
+      /**
+       * Get how many blocks the pool is keeping.
+       *
+       * @return Number of blocks in the free lists.
+       */
+      inline std::size_t nFree() const;
+
+      //________________________________________________________________________
+
+      /**
+       * Get how many blocks have been requested to the pool.
+       *
+       * @return Number of calls to allocate().
+       */
+      inline std::size_t nAllocations() const;
+
+      //________________________________________________________________________
+
+      /**
+       * Get how many blocks have been served from the free lists.
+       *
+       * @return Number of allocations that didn't have to go to the system.
+       */
+      inline std::size_t nReused() const;
+
+      //________________________________________________________________________
+
+      /**
+       * Get how many blocks have been kept for later reuse.
+       *
+       * @return Number of calls to deallocate() that didn't give the block back
+       * to the system.
+       */
+      inline std::size_t nRecycled() const;
+
+      //________________________________________________________________________
+
+      /**
+       * Get the fraction of allocations that have been served from the free lists.
+       *
+       * @return A value between 0 and 1 (0 if nothing has been allocated).
+       */
+      inline double reuseRate() const;
+
+
+      // =======================================================================
+      //                            ELEMENT ACCESS
+      // =======================================================================
+
+
+      /**
+       * Get the pool owned by the calling thread.
+       *
+       * @return A reference to the pool of the calling thread.
+       */
+      static TreePool& local();
+
+      //________________________________________________________________________
+
+      /**
+       * Allocate a block from the pool of the calling thread.
+       *
+       * Once the pool of the thread has been destroyed (while the thread ends),
+       * blocks come straight from the system.
+       *
+       * @param size Size in bytes of the block.
+       * @param alignment Alignment of the block (power of two).
+       * @return A pointer to the block.
+       * @throws std::bad_alloc Thrown if memory allocation fails.
+       */
+      static void* allocateLocal(std::size_t size, std::size_t alignment = alignof(std::max_align_t));
+
+      //________________________________________________________________________
+
+      /**
+       * Give a block back to the pool of the calling thread.
+       *
+       * Once the pool of the thread has been destroyed (while the thread ends),
+       * blocks go straight back to the system.
+       *
+       * @param block Block to be given back.
+       * @param size Size in bytes of the block.
+       * @param alignment Alignment the block was allocated with.
+       */
+      static void deallocateLocal(void* block, std::size_t size, std::size_t alignment = alignof(std::max_align_t));
+
+   private:
+      // =======================================================================
+      //                            PRIVATE TYPES
+      // =======================================================================
+
+
+      /** A recycled block, linked to the rest of blocks of its size class. */
+      struct FreeBlock {
+         FreeBlock* next;
+      };
+
+
+      // =======================================================================
+      //                           PRIVATE CONSTANTS
+      // =======================================================================
+
+
+      /** Granularity of the size classes in bytes. */
+      static const std::size_t GRANULARITY = 16;
+
+      /** Number of size classes. Bigger blocks aren't recycled. */
+      static const std::size_t N_CLASSES = 16;
+
+
+      // =======================================================================
+      //                            PRIVATE METHODS
+      // =======================================================================
+
+
+      /**
+       * The copy constructor and the operator= haven't been implemented because
+       * allocators keep pointers to the pool they allocate from.
+       */
+      TreePool(const TreePool& source);
+      TreePool& operator=(const TreePool& rhs);
+
+      //________________________________________________________________________
+
+      /**
+       * Get the size class of a block.
+       *
+       * @param size Size in bytes of the block.
+       * @return Index of the size class, N_CLASSES if the block is too big to
+       * be recycled.
+       */
+      inline static std::size_t sizeClass(std::size_t size);
+
+      //________________________________________________________________________
+
+      /**
+       * Give blocks back to the system until the pool keeps at most 'n' of them.
+       *
+       * @param n Number of blocks that the pool may keep.
+       */
+      void trim(std::size_t n);
+
+
+      // =======================================================================
+      //                            PRIVATE FIELDS
+      // =======================================================================
+
+
+      /** Free lists, one per size class. */
+      FreeBlock* _free[N_CLASSES];
+
+      //________________________________________________________________________
+
+      /** Maximum number of blocks that the pool may keep. */
+      std::size_t _cap;
+
+      //________________________________________________________________________
+
+      /** Number of blocks kept. */
+      std::size_t _nFree;
+
+      //________________________________________________________________________
+
+      /** Number of calls to allocate(). */
+      std::size_t _nAllocations;
+
+      //________________________________________________________________________
+
+      /** Number of allocations served from the free lists. */
+      std::size_t _nReused;
+
+      //________________________________________________________________________
+
+      /** Number of blocks kept for later reuse. */
+      std::size_t _nRecycled;
+};
+
+
+// *****************************************************************************
+//                            INLINE IMPLEMENTATION
+// *****************************************************************************
+
+
+inline void TreePool::resetCounters() {
+   _nAllocations = _nReused = _nRecycled = 0;
+}
+
+//______________________________________________________________________________
+
+inline std::size_t TreePool::cap() const {
+   return _cap;
+}
+
+//______________________________________________________________________________
+
+inline std::size_t TreePool::nFree() const {
+   return _nFree;
+}
+
+//______________________________________________________________________________
+
+inline std::size_t TreePool::nAllocations() const {
+   return _nAllocations;
+}
+
+//______________________________________________________________________________
+
+inline std::size_t TreePool::nReused() const {
+   return _nReused;
+}
+
+//______________________________________________________________________________
+
+inline std::size_t TreePool::nRecycled() const {
+   return _nRecycled;
+}
+
+//______________________________________________________________________________
+
+inline double TreePool::reuseRate() const {
+   return _nAllocations == 0 ? 0.0 : static_cast<double>(_nReused) / _nAllocations;
+}
+
+//______________________________________________________________________________
+
+inline std::size_t TreePool::sizeClass(std::size_t size) {
+   std::size_t index = (size + GRANULARITY - 1) / GRANULARITY;
+   return index == 0 || index > N_CLASSES ? N_CLASSES : index - 1;
+}
+
+#endif
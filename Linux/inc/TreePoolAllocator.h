@@ -0,0 +1,308 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version. This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details. You should have received a copy of the GNU
+ * General Public License along with this program; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ * USA.
+ *
+ * Copyright © 2011-2012 Francisco Aisa Garcia
+ */
+
+
+#ifndef __TREE_POOL_ALLOCATOR_H__
+#define __TREE_POOL_ALLOCATOR_H__
+
+#include "TreePool.h"
+#include <cstddef>
+#include <type_traits>
+
+
+// *****************************************************************************
+// *****************************************************************************
+// *****************************************************************************
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                HEADER                                 ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// *****************************************************************************
+// *****************************************************************************
+// *****************************************************************************
+
+
+/**
+ * Allocator that recycles memory through a 'TreePool'.
+ *
+ * A tree declared as 'Tree< T, TreePoolAllocator<T> >' gives its nodes (and
+ * the slots of its children lists) back to the pool when they are erased or
+ * chopped, and takes them back from the pool when new nodes are inserted. By
+ * default, every allocation and deallocation uses the pool owned by the thread
+ * that makes it (see TreePool::local()), so a tree can be built on one thread
+ * and changed or destroyed on another. A pool can also be given to each tree to
+ * keep free lists per tree; since pools aren't thread safe, such a tree MUST
+ * only be changed by one thread at a time, and the pool MUST outlive it.
+ *
+ * Because every block of a pool comes from the global operator new, memory
+ * allocated by one pool can be given back to any other pool. Hence, all the
+ * pool allocators compare equal and trees can be grafted into each other
+ * without copying nodes, regardless of the pools that they use.
+ *
+ * @author Francisco Aisa García
+ * @version 0.1
+ */
+template <class T>
+class TreePoolAllocator {
+   public:
+      // =======================================================================
+      //                              TYPEDEFS
+      // =======================================================================
+
+
+      typedef T value_type;
+      typedef T* pointer;
+      typedef const T* const_pointer;
+      typedef std::size_t size_type;
+      typedef std::ptrdiff_t difference_type;
+      typedef std::true_type is_always_equal;
+
+      template <class U>
+      struct rebind {
+         typedef TreePoolAllocator<U> other;
+      };
+
+
+      // =======================================================================
+      //                     CONSTRUCTORS AND DESTRUCTORS
+      // =======================================================================
+
+
+      /**
+       * Default constructor.
+       *
+       * The allocator uses the pool of whichever thread allocates or
+       * deallocates.
+       */
+      inline TreePoolAllocator();
+
+      //________________________________________________________________________
+
+      /**
+       * Custom constructor.
+       *
+       * @param pool Pool from which memory is going to be taken.
+       */
+      inline TreePoolAllocator(TreePool& pool);
+
+      //________________________________________________________________________
+
+      /**
+       * Conversion constructor.
+       *
+       * @param source Allocator (of any type) whose pool is going to be used.
+       */
+      template <class U>
+      inline TreePoolAllocator(const TreePoolAllocator<U>& source);
+
+
+      // =======================================================================
+      //                               OPERATORS
+      // =======================================================================
+
+
+      /**
+       * Equality operator.
+       *
+       * @param rhs Right hand side allocator to be compared.
+       * @return Always 'true', pools can deallocate each other's memory.
+       */
+      template <class U>
+      inline bool operator==(const TreePoolAllocator<U>& rhs) const;
+
+      //________________________________________________________________________
+
+      /**
+       * Inequality operator.
+       *
+       * @param rhs Right hand side allocator to be compared.
+       * @return Always 'false', pools can deallocate each other's memory.
+       */
+      template <class U>
+      inline bool operator!=(const TreePoolAllocator<U>& rhs) const;
+
+
+      // =======================================================================
+      //                               MODIFIERS
+      // =======================================================================
+
+
+      /**
+       * Allocate memory for 'n' objects.
+       *
+       * @param n Number of objects.
+       * @return A pointer to uninitialized memory.
+       * @throws std::bad_alloc Thrown if memory allocation fails.
+       */
+      inline T* allocate(std::size_t n);
+
+      //________________________________________________________________________
+
+      /**
+       * Give the memory of 'n' objects back to the pool.
+       *
+       * @param p Pointer to the memory.
+       * @param n Number of objects.
+       */
+      inline void deallocate(T* p, std::size_t n);
+
+
+      // =======================================================================
+      //                            ELEMENT ACCESS
+      // =======================================================================
+
+
+      /**
+       * Get the pool used by the allocator.
+       *
+       * @return A reference to the pool given in the constructor, or to the pool
+       * of the calling thread if none was given.
+       */
+      inline TreePool& pool() const;
+
+   private:
+      // =======================================================================
+      //                            FRIEND CLASSES
+      // =======================================================================
+
+
+      template <class U>
+      friend class TreePoolAllocator;
+
+
+      // =======================================================================
+      //                            PRIVATE FIELDS
+      // =======================================================================
+
+
+      /** Pool from which memory is taken, NULL for the pool of each thread. */
+      TreePool* _pool;
+};
+
+
+// *****************************************************************************
+// *****************************************************************************
+// *****************************************************************************
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                            IMPLEMENTATION                             ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// *****************************************************************************
+// *****************************************************************************
+// *****************************************************************************
+
+
+template <class T>
+TreePoolAllocator<T>::TreePoolAllocator() : _pool(NULL) {
+   // Nothing to do
+}
+
+//______________________________________________________________________________
+
+template <class T>
+TreePoolAllocator<T>::TreePoolAllocator(TreePool& pool) : _pool(&pool) {
+   // Nothing to do
+}
+
+//______________________________________________________________________________
+
+template <class T>
+template <class U>
+TreePoolAllocator<T>::TreePoolAllocator(const TreePoolAllocator<U>& source) : _pool(source._pool) {
+   // Nothing to do
+}
+
+//______________________________________________________________________________
+
+template <class T>
+template <class U>
+bool TreePoolAllocator<T>::operator==(const TreePoolAllocator<U>& rhs) const {
+   return true;
+}
+
+//______________________________________________________________________________
+
+template <class T>
+template <class U>
+bool TreePoolAllocator<T>::operator!=(const TreePoolAllocator<U>& rhs) const {
+   return false;
+}
+
+//______________________________________________________________________________
+
+template <class T>
+T* TreePoolAllocator<T>::allocate(std::size_t n) {
+#if !defined(__cpp_aligned_new)
+   static_assert(alignof(T) <= alignof(std::max_align_t), "Over-aligned types need the aligned operator new of C++17");
+#endif
+
+   if(_pool == NULL)
+      return static_cast<T*>(TreePool::allocateLocal(n * sizeof(T), alignof(T)));
+
+   return static_cast<T*>(_pool->allocate(n * sizeof(T), alignof(T)));
+}
+
+//______________________________________________________________________________
+
+template <class T>
+void TreePoolAllocator<T>::deallocate(T* p, std::size_t n) {
+   if(_pool == NULL)
+      TreePool::deallocateLocal(p, n * sizeof(T), alignof(T));
+   else
+      _pool->deallocate(p, n * sizeof(T), alignof(T));
+}
+
+//______________________________________________________________________________
+
+template <class T>
+TreePool& TreePoolAllocator<T>::pool() const {
+   return _pool != NULL ? *_pool : TreePool::local();
+}
+
+#endif
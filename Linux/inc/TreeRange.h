@@ -0,0 +1,221 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version. This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details. You should have received a copy of the GNU
+ * General Public License along with this program; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ * USA.
+ *
+ * Copyright © 2011-2012 Francisco Aisa Garcia
+ */
+
+
+
+#ifndef __TREE_RANGE_H__
+#define __TREE_RANGE_H__
+
+#if __cplusplus > 201703L
+#include <ranges>
+#endif
+
+
+// *****************************************************************************
+// *****************************************************************************
+// *****************************************************************************
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                HEADER                                 ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// *****************************************************************************
+// *****************************************************************************
+// *****************************************************************************
+
+
+/**
+ * Pair of iterators that delimits a traversal, so it can be used in a range
+ * based for loop.
+ *
+ * Ranges are returned by Tree::preorder() and Tree::postorder(). The iterators
+ * of a tree stop by themselves when they leave the subtree they were built
+ * from, so the end of a range over a subtree is just the end of the tree and
+ * walking it costs as much as visiting the nodes of the subtree.
+ *
+ * A range doesn't own any node, it is just a view of the tree: copying it costs
+ * as much as copying its iterators and its iterators remain valid after the range
+ * is gone. When compiled as C++20, it models std::ranges::view (and borrowed_range),
+ * so it can be composed lazily with the adaptors of <ranges>, e.g.
+ * 'tree.preorder() | std::views::filter(f) | std::views::transform(g)'.
+ *
+ * @author Francisco Aisa García
+ * @version 0.1
+ */
+template <class Iterator>
+class TreeRange {
+   public:
+      // =======================================================================
+      //                     CONSTRUCTORS AND DESTRUCTORS
+      // =======================================================================
+
+
+      /**
+       * Default constructor.
+       *
+       * It builds an empty range.
+       */
+      inline TreeRange();
+
+      //________________________________________________________________________
+
+      /**
+       * Custom constructor.
+       *
+       * @param first Iterator to the first node of the traversal.
+       * @param last Iterator that marks the end of the traversal.
+       */
+      inline TreeRange(const Iterator& first, const Iterator& last);
+
+
+      // =======================================================================
+      //                               ITERATORS
+      // =======================================================================
+
+
+      /**
+       * Retrieve an iterator to the first node of the traversal.
+       *
+       * @return An iterator to the first node.
+       */
+      inline Iterator begin() const;
+
+      //________________________________________________________________________
+
+      /**
+       * Retrieve an iterator that marks the end of the traversal.
+       *
+       * @return An iterator past the last node.
+       */
+      inline Iterator end() const;
+
+
+      // =======================================================================
+      //                               CAPACITY
+      // =======================================================================
+
+
+      /**
+       * Check if the range is empty.
+       *
+       * @return 'true' if there are no nodes to traverse, 'false' otherwise.
+       */
+      inline bool empty() const;
+
+   private:
+      // =======================================================================
+      //                            PRIVATE FIELDS
+      // =======================================================================
+
+
+      /** Iterator to the first node of the traversal. */
+      Iterator _first;
+
+      //________________________________________________________________________
+
+      /** Iterator that marks the end of the traversal. */
+      Iterator _last;
+};
+
+
+// *****************************************************************************
+// *****************************************************************************
+// *****************************************************************************
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                            IMPLEMENTATION                             ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// ***                                                                       ***
+// *****************************************************************************
+// *****************************************************************************
+// *****************************************************************************
+
+
+template <class Iterator>
+TreeRange<Iterator>::TreeRange() {
+   // Nothing to do
+}
+
+//______________________________________________________________________________
+
+template <class Iterator>
+TreeRange<Iterator>::TreeRange(const Iterator& first, const Iterator& last) : _first(first), _last(last) {
+   // Nothing to do
+}
+
+//______________________________________________________________________________
+
+template <class Iterator>
+Iterator TreeRange<Iterator>::begin() const {
+   return _first;
+}
+
+//______________________________________________________________________________
+
+template <class Iterator>
+Iterator TreeRange<Iterator>::end() const {
+   return _last;
+}
+
+//______________________________________________________________________________
+
+template <class Iterator>
+bool TreeRange<Iterator>::empty() const {
+   return _first == _last;
+}
+
+#if __cplusplus > 201703L
+
+template <class Iterator>
+inline constexpr bool std::ranges::enable_view<TreeRange<Iterator> > = true;
+
+template <class Iterator>
+inline constexpr bool std::ranges::enable_borrowed_range<TreeRange<Iterator> > = true;
+
+#endif
+
+#endif
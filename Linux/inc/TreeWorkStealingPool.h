@@ -0,0 +1,313 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version. This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details. You should have received a copy of the GNU
+ * General Public License along with this program; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ * USA.
+ *
+ * Copyright © 2011-2012 Francisco Aisa Garcia
+ */
+
+
+#ifndef __TREE_WORK_STEALING_POOL_H__
+#define __TREE_WORK_STEALING_POOL_H__
+
+#include "TreeExecutor.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Pool of threads that run the tasks of the parallel tree operations (see
+ * 'TreeParallel'). It is the default executor (see 'TreeExecutor').
+ *
+ * Every worker owns a deque of tasks. A task spawned by a worker is pushed to
+ * the back of its own deque, and the worker takes its next task from the back
+ * too, so it goes on depth first through the work it has just split, while it
+ * is still in cache. Workers that run out of tasks steal from the front of the
+ * deque of other workers, which holds the oldest tasks, usually the biggest
+ * pieces of work. Threads that are not workers of the pool (the one that starts
+ * a parallel operation, for instance) share an extra deque.
+ *
+ * Tasks are grouped (see 'Group'), and waiting for a group doesn't block the
+ * thread: it runs pending tasks until every task of the group is done. Hence,
+ * tasks can spawn and wait for other tasks, and a task and its group can live
+ * in the stack frame of the function that spawns them, so nothing has to be
+ * allocated per task.
+ *
+ * Idle workers spin for a while before going to sleep, and so do threads that
+ * wait for tasks running on other threads. Meanwhile, hungry() tells the running
+ * tasks that splitting their work would pay off. Since a thread that waits runs
+ * other tasks on top of its stack, tasks nested too deep are never told so: they
+ * don't split, hence they never wait, and the stack of every thread stays
+ * bounded.
+ *
+ * The number of threads bounds the CPU time the tree operations take, and the
+ * workers can be pinned to a set of cores, so that they don't compete with the
+ * rest of the process for them.
+ *
+ * @author Francisco Aisa García
+ * @version 0.1
+ */
+class TreeWorkStealingPool : public TreeExecutor {
+   public:
+      // =======================================================================
+      //                     CONSTRUCTORS AND DESTRUCTORS
+      // =======================================================================
+
+
+      /**
+       * Custom constructor.
+       *
+       * @param nThreads Number of threads running tasks, including the one that
+       * waits for them. nThreads - 1 workers are started. 0 means as many as
+       * the hardware can run at once.
+       * @param cores Cores the workers are pinned to: the i-th worker runs on
+       * cores[i % cores.size()]. Empty means that they aren't pinned. The
+       * thread that waits is never pinned. Pinning is only done where the
+       * system supports it, and a worker that can't be pinned to its core runs
+       * anywhere.
+       */
+      explicit TreeWorkStealingPool(unsigned int nThreads = 0, const std::vector<unsigned int>& cores = std::vector<unsigned int>());
+
+      //________________________________________________________________________
+
+      /**
+       * Destructor. It stops and joins the workers.
+       *
+       * Every group MUST have been waited for.
+       */
+      ~TreeWorkStealingPool();
+
+
+      // =======================================================================
+      //                               MODIFIERS
+      // =======================================================================
+
+
+      /**
+       * Hand a task over to the pool.
+       *
+       * @param task Task to be run, it MUST outlive its execution.
+       * @param group Group the task belongs to.
+       */
+      virtual void spawn(Task& task, Group& group);
+
+      //________________________________________________________________________
+
+      /**
+       * Run pending tasks until every task of a group is done.
+       *
+       * If the tasks left are running on other threads, the calling thread
+       * looks for tasks a few times and then sleeps until they are done.
+       *
+       * @param group Group to wait for.
+       * @throws Any exception thrown by a task of the group (the first one).
+       */
+      virtual void wait(Group& group);
+
+
+      // =======================================================================
+      //                               CAPACITY
+      // =======================================================================
+
+
+      /**
+       * Get the number of threads that run tasks.
+       *
+       * @return The number of workers plus one (the thread that waits).
+       */
+      virtual unsigned int concurrency() const;
+
+      //________________________________________________________________________
+
+      /**
+       * Check whether any thread is looking for work.
+       *
+       * Tasks should only split their work when it returns 'true', since
+       * spawning tasks nobody is going to steal is just overhead.
+       *
+       * @return 'true' if some thread of the pool is idle and the calling task
+       * isn't nested too deep, 'false' otherwise.
+       */
+      virtual bool hungry() const;
+
+      //________________________________________________________________________
+
+      /**
+       * Check whether the calling thread may spawn tasks and wait for them.
+       *
+       * @return 'false' if the calling task is nested too deep in the stack of
+       * the thread (so it should run its work by itself), 'true' otherwise.
+       */
+      virtual bool mayWait() const;
+
+
+      // =======================================================================
+      //                            ELEMENT ACCESS
+      // =======================================================================
+
+
+      /**
+       * Get the pool shared by the parallel operations that aren't given an
+       * executor, unless another one is set (see TreeExecutor::setGlobal()).
+       *
+       * It is started the first time it is used, with one thread per core.
+       *
+       * @return A reference to the default pool.
+       */
+      static TreeWorkStealingPool& global();
+
+   private:
+      // =======================================================================
+      //                            PRIVATE TYPES
+      // =======================================================================
+
+
+      /** Deque of tasks owned by a worker (or shared by non worker threads). */
+      struct Worker;
+
+
+      // =======================================================================
+      //                           PRIVATE CONSTANTS
+      // =======================================================================
+
+
+      /**
+       * Number of times an idle worker, or a thread waiting for a group, looks
+       * for tasks before going to sleep.
+       */
+      static const unsigned int SPIN_ROUNDS = 64;
+
+      /** Tasks nested deeper than this in the stack of a thread don't split. */
+      static const unsigned int MAX_NESTING = 8;
+
+
+      // =======================================================================
+      //                            PRIVATE METHODS
+      // =======================================================================
+
+
+      /**
+       * The copy constructor and the operator= haven't been implemented because
+       * the workers keep a pointer to their pool.
+       */
+      TreeWorkStealingPool(const TreeWorkStealingPool& source);
+      TreeWorkStealingPool& operator=(const TreeWorkStealingPool& rhs);
+
+      //________________________________________________________________________
+
+      /**
+       * Main loop of a worker.
+       *
+       * @param index Index of the worker.
+       */
+      void work(unsigned int index);
+
+      //________________________________________________________________________
+
+      /**
+       * Pin the calling worker to its core, if the workers are pinned.
+       *
+       * @param index Index of the worker.
+       */
+      void pin(unsigned int index);
+
+      //________________________________________________________________________
+
+      /**
+       * Get the deque the calling thread pushes its tasks to.
+       *
+       * @return The deque of the calling worker, or the shared one if the
+       * calling thread is not a worker of the pool.
+       */
+      Worker& local();
+
+      //________________________________________________________________________
+
+      /**
+       * Take a task, from the back of the deque of the calling thread or else
+       * from the front of any other deque.
+       *
+       * @return The task, NULL if there are none left.
+       */
+      Task* take();
+
+      //________________________________________________________________________
+
+      /**
+       * Run a task and mark it as done in its group, waking up the threads
+       * sleeping if it was the last one.
+       *
+       * @param task Task to be run.
+       */
+      void run(Task* task);
+
+
+      // =======================================================================
+      //                            PRIVATE FIELDS
+      // =======================================================================
+
+
+      /** Deques of the workers, followed by the shared one. */
+      Worker* _workers;
+
+      //________________________________________________________________________
+
+      /** Number of workers. */
+      unsigned int _nWorkers;
+
+      //________________________________________________________________________
+
+      /** Threads of the workers. */
+      std::vector<std::thread> _threads;
+
+      //________________________________________________________________________
+
+      /** Cores the workers are pinned to, empty if they aren't. */
+      std::vector<unsigned int> _cores;
+
+      //________________________________________________________________________
+
+      /** Number of tasks waiting in the deques. */
+      std::atomic<std::size_t> _nQueued;
+
+      //________________________________________________________________________
+
+      /** Number of threads looking for tasks (spinning, sleeping or waiting). */
+      std::atomic<unsigned int> _nIdle;
+
+      //________________________________________________________________________
+
+      /** Number of threads sleeping, workers or waiting for a group. */
+      std::atomic<unsigned int> _nSleeping;
+
+      //________________________________________________________________________
+
+      /** Whether the workers have to stop. */
+      std::atomic<bool> _stop;
+
+      //________________________________________________________________________
+
+      /** Mutex that sleeping threads wait on. */
+      std::mutex _sleepMutex;
+
+      //________________________________________________________________________
+
+      /**
+       * Condition that wakes sleeping threads up when there are tasks or a
+       * group is done.
+       */
+      std::condition_variable _wakeUp;
+};
+
+
+#endif
@@ -0,0 +1,380 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version. This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details. You should have received a copy of the GNU
+ * General Public License along with this program; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ * USA.
+ *
+ * Copyright © 2011-2012 Francisco Aisa Garcia
+ */
+
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <thread>
+#include <vector>
+#include "Tree.h"
+#include "TreeConcurrent.h"
+#include "TreeInterleaver.h"
+
+using namespace std;
+
+// *****************************************************************************
+//                                    TYPES
+// *****************************************************************************
+
+
+// Payload big enough to be kept apart from the node (see TreeLayoutTraits)
+struct BigPayload {
+   BigPayload(int v = 0) : value(v) {}
+
+   int value;
+   char padding[124];
+};
+
+template <>
+struct TreeLayoutTraits<BigPayload> {
+   static const bool coldPayload = true;
+};
+
+// *****************************************************************************
+//                             FUNCTION DEFINITIONS
+// *****************************************************************************
+
+
+int valueOf(int data) {
+   return data;
+}
+
+// _____________________________________________________________________________
+
+int valueOf(const BigPayload& data) {
+   return data.value;
+}
+
+// _____________________________________________________________________________
+
+// Build a random recursive tree: every node hangs from a node picked at random
+// among the ones already in the tree, so nodes adjacent in a traversal were
+// allocated far apart from each other
+template <class T>
+Tree<T> randomTree(size_t nNodes, unsigned int seed) {
+   Tree<T> tree(T(0));
+   vector<typename Tree<T>::PreOrderIterator> nodes;
+   nodes.reserve(nNodes);
+   nodes.push_back(tree.preBegin());
+
+   mt19937 random(seed);
+   for(size_t i = 1; i < nNodes; ++i) {
+      size_t parent = uniform_int_distribution<size_t>(0, i - 1)(random);
+      nodes.push_back(tree.pushBackChild(nodes[parent], T(i)));
+   }
+
+   return tree;
+}
+
+// _____________________________________________________________________________
+
+// Time the best of a few traversals, in nanoseconds per visited node. Every
+// visit mixes the value of the node 'work' times, as a visitor that computes
+// something would, which is what prefetching overlaps the loads with
+template <class Iterator>
+double timeTraversal(Iterator first, const Iterator& last, TreePrefetchMode mode, unsigned int work, long long& checksum) {
+   double best = 0.0;
+   for(int run = 0; run < 3; ++run) {
+      chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+      long long sum = 0;
+      size_t visited = 0;
+      Iterator it(first);
+      it.setPrefetch(mode);
+      for(; it != last; ++it, ++visited) {
+         unsigned long long mixed = static_cast<unsigned long long>(valueOf(*it));
+         for(unsigned int i = 0; i < work; ++i)
+            mixed = mixed * 6364136223846793005ULL + 1442695040888963407ULL;
+         sum += static_cast<long long>(mixed & 0xffffffffULL);
+      }
+
+      double elapsed = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / visited;
+      if(run == 0 || elapsed < best)
+         best = elapsed;
+      checksum += sum;
+   }
+
+   return best;
+}
+
+// _____________________________________________________________________________
+
+template <class T>
+void benchTree(const Tree<T>& tree, const char* name) {
+   static const TreePrefetchMode modes[] = {TREE_NO_PREFETCH, TREE_PREFETCH_NODES, TREE_PREFETCH_PAYLOADS};
+   static const char* modeNames[] = {"none", "nodes", "payloads"};
+
+   static const unsigned int works[] = {0, 200};
+
+   long long checksum = 0;
+   cout << name << endl;
+   for(int w = 0; w < 2; ++w) {
+      for(int i = 0; i < 3; ++i) {
+         cout << "   work " << works[w] << ", prefetch " << modeNames[i] << ":";
+         cout << "   pre-order " << timeTraversal(tree.preBegin(), tree.preEnd(), modes[i], works[w], checksum) << " ns";
+         cout << "   post-order " << timeTraversal(tree.postBegin(), tree.postEnd(), modes[i], works[w], checksum) << " ns";
+         cout << "   leaves " << timeTraversal(tree.leafBegin(), tree.leafEnd(), modes[i], works[w], checksum) << " ns" << endl;
+      }
+   }
+   cout << "   (checksum " << checksum << ")" << endl;
+}
+
+// _____________________________________________________________________________
+
+// Add the value of every node to the sum of its tree
+struct SumPerTree {
+   SumPerTree(vector<long long>& s) : sums(s) {}
+
+   void operator()(size_t tree, int data) {
+      sums[tree] += data;
+   }
+
+   vector<long long>& sums;
+};
+
+// _____________________________________________________________________________
+
+// Walk many small trees one after the other and interleaved, nodes of every tree
+// are allocated mixed with the nodes of the rest
+void benchManyTrees(size_t nTrees, size_t nodesPerTree) {
+   vector<Tree<int> > trees(nTrees, Tree<int>(0));
+   vector<vector<Tree<int>::PreOrderIterator> > nodes(nTrees);
+   for(size_t t = 0; t < nTrees; ++t)
+      nodes[t].push_back(trees[t].preBegin());
+
+   mt19937 random(42);
+   for(size_t i = 1; i < nodesPerTree; ++i) {
+      for(size_t t = 0; t < nTrees; ++t) {
+         size_t parent = uniform_int_distribution<size_t>(0, i - 1)(random);
+         nodes[t].push_back(trees[t].pushBackChild(nodes[t][parent], int(i)));
+      }
+   }
+   nodes.clear();
+
+   cout << nTrees << " trees of " << nodesPerTree << " nodes" << endl;
+
+   double best = 0.0;
+   long long checksum = 0;
+   for(int run = 0; run < 3; ++run) {
+      chrono::steady_clock::time_point start = chrono::steady_clock::now();
+      checksum = 0;
+      for(size_t t = 0; t < nTrees; ++t) {
+         for(Tree<int>::PreOrderIterator it(trees[t].preBegin()); it != trees[t].preEnd(); ++it)
+            checksum += *it;
+      }
+
+      double elapsed = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / (nTrees * nodesPerTree);
+      if(run == 0 || elapsed < best)
+         best = elapsed;
+   }
+   cout << "   one after the other: " << best << " ns" << endl;
+
+   static const unsigned int widths[] = {1, 4, 8, 16, 32};
+   for(int w = 0; w < 5; ++w) {
+      TreeInterleaver<int> interleaver(widths[w]);
+      for(size_t t = 0; t < nTrees; ++t)
+         interleaver.add(trees[t].preBegin());
+
+      vector<long long> sums(nTrees, 0);
+      for(int run = 0; run < 3; ++run) {
+         chrono::steady_clock::time_point start = chrono::steady_clock::now();
+         fill(sums.begin(), sums.end(), 0);
+         interleaver.preOrder(SumPerTree(sums));
+
+         double elapsed = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / (nTrees * nodesPerTree);
+         if(run == 0 || elapsed < best)
+            best = elapsed;
+      }
+      cout << "   interleaved, width " << widths[w] << ": " << best << " ns";
+      if(accumulate(sums.begin(), sums.end(), 0LL) != checksum)
+         cout << " (WRONG CHECKSUM)";
+      cout << endl;
+   }
+}
+
+// _____________________________________________________________________________
+
+// Grow and shrink a branch of a concurrent tree: three out of four modifications
+// push a child under a random node of the branch, the fourth one erases one
+struct GrowBranch {
+   GrowBranch(TreeConcurrent<int>& t, const TreeConcurrent<int>::Node* b, mutex* g, size_t n, unsigned int s) :
+      tree(t), branch(b), global(g), nModifications(n), seed(s) {}
+
+   void operator()() const {
+      mt19937 random(seed);
+      vector<const TreeConcurrent<int>::Node*> nodes(1, branch);
+      for(size_t i = 0; i < nModifications; ++i) {
+         size_t k = uniform_int_distribution<size_t>(0, nodes.size() - 1)(random);
+
+         // Without concurrent writers every modification goes through the same lock
+         unique_lock<mutex> lock;
+         if(global != NULL)
+            lock = unique_lock<mutex>(*global);
+
+         if(i % 4 == 3 && k > 0) {
+            tree.erase(nodes[k]);
+            nodes[k] = nodes.back();
+            nodes.pop_back();
+         }
+         else {
+            nodes.push_back(tree.pushBackChild(nodes[k], int(i)));
+         }
+      }
+   }
+
+   TreeConcurrent<int>& tree;
+   const TreeConcurrent<int>::Node* branch;
+   mutex* global;
+   size_t nModifications;
+   unsigned int seed;
+};
+
+// _____________________________________________________________________________
+
+// Time (per modification) a few threads modifying their own branch of the same
+// tree, serialized by a single lock or with concurrent writers enabled
+double timeWriters(size_t nThreads, size_t nModifications, bool concurrentWriters) {
+   TreeConcurrent<int> tree(0);
+   mutex global;
+   if(concurrentWriters)
+      tree.enableConcurrentWriters();
+
+   vector<const TreeConcurrent<int>::Node*> branches;
+   for(size_t t = 0; t < nThreads; ++t)
+      branches.push_back(tree.pushBackChild(tree.root(), int(t)));
+
+   chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+   vector<thread> writers;
+   for(size_t t = 0; t < nThreads; ++t)
+      writers.push_back(thread(GrowBranch(tree, branches[t], concurrentWriters ? NULL : &global, nModifications, (unsigned int)t)));
+   for(size_t t = 0; t < nThreads; ++t)
+      writers[t].join();
+
+   return chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / (nThreads * nModifications);
+}
+
+// _____________________________________________________________________________
+
+// Compare writers on disjoint branches serialized by one lock with writers that
+// only lock the nodes they modify
+void benchWriters(size_t nModifications) {
+   static const size_t threads[] = {1, 2, 4, 8};
+
+   cout << "writers on disjoint branches, " << nModifications << " modifications each" << endl;
+   for(int i = 0; i < 4; ++i) {
+      cout << "   " << threads[i] << " threads:";
+      cout << "   global lock " << timeWriters(threads[i], nModifications, false) << " ns";
+      cout << "   striped locks " << timeWriters(threads[i], nModifications, true) << " ns" << endl;
+   }
+}
+
+// _____________________________________________________________________________
+
+// Append children under a few hot parents picked at random, without locks or
+// through the locks of concurrent writers
+struct AppendToBuckets {
+   AppendToBuckets(TreeConcurrent<int>& t, const vector<const TreeConcurrent<int>::Node*>& b, bool l, size_t n, unsigned int s) :
+      tree(t), buckets(b), lockFree(l), nAppends(n), seed(s) {}
+
+   void operator()() const {
+      mt19937 random(seed);
+      for(size_t i = 0; i < nAppends; ++i) {
+         size_t k = uniform_int_distribution<size_t>(0, buckets.size() - 1)(random);
+         if(lockFree)
+            tree.appendChild(buckets[k], int(i));
+         else
+            tree.pushBackChild(buckets[k], int(i));
+      }
+   }
+
+   TreeConcurrent<int>& tree;
+   const vector<const TreeConcurrent<int>::Node*>& buckets;
+   bool lockFree;
+   size_t nAppends;
+   unsigned int seed;
+};
+
+// _____________________________________________________________________________
+
+// Time (per child) a few threads appending children under the same parents
+double timeAppends(size_t nThreads, size_t nAppends, size_t nBuckets, bool lockFree) {
+   TreeConcurrent<int> tree(0);
+   tree.enableConcurrentWriters();
+
+   vector<const TreeConcurrent<int>::Node*> buckets;
+   for(size_t b = 0; b < nBuckets; ++b)
+      buckets.push_back(tree.pushBackChild(tree.root(), int(b)));
+
+   chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+   vector<thread> writers;
+   for(size_t t = 0; t < nThreads; ++t)
+      writers.push_back(thread(AppendToBuckets(tree, buckets, lockFree, nAppends, (unsigned int)t)));
+   for(size_t t = 0; t < nThreads; ++t)
+      writers[t].join();
+
+   return chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / (nThreads * nAppends);
+}
+
+// _____________________________________________________________________________
+
+// Compare appending children under hot parents through the lock of the parent
+// with appending them with a compare-and-swap
+void benchAppends(size_t nAppends, size_t nBuckets) {
+   static const size_t threads[] = {1, 2, 4, 8};
+
+   cout << "appends under " << nBuckets << " hot parents, " << nAppends << " appends each" << endl;
+   for(int i = 0; i < 4; ++i) {
+      cout << "   " << threads[i] << " threads:";
+      cout << "   striped locks " << timeAppends(threads[i], nAppends, nBuckets, false) << " ns";
+      cout << "   lock-free " << timeAppends(threads[i], nAppends, nBuckets, true) << " ns" << endl;
+   }
+}
+
+// _____________________________________________________________________________
+
+// Measure how long it takes to traverse (per node) trees that don't fit in the
+// last level cache, with and without prefetching
+int main(int argc, char** argv) {
+   size_t nNodes = argc > 1 ? strtoul(argv[1], NULL, 10) : 4000000;
+   cout << nNodes << " nodes" << endl;
+
+   {
+      Tree<int> tree = randomTree<int>(nNodes, 42);
+      benchTree(tree, "int payload, scattered");
+      tree.relayout();
+      benchTree(tree, "int payload, pre-order layout");
+   }
+
+   {
+      Tree<BigPayload> tree = randomTree<BigPayload>(nNodes, 42);
+      benchTree(tree, "cold payload, scattered");
+      tree.relayout();
+      benchTree(tree, "cold payload, pre-order layout");
+   }
+
+   benchManyTrees(nNodes / 1000, 1000);
+
+   benchWriters(nNodes / 20);
+   benchAppends(nNodes / 20, 4);
+
+   return 0;
+}
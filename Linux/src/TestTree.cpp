@@ -13,12 +13,708 @@
  * Copyright © 2011-2012 Francisco Aisa Garcia
  */
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <cstdint>
+#include <cstring>
+#include <functional>
 #include <iostream>
+#include <iterator>
 #include <list>
+#include <map>
+#include <new>
+#include <numeric>
+#include <stdexcept>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#if __cplusplus > 201703L
+#include <ranges>
+#endif
 #include "Tree.h"
+#include "TreeArenaAllocator.h"
+#include "TreeConcurrent.h"
+#include "TreeEpoch.h"
+#include "TreeInterleaver.h"
+#include "TreeMutationQueue.h"
+#include "TreeParallel.h"
+#include "TreePathCache.h"
+#include "TreePoolAllocator.h"
+#include "TreeWorkStealingPool.h"
 
 using namespace std;
 
+// *****************************************************************************
+//                              TESTING UTILITIES
+// *****************************************************************************
+
+
+// Number of checks that haven't held
+int nFailures = 0;
+
+// Report a check that doesn't hold
+void check(bool condition, const char* what, int line) {
+   if(!condition) {
+      cerr << "TestTree.cpp:" << line << ": check failed: " << what << endl;
+      ++nFailures;
+   }
+}
+
+#define CHECK(condition) check((condition), #condition, __LINE__)
+
+// _____________________________________________________________________________
+
+// Keeps the messages the tree prints on purpose (allocation failures, for
+// instance) out of the output while it is alive
+class Silence {
+   public:
+      Silence() : _saved(cerr.rdbuf(_sink.rdbuf())) {}
+      ~Silence() { cerr.rdbuf(_saved); }
+
+   private:
+      ostringstream _sink;
+      streambuf* _saved;
+};
+
+// _____________________________________________________________________________
+
+// Counters shared by the copies of a 'CountingAllocator'
+struct AllocationCounters {
+   AllocationCounters() : live(0), budget(-1) {}
+
+   // Blocks handed out and not given back yet
+   long live;
+
+   // Allocations left before failing, -1 for unlimited
+   long budget;
+};
+
+// _____________________________________________________________________________
+
+// Allocator that counts the blocks it hands out and fails once its budget of
+// allocations is spent. Copies share the counters, and only copies compare
+// equal
+template <class T>
+class CountingAllocator {
+   public:
+      typedef T value_type;
+      typedef AllocationCounters Counters;
+
+      explicit CountingAllocator(Counters& counters) : counters(&counters) {}
+
+      template <class U>
+      CountingAllocator(const CountingAllocator<U>& source) : counters(source.counters) {}
+
+      T* allocate(size_t n) {
+         if(counters->budget == 0)
+            throw bad_alloc();
+         if(counters->budget > 0)
+            --counters->budget;
+
+         ++counters->live;
+         return static_cast<T*>(::operator new(n * sizeof(T)));
+      }
+
+      void deallocate(T* p, size_t) {
+         --counters->live;
+         ::operator delete(p);
+      }
+
+      template <class U>
+      bool operator==(const CountingAllocator<U>& rhs) const { return counters == rhs.counters; }
+
+      template <class U>
+      bool operator!=(const CountingAllocator<U>& rhs) const { return counters != rhs.counters; }
+
+      Counters* counters;
+};
+
+// _____________________________________________________________________________
+
+// Values visited by a pair of iterators, in order
+template <class Iterator>
+vector<int> collect(Iterator first, Iterator last) {
+   vector<int> values;
+   for(; first != last; ++first)
+      values.push_back(*first);
+
+   return values;
+}
+
+// _____________________________________________________________________________
+
+// Values visited by a range, in order
+template <class Range>
+vector<int> collect(const Range& range) {
+   return collect(range.begin(), range.end());
+}
+
+// _____________________________________________________________________________
+
+// Build a vector out of a list of values
+vector<int> values(const char* list) {
+   vector<int> result;
+   istringstream stream(list);
+   for(int value; stream >> value; )
+      result.push_back(value);
+
+   return result;
+}
+
+
+// _____________________________________________________________________________
+
+// Payload that counts how many of its instances are alive
+struct Tracked {
+   Tracked(int value = 0) : value(value) { ++nLive; }
+   Tracked(const Tracked& source) : value(source.value) { ++nLive; }
+   ~Tracked() { --nLive; }
+
+   Tracked& operator=(const Tracked& rhs) { value = rhs.value; return *this; }
+   bool operator!=(const Tracked& rhs) const { return value != rhs.value; }
+   operator int() const { return value; }
+
+   int value;
+   static long nLive;
+};
+
+long Tracked::nLive = 0;
+
+// _____________________________________________________________________________
+
+// Big payload kept apart from the nodes of its trees
+struct ColdRecord {
+   ColdRecord(int value = 0) : value(value) {}
+
+   bool operator!=(const ColdRecord& rhs) const { return value.value != rhs.value.value; }
+   operator int() const { return value.value; }
+
+   Tracked value;
+   char padding[256];
+};
+
+template <>
+struct TreeLayoutTraits<ColdRecord> {
+   static const bool coldPayload = true;
+};
+
+// _____________________________________________________________________________
+
+// Payload that needs more alignment than the global operator new gives by default
+struct alignas(64) Wide {
+   Wide(int value = 0) : value(value) {}
+
+   bool operator!=(const Wide& rhs) const { return value != rhs.value; }
+   operator int() const { return value; }
+
+   int value;
+};
+
+// _____________________________________________________________________________
+
+// Shape of a tree, used as the reference the trees are checked against: node
+// 'i' holds the value 'i', and 'children[i]' lists its children in order
+struct Shape {
+   vector< vector<int> > children;
+};
+
+// _____________________________________________________________________________
+
+// Grow a tree of 'nNodes' nodes with a random shape out of a root holding 0
+template <class T, class Alloc>
+Shape grow(Tree<T, Alloc>& tree, int nNodes, unsigned int seed) {
+   Shape shape;
+   shape.children.resize(nNodes);
+
+   vector<typename Tree<T, Alloc>::PreOrderIterator> nodes;
+   tree.setRoot(0);
+   nodes.push_back(tree.preBegin());
+   for(int i = 1; i < nNodes; ++i) {
+      seed = seed * 1103515245 + 12345;
+      int parent = (seed >> 8) % i;
+      nodes.push_back(tree.pushBackChild(nodes[parent], i));
+      shape.children[parent].push_back(i);
+   }
+
+   return shape;
+}
+
+// _____________________________________________________________________________
+
+// Pre-order of a shape, from a given node and down to a given depth
+void preorderOf(const Shape& shape, int node, vector<int>& result, unsigned int maxDepth = TREE_UNLIMITED_DEPTH) {
+   result.push_back(node);
+   for(size_t i = 0; maxDepth > 0 && i < shape.children[node].size(); ++i)
+      preorderOf(shape, shape.children[node][i], result, maxDepth - 1);
+}
+
+// _____________________________________________________________________________
+
+// Post-order of a shape, from a given node and down to a given depth
+void postorderOf(const Shape& shape, int node, vector<int>& result, unsigned int maxDepth = TREE_UNLIMITED_DEPTH) {
+   for(size_t i = 0; maxDepth > 0 && i < shape.children[node].size(); ++i)
+      postorderOf(shape, shape.children[node][i], result, maxDepth - 1);
+   result.push_back(node);
+}
+
+// _____________________________________________________________________________
+
+// Leaves of a shape, from left to right
+void leavesOf(const Shape& shape, int node, vector<int>& result) {
+   if(shape.children[node].empty())
+      result.push_back(node);
+   for(size_t i = 0; i < shape.children[node].size(); ++i)
+      leavesOf(shape, shape.children[node][i], result);
+}
+
+// _____________________________________________________________________________
+
+// Iterator to the node holding a given value
+template <class T, class Alloc>
+typename Tree<T, Alloc>::PreOrderIterator nodeOf(const Tree<T, Alloc>& tree, int value) {
+   typename Tree<T, Alloc>::PreOrderIterator it = tree.preBegin();
+   while(it != tree.preEnd() && *it != value)
+      ++it;
+
+   return it;
+}
+
+
+// _____________________________________________________________________________
+
+// Visitor that keeps the values it is given apart for each subtree
+struct PerSubtree {
+   explicit PerSubtree(vector< vector<int> >& visited) : visited(&visited) {}
+
+   void operator()(size_t index, int value) { (*visited)[index].push_back(value); }
+
+   vector< vector<int> >* visited;
+};
+
+// _____________________________________________________________________________
+
+// Visitor of parallel traversals that counts the visits to every node and, in
+// bottom-up traversals, checks that the children of a node came first
+struct CountVisits {
+   CountVisits(const Shape& shape, vector< atomic<int> >& visits, atomic<bool>& inOrder, bool bottomUp) :
+      shape(&shape), visits(&visits), inOrder(&inOrder), bottomUp(bottomUp) {}
+
+   void operator()(int& value) const {
+      const vector<int>& children = shape->children[value];
+      for(size_t i = 0; bottomUp && i < children.size(); ++i)
+         if((*visits)[children[i]].load() == 0)
+            inOrder->store(false);
+      (*visits)[value].fetch_add(1);
+   }
+
+   const Shape* shape;
+   vector< atomic<int> >* visits;
+   atomic<bool>* inOrder;
+   bool bottomUp;
+};
+
+// _____________________________________________________________________________
+
+// Algebra of contractions where the children of odd nodes are multiplied into
+// them and the children of even nodes are added to them, modulo a prime so
+// the results are exact whatever the grouping
+struct ModularAlgebra {
+   static const uint64_t PRIME = 1000000007;
+
+   typedef uint64_t Value;
+
+   // x -> a * x + b
+   struct Function {
+      Function(uint64_t a = 1, uint64_t b = 0) : a(a), b(b) {}
+
+      uint64_t a;
+      uint64_t b;
+   };
+
+   static Value apply(int data, const Value& lhs, const Value& rhs) {
+      return data % 2 != 0 ? lhs * rhs % PRIME : (lhs + rhs) % PRIME;
+   }
+
+   Value start(int data) const { return data; }
+   Value fold(int data, const Value& partial, const Value& child) const { return apply(data, partial, child); }
+
+   Function foldChild(int data, const Value& child) const {
+      return data % 2 != 0 ? Function(child, 0) : Function(1, child);
+   }
+
+   Function foldInto(int data, const Value& partial) const {
+      return data % 2 != 0 ? Function(partial, 0) : Function(1, partial);
+   }
+
+   Function compose(const Function& outer, const Function& inner) const {
+      return Function(outer.a * inner.a % PRIME, (outer.a * inner.b + outer.b) % PRIME);
+   }
+
+   Value apply(const Function& function, const Value& x) const { return (function.a * x + function.b) % PRIME; }
+};
+
+// _____________________________________________________________________________
+
+// Value of a node of a shape under 'ModularAlgebra'
+uint64_t evaluate(const Shape& shape, int node) {
+   uint64_t value = node;
+   for(size_t i = 0; i < shape.children[node].size(); ++i)
+      value = ModularAlgebra::apply(node, value, evaluate(shape, shape.children[node][i]));
+
+   return value;
+}
+
+// _____________________________________________________________________________
+
+// Function of parallel scans that keeps the position of every node
+struct KeepScanInfo {
+   explicit KeepScanInfo(vector< TreeScanInfo<long> >& infos) : infos(&infos) {}
+
+   void operator()(int& value, const TreeScanInfo<long>& info) const { (*infos)[value] = info; }
+
+   vector< TreeScanInfo<long> >* infos;
+};
+
+// _____________________________________________________________________________
+
+// Position of the nodes of a shape, as a parallel scan with sums of the values
+// computes it
+size_t scanOf(const Shape& shape, int node, size_t depth, long prefix, size_t& preorder, vector< TreeScanInfo<long> >& infos) {
+   TreeScanInfo<long>& info = infos[node];
+   info.depth = depth;
+   info.preorder = preorder++;
+   info.prefix = prefix + node;
+   info.size = 1;
+   for(size_t i = 0; i < shape.children[node].size(); ++i)
+      info.size += scanOf(shape, shape.children[node][i], depth + 1, info.prefix, preorder, infos);
+
+   return infos[node].size;
+}
+
+// _____________________________________________________________________________
+
+// Payload of the concurrent trees: readers must never see a stamp whose
+// halves don't match
+struct Stamp {
+   Stamp(int id = 0, long version = 0) : id(id), first(version), second(version) {}
+
+   bool operator!=(const Stamp& rhs) const { return id != rhs.id || first != rhs.first; }
+   operator int() const { return id; }
+
+   int id;
+   long first;
+   long second;
+};
+
+// _____________________________________________________________________________
+
+// Reference model of the concurrent trees: the nodes hold their ids, and every
+// change made to a tree is made to the model as well
+class Model {
+   public:
+      // Start a tree, or a branch of one, at a given node
+      void setRoot(int id) { _nodes[id].parent = -1; }
+
+      int parent(int node) const { return _nodes.find(node)->second.parent; }
+      const vector<int>& children(int node) const { return _nodes.find(node)->second.children; }
+
+      // Position of a node among its siblings
+      size_t position(int node) const {
+         const vector<int>& siblings = children(parent(node));
+         return find(siblings.begin(), siblings.end(), node) - siblings.begin();
+      }
+
+      // Link a node, new or detached, as the child of a node at a position
+      void attach(int parent, size_t position, int node) {
+         vector<int>& siblings = _nodes[parent].children;
+         siblings.insert(siblings.begin() + min(position, siblings.size()), node);
+         _nodes[node].parent = parent;
+      }
+
+      // Unlink a node from its parent, keeping its subtree
+      void detach(int node) {
+         vector<int>& siblings = _nodes[parent(node)].children;
+         siblings.erase(siblings.begin() + position(node));
+      }
+
+      // Erase a node, its children take its place
+      void erase(int node) {
+         int parent = this->parent(node);
+         size_t position = this->position(node);
+         vector<int> children = this->children(node);
+         detach(node);
+         for(size_t i = 0; i < children.size(); ++i)
+            attach(parent, position + i, children[i]);
+         _nodes.erase(node);
+      }
+
+      // Erase a subtree
+      void chop(int node) {
+         detach(node);
+         vector<int> subtree;
+         preorder(node, subtree);
+         for(size_t i = 0; i < subtree.size(); ++i)
+            _nodes.erase(subtree[i]);
+      }
+
+      // Pre-order of a subtree
+      void preorder(int node, vector<int>& result) const {
+         result.push_back(node);
+         const vector<int>& children = this->children(node);
+         for(size_t i = 0; i < children.size(); ++i)
+            preorder(children[i], result);
+      }
+
+      vector<int> preorder(int node) const {
+         vector<int> result;
+         preorder(node, result);
+         return result;
+      }
+
+   private:
+      struct Entry {
+         int parent;
+         vector<int> children;
+      };
+
+      map<int, Entry> _nodes;
+};
+
+// _____________________________________________________________________________
+
+// Nodes of a concurrent tree, by id
+template <class Alloc>
+struct NodeMap {
+   typedef typename TreeConcurrent<Stamp, Alloc>::Node Node;
+
+   // Map the nodes of a subtree, after they have been copied in
+   void add(const Node* node) {
+      nodes[node->data().id] = node;
+      for(const Node* child = node->firstChild(); child != NULL; child = child->nextSibling())
+         add(child);
+   }
+
+   const Node* operator[](int id) const { return nodes.find(id)->second; }
+
+   map<int, const Node*> nodes;
+};
+
+// _____________________________________________________________________________
+
+// Make random changes to the subtree of a concurrent tree hanging from a node,
+// and the same ones to its model. Ids are taken from 'nextId' on
+template <class Alloc>
+void mutate(TreeConcurrent<Stamp, Alloc>& tree, Model& model, NodeMap<Alloc>& nodes, int root, int nextId, int nOps, unsigned int seed) {
+   typedef typename TreeConcurrent<Stamp, Alloc>::Node Node;
+
+   for(int op = 0; op < nOps; ++op) {
+      vector<int> order = model.preorder(root);
+      seed = seed * 1103515245 + 12345;
+      int node = order[(seed >> 8) % order.size()];
+      int kind = (seed >> 20) % 9;
+      if(node == root && kind >= 4)
+         kind = 0;
+      if(kind == 6 && order.size() < 200)
+         kind = 1;
+
+      int id = nextId++;
+      switch(kind) {
+         case 0:
+            nodes.nodes[id] = tree.pushBackChild(nodes[node], Stamp(id));
+            model.attach(node, model.children(node).size(), id);
+            break;
+
+         case 1:
+            nodes.nodes[id] = tree.pushFrontChild(nodes[node], Stamp(id));
+            model.attach(node, 0, id);
+            break;
+
+         case 2: {
+            // A small tree grafted at the front
+            Tree<Stamp, Alloc> small(Stamp(id), tree.getAllocator());
+            small.pushBackChild(small.preBegin(), Stamp(nextId));
+            small.pushBackChild(small.preBegin(), Stamp(nextId + 1));
+            tree.graftFront(nodes[node], small);
+            nodes.add(nodes[node]->firstChild());
+            model.attach(node, 0, id);
+            model.attach(id, 0, nextId++);
+            model.attach(id, 1, nextId++);
+            break;
+         }
+
+         case 3:
+            tree.set(nodes[node], Stamp(node, id));
+            break;
+
+         case 4:
+            nodes.nodes[id] = tree.insertChild(nodes[model.parent(node)], nodes[node], Stamp(id));
+            model.attach(model.parent(node), model.position(node), id);
+            break;
+
+         case 5:
+            tree.erase(nodes[node]);
+            model.erase(node);
+            break;
+
+         case 6:
+            tree.chop(nodes[node]);
+            model.chop(node);
+            break;
+
+         case 7: {
+            // A subtree moved under another node out of it
+            Tree<Stamp, Alloc> pruned = tree.prune(nodes[node]);
+            model.detach(node);
+            order = model.preorder(root);
+            int parent = order[(seed >> 4) % order.size()];
+            tree.graftBack(nodes[parent], pruned);
+            const Node* last = nodes[parent]->firstChild();
+            while(last->nextSibling() != NULL)
+               last = last->nextSibling();
+            nodes.add(last);
+            model.attach(parent, model.children(parent).size(), node);
+            break;
+         }
+
+         default: {
+            // A leaf grafted right before a node
+            Tree<Stamp, Alloc> leaf(Stamp(id), tree.getAllocator());
+            tree.graftAt(nodes[model.parent(node)], nodes[node], leaf);
+            size_t position = model.position(node);
+            model.attach(model.parent(node), position, id);
+            const Node* grafted = nodes[model.parent(node)]->firstChild();
+            for(size_t i = 0; i < position; ++i)
+               grafted = grafted->nextSibling();
+            nodes.add(grafted);
+            break;
+         }
+      }
+   }
+}
+
+// _____________________________________________________________________________
+
+// Reader of a concurrent tree that walks it over and over until it is told to
+// stop, checking every payload it sees
+template <class Alloc>
+void readUntil(const TreeConcurrent<Stamp, Alloc>& tree, const atomic<bool>& stop, atomic<bool>& consistent, atomic<long>& nWalks) {
+   while(!stop.load()) {
+      TreeEpoch::Guard guard;
+      for(const Stamp& stamp : tree.preorder())
+         if(stamp.first != stamp.second)
+            consistent.store(false);
+      nWalks.fetch_add(1);
+   }
+}
+
+// _____________________________________________________________________________
+
+// Queue random modifications of the subtree hanging from a node, and make the
+// same ones to its model. Ids are taken from 'nextId' on
+void produce(TreeMutationQueue<Stamp>& queue, Model& model, const TreeConcurrent<Stamp>::Node* root, int nextId, int nOps, unsigned int seed) {
+   typedef TreeConcurrent<Stamp>::Node Node;
+
+   // Nodes the producer may still refer to, grafted ones aren't known. The
+   // parents of the known nodes are known as well
+   int rootId = root->data().id;
+   vector< pair<int, const Node*> > known(1, make_pair(rootId, root));
+   map<int, const Node*> nodes;
+   nodes[rootId] = root;
+   for(int op = 0; op < nOps; ++op) {
+      seed = seed * 1103515245 + 12345;
+      size_t picked = (seed >> 8) % known.size();
+      int node = known[picked].first;
+      int kind = (seed >> 20) % 8;
+      if(node == rootId && kind >= 4)
+         kind = 0;
+
+      int id = nextId++;
+      if(kind <= 2) {
+         nodes[id] = queue.pushBackChild(known[picked].second, Stamp(id));
+         known.push_back(make_pair(id, nodes[id]));
+         model.attach(node, model.children(node).size(), id);
+      }
+      else if(kind == 3) {
+         queue.set(known[picked].second, Stamp(node, id));
+      }
+      else if(kind == 4 || kind == 5) {
+         // Never erased twice, the applier may take a batch in between and
+         // release the node
+         queue.erase(known[picked].second);
+         model.erase(node);
+         known.erase(known.begin() + picked);
+         nodes.erase(node);
+      }
+      else {
+         Tree<Stamp> small((Stamp(id)));
+         small.pushBackChild(small.preBegin(), Stamp(nextId));
+         if(kind == 6) {
+            // The parent the node has in the tree may not be the one it has
+            // after the modifications queued so far
+            queue.graftAt(nodes[model.parent(node)], known[picked].second, small);
+            model.attach(model.parent(node), model.position(node), id);
+         }
+         else {
+            queue.graftBack(known[picked].second, small);
+            model.attach(node, model.children(node).size(), id);
+         }
+         model.attach(id, 0, nextId++);
+      }
+   }
+}
+
+// _____________________________________________________________________________
+
+// Task that sleeps for a while, so that it is stolen and waited for
+struct SlowTask : public TreeExecutor::Task {
+   explicit SlowTask(long microseconds = 0, bool fail = false) : microseconds(microseconds), fail(fail), done(false) {}
+
+   virtual void execute() {
+      this_thread::sleep_for(chrono::microseconds(microseconds));
+      if(fail)
+         throw runtime_error("slow task failed");
+      done.store(true);
+   }
+
+   long microseconds;
+   bool fail;
+   atomic<bool> done;
+};
+
+// _____________________________________________________________________________
+
+// Task that adds up a range of integers, splitting it in halves that are run
+// by other tasks, and sleeping a little for each of them
+struct SumTask : public TreeExecutor::Task {
+   SumTask(TreeExecutor& executor, long first, long last, atomic<long>& sum) : executor(&executor), first(first), last(last), sum(&sum) {}
+
+   virtual void execute() {
+      if(last - first <= 4 || !executor->mayWait()) {
+         for(long i = first; i < last; ++i)
+            sum->fetch_add(i);
+         this_thread::sleep_for(chrono::microseconds((first * 7) % 50));
+         return;
+      }
+
+      long middle = first + (last - first) / 2;
+      SumTask left(*executor, first, middle, *sum);
+      SumTask right(*executor, middle, last, *sum);
+      TreeExecutor::Group group;
+      executor->spawn(left, group);
+      executor->spawn(right, group);
+      executor->wait(group);
+   }
+
+   TreeExecutor* executor;
+   long first;
+   long last;
+   atomic<long>* sum;
+};
+
 // *****************************************************************************
 //                             FUNCTION DEFINITIONS
 // *****************************************************************************
@@ -137,26 +833,1698 @@ void graftBackTest(Tree<int>& tree, Tree<int>& adoptTree, const Tree<int>::PreOr
 }
 
 
-// *****************************************************************************
-//                                    MAIN
-// *****************************************************************************
+// _____________________________________________________________________________
 
-// Some examples of how to use a Tree structure
-int main(int argc, char** argv) {
-   // Build the tree example found in wikipedia -> http://en.wikipedia.org/wiki/Binary_tree
-   Tree<int> tree = wikipediaTree();
-   Tree<int> tree2 = tree;
+// Trees allocate through their allocator, give everything back, and stay as
+// they were when an allocation fails
+void allocatorTest() {
+   typedef CountingAllocator<int> Allocator;
+   typedef Tree<int, Allocator> CountedTree;
 
-   Tree<int>::PreOrderIterator eraseIt, graftIt;
+   AllocationCounters counters;
+   {
+      Allocator alloc(counters);
+      CountedTree tree(0, alloc);
+      Shape shape = grow(tree, 200, 1);
+      vector<int> expected;
+      preorderOf(shape, 0, expected);
+      CHECK(collect(tree.preBegin(), tree.preEnd()) == expected);
+      CHECK(counters.live > 0);
+      CHECK(tree.getAllocator() == alloc);
 
-   eraseIt = tree.preBegin(); // Root Node 2
-   eraseIt = eraseIt.firstChild(); // Node 7
-   graftIt = eraseIt.firstChild(); // Node 2
-   eraseIt = eraseIt.nextChild(); // Node 6
+      CountedTree copy(tree);
+      CHECK(copy == tree);
 
-   //chopTest(tree, eraseIt);
-   //eraseTest(tree, eraseIt);
-   //graftBackTest(tree, tree2, graftIt);
+      // Insertions fail whether it is the node or its slot in the children
+      // list that can't be allocated
+      long live = counters.live;
+      for(long budget = 0; budget < 2; ++budget) {
+         CountedTree::PreOrderIterator child = tree.preBegin();
+         child = child.firstChild();
+
+         for(int method = 0; method < 3; ++method) {
+            counters.budget = budget;
+            try {
+               Silence silence;
+               if(method == 0)
+                  tree.pushFrontChild(tree.preBegin(), 1000);
+               else if(method == 1)
+                  tree.pushBackChild(tree.preBegin(), 1000);
+               else
+                  tree.insertChild(tree.preBegin(), child, 1000);
+               CHECK(false);
+            }
+            catch(bad_alloc&) {}
+            counters.budget = -1;
+            CHECK(counters.live == live);
+            CHECK(tree == copy);
+         }
+      }
+
+      // Copies that run out of memory half way give back what they took
+      for(long budget = 0; budget < 400; budget += 13) {
+         counters.budget = budget;
+         try {
+            Silence silence;
+            CountedTree failed(tree);
+            counters.budget = -1;
+            CHECK(failed == tree);
+         }
+         catch(bad_alloc&) {}
+         counters.budget = -1;
+         CHECK(counters.live == live);
+      }
+
+      // Grafts that fail leave both trees as they were. Adopting the nodes of
+      // a tree with the same allocator only takes the slot in the children
+      // list, copying the foreign one takes two nodes and their slots
+      CountedTree same(7, alloc);
+      AllocationCounters foreignCounters;
+      CountedTree foreign(7, Allocator(foreignCounters));
+      foreign.pushBackChild(foreign.preBegin(), 8);
+      live = counters.live;
+      for(long budget = 0; budget < 4; ++budget) {
+         CountedTree::PreOrderIterator child = tree.preBegin();
+         child = child.firstChild();
+
+         for(int method = budget == 0 ? 0 : 1; method < 3; ++method) {
+            counters.budget = budget;
+            try {
+               Silence silence;
+               if(method == 0)
+                  tree.graftFront(tree.preBegin(), same);
+               else if(method == 1)
+                  tree.graftBack(tree.preBegin(), foreign);
+               else
+                  tree.graftAt(tree.preBegin(), child, foreign);
+               CHECK(false);
+            }
+            catch(bad_alloc&) {}
+            counters.budget = -1;
+            CHECK(counters.live == live);
+            CHECK(tree == copy);
+            CHECK(!same.empty() && !foreign.empty());
+         }
+      }
+
+      // Trees whose allocators don't compare equal are copied when grafted
+      tree.graftBack(tree.preBegin(), foreign);
+      CHECK(foreign.empty());
+      CHECK(foreignCounters.live == 0);
+
+      CountedTree::PreOrderIterator grafted = tree.preBegin();
+      grafted = grafted.lastChild();
+      CHECK(*grafted == 7 && grafted.nChildren() == 1);
+   }
+   CHECK(counters.live == 0);
+}
+
+
+// _____________________________________________________________________________
+
+// Trees on an arena take every node from it, graft into each other for free,
+// and run the destructors of their payloads without giving memory back
+void arenaTest() {
+   typedef Tree<int, TreeArenaAllocator<int> > ArenaTree;
+
+   TreeArena arena(4096);
+   {
+      ArenaTree tree(0, TreeArenaAllocator<int>(arena));
+      Shape shape = grow(tree, 500, 2);
+      vector<int> expected;
+      preorderOf(shape, 0, expected);
+      CHECK(collect(tree.preBegin(), tree.preEnd()) == expected);
+      CHECK(arena.bytesAllocated() >= 500 * sizeof(int));
+      CHECK(arena.nBlocks() > 1);
+
+      // Same arena: the nodes are adopted, nothing is copied
+      ArenaTree other(1000, TreeArenaAllocator<int>(arena));
+      other.pushBackChild(other.preBegin(), 1001);
+      ArenaTree::PreOrderIterator adopted = other.preBegin();
+      tree.graftFront(tree.preBegin(), other);
+      CHECK(other.empty());
+
+      ArenaTree::PreOrderIterator grafted = tree.preBegin();
+      grafted = grafted.firstChild();
+      CHECK(&*grafted == &*adopted);
+      CHECK(*grafted == 1000 && grafted.nChildren() == 1);
+
+      // Chopping doesn't give memory back to the arena
+      size_t before = arena.bytesAllocated();
+      tree.chop(grafted);
+      CHECK(arena.bytesAllocated() == before);
+      CHECK(collect(tree.preBegin(), tree.preEnd()) == expected);
+   }
+
+   arena.release();
+   CHECK(arena.bytesAllocated() == 0);
+   CHECK(arena.nBlocks() == 1);
+
+   for(size_t alignment = 1; alignment <= 64; alignment *= 2) {
+      void* memory = arena.allocate(3, alignment);
+      CHECK(reinterpret_cast<size_t>(memory) % alignment == 0);
+   }
+   void* big = arena.allocate(10000, 16);
+   CHECK(big != NULL && reinterpret_cast<size_t>(big) % 16 == 0);
+   arena.release();
+
+   // Payloads are destroyed even though their memory stays in the arena
+   {
+      Tree<Tracked, TreeArenaAllocator<Tracked> > tracked(Tracked(0), TreeArenaAllocator<Tracked>(arena));
+      for(int i = 1; i < 100; ++i)
+         tracked.pushBackChild(tracked.preBegin(), Tracked(i));
+      CHECK(Tracked::nLive == 100);
+   }
+   CHECK(Tracked::nLive == 0);
+}
+
+
+// _____________________________________________________________________________
+
+// Tree destroyed after the pool of the main thread, when the program exits
+Tree<int, TreePoolAllocator<int> > exitTree;
+
+// Nodes erased from a pooled tree are reused by the next insertions, and trees
+// on the pool of each thread can move from thread to thread
+void poolTest() {
+   typedef Tree<int, TreePoolAllocator<int> > PooledTree;
+
+   TreePool pool;
+   {
+      PooledTree tree(0, TreePoolAllocator<int>(pool));
+      Shape shape = grow(tree, 300, 3);
+
+      PooledTree::PreOrderIterator first = tree.preBegin();
+      first = first.firstChild();
+      tree.chop(first);
+      CHECK(pool.nFree() > 0);
+      CHECK(pool.nRecycled() > 0);
+
+      size_t nFree = pool.nFree();
+      pool.resetCounters();
+      for(int i = 0; i < 10; ++i)
+         tree.pushBackChild(tree.preBegin(), i);
+      CHECK(pool.nAllocations() > 0);
+      CHECK(pool.nReused() == pool.nAllocations());
+      CHECK(pool.nFree() < nFree);
+      CHECK(pool.reuseRate() == 1.0);
+   }
+
+   pool.setCap(4);
+   CHECK(pool.nFree() <= 4);
+   pool.shrink();
+   CHECK(pool.nFree() == 0);
+
+   // Built on a thread that is gone by the time the tree is changed and
+   // destroyed on this one
+   PooledTree* moved = NULL;
+   Shape shape;
+   std::thread builder([&moved, &shape]() {
+      moved = new PooledTree();
+      shape = grow(*moved, 300, 4);
+   });
+   builder.join();
+
+   vector<int> expected;
+   preorderOf(shape, 0, expected);
+   CHECK(collect(moved->preBegin(), moved->preEnd()) == expected);
+
+   PooledTree::PreOrderIterator first = moved->preBegin();
+   first = first.firstChild();
+   moved->chop(first);
+   TreePool::local().resetCounters();
+   moved->pushBackChild(moved->preBegin(), 300);
+   CHECK(TreePool::local().nAllocations() > 0);
+   CHECK(&moved->getAllocator().pool() == &TreePool::local());
+   delete moved;
+
+   grow(exitTree, 100, 5);
+
+#if __cplusplus > 201402L
+   // Nodes holding over-aligned payloads get blocks aligned for them, even
+   // after the pool has recycled the blocks of other nodes
+   {
+      typedef Tree<Wide, TreePoolAllocator<Wide> > WideTree;
+
+      WideTree tree(0, TreePoolAllocator<Wide>(pool));
+      grow(tree, 300, 6);
+      WideTree::PreOrderIterator child = tree.preBegin();
+      child = child.firstChild();
+      tree.chop(child);
+      for(int i = 0; i < 10; ++i)
+         tree.pushBackChild(tree.preBegin(), 300 + i);
+
+      bool aligned = true;
+      for(WideTree::PreOrderIterator it = tree.preBegin(); it != tree.preEnd(); ++it)
+         aligned = aligned && reinterpret_cast<std::uintptr_t>(&*it) % alignof(Wide) == 0;
+      CHECK(aligned);
+   }
+#endif
+}
+
+
+// _____________________________________________________________________________
+
+// Relayout places the nodes in the requested order without changing the tree,
+// and leaves the tree untouched when it runs out of memory
+void relayoutTest() {
+   typedef CountingAllocator<int> Allocator;
+   typedef Tree<int, Allocator> CountedTree;
+
+   AllocationCounters counters;
+   {
+      CountedTree tree(0, Allocator(counters));
+      Shape shape = grow(tree, 400, 6);
+      vector<int> expected;
+      preorderOf(shape, 0, expected);
+
+      TreeLayoutOrder orders[] = {TREE_PRE_ORDER_LAYOUT, TREE_BREADTH_FIRST_LAYOUT, TREE_VAN_EMDE_BOAS_LAYOUT};
+      for(int i = 0; i < 3; ++i) {
+         tree.relayout(orders[i]);
+         CHECK(collect(tree.preBegin(), tree.preEnd()) == expected);
+      }
+
+      // Pre-order layout: the payloads come one after the other in memory
+      tree.relayout(TREE_PRE_ORDER_LAYOUT);
+      bool ascending = true;
+      const int* previous = NULL;
+      for(CountedTree::PreOrderIterator it = tree.preBegin(); it != tree.preEnd(); ++it) {
+         ascending = ascending && (previous == NULL || previous < &*it);
+         previous = &*it;
+      }
+      CHECK(ascending);
+
+      // A subtree at a time
+      CountedTree::PreOrderIterator child = tree.preBegin();
+      child = child.firstChild();
+      tree.relayout(child, TREE_BREADTH_FIRST_LAYOUT);
+      CHECK(collect(tree.preBegin(), tree.preEnd()) == expected);
+
+      // Out of memory: nothing changes, nothing leaks
+      long live = counters.live;
+      counters.budget = 3;
+      try {
+         Silence silence;
+         tree.relayout(TREE_BREADTH_FIRST_LAYOUT);
+         CHECK(false);
+      }
+      catch(bad_alloc&) {}
+      counters.budget = -1;
+      CHECK(counters.live == live);
+      CHECK(collect(tree.preBegin(), tree.preEnd()) == expected);
+
+      // The relaid tree can still be changed node by node
+      tree.pushBackChild(tree.preBegin(), 400);
+      CountedTree::PreOrderIterator last = tree.preBegin();
+      last = last.lastChild();
+      tree.erase(last);
+      child = tree.preBegin();
+      child = child.firstChild();
+      tree.chop(child);
+      CHECK(collect(tree.preBegin(), tree.preEnd()).size() < expected.size());
+   }
+   CHECK(counters.live == 0);
+}
+
+
+// _____________________________________________________________________________
+
+// Cold payloads live apart from the nodes but behave like inline ones
+void coldPayloadTest() {
+   typedef CountingAllocator<ColdRecord> Allocator;
+   typedef Tree<ColdRecord, Allocator> ColdTree;
+
+   CHECK(sizeof(TreeNode<ColdRecord, Allocator>) < sizeof(ColdRecord));
+
+   AllocationCounters counters;
+   {
+      ColdTree tree(ColdRecord(0), Allocator(counters));
+      Shape shape = grow(tree, 200, 7);
+      vector<int> expected;
+      preorderOf(shape, 0, expected);
+      CHECK(collect(tree.preBegin(), tree.preEnd()) == expected);
+      CHECK(Tracked::nLive == 200);
+
+      // Relayout hands the payloads over instead of copying them
+      const ColdRecord* root = &*tree.preBegin();
+      tree.relayout(TREE_BREADTH_FIRST_LAYOUT);
+      CHECK(&*tree.preBegin() == root);
+      CHECK(collect(tree.preBegin(), tree.preEnd()) == expected);
+      CHECK(tree.preBegin()->value.value == 0);
+
+      ColdTree copy(tree);
+      CHECK(copy == tree);
+      CHECK(&*copy.preBegin() != root);
+
+      // Whether the node or its payload is the allocation that fails, the
+      // tree stays as it was
+      long live = counters.live;
+      for(long budget = 0; budget < 3; ++budget) {
+         counters.budget = budget;
+         try {
+            Silence silence;
+            tree.pushBackChild(tree.preBegin(), ColdRecord(200));
+            counters.budget = -1;
+            ColdTree::PreOrderIterator last = tree.preBegin();
+            last = last.lastChild();
+            tree.erase(last);
+         }
+         catch(bad_alloc&) {}
+         counters.budget = -1;
+         CHECK(counters.live == live);
+         CHECK(collect(tree.preBegin(), tree.preEnd()) == expected);
+      }
+   }
+   CHECK(counters.live == 0);
+   CHECK(Tracked::nLive == 0);
+}
+
+
+// _____________________________________________________________________________
+
+// Pre-order and post-order iterators walk the tree in order without a stack,
+// and their copies go on from where they were copied on their own
+void cursorTest() {
+   Tree<int> tree;
+   CHECK(tree.preBegin() == tree.preEnd());
+   CHECK(tree.postBegin() == tree.postEnd());
+
+   Shape shape = grow(tree, 500, 8);
+   vector<int> expectedPre, expectedPost;
+   preorderOf(shape, 0, expectedPre);
+   postorderOf(shape, 0, expectedPost);
+   CHECK(collect(tree.preBegin(), tree.preEnd()) == expectedPre);
+   CHECK(collect(tree.postBegin(), tree.postEnd()) == expectedPost);
+
+   // A copy taken half way goes on with the rest of the traversal
+   Tree<int>::PreOrderIterator it = tree.preBegin();
+   for(int i = 0; i < 250; ++i)
+      ++it;
+   Tree<int>::PreOrderIterator copy = it;
+   CHECK(collect(copy, tree.preEnd()) == vector<int>(expectedPre.begin() + 250, expectedPre.end()));
+   CHECK(*it == expectedPre[250]);
+   CHECK(*it++ == expectedPre[250]);
+   CHECK(*it == expectedPre[251]);
+
+   Tree<int>::PostOrderIterator postIt = tree.postBegin();
+   for(int i = 0; i < 250; ++i)
+      ++postIt;
+   Tree<int>::PostOrderIterator postCopy(postIt);
+   CHECK(collect(postCopy, tree.postEnd()) == vector<int>(expectedPost.begin() + 250, expectedPost.end()));
+   CHECK(*postIt == expectedPost[250]);
+
+   // Changes made through the iterators are seen by the next traversals
+   tree.pushFrontChild(tree.preBegin(), 500);
+   expectedPre.insert(expectedPre.begin() + 1, 500);
+   expectedPost.insert(expectedPost.begin(), 500);
+   CHECK(collect(tree.preBegin(), tree.preEnd()) == expectedPre);
+   CHECK(collect(tree.postBegin(), tree.postEnd()) == expectedPost);
+}
+
+
+// _____________________________________________________________________________
+
+// Subtree ranges visit the subtree and nothing else, in the same order as a
+// traversal of the whole tree
+void subtreeRangeTest() {
+   Tree<int> tree;
+   Shape shape = grow(tree, 400, 9);
+   vector<int> expected;
+   preorderOf(shape, 0, expected);
+   CHECK(collect(tree.preorder()) == expected);
+   expected.clear();
+   postorderOf(shape, 0, expected);
+   CHECK(collect(tree.postorder()) == expected);
+
+   for(int node = 0; node < 400; node += 7) {
+      Tree<int>::PreOrderIterator root = nodeOf(tree, node);
+
+      expected.clear();
+      preorderOf(shape, node, expected);
+      CHECK(collect(tree.preorder(root)) == expected);
+
+      expected.clear();
+      postorderOf(shape, node, expected);
+      CHECK(collect(tree.postorder(root)) == expected);
+
+      CHECK(collect(tree.children(root)) == shape.children[node]);
+      CHECK(tree.children(root).empty() == shape.children[node].empty());
+   }
+
+   // The last subtree of the tree ends where the tree ends
+   Tree<int>::PreOrderIterator last = tree.preBegin();
+   last = last.lastChild();
+   expected.clear();
+   preorderOf(shape, *last, expected);
+   CHECK(collect(tree.preorder(last)) == expected);
+
+   // The iterators of a children range can be used to change the tree
+   Tree<int>::PreOrderIterator child = tree.children(tree.preBegin()).begin();
+   tree.pushBackChild(child, 400);
+   expected.clear();
+   preorderOf(shape, *child, expected);
+   expected.push_back(400);
+   CHECK(collect(tree.preorder(child)) == expected);
+}
+
+
+// _____________________________________________________________________________
+
+// Depth-limited traversals stop at the given depth, and skipped subtrees are
+// left out of pre-order traversals
+void depthLimitTest() {
+   Tree<int> tree;
+   Shape shape = grow(tree, 400, 10);
+
+   for(unsigned int maxDepth = 0; maxDepth < 6; ++maxDepth) {
+      vector<int> expected;
+      preorderOf(shape, 0, expected, maxDepth);
+      CHECK(collect(tree.preorder(tree.preBegin(), maxDepth)) == expected);
+
+      expected.clear();
+      postorderOf(shape, 0, expected, maxDepth);
+      CHECK(collect(tree.postorder(tree.preBegin(), maxDepth)) == expected);
+
+      Tree<int>::PreOrderIterator child = tree.preBegin();
+      child = child.firstChild();
+      expected.clear();
+      preorderOf(shape, *child, expected, maxDepth);
+      CHECK(collect(tree.preorder(child, maxDepth)) == expected);
+   }
+
+   // Depths are counted from the root of the traversal
+   vector<unsigned int> depths(400);
+   bool depthsMatch = true;
+   for(Tree<int>::PreOrderIterator it = tree.preBegin(); it != tree.preEnd(); ++it) {
+      for(size_t i = 0; i < shape.children[*it].size(); ++i)
+         depths[shape.children[*it][i]] = depths[*it] + 1;
+      depthsMatch = depthsMatch && it.depth() == depths[*it];
+   }
+   CHECK(depthsMatch);
+
+   // Skipping the children of every odd node
+   vector<int> expected;
+   vector<int> pending(1, 0);
+   while(!pending.empty()) {
+      int node = pending.back();
+      pending.pop_back();
+      expected.push_back(node);
+      if(node % 2 == 0)
+         pending.insert(pending.end(), shape.children[node].rbegin(), shape.children[node].rend());
+   }
+
+   vector<int> visited;
+   for(Tree<int>::PreOrderIterator it = tree.preBegin(); it != tree.preEnd(); ++it) {
+      visited.push_back(*it);
+      if(*it % 2 != 0)
+         it.skipChildren();
+   }
+   CHECK(visited == expected);
+}
+
+
+// _____________________________________________________________________________
+
+// Check the leaf counts and the k-th leaves of every node of a tree against
+// the leaves its traversals find
+bool leafCountsHold(const Tree<int>& tree) {
+   bool hold = true;
+   for(Tree<int>::PreOrderIterator it = tree.preBegin(); it != tree.preEnd(); ++it) {
+      vector<int> leaves = collect(tree.leaves(it));
+      hold = hold && tree.nLeaves(it) == leaves.size();
+      for(size_t k = 0; k < leaves.size(); k += 3)
+         hold = hold && *tree.leafAt(it, k) == leaves[k];
+      hold = hold && tree.leafAt(it, leaves.size()) == tree.leafEnd();
+   }
+
+   return hold;
+}
+
+// _____________________________________________________________________________
+
+// Leaf iterators visit the leaves from left to right, and the leaf index keeps
+// the counts right through every kind of change
+void leafTest() {
+   Tree<int> tree;
+   Shape shape = grow(tree, 300, 11);
+   vector<int> expected;
+   leavesOf(shape, 0, expected);
+   CHECK(collect(tree.leafBegin(), tree.leafEnd()) == expected);
+   CHECK(collect(tree.leaves()) == expected);
+
+   for(int node = 0; node < 300; node += 11) {
+      expected.clear();
+      leavesOf(shape, node, expected);
+      CHECK(collect(tree.leaves(nodeOf(tree, node))) == expected);
+   }
+
+   CHECK(!tree.leafIndexEnabled());
+   CHECK(leafCountsHold(tree));
+   tree.enableLeafIndex();
+   CHECK(tree.leafIndexEnabled());
+   CHECK(leafCountsHold(tree));
+
+   // Insertions under leaves and inner nodes
+   Tree<int>::PreOrderIterator leaf;
+   leaf = tree.leafBegin();
+   tree.pushBackChild(leaf, 300);
+   tree.pushFrontChild(leaf, 301);
+   tree.pushBackChild(tree.preBegin(), 302);
+   CHECK(leafCountsHold(tree));
+
+   // Erasures, chops, prunes and grafts
+   Tree<int>::PreOrderIterator node = nodeOf(tree, 1);
+   tree.erase(node);
+   CHECK(leafCountsHold(tree));
+
+   node = nodeOf(tree, 2);
+   tree.chop(node);
+   CHECK(leafCountsHold(tree));
+
+   node = tree.preBegin();
+   node = node.firstChild();
+   Tree<int> pruned = tree.prune(node);
+   CHECK(leafCountsHold(tree));
+   CHECK(pruned.leafIndexEnabled());
+   CHECK(leafCountsHold(pruned));
+
+   leaf = tree.leafBegin();
+   tree.graftBack(leaf, pruned);
+   CHECK(leafCountsHold(tree));
+
+   Tree<int> copy(tree);
+   CHECK(copy.leafIndexEnabled());
+   CHECK(leafCountsHold(copy));
+
+   tree.disableLeafIndex();
+   CHECK(leafCountsHold(tree));
+}
+
+
+// _____________________________________________________________________________
+
+// Tree iterators and ranges work with the standard algorithms and, as C++20,
+// with the adaptors of <ranges>
+void standardIteratorTest() {
+   Tree<int> tree;
+   Shape shape = grow(tree, 200, 12);
+   vector<int> expected;
+   preorderOf(shape, 0, expected);
+
+   CHECK(std::distance(tree.preBegin(), tree.preEnd()) == 200);
+   CHECK(std::accumulate(tree.preBegin(), tree.preEnd(), 0) == 199 * 200 / 2);
+   CHECK(std::count_if(tree.postBegin(), tree.postEnd(), [](int value) { return value % 2 == 0; }) == 100);
+   CHECK(*std::find(tree.preBegin(), tree.preEnd(), 100) == 100);
+   CHECK(std::find(tree.preBegin(), tree.preEnd(), 200) == tree.preEnd());
+   CHECK(std::equal(tree.preBegin(), tree.preEnd(), expected.begin()));
+
+   vector<int> copied;
+   std::copy(tree.preorder().begin(), tree.preorder().end(), std::back_inserter(copied));
+   CHECK(copied == expected);
+
+   int total = 0;
+   for(int value : tree.preorder())
+      total += value;
+   CHECK(total == 199 * 200 / 2);
+
+   TreeRange<Tree<int>::PreOrderIterator> empty;
+   CHECK(empty.empty());
+
+#if __cplusplus > 201703L
+   static_assert(std::forward_iterator<Tree<int>::PreOrderIterator>);
+   static_assert(std::forward_iterator<Tree<int>::PostOrderIterator>);
+   static_assert(std::forward_iterator<Tree<int>::LeafIterator>);
+   static_assert(std::ranges::view<TreeRange<Tree<int>::PreOrderIterator> >);
+
+   vector<int> evens;
+   for(int value : tree.preorder() | std::views::filter([](int value) { return value % 2 == 0; }) | std::views::transform([](int value) { return value / 2; }))
+      evens.push_back(value);
+
+   vector<int> expectedEvens;
+   for(size_t i = 0; i < expected.size(); ++i)
+      if(expected[i] % 2 == 0)
+         expectedEvens.push_back(expected[i] / 2);
+   CHECK(evens == expectedEvens);
+   CHECK(std::ranges::distance(tree.leaves()) == static_cast<std::ptrdiff_t>(tree.nLeaves(tree.preBegin())));
+#endif
+}
+
+
+// _____________________________________________________________________________
+
+// Check that the traversals of a tree visit the same nodes whatever they
+// prefetch
+template <class T, class Alloc>
+void checkPrefetch(const Tree<T, Alloc>& tree, const Shape& shape) {
+   vector<int> expectedPre, expectedPost, expectedLeaves;
+   preorderOf(shape, 0, expectedPre);
+   postorderOf(shape, 0, expectedPost);
+   leavesOf(shape, 0, expectedLeaves);
+
+   TreePrefetchMode modes[] = {TREE_NO_PREFETCH, TREE_PREFETCH_NODES, TREE_PREFETCH_PAYLOADS};
+   for(int i = 0; i < 3; ++i) {
+      typename Tree<T, Alloc>::PreOrderIterator preIt = tree.preBegin();
+      preIt.setPrefetch(modes[i]);
+      CHECK(collect(preIt, tree.preEnd()) == expectedPre);
+
+      typename Tree<T, Alloc>::PostOrderIterator postIt = tree.postBegin();
+      postIt.setPrefetch(modes[i]);
+      CHECK(collect(postIt, tree.postEnd()) == expectedPost);
+
+      typename Tree<T, Alloc>::LeafIterator leafIt = tree.leafBegin();
+      leafIt.setPrefetch(modes[i]);
+      CHECK(collect(leafIt, tree.leafEnd()) == expectedLeaves);
+
+      // Subtrees and depth limits
+      typename Tree<T, Alloc>::PreOrderIterator child = tree.preBegin();
+      child = child.firstChild();
+      typename Tree<T, Alloc>::PreOrderIterator subtreeIt = tree.preorder(child, 2).begin();
+      subtreeIt.setPrefetch(modes[i]);
+      vector<int> expected;
+      preorderOf(shape, *child, expected, 2);
+      CHECK(collect(subtreeIt, tree.preEnd()) == expected);
+   }
+}
+
+// _____________________________________________________________________________
+
+// Prefetching doesn't change what the traversals visit, whether the payloads
+// live in the nodes or apart from them
+void prefetchTest() {
+   Tree<int> tree;
+   Shape shape = grow(tree, 300, 13);
+   checkPrefetch(tree, shape);
+
+   AllocationCounters counters;
+   Tree<ColdRecord, CountingAllocator<ColdRecord> > coldTree(ColdRecord(0), CountingAllocator<ColdRecord>(counters));
+   shape = grow(coldTree, 300, 13);
+   checkPrefetch(coldTree, shape);
+}
+
+
+// _____________________________________________________________________________
+
+// Interleaved traversals visit every subtree in order, however many subtrees
+// are walked at once
+void interleaverTest() {
+   vector< Tree<int> > trees(20);
+   vector< vector<int> > expectedPre(21), expectedPost(21);
+   for(int i = 0; i < 20; ++i) {
+      Shape shape = grow(trees[i], 1 + i * 13, 14 + i);
+      preorderOf(shape, 0, expectedPre[i]);
+      postorderOf(shape, 0, expectedPost[i]);
+   }
+
+   // The last subtree is a subtree of the last tree
+   Tree<int>::PreOrderIterator child = trees[19].preBegin();
+   child = child.firstChild();
+   expectedPre[20] = collect(trees[19].preorder(child));
+   expectedPost[20] = collect(trees[19].postorder(child));
+
+   unsigned int widths[] = {1, 3, 8, 64};
+   for(int i = 0; i < 4; ++i) {
+      TreeInterleaver<int> interleaver(widths[i], i % 2 == 0 ? TREE_PREFETCH_NODES : TREE_NO_PREFETCH);
+      CHECK(interleaver.width() == widths[i]);
+      for(int j = 0; j < 20; ++j)
+         CHECK(interleaver.add(trees[j].preBegin()) == static_cast<size_t>(j));
+      CHECK(interleaver.add(child) == 20);
+      CHECK(interleaver.size() == 21);
+
+      vector< vector<int> > visited(21);
+      interleaver.preOrder(PerSubtree(visited));
+      CHECK(visited == expectedPre);
+
+      visited.assign(21, vector<int>());
+      interleaver.postOrder(PerSubtree(visited));
+      CHECK(visited == expectedPost);
+
+      interleaver.clear();
+      CHECK(interleaver.size() == 0);
+      visited.assign(21, vector<int>());
+      interleaver.preOrder(PerSubtree(visited));
+      CHECK(visited == vector< vector<int> >(21));
+   }
+}
+
+
+// _____________________________________________________________________________
+
+// Reverse traversals visit the nodes in the opposite order to the forward ones
+void reverseTest() {
+   Tree<int> tree;
+   CHECK(tree.preRBegin() == tree.preREnd());
+   CHECK(tree.postRBegin() == tree.postREnd());
+
+   Shape shape = grow(tree, 400, 15);
+   vector<int> expected;
+   preorderOf(shape, 0, expected);
+   CHECK(collect(tree.preRBegin(), tree.preREnd()) == vector<int>(expected.rbegin(), expected.rend()));
+   expected.clear();
+   postorderOf(shape, 0, expected);
+   CHECK(collect(tree.postRBegin(), tree.postREnd()) == vector<int>(expected.rbegin(), expected.rend()));
+
+   for(int node = 0; node < 400; node += 9) {
+      Tree<int>::PreOrderIterator root = nodeOf(tree, node);
+      for(unsigned int maxDepth = 1; maxDepth < 5; maxDepth += 3) {
+         expected.clear();
+         preorderOf(shape, node, expected, maxDepth);
+         CHECK(collect(tree.reversePreorder(root, maxDepth)) == vector<int>(expected.rbegin(), expected.rend()));
+
+         expected.clear();
+         postorderOf(shape, node, expected, maxDepth);
+         CHECK(collect(tree.reversePostorder(root, maxDepth)) == vector<int>(expected.rbegin(), expected.rend()));
+      }
+
+      expected.clear();
+      preorderOf(shape, node, expected);
+      CHECK(collect(tree.reversePreorder(root)) == vector<int>(expected.rbegin(), expected.rend()));
+
+      expected = shape.children[node];
+      CHECK(collect(tree.reverseChildren(root)) == vector<int>(expected.rbegin(), expected.rend()));
+   }
+}
+
+
+// _____________________________________________________________________________
+
+// Path from the root to a node, built out of its ancestors
+string pathOf(const Tree<int>& tree, const Tree<int>::PreOrderIterator& node) {
+   vector<int> ancestors = collect(tree.ancestors(node));
+   string path;
+   for(vector<int>::reverse_iterator it = ancestors.rbegin(); it != ancestors.rend(); ++it)
+      path += "/" + to_string(*it);
+
+   return path + "/" + to_string(*node);
+}
+
+// _____________________________________________________________________________
+
+// Key function of the path caches
+string joinPath(const string& parentPath, const int& value) {
+   return parentPath + "/" + to_string(value);
+}
+
+// _____________________________________________________________________________
+
+// Check every key of a path cache against the path of its node
+bool pathsHold(const Tree<int>& tree, TreePathCache<int, string>& paths) {
+   bool hold = true;
+   for(Tree<int>::PreOrderIterator it = tree.preBegin(); it != tree.preEnd(); ++it)
+      hold = hold && paths.get(it) == pathOf(tree, it);
+
+   return hold;
+}
+
+// _____________________________________________________________________________
+
+// Ancestor ranges go from the parent up to the root, and path caches drop the
+// keys of the nodes whose path changes
+void ancestorTest() {
+   Tree<int>* tree = new Tree<int>();
+   Shape shape = grow(*tree, 300, 16);
+
+   vector<int> parents(300, -1);
+   for(int node = 0; node < 300; ++node)
+      for(size_t i = 0; i < shape.children[node].size(); ++i)
+         parents[shape.children[node][i]] = node;
+
+   for(int node = 0; node < 300; node += 7) {
+      vector<int> expected;
+      for(int parent = parents[node]; parent != -1; parent = parents[parent])
+         expected.push_back(parent);
+      CHECK(collect(tree->ancestors(nodeOf(*tree, node))) == expected);
+   }
+   CHECK(tree->ancestors(tree->preBegin()).empty());
+
+   TreePathCache<int, string>* paths = new TreePathCache<int, string>(*tree, joinPath);
+   CHECK(paths->size() == 0);
+   Tree<int>::PreOrderIterator deep;
+   deep = tree->leafAt(tree->preBegin(), 100);
+   CHECK(paths->get(deep) == pathOf(*tree, deep));
+   CHECK(paths->size() == collect(tree->ancestors(deep)).size() + 1);
+   CHECK(pathsHold(*tree, *paths));
+   CHECK(paths->size() == 300);
+
+   // Erasing a node moves its children up
+   Tree<int>::PreOrderIterator node = tree->preBegin();
+   node = node.firstChild();
+   tree->erase(node);
+   CHECK(paths->size() < 299);
+   CHECK(pathsHold(*tree, *paths));
+
+   // Chopped nodes are forgotten, pruned ones too
+   node = tree->preBegin();
+   node = node.lastChild();
+   tree->chop(node);
+   CHECK(pathsHold(*tree, *paths));
+   size_t size = paths->size();
+   node = tree->preBegin();
+   node = node.firstChild();
+   Tree<int> pruned = tree->prune(node);
+   CHECK(paths->size() < size);
+   CHECK(pathsHold(*tree, *paths));
+
+   // Grafted nodes get a path of their own
+   Tree<int>::PreOrderIterator leaf;
+   leaf = tree->leafBegin();
+   tree->graftBack(leaf, pruned);
+   CHECK(pathsHold(*tree, *paths));
+
+   // Payloads aren't seen by the tree, invalidating by hand picks them up
+   node = tree->preBegin();
+   node = node.firstChild();
+   *node = 1000;
+   paths->invalidate(node);
+   CHECK(pathsHold(*tree, *paths));
+
+   tree->relayout();
+   CHECK(pathsHold(*tree, *paths));
+   paths->clear();
+   CHECK(paths->size() == 0);
+
+   // The tree may go first
+   delete tree;
+   CHECK(paths->size() == 0);
+   delete paths;
+}
+
+
+// _____________________________________________________________________________
+
+// Euler tour of a shape, three values per step: the node, the event and the
+// depth
+void eulerTourOf(const Shape& shape, int node, unsigned int depth, unsigned int maxDepth, vector<int>& result) {
+   result.push_back(node);
+   result.push_back(TREE_ENTER);
+   result.push_back(depth);
+   for(size_t i = 0; depth < maxDepth && i < shape.children[node].size(); ++i)
+      eulerTourOf(shape, shape.children[node][i], depth + 1, maxDepth, result);
+   result.push_back(node);
+   result.push_back(TREE_EXIT);
+   result.push_back(depth);
+}
+
+// _____________________________________________________________________________
+
+// Steps of an Euler tour, three values per step like eulerTourOf()
+vector<int> collectTour(const TreeRange<Tree<int>::EulerTourIterator>& tour) {
+   vector<int> steps;
+   for(Tree<int>::EulerTourIterator it = tour.begin(); it != tour.end(); ++it) {
+      steps.push_back(*it);
+      steps.push_back(it.event());
+      steps.push_back(it.depth());
+   }
+
+   return steps;
+}
+
+// _____________________________________________________________________________
+
+// Euler tours enter every node before its children and exit it after them, in
+// a single pass
+void eulerTourTest() {
+   Tree<int> tree;
+   CHECK(tree.eulerBegin() == tree.eulerEnd());
+
+   Shape shape = grow(tree, 300, 17);
+   vector<int> expected;
+   eulerTourOf(shape, 0, 0, TREE_UNLIMITED_DEPTH, expected);
+   CHECK(collectTour(tree.eulerTour()) == expected);
+   CHECK(collectTour(TreeRange<Tree<int>::EulerTourIterator>(tree.eulerBegin(), tree.eulerEnd())) == expected);
+
+   for(int node = 0; node < 300; node += 13) {
+      Tree<int>::PreOrderIterator root = nodeOf(tree, node);
+      for(unsigned int maxDepth = 0; maxDepth < 4; maxDepth += 3) {
+         expected.clear();
+         eulerTourOf(shape, node, 0, maxDepth, expected);
+         CHECK(collectTour(tree.eulerTour(root, maxDepth)) == expected);
+      }
+
+      expected.clear();
+      eulerTourOf(shape, node, 0, TREE_UNLIMITED_DEPTH, expected);
+      CHECK(collectTour(tree.eulerTour(root)) == expected);
+   }
+
+   // A leaf is entered and exited right away
+   Tree<int>::PreOrderIterator leaf;
+   leaf = tree.leafBegin();
+   Tree<int>::EulerTourIterator step = tree.eulerTour(leaf).begin();
+   CHECK(step.event() == TREE_ENTER);
+   ++step;
+   CHECK(*step == *leaf && step.event() == TREE_EXIT);
+   ++step;
+   CHECK(step == tree.eulerEnd());
+}
+
+
+// _____________________________________________________________________________
+
+// Parallel traversals visit every node exactly once, bottom-up ones after the
+// descendants of the node, whatever executor runs them
+void parallelForEachTest() {
+   Tree<int> tree;
+   Shape shape = grow(tree, 20000, 18);
+
+   // A long chain under the last child, which defeats splitting by subtrees
+   Tree<int>::PreOrderIterator chain = tree.preBegin();
+   chain = chain.lastChild();
+   for(int i = 20000; i < 25000; ++i) {
+      shape.children.push_back(vector<int>());
+      shape.children[*chain].push_back(i);
+      chain = tree.pushBackChild(chain, i);
+   }
+
+   TreeWorkStealingPool pool(4);
+   TreeParallelOrder orders[] = {TREE_TOP_DOWN, TREE_BOTTOM_UP};
+   for(int i = 0; i < 2; ++i) {
+      for(size_t grain = 1; grain <= 4096; grain *= 64) {
+         vector< atomic<int> > visits(25000);
+         atomic<bool> inOrder(true);
+         TreeParallel<int>(pool, grain).forEach(tree.preBegin(), CountVisits(shape, visits, inOrder, i == 1), orders[i]);
+
+         bool once = true;
+         for(size_t j = 0; j < visits.size(); ++j)
+            once = once && visits[j].load() == 1;
+         CHECK(once);
+         CHECK(inOrder.load());
+      }
+
+      // Subtrees, with the global executor and with a given one
+      Tree<int>::PreOrderIterator child = tree.preBegin();
+      child = child.firstChild();
+      vector<int> expected;
+      preorderOf(shape, *child, expected);
+      vector< atomic<int> > visits(25000);
+      atomic<bool> inOrder(true);
+      TreeParallel<int>(TreeExecutor::global(), 16).forEach(child, CountVisits(shape, visits, inOrder, i == 1), orders[i]);
+      bool once = true;
+      for(size_t j = 0; j < expected.size(); ++j)
+         once = once && visits[expected[j]].exchange(0) == 1;
+      for(size_t j = 0; j < visits.size(); ++j)
+         once = once && visits[j].load() == 0;
+      CHECK(once);
+      CHECK(inOrder.load());
+
+      parallelForEach(pool, tree, CountVisits(shape, visits, inOrder, i == 1), orders[i]);
+      parallelForEach(tree, CountVisits(shape, visits, inOrder, i == 1), orders[i]);
+      once = true;
+      for(size_t j = 0; j < visits.size(); ++j)
+         once = once && visits[j].load() == 2;
+      CHECK(once);
+      CHECK(inOrder.load());
+   }
+
+   // Changes made by the function are seen once the traversal is over
+   parallelForEach(pool, tree, [](int& value) { value *= 2; });
+   vector<int> expected;
+   preorderOf(shape, 0, expected);
+   for(size_t i = 0; i < expected.size(); ++i)
+      expected[i] *= 2;
+   CHECK(collect(tree.preBegin(), tree.preEnd()) == expected);
+
+   // The first exception is thrown once every task is done
+   atomic<int> nVisited(0);
+   try {
+      TreeParallel<int>(pool, 16).forEach(tree.preBegin(), [&nVisited](int& value) {
+         nVisited.fetch_add(1);
+         if(value == 2 * 12345)
+            throw runtime_error("12345");
+      });
+      CHECK(false);
+   }
+   catch(runtime_error& ex) {
+      CHECK(string(ex.what()) == "12345");
+   }
+   CHECK(nVisited.load() <= 25000);
+
+   // The pool is still usable after the failure
+   vector< atomic<int> > visits(25000);
+   atomic<bool> inOrder(true);
+   parallelForEach(pool, tree, [](int& value) { value /= 2; });
+   parallelForEach(pool, tree, CountVisits(shape, visits, inOrder, false));
+   bool once = true;
+   for(size_t j = 0; j < visits.size(); ++j)
+      once = once && visits[j].load() == 1;
+   CHECK(once);
+
+   Tree<int> empty;
+   parallelForEach(pool, empty, CountVisits(shape, visits, inOrder, false));
+}
+
+
+// _____________________________________________________________________________
+
+// Parallel reductions keep the order of the operands, and deterministic ones
+// give the same result bit by bit whatever the number of threads
+void parallelReduceTest() {
+   Tree<int> tree;
+   Shape shape = grow(tree, 20000, 19);
+   vector<int> expected;
+   preorderOf(shape, 0, expected);
+
+   // Concatenation is associative but not commutative
+   auto wrap = [](int value) { return vector<int>(1, value); };
+   auto concatenate = [](vector<int> a, const vector<int>& b) {
+      a.insert(a.end(), b.begin(), b.end());
+      return a;
+   };
+
+   TreeWorkStealingPool pool(4);
+   TreeReduceMode modes[] = {TREE_REDUCE_FAST, TREE_REDUCE_DETERMINISTIC};
+   for(int i = 0; i < 2; ++i) {
+      for(size_t grain = 1; grain <= 4096; grain *= 64)
+         CHECK(TreeParallel<int>(pool, grain).reduce(tree.preBegin(), wrap, concatenate, modes[i]) == expected);
+
+      Tree<int>::PreOrderIterator child = tree.preBegin();
+      child = child.lastChild();
+      vector<int> subtree;
+      preorderOf(shape, *child, subtree);
+      CHECK(TreeParallel<int>(pool, 16).reduce(child, wrap, concatenate, modes[i]) == subtree);
+   }
+   CHECK(parallelReduce(pool, tree, [](int value) { return static_cast<long>(value); }, std::plus<long>()) == 19999L * 20000 / 2);
+   CHECK(parallelReduce(tree, [](int value) { return static_cast<long>(value); }, std::plus<long>()) == 19999L * 20000 / 2);
+
+   // Floating point sums differ with the grouping, deterministic ones don't
+   auto reciprocal = [](int value) { return 1.0 / (value + 1); };
+   TreeWorkStealingPool serial(1);
+   double reference = TreeParallel<int>(serial, 64).reduce(tree.preBegin(), reciprocal, std::plus<double>(), TREE_REDUCE_DETERMINISTIC);
+   bool reproducible = true;
+   for(int run = 0; run < 10; ++run) {
+      double sum = TreeParallel<int>(pool, 64).reduce(tree.preBegin(), reciprocal, std::plus<double>(), TREE_REDUCE_DETERMINISTIC);
+      reproducible = reproducible && memcmp(&sum, &reference, sizeof(double)) == 0;
+   }
+   CHECK(reproducible);
+
+   // Empty subtrees give a value initialized value
+   Tree<int> empty;
+   CHECK(parallelReduce(pool, empty, wrap, concatenate).empty());
+
+   // The first exception is thrown once every task is done
+   try {
+      TreeParallel<int>(pool, 16).reduce(tree.preBegin(), [](int value) {
+         if(value == 12345)
+            throw runtime_error("12345");
+         return value;
+      }, std::plus<int>());
+      CHECK(false);
+   }
+   catch(runtime_error& ex) {
+      CHECK(string(ex.what()) == "12345");
+   }
+}
+
+
+// _____________________________________________________________________________
+
+// Check that a tree has the same shape as a subtree of another one, and holds
+// the values of its nodes plus a half
+template <class Source, class Copy>
+bool transformed(const Source& source, const typename Source::PreOrderIterator& subtreeRoot, const Copy& copy) {
+   typename Source::PreOrderIterator sourceIt = source.preorder(subtreeRoot).begin();
+   typename Copy::PreOrderIterator copyIt = copy.preBegin();
+   bool same = true;
+   for(; same && sourceIt != source.preEnd() && copyIt != copy.preEnd(); ++sourceIt, ++copyIt)
+      same = *copyIt == *sourceIt + 0.5 && copyIt.nChildren() == sourceIt.nChildren();
+
+   return same && sourceIt == source.preEnd() && copyIt == copy.preEnd();
+}
+
+// _____________________________________________________________________________
+
+// Parallel transforms build trees with the same shape, allocated from the
+// threads of the executor with an allocator that can take it
+void parallelTransformTest() {
+   auto half = [](int value) { return value + 0.5; };
+
+   Tree<int> tree;
+   grow(tree, 20000, 20);
+   TreeWorkStealingPool pool(4);
+   for(size_t grain = 1; grain <= 4096; grain *= 64) {
+      Tree<double> copy = TreeParallel<int>(pool, grain).transform<double>(tree.preBegin(), half);
+      CHECK(transformed(tree, tree.preBegin(), copy));
+   }
+
+   Tree<int>::PreOrderIterator child = tree.preBegin();
+   child = child.firstChild();
+   CHECK(transformed(tree, child, TreeParallel<int>(pool, 16).transform<double>(child, half)));
+   CHECK(transformed(tree, tree.preBegin(), parallelTransform<double>(tree, half)));
+
+   Tree<int> empty;
+   CHECK(parallelTransform<double>(pool, empty, half).empty());
+
+   // Arenas and pools of the source tree aren't handed over to the threads
+   typedef Tree<int, TreeArenaAllocator<int> > ArenaTree;
+   TreeArena arena;
+   ArenaTree arenaTree(0, TreeArenaAllocator<int>(arena));
+   grow(arenaTree, 20000, 21);
+   size_t arenaBytes = arena.bytesAllocated();
+   Tree<double> fromArena = parallelTransform<double>(pool, arenaTree, half);
+   CHECK((is_same<Tree<double>, decltype(fromArena)>::value));
+   CHECK(transformed(arenaTree, arenaTree.preBegin(), fromArena));
+   CHECK(arena.bytesAllocated() == arenaBytes);
+
+   typedef Tree<int, TreePoolAllocator<int> > PooledTree;
+   TreePool treePool;
+   PooledTree pooledTree(0, TreePoolAllocator<int>(treePool));
+   grow(pooledTree, 20000, 22);
+   treePool.resetCounters();
+   CHECK(transformed(pooledTree, pooledTree.preBegin(), parallelTransform<double>(pool, pooledTree, half)));
+   CHECK(treePool.nAllocations() == 0);
+
+   // Given allocators are used for every node, and get back what was taken
+   // when the function throws
+   TreeWorkStealingPool serial(1);
+   AllocationCounters counters;
+   {
+      Tree<double, CountingAllocator<double> > copy =
+         TreeParallel<int>(serial, 64).transform<double>(tree.preBegin(), half, CountingAllocator<double>(counters));
+      CHECK(counters.live > 0);
+      CHECK(transformed(tree, tree.preBegin(), copy));
+   }
+   CHECK(counters.live == 0);
+
+   try {
+      TreeParallel<int>(serial, 64).transform<double>(tree.preBegin(), [](int value) {
+         if(value == 12345)
+            throw runtime_error("12345");
+         return value + 0.5;
+      }, CountingAllocator<double>(counters));
+      CHECK(false);
+   }
+   catch(runtime_error& ex) {
+      CHECK(string(ex.what()) == "12345");
+   }
+   CHECK(counters.live == 0);
+}
+
+
+// _____________________________________________________________________________
+
+// Contractions evaluate any shape of tree like a serial bottom-up evaluation
+void parallelContractTest() {
+   Tree<int> tree;
+   Shape shape = grow(tree, 10000, 23);
+
+   // A long chain under the first child and a huge fan-out under the last one
+   Tree<int>::PreOrderIterator chain = tree.preBegin();
+   chain = chain.firstChild();
+   Tree<int>::PreOrderIterator fan = tree.preBegin();
+   fan = fan.lastChild();
+   int nNodes = 10000;
+   for(int i = 0; i < 5000; ++i, ++nNodes) {
+      shape.children.push_back(vector<int>());
+      shape.children[*chain].push_back(nNodes);
+      chain = tree.pushBackChild(chain, nNodes);
+   }
+   for(int i = 0; i < 5000; ++i, ++nNodes) {
+      shape.children.push_back(vector<int>());
+      shape.children[*fan].push_back(nNodes);
+      tree.pushBackChild(fan, nNodes);
+   }
+
+   TreeWorkStealingPool pool(4);
+   uint64_t expected = evaluate(shape, 0);
+   for(size_t grain = 1; grain <= 4096; grain *= 64)
+      CHECK(TreeParallel<int>(pool, grain).contract(tree.preBegin(), ModularAlgebra()) == expected);
+   CHECK(parallelContract(pool, tree, ModularAlgebra()) == expected);
+   CHECK(parallelContract(tree, ModularAlgebra()) == expected);
+
+   Tree<int>::PreOrderIterator child = tree.preBegin();
+   child = child.firstChild();
+   CHECK(TreeParallel<int>(pool, 16).contract(child, ModularAlgebra()) == evaluate(shape, *child));
+
+   // Leaves and empty trees
+   Tree<int>::PreOrderIterator leaf;
+   leaf = tree.leafBegin();
+   CHECK(TreeParallel<int>(pool, 16).contract(leaf, ModularAlgebra()) == static_cast<uint64_t>(*leaf));
+   Tree<int> empty;
+   CHECK(parallelContract(pool, empty, ModularAlgebra()) == 0);
+}
+
+
+// _____________________________________________________________________________
+
+// Check the positions computed by a parallel scan against the expected ones
+bool sameScan(const vector< TreeScanInfo<long> >& infos, const vector< TreeScanInfo<long> >& expected, const vector<int>& nodes) {
+   bool same = true;
+   for(size_t i = 0; i < nodes.size(); ++i) {
+      const TreeScanInfo<long>& info = infos[nodes[i]];
+      const TreeScanInfo<long>& reference = expected[nodes[i]];
+      same = same && info.depth == reference.depth && info.preorder == reference.preorder && info.size == reference.size &&
+             info.prefix == reference.prefix;
+   }
+
+   return same;
+}
+
+// _____________________________________________________________________________
+
+// Parallel scans number the nodes and combine the values along their paths
+// like a serial pre-order traversal
+void parallelScanTest() {
+   Tree<int> tree;
+   Shape shape = grow(tree, 20000, 24);
+
+   // A long chain under the last child
+   Tree<int>::PreOrderIterator chain = tree.preBegin();
+   chain = chain.lastChild();
+   for(int i = 20000; i < 25000; ++i) {
+      shape.children.push_back(vector<int>());
+      shape.children[*chain].push_back(i);
+      chain = tree.pushBackChild(chain, i);
+   }
+
+   vector<int> nodes;
+   preorderOf(shape, 0, nodes);
+   vector< TreeScanInfo<long> > expected(25000);
+   size_t preorder = 0;
+   scanOf(shape, 0, 0, 0, preorder, expected);
+
+   auto value = [](int data) { return static_cast<long>(data); };
+   TreeWorkStealingPool pool(4);
+   for(size_t grain = 1; grain <= 4096; grain *= 64) {
+      vector< TreeScanInfo<long> > infos(25000);
+      TreeParallel<int>(pool, grain).scan(tree.preBegin(), value, std::plus<long>(), std::negate<long>(), KeepScanInfo(infos));
+      CHECK(sameScan(infos, expected, nodes));
+   }
+
+   vector< TreeScanInfo<long> > infos(25000);
+   parallelScan(pool, tree, value, std::plus<long>(), std::negate<long>(), KeepScanInfo(infos));
+   CHECK(sameScan(infos, expected, nodes));
+
+   // Subtrees are numbered from their root
+   Tree<int>::PreOrderIterator child = tree.preBegin();
+   child = child.firstChild();
+   nodes.clear();
+   preorderOf(shape, *child, nodes);
+   preorder = 0;
+   scanOf(shape, *child, 0, 0, preorder, expected);
+   TreeParallel<int>(pool, 16).scan(child, value, std::plus<long>(), std::negate<long>(), KeepScanInfo(infos));
+   CHECK(sameScan(infos, expected, nodes));
+
+   Tree<int> empty;
+   parallelScan(pool, empty, value, std::plus<long>(), std::negate<long>(), KeepScanInfo(infos));
+}
+
+
+// _____________________________________________________________________________
+
+// Readers walk a concurrent tree while a writer changes it, and the writer
+// ends up with the same tree as the model
+void concurrentTreeTest() {
+   typedef CountingAllocator<Stamp> Allocator;
+
+   AllocationCounters counters;
+   {
+      TreeConcurrent<Stamp, Allocator> tree(Stamp(0), Allocator(counters));
+      Model model;
+      model.setRoot(0);
+      NodeMap<Allocator> nodes;
+      nodes.add(tree.root());
+
+      atomic<bool> stop(false), consistent(true);
+      atomic<long> nWalks(0);
+      vector<thread> readers;
+      for(int i = 0; i < 3; ++i)
+         readers.push_back(thread(readUntil<Allocator>, std::cref(tree), std::cref(stop), std::ref(consistent), std::ref(nWalks)));
+
+      mutate(tree, model, nodes, 0, 1, 3000, 25);
+      while(nWalks.load() < 10)
+         this_thread::yield();
+      stop.store(true);
+      for(size_t i = 0; i < readers.size(); ++i)
+         readers[i].join();
+
+      CHECK(consistent.load());
+      CHECK(collect(tree.preorder()) == model.preorder(0));
+      CHECK(collect(tree.preorder(nodes[model.children(0)[0]])) == model.preorder(model.children(0)[0]));
+
+      tree.reclaim();
+      CHECK(tree.nRetired() == 0);
+
+      // Erasing the root isn't allowed
+      try {
+         tree.erase(tree.root());
+         CHECK(false);
+      }
+      catch(RootNotErasableException&) {}
+   }
+   CHECK(counters.live == 0);
+}
+
+
+// _____________________________________________________________________________
+
+// Writers change branches of a concurrent tree at the same time, each of them
+// ending up with the same branch as its own model
+void concurrentWritersTest() {
+   typedef std::allocator<Stamp> Allocator;
+
+   TreeConcurrent<Stamp> tree(Stamp(0));
+   tree.enableConcurrentWriters();
+   CHECK(tree.concurrentWriters());
+
+   vector<Model> models(4);
+   vector< NodeMap<Allocator> > nodes(4);
+   vector<int> branches;
+   for(int i = 0; i < 4; ++i) {
+      int branch = (i + 1) * 1000000;
+      branches.push_back(branch);
+      models[i].setRoot(branch);
+      nodes[i].add(tree.pushBackChild(tree.root(), Stamp(branch)));
+   }
+
+   atomic<bool> stop(false), consistent(true);
+   atomic<long> nWalks(0);
+   vector<thread> threads;
+   for(int i = 0; i < 2; ++i)
+      threads.push_back(thread(readUntil<Allocator>, std::cref(tree), std::cref(stop), std::ref(consistent), std::ref(nWalks)));
+
+   vector<thread> writers;
+   for(int i = 0; i < 4; ++i)
+      writers.push_back(thread(mutate<Allocator>, std::ref(tree), std::ref(models[i]), std::ref(nodes[i]), branches[i], branches[i] + 1, 1500, 26 + i));
+   for(int i = 0; i < 4; ++i)
+      writers[i].join();
+
+   stop.store(true);
+   for(size_t i = 0; i < threads.size(); ++i)
+      threads[i].join();
+
+   CHECK(consistent.load());
+   CHECK(collect(tree.children(tree.root())) == branches);
+   for(int i = 0; i < 4; ++i)
+      CHECK(collect(tree.preorder(nodes[i][branches[i]])) == models[i].preorder(branches[i]));
+
+   // Back to a single writer
+   tree.disableConcurrentWriters();
+   CHECK(!tree.concurrentWriters());
+   mutate(tree, models[0], nodes[0], branches[0], branches[0] + 100000, 200, 30);
+   CHECK(collect(tree.preorder(nodes[0][branches[0]])) == models[0].preorder(branches[0]));
+
+   tree.reclaim();
+   CHECK(tree.nRetired() == 0);
+}
+
+
+// _____________________________________________________________________________
+
+// Children appended by many threads at once to the same node all make it, each
+// thread's in the order it appended them
+void appendChildTest() {
+   typedef std::allocator<Stamp> Allocator;
+   typedef TreeConcurrent<Stamp>::Node Node;
+
+   TreeConcurrent<Stamp> tree(Stamp(0));
+   tree.pushBackChild(tree.root(), Stamp(1));
+   const Node* shared = tree.pushBackChild(tree.root(), Stamp(2));
+
+   atomic<bool> stop(false), consistent(true);
+   atomic<long> nWalks(0);
+   thread reader(readUntil<Allocator>, std::cref(tree), std::cref(stop), std::ref(consistent), std::ref(nWalks));
+
+   // Every appender also grows a branch of its own under its first child
+   atomic<bool> returned(true);
+   vector<thread> appenders;
+   for(int i = 0; i < 4; ++i) {
+      appenders.push_back(thread([&tree, &returned, shared, i]() {
+         int first = (i + 1) * 1000;
+         const Node* own = tree.appendChild(tree.root(), Stamp(first));
+         for(int j = 1; j < 500; ++j) {
+            const Node* appended = tree.appendChild(j % 2 == 0 ? tree.root() : shared, Stamp(first + j));
+            if(appended->data().id != first + j || appended->parent() != (j % 2 == 0 ? tree.root() : shared))
+               returned.store(false);
+            if(j % 50 == 0)
+               tree.appendChild(own, Stamp(first + j + 100000));
+         }
+      }));
+   }
+   for(int i = 0; i < 4; ++i)
+      appenders[i].join();
+   stop.store(true);
+   reader.join();
+
+   CHECK(consistent.load());
+   CHECK(returned.load());
+
+   // Each appender's children, in the order it appended them
+   vector<int> children = collect(tree.children(tree.root()));
+   children.insert(children.end(), tree.children(shared).begin(), tree.children(shared).end());
+   bool ordered = true;
+   for(int i = 0; i < 4; ++i) {
+      int first = (i + 1) * 1000;
+      vector<int> mine, expected;
+      for(size_t j = 0; j < children.size(); ++j)
+         if(children[j] >= first && children[j] < first + 1000)
+            mine.push_back(children[j]);
+      for(int j = 0; j < 500; ++j)
+         expected.push_back(first + j);
+      vector<int> sorted = mine;
+      sort(sorted.begin(), sorted.end());
+      ordered = ordered && sorted == expected;
+
+      // Children of the root and of the shared node are each in order
+      vector<int> underRoot, underShared;
+      for(size_t j = 0; j < mine.size(); ++j)
+         ((mine[j] - first) % 2 == 0 ? underRoot : underShared).push_back(mine[j]);
+      ordered = ordered && is_sorted(underRoot.begin(), underRoot.end()) && is_sorted(underShared.begin(), underShared.end());
+   }
+   CHECK(ordered);
+   CHECK(children.size() == 2 + 4 * 500);
+
+   // Appended children are regular nodes
+   const Node* own = tree.root()->firstChild();
+   while(own->data().id != 1000)
+      own = own->nextSibling();
+   vector<int> expected;
+   for(int j = 50; j < 500; j += 50)
+      expected.push_back(1000 + j + 100000);
+   CHECK(collect(tree.children(own)) == expected);
+   tree.pushFrontChild(own, Stamp(99));
+   tree.chop(own);
+   CHECK(collect(tree.preorder()).size() == 1 + 2 + 4 * 500 - 1 + 3 * 9);
+}
+
+
+// _____________________________________________________________________________
+
+// Batches coalesce redundant modifications, and many producers end up with the
+// same tree as their models
+void mutationQueueTest() {
+   typedef TreeConcurrent<Stamp>::Node Node;
+
+   {
+      TreeConcurrent<Stamp> tree(Stamp(0));
+      const Node* a = tree.pushBackChild(tree.root(), Stamp(1));
+      tree.pushBackChild(a, Stamp(2));
+      tree.pushBackChild(tree.root(), Stamp(3));
+      TreeMutationQueue<Stamp> queue(tree);
+      CHECK(queue.apply() == 0);
+
+      // The same node erased twice
+      queue.erase(a);
+      queue.erase(a);
+      CHECK(queue.apply() == 2);
+      CHECK(collect(tree.preorder()) == values("0 2 3"));
+      tree.reclaim();
+      CHECK(tree.nRetired() == 0);
+
+      // A node created and erased twice by the same batch is never linked,
+      // and the payloads set on it are dropped
+      const Node* created = queue.pushBackChild(tree.root(), Stamp(4));
+      queue.set(created, Stamp(4, 1));
+      queue.erase(created);
+      queue.erase(created);
+      CHECK(queue.apply() == 4);
+      CHECK(collect(tree.preorder()) == values("0 2 3"));
+      tree.reclaim();
+      CHECK(tree.nRetired() == 0);
+
+      // Only the last payload set on a node is kept
+      const Node* leaf = tree.root()->firstChild();
+      queue.set(leaf, Stamp(5, 1));
+      queue.set(leaf, Stamp(6, 2));
+      unsigned long long version = queue.version();
+      CHECK(queue.apply() == 2);
+      CHECK(queue.version() == version + 2);
+      CHECK(collect(tree.preorder()) == values("0 6 3"));
+      CHECK(tree.root()->firstChild()->data().first == 2);
+
+      // Children of a new node are linked with it, even if it is erased
+      const Node* parent = queue.pushBackChild(tree.root(), Stamp(7));
+      queue.pushBackChild(parent, Stamp(8));
+      queue.pushBackChild(parent, Stamp(9));
+      queue.erase(parent);
+      queue.apply();
+      CHECK(collect(tree.preorder()) == values("0 6 3 8 9"));
+
+      // Nodes inserted before a node whose parent is erased by the same batch
+      // end up before it
+      const Node* erased = tree.pushBackChild(tree.root(), Stamp(12));
+      const Node* position = tree.pushBackChild(erased, Stamp(13));
+      Tree<Stamp> grafted((Stamp(14)));
+      queue.erase(erased);
+      queue.graftAt(tree.root(), position, grafted);
+      queue.apply();
+      CHECK(collect(tree.preorder()) == values("0 6 3 8 9 14 13"));
+      CHECK(position->parent() == tree.root());
+
+      // Modifications that are never applied are discarded
+      queue.pushBackChild(tree.root(), Stamp(10));
+      queue.set(leaf, Stamp(11));
+   }
+
+   TreeConcurrent<Stamp> tree(Stamp(0));
+   TreeMutationQueue<Stamp> queue(tree);
+   vector<Model> models(3);
+   vector<const Node*> branches;
+   for(int i = 0; i < 3; ++i) {
+      int branch = (i + 1) * 1000000;
+      models[i].setRoot(branch);
+      branches.push_back(tree.pushBackChild(tree.root(), Stamp(branch)));
+   }
+
+   // Readers see every batch whole: the branches only ever grow by whole
+   // batches, so a read never sees a stamp half set
+   atomic<bool> stop(false), consistent(true);
+   thread reader([&]() {
+      while(!stop.load()) {
+         queue.read([&]() {
+            for(const Stamp& stamp : tree.preorder())
+               if(stamp.first != stamp.second)
+                  consistent.store(false);
+         });
+      }
+   });
+
+   atomic<int> nProducing(3);
+   vector<thread> producers;
+   for(int i = 0; i < 3; ++i) {
+      producers.push_back(thread([&, i]() {
+         produce(queue, models[i], branches[i], (i + 1) * 1000000 + 1, 2000, 31 + i);
+         nProducing.fetch_sub(1);
+      }));
+   }
+
+   size_t nApplied = 0;
+   while(nProducing.load() > 0) {
+      nApplied += queue.apply();
+      this_thread::yield();
+   }
+   for(int i = 0; i < 3; ++i)
+      producers[i].join();
+   nApplied += queue.apply();
+   stop.store(true);
+   reader.join();
+
+   CHECK(consistent.load());
+   CHECK(nApplied >= 3 * 2000);
+   for(int i = 0; i < 3; ++i)
+      CHECK(collect(tree.preorder(branches[i])) == models[i].preorder((i + 1) * 1000000));
+
+   tree.reclaim();
+   CHECK(tree.nRetired() == 0);
+}
+
+
+// _____________________________________________________________________________
+
+// Threads that wait for tasks running on other threads sleep until they are
+// done, and are always woken up
+void workStealingPoolTest() {
+   TreeWorkStealingPool pool(4);
+
+   // The task is stolen while the spawning thread is away, and waiting for it
+   // takes hardly any CPU time
+   {
+      SlowTask task(300000);
+      TreeExecutor::Group group;
+      pool.spawn(task, group);
+      this_thread::sleep_for(chrono::milliseconds(50));
+      clock_t start = clock();
+      pool.wait(group);
+      double seconds = double(clock() - start) / CLOCKS_PER_SEC;
+      CHECK(task.done.load());
+      CHECK(group.done());
+      CHECK(seconds < 0.1);
+   }
+
+   // Exceptions of stolen tasks are thrown once the rest are done
+   {
+      SlowTask failing(20000, true), first(60000), second(60000);
+      TreeExecutor::Group group;
+      pool.spawn(failing, group);
+      pool.spawn(first, group);
+      pool.spawn(second, group);
+      this_thread::sleep_for(chrono::milliseconds(10));
+      bool thrown = false;
+      try {
+         pool.wait(group);
+      }
+      catch(runtime_error&) {
+         thrown = true;
+      }
+      CHECK(thrown);
+      CHECK(first.done.load() && second.done.load());
+   }
+
+   // Many short groups nested in each other, every wait must end
+   for(int i = 0; i < 20; ++i) {
+      atomic<long> sum(0);
+      SumTask task(pool, 0, 2000 + i, sum);
+      TreeExecutor::Group group;
+      pool.spawn(task, group);
+      pool.wait(group);
+      CHECK(sum.load() == long(2000 + i) * (2000 + i - 1) / 2);
+   }
+}
+
+
+// *****************************************************************************
+//                                    MAIN
+// *****************************************************************************
+
+// Some examples of how to use a Tree structure
+int main(int argc, char** argv) {
+   // Build the tree example found in wikipedia -> http://en.wikipedia.org/wiki/Binary_tree
+   Tree<int> tree = wikipediaTree();
+   Tree<int> tree2 = tree;
+
+   Tree<int>::PreOrderIterator eraseIt, graftIt;
+
+   eraseIt = tree.preBegin(); // Root Node 2
+   eraseIt = eraseIt.firstChild(); // Node 7
+   graftIt = eraseIt.firstChild(); // Node 2
+   eraseIt = eraseIt.nextChild(); // Node 6
+
+   //chopTest(tree, eraseIt);
+   //eraseTest(tree, eraseIt);
+   //graftBackTest(tree, tree2, graftIt);
+
+   allocatorTest();
+   arenaTest();
+   poolTest();
+   relayoutTest();
+   coldPayloadTest();
+   cursorTest();
+   subtreeRangeTest();
+   depthLimitTest();
+   leafTest();
+   standardIteratorTest();
+   prefetchTest();
+   interleaverTest();
+   reverseTest();
+   ancestorTest();
+   eulerTourTest();
+   parallelForEachTest();
+   parallelReduceTest();
+   parallelTransformTest();
+   parallelContractTest();
+   parallelScanTest();
+   concurrentTreeTest();
+   concurrentWritersTest();
+   appendChildTest();
+   mutationQueueTest();
+   workStealingPoolTest();
 
-   return 0;
+   return nFailures == 0 ? 0 : 1;
 }
\ No newline at end of file
@@ -0,0 +1,117 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version. This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details. You should have received a copy of the GNU
+ * General Public License along with this program; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ * USA.
+ *
+ * Copyright © 2011-2012 Francisco Aisa Garcia
+ */
+
+
+#include "TreeArena.h"
+
+namespace {
+   /** Space reserved at the beginning of every block for its header. */
+   const std::size_t HEADER_SIZE = 2 * sizeof(void*) > sizeof(long double) ? 2 * sizeof(void*) : sizeof(long double);
+}
+
+//______________________________________________________________________________
+
+TreeArena::TreeArena(std::size_t blockSize) :
+   _head(NULL),
+   _cursor(NULL),
+   _end(NULL),
+   _blockSize(blockSize),
+   _bytesAllocated(0),
+   _nBlocks(0)
+{
+   // Nothing to do
+}
+
+//______________________________________________________________________________
+
+TreeArena::~TreeArena() {
+   while(_head != NULL) {
+      Block* next = _head->next;
+      ::operator delete(_head);
+      _head = next;
+   }
+}
+
+//______________________________________________________________________________
+
+void* TreeArena::allocate(std::size_t size, std::size_t alignment) {
+   // Padding needed to align the cursor
+   std::size_t padding = (alignment - reinterpret_cast<std::size_t>(_cursor) % alignment) % alignment;
+
+   if(_cursor == NULL || padding + size > static_cast<std::size_t>(_end - _cursor)) {
+      // Big requests get a block of their own so that the current one can
+      // still be used by the smaller ones
+      if(size + alignment > _blockSize / 4 && _head != NULL) {
+         char* memory = newBlock(size + alignment, false);
+         padding = (alignment - reinterpret_cast<std::size_t>(memory) % alignment) % alignment;
+         _bytesAllocated += padding + size;
+
+         return memory + padding;
+      }
+
+      std::size_t blockSize = size + alignment > _blockSize ? size + alignment : _blockSize;
+      newBlock(blockSize, true);
+      padding = (alignment - reinterpret_cast<std::size_t>(_cursor) % alignment) % alignment;
+   }
+
+   char* memory = _cursor + padding;
+   _cursor = memory + size;
+   _bytesAllocated += padding + size;
+
+   return memory;
+}
+
+//______________________________________________________________________________
+
+void TreeArena::release() {
+   if(_head == NULL)
+      return;
+
+   // Keep the oldest block, deallocate the rest of them
+   while(_head->next != NULL) {
+      Block* next = _head->next;
+      ::operator delete(_head);
+      _head = next;
+      --_nBlocks;
+   }
+
+   _cursor = reinterpret_cast<char*>(_head) + HEADER_SIZE;
+   _end = reinterpret_cast<char*>(_head) + _head->size;
+   _bytesAllocated = 0;
+}
+
+//______________________________________________________________________________
+
+char* TreeArena::newBlock(std::size_t size, bool makeCurrent) {
+   // Throws std::bad_alloc if memory allocation fails, the arena is left untouched
+   Block* block = static_cast<Block*>(::operator new(HEADER_SIZE + size));
+   block->size = HEADER_SIZE + size;
+   ++_nBlocks;
+
+   char* memory = reinterpret_cast<char*>(block) + HEADER_SIZE;
+   if(makeCurrent) {
+      block->next = _head;
+      _head = block;
+      _cursor = memory;
+      _end = reinterpret_cast<char*>(block) + block->size;
+   }
+   else {
+      // Link it behind the current block, which keeps serving small requests
+      block->next = _head->next;
+      _head->next = block;
+   }
+
+   return memory;
+}
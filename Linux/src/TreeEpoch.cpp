@@ -0,0 +1,131 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version. This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details. You should have received a copy of the GNU
+ * General Public License along with this program; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ * USA.
+ *
+ * Copyright © 2011-2012 Francisco Aisa Garcia
+ */
+
+
+#include "TreeEpoch.h"
+#include <cstddef>
+#include <thread>
+
+// Records are padded to a cache line, so that readers announcing themselves
+// don't slow down each other
+struct alignas(64) TreeEpoch::Record {
+   /** Epoch the thread started reading in, 0 if it isn't reading. */
+   std::atomic<unsigned long long> epoch;
+
+   /** Whether a thread owns the record. */
+   std::atomic<bool> used;
+
+   /** Number of nested guards of the owner. */
+   unsigned int nesting;
+
+   /** Next record of the list. */
+   Record* next;
+};
+
+struct TreeEpoch::Owner {
+   /** Give the record back. */
+   ~Owner() {
+      if(record != NULL) {
+         record->nesting = 0;
+         record->epoch.store(0, std::memory_order_release);
+         record->used.store(false, std::memory_order_release);
+      }
+   }
+
+   /** Record owned, NULL until the thread reads for the first time. */
+   Record* record;
+};
+
+std::atomic<unsigned long long> TreeEpoch::_epoch(1);
+std::atomic<TreeEpoch::Record*> TreeEpoch::_records(NULL);
+thread_local TreeEpoch::Owner TreeEpoch::_owner = {NULL};
+
+//______________________________________________________________________________
+
+void TreeEpoch::enter() {
+   Record& record = local();
+   if(record.nesting++ > 0)
+      return;
+
+   // The fence orders the announcement before any read of the tree, against
+   // the fence of oldest(): either the writer sees the announcement, or the
+   // reader sees what the writer unlinked before looking
+   record.epoch.store(_epoch.load(std::memory_order_acquire), std::memory_order_relaxed);
+   std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+//______________________________________________________________________________
+
+void TreeEpoch::leave() {
+   Record& record = local();
+   if(--record.nesting == 0)
+      record.epoch.store(0, std::memory_order_release);
+}
+
+//______________________________________________________________________________
+
+unsigned long long TreeEpoch::advance() {
+   return _epoch.fetch_add(1, std::memory_order_acq_rel);
+}
+
+//______________________________________________________________________________
+
+void TreeEpoch::synchronize() {
+   unsigned long long tag = advance();
+   while(oldest() <= tag)
+      std::this_thread::yield();
+}
+
+//______________________________________________________________________________
+
+unsigned long long TreeEpoch::oldest() {
+   std::atomic_thread_fence(std::memory_order_seq_cst);
+
+   unsigned long long result = ~0ULL;
+   for(Record* record = _records.load(std::memory_order_acquire); record != NULL; record = record->next) {
+      unsigned long long started = record->epoch.load(std::memory_order_acquire);
+      if(started != 0 && started < result)
+         result = started;
+   }
+
+   return result;
+}
+
+//______________________________________________________________________________
+
+TreeEpoch::Record& TreeEpoch::local() {
+   if(_owner.record != NULL)
+      return *_owner.record;
+
+   // Records of threads that have ended are reused, so the list only grows
+   // up to the number of threads reading at once
+   for(Record* record = _records.load(std::memory_order_acquire); record != NULL; record = record->next) {
+      bool expected = false;
+      if(!record->used.load(std::memory_order_relaxed) && record->used.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+         _owner.record = record;
+         return *record;
+      }
+   }
+
+   Record* record = new Record();
+   record->epoch.store(0, std::memory_order_relaxed);
+   record->used.store(true, std::memory_order_relaxed);
+   record->nesting = 0;
+   record->next = _records.load(std::memory_order_relaxed);
+   while(!_records.compare_exchange_weak(record->next, record, std::memory_order_release, std::memory_order_relaxed));
+
+   _owner.record = record;
+   return *record;
+}
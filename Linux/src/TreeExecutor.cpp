@@ -0,0 +1,60 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version. This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details. You should have received a copy of the GNU
+ * General Public License along with this program; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ * USA.
+ *
+ * Copyright © 2011-2012 Francisco Aisa Garcia
+ */
+
+
+#include "TreeExecutor.h"
+#include "TreeWorkStealingPool.h"
+
+std::atomic<TreeExecutor*> TreeExecutor::_global(NULL);
+
+//______________________________________________________________________________
+
+TreeExecutor& TreeExecutor::global() {
+   TreeExecutor* executor = _global.load(std::memory_order_acquire);
+   return executor != NULL ? *executor : TreeWorkStealingPool::global();
+}
+
+//______________________________________________________________________________
+
+void TreeExecutor::setGlobal(TreeExecutor* executor) {
+   _global.store(executor, std::memory_order_release);
+}
+
+//______________________________________________________________________________
+
+bool TreeExecutor::runTask(Task& task) {
+   // The task may be destroyed as soon as its group is done
+   Group* group = task._group;
+   try {
+      task.execute();
+   }
+   catch(...) {
+      if(!group->_failed.exchange(true))
+         group->_error = std::current_exception();
+   }
+
+   return group->_pending.fetch_sub(1) == 1;
+}
+
+//______________________________________________________________________________
+
+void TreeExecutor::finish(Group& group) {
+   if(group._failed.load(std::memory_order_acquire)) {
+      std::exception_ptr error = group._error;
+      group._error = std::exception_ptr();
+      group._failed.store(false, std::memory_order_relaxed);
+      std::rethrow_exception(error);
+   }
+}
@@ -0,0 +1,171 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version. This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details. You should have received a copy of the GNU
+ * General Public License along with this program; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ * USA.
+ *
+ * Copyright © 2011-2012 Francisco Aisa Garcia
+ */
+
+
+#include "TreePool.h"
+
+namespace {
+   /**
+    * Whether the pool of the calling thread has been destroyed. It is trivially
+    * destructible, so it can still be read after the pool is gone.
+    */
+   thread_local bool localDestroyed = false;
+
+   /** Owner of the pool of a thread, it flags the pool as destroyed. */
+   struct LocalPool {
+      ~LocalPool() {
+         localDestroyed = true;
+      }
+
+      TreePool pool;
+   };
+
+   /** Pool of the calling thread. */
+   thread_local LocalPool localPool;
+
+#if defined(__STDCPP_DEFAULT_NEW_ALIGNMENT__)
+   /** Alignment of the blocks given by the global operator new. */
+   const std::size_t NEW_ALIGNMENT = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+#else
+   const std::size_t NEW_ALIGNMENT = alignof(std::max_align_t);
+#endif
+
+   /** Get a block from the system, aligned to 'alignment'. */
+   void* newBlock(std::size_t size, std::size_t alignment) {
+#if defined(__cpp_aligned_new)
+      if(alignment > NEW_ALIGNMENT)
+         return ::operator new(size, std::align_val_t(alignment));
+#endif
+      return ::operator new(size);
+   }
+
+   /** Give a block allocated by newBlock() back to the system. */
+   void deleteBlock(void* block, std::size_t alignment) {
+#if defined(__cpp_aligned_new)
+      if(alignment > NEW_ALIGNMENT) {
+         ::operator delete(block, std::align_val_t(alignment));
+         return;
+      }
+#endif
+      ::operator delete(block);
+   }
+}
+
+//______________________________________________________________________________
+
+TreePool::TreePool(std::size_t cap) :
+   _cap(cap),
+   _nFree(0),
+   _nAllocations(0),
+   _nReused(0),
+   _nRecycled(0)
+{
+   for(std::size_t i = 0; i < N_CLASSES; ++i)
+      _free[i] = NULL;
+}
+
+//______________________________________________________________________________
+
+TreePool::~TreePool() {
+   shrink();
+}
+
+//______________________________________________________________________________
+
+void* TreePool::allocate(std::size_t size, std::size_t alignment) {
+   ++_nAllocations;
+
+   // Recycled blocks are only as aligned as the global operator new makes them
+   std::size_t index = sizeClass(size);
+   if(index == N_CLASSES || alignment > NEW_ALIGNMENT)
+      return newBlock(size, alignment);
+
+   // Reuse a recycled block if there is one
+   if(_free[index] != NULL) {
+      FreeBlock* block = _free[index];
+      _free[index] = block->next;
+      --_nFree;
+      ++_nReused;
+
+      return block;
+   }
+
+   // Blocks are allocated with the size of their class, so that any block of
+   // the class can serve any request of the class
+   return ::operator new((index + 1) * GRANULARITY);
+}
+
+//______________________________________________________________________________
+
+void TreePool::deallocate(void* block, std::size_t size, std::size_t alignment) {
+   std::size_t index = sizeClass(size);
+   if(index == N_CLASSES || alignment > NEW_ALIGNMENT || _nFree >= _cap) {
+      deleteBlock(block, alignment);
+      return;
+   }
+
+   FreeBlock* freeBlock = static_cast<FreeBlock*>(block);
+   freeBlock->next = _free[index];
+   _free[index] = freeBlock;
+   ++_nFree;
+   ++_nRecycled;
+}
+
+//______________________________________________________________________________
+
+void TreePool::shrink() {
+   trim(0);
+}
+
+//______________________________________________________________________________
+
+void TreePool::setCap(std::size_t cap) {
+   _cap = cap;
+   trim(cap);
+}
+
+//______________________________________________________________________________
+
+TreePool& TreePool::local() {
+   return localPool.pool;
+}
+
+//______________________________________________________________________________
+
+void* TreePool::allocateLocal(std::size_t size, std::size_t alignment) {
+   return localDestroyed ? newBlock(size, alignment) : localPool.pool.allocate(size, alignment);
+}
+
+//______________________________________________________________________________
+
+void TreePool::deallocateLocal(void* block, std::size_t size, std::size_t alignment) {
+   if(localDestroyed)
+      deleteBlock(block, alignment);
+   else
+      localPool.pool.deallocate(block, size, alignment);
+}
+
+//______________________________________________________________________________
+
+void TreePool::trim(std::size_t n) {
+   for(std::size_t i = 0; i < N_CLASSES && _nFree > n; ++i) {
+      while(_free[i] != NULL && _nFree > n) {
+         FreeBlock* next = _free[i]->next;
+         ::operator delete(_free[i]);
+         _free[i] = next;
+         --_nFree;
+      }
+   }
+}
@@ -0,0 +1,307 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version. This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details. You should have received a copy of the GNU
+ * General Public License along with this program; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+ * USA.
+ *
+ * Copyright © 2011-2012 Francisco Aisa Garcia
+ */
+
+
+#include "TreeWorkStealingPool.h"
+#include <deque>
+#include <functional>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// Deques are padded to a cache line, so that workers taking tasks from their
+// own deque don't slow down each other
+struct alignas(64) TreeWorkStealingPool::Worker {
+   /** Mutex that guards the deque. */
+   std::mutex mutex;
+
+   /** Tasks waiting to be run, the newest ones at the back. */
+   std::deque<Task*> tasks;
+};
+
+namespace {
+   /** Pool the calling thread is a worker of, if any. */
+   thread_local TreeWorkStealingPool* currentPool = NULL;
+
+   /** Index of the calling thread in 'currentPool'. */
+   thread_local unsigned int currentWorker = 0;
+
+   /** Number of tasks running in the stack of the calling thread. */
+   thread_local unsigned int nesting = 0;
+
+   /** State of the generator that picks the victims of the calling thread. */
+   thread_local unsigned int victimSeed = 0;
+
+   /** Get the next victim to steal from (xorshift). */
+   unsigned int nextVictim() {
+      if(victimSeed == 0)
+         victimSeed = static_cast<unsigned int>(std::hash<std::thread::id>()(std::this_thread::get_id())) | 1;
+
+      victimSeed ^= victimSeed << 13;
+      victimSeed ^= victimSeed >> 17;
+      victimSeed ^= victimSeed << 5;
+      return victimSeed;
+   }
+}
+
+//______________________________________________________________________________
+
+TreeWorkStealingPool::TreeWorkStealingPool(unsigned int nThreads, const std::vector<unsigned int>& cores) :
+   _workers(NULL),
+   _nWorkers(0),
+   _cores(cores),
+   _nQueued(0),
+   _nIdle(0),
+   _nSleeping(0),
+   _stop(false)
+{
+   if(nThreads == 0)
+      nThreads = std::thread::hardware_concurrency();
+
+   _nWorkers = nThreads > 1 ? nThreads - 1 : 0;
+   _workers = new Worker[_nWorkers + 1];
+
+   _threads.reserve(_nWorkers);
+   for(unsigned int i = 0; i < _nWorkers; ++i)
+      _threads.push_back(std::thread(&TreeWorkStealingPool::work, this, i));
+}
+
+//______________________________________________________________________________
+
+TreeWorkStealingPool::~TreeWorkStealingPool() {
+   {
+      std::lock_guard<std::mutex> lock(_sleepMutex);
+      _stop.store(true);
+   }
+   _wakeUp.notify_all();
+
+   for(std::size_t i = 0; i < _threads.size(); ++i)
+      _threads[i].join();
+
+   delete[] _workers;
+}
+
+//______________________________________________________________________________
+
+void TreeWorkStealingPool::spawn(Task& task, Group& group) {
+   bind(task, group);
+
+   Worker& worker = local();
+   {
+      std::lock_guard<std::mutex> lock(worker.mutex);
+      worker.tasks.push_back(&task);
+   }
+
+   // A worker going to sleep checks _nQueued after announcing itself, so either
+   // it sees the task or it is seen here
+   _nQueued.fetch_add(1);
+   if(_nSleeping.load() > 0) {
+      std::lock_guard<std::mutex> lock(_sleepMutex);
+      _wakeUp.notify_one();
+   }
+}
+
+//______________________________________________________________________________
+
+void TreeWorkStealingPool::wait(Group& group) {
+   bool idle = false;
+   unsigned int nRounds = 0;
+   while(!group.done()) {
+      Task* task = take();
+      if(task != NULL) {
+         if(idle) {
+            _nIdle.fetch_sub(1, std::memory_order_relaxed);
+            idle = false;
+         }
+
+         nRounds = 0;
+         run(task);
+      }
+      else {
+         // The tasks of the group are being run by other threads
+         if(!idle) {
+            _nIdle.fetch_add(1, std::memory_order_relaxed);
+            idle = true;
+         }
+
+         if(nRounds < SPIN_ROUNDS) {
+            ++nRounds;
+            std::this_thread::yield();
+            continue;
+         }
+
+         // They take long, so sleep like the workers do until the last one is
+         // done or there are tasks to help with. The thread that runs the last
+         // one checks _nSleeping after the group is done, so either the group
+         // is seen done here or it wakes us up
+         std::unique_lock<std::mutex> lock(_sleepMutex);
+         _nSleeping.fetch_add(1);
+         while(!group.done() && _nQueued.load() == 0)
+            _wakeUp.wait(lock);
+         _nSleeping.fetch_sub(1);
+         nRounds = 0;
+      }
+   }
+
+   if(idle)
+      _nIdle.fetch_sub(1, std::memory_order_relaxed);
+
+   finish(group);
+}
+
+//______________________________________________________________________________
+
+unsigned int TreeWorkStealingPool::concurrency() const {
+   return _nWorkers + 1;
+}
+
+//______________________________________________________________________________
+
+bool TreeWorkStealingPool::hungry() const {
+   return mayWait() && _nIdle.load(std::memory_order_relaxed) > 0;
+}
+
+//______________________________________________________________________________
+
+bool TreeWorkStealingPool::mayWait() const {
+   return nesting < MAX_NESTING;
+}
+
+//______________________________________________________________________________
+
+TreeWorkStealingPool& TreeWorkStealingPool::global() {
+   static TreeWorkStealingPool pool;
+   return pool;
+}
+
+//______________________________________________________________________________
+
+void TreeWorkStealingPool::work(unsigned int index) {
+   currentPool = this;
+   currentWorker = index;
+   pin(index);
+
+   while(true) {
+      Task* task = take();
+      if(task != NULL) {
+         run(task);
+         continue;
+      }
+
+      _nIdle.fetch_add(1, std::memory_order_relaxed);
+      for(unsigned int i = 0; i < SPIN_ROUNDS && task == NULL; ++i) {
+         std::this_thread::yield();
+         task = take();
+      }
+
+      if(task == NULL) {
+         std::unique_lock<std::mutex> lock(_sleepMutex);
+         _nSleeping.fetch_add(1);
+         while(!_stop.load() && _nQueued.load() == 0)
+            _wakeUp.wait(lock);
+         _nSleeping.fetch_sub(1);
+      }
+      _nIdle.fetch_sub(1, std::memory_order_relaxed);
+
+      if(task != NULL)
+         run(task);
+      else if(_stop.load() && _nQueued.load() == 0)
+         return;
+   }
+}
+
+//______________________________________________________________________________
+
+void TreeWorkStealingPool::pin(unsigned int index) {
+   if(_cores.empty())
+      return;
+
+#if defined(__linux__)
+   unsigned int core = _cores[index % _cores.size()];
+   if(core >= CPU_SETSIZE)
+      return;
+
+   // A core that doesn't exist or isn't allowed makes the call fail, and the
+   // worker keeps running wherever it was allowed to
+   cpu_set_t set;
+   CPU_ZERO(&set);
+   CPU_SET(core, &set);
+   pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+   (void) index;
+#endif
+}
+
+//______________________________________________________________________________
+
+TreeWorkStealingPool::Worker& TreeWorkStealingPool::local() {
+   return currentPool == this ? _workers[currentWorker] : _workers[_nWorkers];
+}
+
+//______________________________________________________________________________
+
+TreeWorkStealingPool::Task* TreeWorkStealingPool::take() {
+   Task* task = NULL;
+
+   // The newest task of our own deque first...
+   Worker& own = local();
+   {
+      std::lock_guard<std::mutex> lock(own.mutex);
+      if(!own.tasks.empty()) {
+         task = own.tasks.back();
+         own.tasks.pop_back();
+      }
+   }
+
+   if(task == NULL && _nQueued.load() == 0)
+      return NULL;
+
+   // ...or else the oldest task of any other deque
+   unsigned int nDeques = _nWorkers + 1;
+   unsigned int first = nextVictim() % nDeques;
+   for(unsigned int i = 0; i < nDeques && task == NULL; ++i) {
+      Worker& victim = _workers[(first + i) % nDeques];
+      if(&victim == &own)
+         continue;
+
+      std::lock_guard<std::mutex> lock(victim.mutex);
+      if(!victim.tasks.empty()) {
+         task = victim.tasks.front();
+         victim.tasks.pop_front();
+      }
+   }
+
+   if(task != NULL)
+      _nQueued.fetch_sub(1);
+
+   return task;
+}
+
+//______________________________________________________________________________
+
+void TreeWorkStealingPool::run(Task* task) {
+   ++nesting;
+   bool last = runTask(*task);
+   --nesting;
+
+   // The thread waiting for the group may be sleeping. Workers woken up as well
+   // go back to sleep if there aren't any tasks
+   if(last && _nSleeping.load() > 0) {
+      std::lock_guard<std::mutex> lock(_sleepMutex);
+      _wakeUp.notify_all();
+   }
+}